@@ -0,0 +1,70 @@
+#!/bin/sh
+#
+#		batch_scaling.sh
+#		LUMEN LANGUAGE PROJECT
+#		Rainy101112 - 2025/7/20
+#
+# Measures how `lumen batch` throughput scales with the number of worker
+# threads. Generates a corpus of synthetic files once, then compiles it with
+# -j 1, 2, 4, ... up to the processor count and prints a CSV scaling curve:
+#
+#	threads,seconds,files_per_second,mib_per_second,speedup
+#
+# Usage: bench/batch_scaling.sh [lumen binary] [file count] [statements per file]
+
+LUMEN=${1:-./lumen}
+FILES=${2:-2000}
+STATEMENTS=${3:-400}
+CORPUS=${TMPDIR:-/tmp}/lumen-batch-corpus-$FILES-$STATEMENTS
+CPUS=$(getconf _NPROCESSORS_ONLN 2>/dev/null || echo 1)
+
+if [ ! -d "$CORPUS" ]; then
+	mkdir -p "$CORPUS" || exit 1
+	awk -v files="$FILES" -v statements="$STATEMENTS" -v dir="$CORPUS" 'BEGIN {
+		srand(42)
+		for (f = 0; f < files; f++) {
+			path = sprintf("%s/f%06d.lumen", dir, f)
+			print "{" > path
+			for (s = 0; s < statements; s++) {
+				v = sprintf("v%d", int(rand() * 64))
+				if (s % 40 == 39) {
+					printf "  for (i = 0; i < %d; i = i + 1) { %s = %s + i * 2; }\n", int(rand() * 100), v, v > path
+				} else {
+					printf "  %s = %s + %d * (w%d - %d) / 3;\n", v, v, s, int(rand() * 16), int(rand() * 9) > path
+				}
+			}
+			print "}" > path
+			close(path)
+		}
+	}'
+fi
+
+ls "$CORPUS"/*.lumen > "$CORPUS.list"
+
+echo "threads,seconds,files_per_second,mib_per_second,speedup"
+threads=1
+base=""
+while [ "$threads" -le "$CPUS" ]; do
+	# Best of three, to keep page cache and scheduling noise out of the curve
+	best=""
+	for run in 1 2 3; do
+		line=$("$LUMEN" batch -j "$threads" --compile --summary --files-from "$CORPUS.list" 2>&1 >/dev/null | grep "MiB in")
+		seconds=$(echo "$line" | awk '{ print $4 }')
+		if [ -z "$best" ] || awk -v a="$seconds" -v b="$best" 'BEGIN { exit !(a < b) }'; then
+			best=$seconds
+			best_line=$line
+		fi
+	done
+
+	[ -z "$base" ] && base=$best
+	echo "$best_line" | awk -v t="$threads" -v base="$base" -v s="$best" '{
+		gsub(/[:,]/, "")
+		printf "%d,%s,%s,%s,%.2f\n", t, s, $9, $11, base / s
+	}'
+
+	if [ "$threads" -lt "$CPUS" ] && [ $((threads * 2)) -gt "$CPUS" ]; then
+		threads=$CPUS
+	else
+		threads=$((threads * 2))
+	fi
+done
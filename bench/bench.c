@@ -0,0 +1,428 @@
+/*
+ *
+ *		bench.c
+ *		LUMEN LANGUAGE PROJECT
+ *		Rainy101112 - 2025/7/20
+ *
+ */
+
+/*
+ * Front-end benchmark. Generates deterministic scripts of a given size in
+ * one of several shapes and measures, over repeated runs:
+ *
+ *   lex      get_next_token over the whole script      tokens/s, MiB/s
+ *   parse    parse() into an arena                      nodes/s, bytes/node
+ *   stream   token_stream_fill alone, then parse_stream on its tokens
+ *   heap     parse() onto the heap, then free_ast       both times
+ *   print    print_ast with stdout sent to /dev/null    time
+ *   dump     dump_ast as S-expression and as JSON, the same way
+ *
+ * Results are medians (with min and max) and are printed as JSON, one
+ * object per shape, or as a table with --text.
+ *
+ * Usage: lumen_bench [--shape all|deep|long|expr|ident] [--size bytes]
+ *                    [--runs n] [--seed n] [--text] [--generate]
+ */
+
+#include <arena.h>
+#include <ast.h>
+#include <diag.h>
+#include <dump.h>
+#include <fcntl.h>
+#include <lexer.h>
+#include <print.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <symbol.h>
+#include <visit.h>
+#include <time.h>
+#include <unistd.h>
+
+typedef enum {
+	SHAPE_DEEP,
+	SHAPE_LONG,
+	SHAPE_EXPR,
+	SHAPE_IDENT,
+
+	SHAPE_COUNT
+} shape_t;
+
+static const char *shape_names[SHAPE_COUNT] = {
+	[SHAPE_DEEP] = "deep",
+	[SHAPE_LONG] = "long",
+	[SHAPE_EXPR] = "expr",
+	[SHAPE_IDENT] = "ident"
+};
+
+/*
+ * Generator
+ */
+
+typedef struct {
+	char *text;
+	size_t length;
+	size_t capacity;
+	uint64_t rng;
+} script;
+
+// xorshift64*, so scripts are identical on every platform for a seed
+static uint32_t next_random(script *s) {
+	s->rng ^= s->rng >> 12;
+	s->rng ^= s->rng << 25;
+	s->rng ^= s->rng >> 27;
+	return (uint32_t)((s->rng * 0x2545F4914F6CDD1Dull) >> 32);
+}
+
+static void append(script *s, const char *format, ...) __attribute__((format(printf, 2, 3)));
+
+static void append(script *s, const char *format, ...) {
+	for (;;) {
+		va_list args;
+		va_start(args, format);
+		int written = vsnprintf(s->text + s->length, s->capacity - s->length, format, args);
+		va_end(args);
+
+		if (written >= 0 && (size_t)written < s->capacity - s->length) {
+			s->length += (size_t)written;
+			return;
+		}
+
+		s->capacity *= 2;
+		s->text = realloc(s->text, s->capacity);
+		if (!s->text) {
+			fprintf(stderr, "Memory allocate failed at %s:%d", __FILE__, __LINE__);
+			exit(1);
+		}
+	}
+}
+
+static void simple_statement(script *s, int indent) {
+	append(s, "%*sv%u = v%u + %u * (w%u - %u);\n", indent, "",
+		next_random(s) % 16, next_random(s) % 16, next_random(s) % 100, next_random(s) % 8, next_random(s) % 10);
+}
+
+// Nested if/while/for chains 64 levels deep, repeated
+static void generate_deep(script *s, size_t size) {
+	while (s->length < size) {
+		int depth = 64;
+		for (int level = 0; level < depth; level++) {
+			switch (level % 3) {
+				case 0: append(s, "%*sif (v%u < %u) {\n", level * 2 + 2, "", next_random(s) % 16, next_random(s) % 100); break;
+				case 1: append(s, "%*swhile (v%u > %u) {\n", level * 2 + 2, "", next_random(s) % 16, next_random(s) % 100); break;
+				default: append(s, "%*sfor (i = 0; i < %u; i = i + 1) {\n", level * 2 + 2, "", next_random(s) % 100); break;
+			}
+			simple_statement(s, level * 2 + 4);
+		}
+		for (int level = depth - 1; level >= 0; level--) append(s, "%*s}\n", level * 2 + 2, "");
+	}
+}
+
+// One flat block of short statements
+static void generate_long(script *s, size_t size) {
+	while (s->length < size) simple_statement(s, 2);
+}
+
+// Few statements, each a long operator chain with parentheses
+static void generate_expr(script *s, size_t size) {
+	static const char operators[] = "+-*/<>";
+
+	while (s->length < size) {
+		append(s, "  x%u = a", next_random(s) % 8);
+		for (int term = 0; term < 200; term++) {
+			char op = operators[next_random(s) % (term % 10 == 9 ? 6 : 4)];
+			if (next_random(s) % 8 == 0) {
+				append(s, " %c (b%u * %u + c)", op, next_random(s) % 8, next_random(s) % 1000);
+			} else {
+				append(s, " %c %s%u", op, next_random(s) % 2 ? "v" : "", next_random(s) % 1000);
+			}
+		}
+		append(s, ";\n");
+	}
+}
+
+// Thousands of distinct, long identifiers
+static void generate_ident(script *s, size_t size) {
+	while (s->length < size) {
+		append(s, "  configuration_value_%u_%u = previous_total_%u + accumulated_offset_%u;\n",
+			next_random(s) % 4096, next_random(s) % 64, next_random(s) % 4096, next_random(s) % 4096);
+	}
+}
+
+static script generate(shape_t shape, size_t size, uint64_t seed) {
+	script s = {
+		.capacity = size + 4096,
+		.rng = seed ? seed : 1
+	};
+	s.text = malloc(s.capacity);
+	if (!s.text) {
+		fprintf(stderr, "Memory allocate failed at %s:%d", __FILE__, __LINE__);
+		exit(1);
+	}
+	s.text[0] = '\0';
+
+	append(&s, "{\n");
+	switch (shape) {
+		case SHAPE_DEEP: generate_deep(&s, size); break;
+		case SHAPE_LONG: generate_long(&s, size); break;
+		case SHAPE_EXPR: generate_expr(&s, size); break;
+		default: generate_ident(&s, size); break;
+	}
+	append(&s, "}\n");
+	return s;
+}
+
+/*
+ * Measurement
+ */
+
+typedef struct {
+	double *samples;
+	int count;
+} timing;
+
+static double now_seconds(void) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+static int compare_doubles(const void *a, const void *b) {
+	double x = *(const double *)a, y = *(const double *)b;
+	return (x > y) - (x < y);
+}
+
+static double median(timing *t) {
+	qsort(t->samples, t->count, sizeof(double), compare_doubles);
+	if (t->count % 2) return t->samples[t->count / 2];
+	return (t->samples[t->count / 2 - 1] + t->samples[t->count / 2]) / 2;
+}
+
+static ast_visit_action count_node(ast_node *node, const ast_visit_position *at, void *context) {
+	(void)node;
+	(void)at;
+	(*(uint64_t *)context)++;
+	return AST_VISIT_CONTINUE;
+}
+
+static uint64_t count_nodes(ast_node *node) {
+	static const ast_visitor visitor = { count_node, NULL };
+	uint64_t total = 0;
+	ast_visit(node, &visitor, &total);
+	return total;
+}
+
+typedef struct {
+	size_t bytes;
+	uint64_t tokens;
+	uint64_t nodes;
+	size_t arena_bytes;
+
+	timing lex;
+	timing lex_stream;
+	timing parse;
+	timing parse_stream;
+	timing heap_parse;
+	timing free;
+	timing print;
+	timing sexpr;
+	timing json;
+} result;
+
+static void measure(const script *s, int runs, result *r) {
+	timing *all[] = { &r->lex, &r->lex_stream, &r->parse, &r->parse_stream, &r->heap_parse, &r->free, &r->print, &r->sexpr, &r->json };
+	for (size_t i = 0; i < sizeof(all) / sizeof(*all); i++) {
+		all[i]->samples = calloc(runs, sizeof(double));
+		all[i]->count = runs;
+	}
+	r->bytes = s->length;
+
+	int devnull = open("/dev/null", O_WRONLY);
+	int saved_stdout = dup(STDOUT_FILENO);
+
+	// Run -1 is a warm-up that interns every name and faults in the pages
+	for (int run = -1; run < runs; run++) {
+		double start = now_seconds();
+		size_t index = 0;
+		uint64_t tokens = 0;
+		while (get_next_token(s->text, &index).type != TOKEN_END_OF_FILE) tokens++;
+		double lexed = now_seconds();
+
+		arena_t *arena = arena_create(0);
+		ast_node *tree = parse(s->text, arena);
+		double parsed = now_seconds();
+		r->nodes = count_nodes(tree);
+		r->arena_bytes = arena_bytes_used(arena);
+		arena_reset(arena);
+
+		double stream_start = now_seconds();
+		token_stream stream;
+		token_stream_init(&stream, s->text, 0);
+		token_stream_fill(&stream, SIZE_MAX, 0);
+		double streamed = now_seconds();
+		parse_stream(&stream, arena);
+		double stream_parsed = now_seconds();
+		token_stream_free(&stream);
+		arena_destroy(arena);
+
+		double heap_start = now_seconds();
+		ast_node *heap_tree = parse(s->text, NULL);
+		double heap_parsed = now_seconds();
+
+		fflush(stdout);
+		dup2(devnull, STDOUT_FILENO);
+		double print_start = now_seconds();
+		print_ast(heap_tree, 0);
+		fflush(stdout);
+		double printed = now_seconds();
+		dump_ast(stdout, heap_tree, DUMP_SEXPR, 0);
+		fflush(stdout);
+		double sexpr_dumped = now_seconds();
+		dump_ast(stdout, heap_tree, DUMP_JSON, 0);
+		fflush(stdout);
+		double json_dumped = now_seconds();
+		dup2(saved_stdout, STDOUT_FILENO);
+
+		double free_start = now_seconds();
+		free_ast(heap_tree);
+		double freed = now_seconds();
+
+		r->tokens = tokens;
+		if (run < 0) continue;
+		r->lex.samples[run] = lexed - start;
+		r->parse.samples[run] = parsed - lexed;
+		r->lex_stream.samples[run] = streamed - stream_start;
+		r->parse_stream.samples[run] = stream_parsed - streamed;
+		r->heap_parse.samples[run] = heap_parsed - heap_start;
+		r->print.samples[run] = printed - print_start;
+		r->sexpr.samples[run] = sexpr_dumped - printed;
+		r->json.samples[run] = json_dumped - sexpr_dumped;
+		r->free.samples[run] = freed - free_start;
+	}
+
+	close(saved_stdout);
+	close(devnull);
+}
+
+static void print_timing(const char *name, timing *t, int last) {
+	double mid = median(t);
+	printf("    \"%s\": {\"median_s\": %.9f, \"min_s\": %.9f, \"max_s\": %.9f}%s\n",
+		name, mid, t->samples[0], t->samples[t->count - 1], last ? "" : ",");
+}
+
+static void report_json(shape_t shape, result *r, int runs, int last) {
+	double lex = median(&r->lex), parse_time = median(&r->parse);
+
+	printf("  {\n");
+	printf("    \"shape\": \"%s\", \"bytes\": %zu, \"tokens\": %llu, \"nodes\": %llu, \"runs\": %d,\n",
+		shape_names[shape], r->bytes, (unsigned long long)r->tokens, (unsigned long long)r->nodes, runs);
+	printf("    \"tokens_per_s\": %.0f, \"lex_mib_per_s\": %.2f,\n",
+		r->tokens / lex, r->bytes / (1024.0 * 1024.0) / lex);
+	printf("    \"nodes_per_s\": %.0f, \"bytes_per_node\": %.2f,\n",
+		r->nodes / parse_time, r->nodes ? (double)r->arena_bytes / r->nodes : 0.0);
+	print_timing("lex", &r->lex, 0);
+	print_timing("lex_stream", &r->lex_stream, 0);
+	print_timing("parse_arena", &r->parse, 0);
+	print_timing("parse_stream", &r->parse_stream, 0);
+	print_timing("parse_heap", &r->heap_parse, 0);
+	print_timing("free_ast", &r->free, 0);
+	print_timing("print_ast", &r->print, 0);
+	print_timing("dump_sexpr", &r->sexpr, 0);
+	print_timing("dump_json", &r->json, 1);
+	printf("  }%s\n", last ? "" : ",");
+}
+
+static void report_text(shape_t shape, result *r) {
+	double lex = median(&r->lex), parse_time = median(&r->parse);
+
+	printf("%-6s %10zu B %10llu tok %10llu nodes | lex %8.3f ms %7.1f Mtok/s | parse %8.3f ms %6.2f Mnode/s %6.1f B/node"
+		" | stream lex %8.3f ms parse %8.3f ms | heap %8.3f ms | free %8.3f ms | print %8.3f ms | sexpr %8.3f ms | json %8.3f ms\n",
+		shape_names[shape], r->bytes, (unsigned long long)r->tokens, (unsigned long long)r->nodes,
+		lex * 1e3, r->tokens / lex / 1e6, parse_time * 1e3, r->nodes / parse_time / 1e6,
+		r->nodes ? (double)r->arena_bytes / r->nodes : 0.0,
+		median(&r->lex_stream) * 1e3, median(&r->parse_stream) * 1e3,
+		median(&r->heap_parse) * 1e3, median(&r->free) * 1e3, median(&r->print) * 1e3,
+		median(&r->sexpr) * 1e3, median(&r->json) * 1e3);
+}
+
+static void usage(void) {
+	fprintf(stderr, "Usage: lumen_bench [--shape all|deep|long|expr|ident] [--size bytes] [--runs n] [--seed n] [--text] [--generate]\n");
+}
+
+int main(int argc, char *argv[]) {
+	int first_shape = 0, last_shape = SHAPE_COUNT - 1;
+	size_t size = 4 * 1024 * 1024;
+	int runs = 7, text = 0, generate_only = 0;
+	uint64_t seed = 20250720;
+
+	for (int i = 1; i < argc; i++) {
+		const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+
+		if (strcmp(argv[i], "--shape") == 0 && value) {
+			i++;
+			if (strcmp(value, "all") != 0) {
+				int found = -1;
+				for (int s = 0; s < SHAPE_COUNT; s++) {
+					if (strcmp(value, shape_names[s]) == 0) found = s;
+				}
+				if (found < 0) {
+					usage();
+					return 2;
+				}
+				first_shape = last_shape = found;
+			}
+		} else if (strcmp(argv[i], "--size") == 0 && value) {
+			size = strtoull(argv[++i], NULL, 10);
+		} else if (strcmp(argv[i], "--runs") == 0 && value) {
+			runs = atoi(argv[++i]);
+			if (runs < 1) runs = 1;
+		} else if (strcmp(argv[i], "--seed") == 0 && value) {
+			seed = strtoull(argv[++i], NULL, 10);
+		} else if (strcmp(argv[i], "--text") == 0) {
+			text = 1;
+		} else if (strcmp(argv[i], "--generate") == 0) {
+			generate_only = 1;
+		} else {
+			usage();
+			return 2;
+		}
+	}
+
+	// Parse errors would skew the numbers; report them but keep them off the output
+	diag_buffer diagnostics = {0};
+	diag_capture(&diagnostics);
+
+	if (!text && !generate_only) printf("[\n");
+	for (int shape = first_shape; shape <= last_shape; shape++) {
+		script s = generate((shape_t)shape, size, seed);
+
+		if (generate_only) {
+			fwrite(s.text, 1, s.length, stdout);
+			free(s.text);
+			continue;
+		}
+
+		result r = {0};
+		measure(&s, runs, &r);
+		if (text) report_text((shape_t)shape, &r);
+		else report_json((shape_t)shape, &r, runs, shape == last_shape);
+
+		free(r.lex.samples);
+		free(r.parse.samples);
+		free(r.heap_parse.samples);
+		free(r.free.samples);
+		free(r.print.samples);
+		free(s.text);
+	}
+	if (!text && !generate_only) printf("]\n");
+
+	diag_capture(NULL);
+	if (diagnostics.error_count) {
+		fprintf(stderr, "warning: generated scripts produced %u diagnostic(s)\n", diagnostics.error_count);
+	}
+	diag_buffer_free(&diagnostics);
+	symbol_table_free();
+	return 0;
+}
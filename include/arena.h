@@ -0,0 +1,31 @@
+/*
+ *
+ *		arena.h
+ *		LUMEN LANGUAGE PROJECT
+ *		Rainy101112 - 2025/7/20
+ *
+ */
+
+#pragma once
+
+#include <stddef.h>
+
+/*
+ * Bump allocator with chunk growth. Individual allocations are never freed;
+ * everything goes away at once with arena_reset or arena_destroy.
+ */
+
+typedef struct arena arena_t;
+
+// chunk_size of 0 selects the default first chunk size
+arena_t *arena_create(size_t chunk_size);
+void arena_destroy(arena_t *arena);
+
+// Keeps the largest chunk for reuse and drops the rest
+void arena_reset(arena_t *arena);
+
+// Returned memory is aligned for any object type; NULL on allocation failure
+void *arena_alloc(arena_t *arena, size_t size);
+void *arena_memdup(arena_t *arena, const void *data, size_t size);
+
+size_t arena_bytes_used(const arena_t *arena);
@@ -0,0 +1,95 @@
+/*
+ *
+ *		array.h
+ *		LUMEN LANGUAGE PROJECT
+ *		Rainy101112 - 2025/7/20
+ *
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/*
+ * Numeric arrays. Registers only hold doubles, so an array lives in a heap
+ * of its own and a register holds a handle to it: a quiet NaN with
+ * ARRAY_TAG in the top 32 bits and the heap slot in the low 32. The
+ * compiler types every expression, so handles never reach scalar
+ * arithmetic and the pattern cannot come out of it either (the hardware's
+ * default NaN has only bit 51 of the mantissa set).
+ *
+ * Arrays are immutable once built. Unreachable ones are reclaimed by
+ * array_heap_collect, which treats every handle found in the roots it is
+ * given as live.
+ */
+
+#define ARRAY_TAG			0xFFFC0000u
+
+// Element storage is aligned for the widest vector kernel
+#define ARRAY_ALIGN			32
+
+// Longest array; longer ones are reported like any other bad length
+#define ARRAY_MAX_LENGTH	UINT32_MAX
+
+// Collections wait until at least this much has been allocated since the last one
+#define ARRAY_GC_MIN_BYTES	(8u << 20)
+
+typedef struct {
+	double *items;		// NULL when length is 0
+	uint64_t length;
+} array_t;
+
+typedef struct array_heap array_heap;
+
+array_heap *array_heap_create(void);
+void array_heap_destroy(array_heap *heap);
+
+static inline int array_is_handle(double value) {
+	uint64_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	return (uint32_t)(bits >> 32) == ARRAY_TAG;
+}
+
+static inline double array_handle(uint32_t slot) {
+	uint64_t bits = (uint64_t)ARRAY_TAG << 32 | slot;
+	double value;
+	memcpy(&value, &bits, sizeof(value));
+	return value;
+}
+
+/*
+ * A new array of length elements, left uninitialised; its handle goes to
+ * *handle. NULL after a message when memory runs out.
+ */
+array_t *array_alloc(array_heap *heap, uint64_t length, double *handle);
+
+// The live array value is a handle of, or NULL
+const array_t *array_lookup(const array_heap *heap, double value);
+
+// Whether allocations since the last collection make another one worthwhile
+int array_heap_should_collect(const array_heap *heap);
+
+// Frees every array no handle in roots[0, count) names
+void array_heap_collect(array_heap *heap, const double *roots, size_t count);
+
+/*
+ * Element-wise kernels, run on SSE2 or AVX as the CPU allows; results are
+ * the same bit for bit as the scalar loops. In array_binary either side
+ * may be a single number (left_scalar, right_scalar), which then applies
+ * to every element.
+ */
+
+typedef enum {
+	ARRAY_ADD,
+	ARRAY_SUB,
+	ARRAY_MUL,
+	ARRAY_DIV,
+
+	ARRAY_OP_COUNT
+} array_op;
+
+void array_binary(array_op op, double *out, const double *left, int left_scalar,
+	const double *right, int right_scalar, size_t count);
+void array_negate(double *out, const double *in, size_t count);
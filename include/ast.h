@@ -1,78 +1,173 @@
-/*
- *
- *		ast.h
- *		LUMEN LANGUAGE PROJECT
- *		Rainy101112 - 2025/7/20
- *
- */
-
-#pragma once
-
-#include "token.h"
-
-typedef enum {
-	AST_PROGRAM,
-	AST_BLOCK,
-	AST_ASSIGNMENT,
-	AST_BINARY_OP,
-	AST_VARIABLE,
-	AST_LITERAL,
-	AST_IF_STMT,
-	AST_FOR_LOOP,
-	AST_WHILE_LOOP,
-	AST_BREAK,
-	AST_CONTINUE
-} ast_node_type;
-
-typedef struct ast_node ast_node;
-
-typedef struct {
-	ast_node **statements;
-	int count;
-} block_statement;
-
-typedef struct {
-	char *name;
-	ast_node *value;
-} assignment;
-
-typedef struct {
-	token_type_t op;
-	ast_node *left;
-	ast_node *right;
-} binary_operation;
-
-typedef struct {
-	ast_node *condition;
-	ast_node *then_block;
-	ast_node *else_block;
-} if_statement;
-
-typedef struct {
-	ast_node *init;
-	ast_node *condition;
-	ast_node *update;
-	ast_node *body;
-} for_loop;
-
-typedef struct {
-	ast_node *condition;
-	ast_node *body;
-} while_loop;
-
-struct ast_node {
-	ast_node_type type;
-	union {
-		block_statement block;
-		assignment assign;
-		binary_operation binop;
-		char *variable;
-		double literal;
-		if_statement if_stmt;
-		for_loop for_loop;
-		while_loop while_loop;
-	} data;
-};
-
-ast_node *parse(const char *source_code);
-void free_ast(ast_node *node);
+/*
+ *
+ *		ast.h
+ *		LUMEN LANGUAGE PROJECT
+ *		Rainy101112 - 2025/7/20
+ *
+ */
+
+#pragma once
+
+#include "token.h"
+#include "lexer.h"
+#include "symbol.h"
+#include "arena.h"
+#include "number.h"
+
+typedef enum {
+	AST_PROGRAM,
+	AST_BLOCK,
+	AST_ASSIGNMENT,
+	AST_BINARY_OP,
+	AST_UNARY_OP,
+	AST_VARIABLE,
+	AST_LITERAL,
+	AST_ARRAY,
+	AST_IF_STMT,
+	AST_FOR_LOOP,
+	AST_WHILE_LOOP,
+	AST_BREAK,
+	AST_CONTINUE
+} ast_node_type;
+
+// AST_CONTINUE stays last so per-type tables can be sized by this
+#define AST_NODE_TYPE_COUNT (AST_CONTINUE + 1)
+
+typedef struct ast_node ast_node;
+
+typedef struct {
+	ast_node **statements;
+	int count;
+} block_statement;
+
+// Variable slots are filled in by resolve_ast; the parser leaves SLOT_UNRESOLVED
+#define SLOT_UNRESOLVED UINT32_MAX
+
+typedef struct {
+	symbol_id name;
+	uint32_t slot;
+	ast_node *value;
+} assignment;
+
+typedef struct {
+	symbol_id name;
+	uint32_t slot;
+} variable_ref;
+
+// Indexing a[i] is op TOKEN_OPEN_BRACKET with the array on the left
+typedef struct {
+	token_type_t op;
+	ast_node *left;
+	ast_node *right;
+} binary_operation;
+
+// TOKEN_OPERATOR_MINUS, TOKEN_OPERATOR_NOT or TOKEN_KEYWORD_LEN; unary plus leaves no node
+typedef struct {
+	token_type_t op;
+	ast_node *operand;
+} unary_operation;
+
+// [a, b, c] lists its elements; [value; count] is a repeat with elements {value, count}
+typedef struct {
+	ast_node **elements;
+	int count;
+	uint8_t repeat;
+} array_literal;
+
+typedef struct {
+	ast_node *condition;
+	ast_node *then_block;
+	ast_node *else_block;
+} if_statement;
+
+typedef struct {
+	ast_node *init;
+	ast_node *condition;
+	ast_node *update;
+	ast_node *body;
+} for_loop;
+
+typedef struct {
+	ast_node *condition;
+	ast_node *body;
+} while_loop;
+
+struct ast_node {
+	ast_node_type type;
+
+	// Byte range [start, end) in the source; statements include their ';'
+	size_t start;
+	size_t end;
+
+	union {
+		block_statement block;
+		assignment assign;
+		binary_operation binop;
+		unary_operation unop;
+		variable_ref variable;
+		literal_value literal;
+		array_literal array;
+		if_statement if_stmt;
+		for_loop for_loop;
+		while_loop while_loop;
+	} data;
+};
+
+/*
+ * With an arena every node and statement vector of the tree is allocated
+ * from it and the whole tree is released by destroying or resetting the
+ * arena. Without one (NULL) the tree is heap-allocated and freed with
+ * free_ast. Never call free_ast on an arena-owned tree.
+ */
+ast_node *parse(const char *source_code, arena_t *arena);
+void free_ast(ast_node *node);
+
+// parse on a stream the caller has lexed (or started) from offset 0; tokens stay owned by the caller
+ast_node *parse_stream(token_stream *tokens, arena_t *arena);
+
+/*
+ * Blocks, parenthesised expressions, array literals and indexes may nest
+ * this deep, and each operator in an expression counts as a level too, so
+ * a chain of n binary operators is n levels. One level more is reported as
+ * an error and the construct is skipped like any other syntax error, which
+ * keeps the stack use of the parser and of every pass after it bounded.
+ */
+#define PARSE_DEFAULT_NESTING_LIMIT 1024
+
+// Applies to every later parse and reparse, 0 restores the default; set it before parsing starts. Returns the old limit
+uint32_t parse_set_nesting_limit(uint32_t limit);
+uint32_t parse_nesting_limit(void);
+
+/*
+ * Levels the calling thread's last parse or parse_stream needed, counted
+ * as the limit counts them. A source that parsed without errors parses
+ * the same under any limit at least this high and fails under any lower
+ * one.
+ */
+uint32_t parse_nesting(void);
+
+/*
+ * A replaced byte range: old_length bytes at start in the old source
+ * became new_length bytes. Several edits must be sorted by start, must not
+ * overlap, and all use old-source offsets.
+ */
+typedef struct {
+	size_t start;
+	size_t old_length;
+	size_t new_length;
+} source_edit;
+
+/*
+ * Brings a tree returned by parse or reparse (and not yet optimized or
+ * resolved) up to date with new_source. Only the statements touching the
+ * edits are re-lexed and re-parsed, inside the innermost block around
+ * them; when that does not parse cleanly the enclosing statement is
+ * retried, up to a full parse. Every other subtree is kept as it is, with
+ * its span moved by the length change. The tree is updated in place and
+ * returned; if a full parse was needed the result is a new tree and, for
+ * a heap tree, the old one has been freed. Pass the same arena (or NULL)
+ * the tree was parsed with; replaced nodes in an arena stay allocated
+ * until it is reset.
+ */
+ast_node *reparse(ast_node *root, const char *old_source, const char *new_source,
+	const source_edit *edits, size_t edit_count, arena_t *arena);
@@ -0,0 +1,29 @@
+/*
+ *
+ *		batch.h
+ *		LUMEN LANGUAGE PROJECT
+ *		Rainy101112 - 2025/7/20
+ *
+ */
+
+#pragma once
+
+#include <stddef.h>
+
+/*
+ * lumen batch: runs lex -> parse -> the selected passes over many files on
+ * a work-stealing thread pool. Each file's diagnostics are collected while
+ * it is compiled and printed afterwards in input order, so the output does
+ * not depend on the number of threads or on scheduling.
+ */
+
+typedef struct {
+	unsigned threads;	// 0 = one per online processor
+	int optimize;
+	int compile;		// resolve and compile to bytecode; implies optimize
+	int summary;		// print totals and throughput to stderr
+	const char *cache_dir;	// NULL disables the precompiled-program cache
+} batch_options;
+
+// 0 when every file compiled without errors
+int batch_compile(const char *const *paths, size_t count, const batch_options *options);
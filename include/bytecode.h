@@ -0,0 +1,132 @@
+/*
+ *
+ *		bytecode.h
+ *		LUMEN LANGUAGE PROJECT
+ *		Rainy101112 - 2025/7/20
+ *
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include "symbol.h"
+
+/*
+ * Register-based bytecode. Every instruction names its operands directly as
+ * register numbers; there is no operand stack. The register file is laid
+ * out as
+ *
+ *   [0, variable_count)             program variables
+ *   [variable_count, constant_base) expression temporaries
+ *   [constant_base, register_count) constants, loaded before execution
+ *
+ * so literals are read like any other register. A register holding an
+ * array holds its handle (see array.h); the compiler only emits the array
+ * instructions on array values, but they check their operands anyway.
+ */
+
+typedef enum {
+	OP_MOVE,	// R[a] = R[b]
+	OP_ADD,		// R[a] = R[b] + R[c]
+	OP_SUB,		// R[a] = R[b] - R[c]
+	OP_MUL,		// R[a] = R[b] * R[c]
+	OP_DIV,		// R[a] = R[b] / R[c]
+	OP_LT,		// R[a] = R[b] < R[c]
+	OP_GT,		// R[a] = R[b] > R[c]
+	OP_LE,		// R[a] = R[b] <= R[c]
+	OP_GE,		// R[a] = R[b] >= R[c]
+	OP_EQ,		// R[a] = R[b] == R[c]
+	OP_NE,		// R[a] = R[b] != R[c]
+	OP_AND,		// R[a] = R[b] != 0 && R[c] != 0, both always evaluated
+	OP_OR,		// R[a] = R[b] != 0 || R[c] != 0, both always evaluated
+	OP_NOT,		// R[a] = R[b] == 0
+	OP_NEG,		// R[a] = -R[b]
+	OP_ARRAY,	// R[a] = [R[b], R[b + 1], ..., R[b + c - 1]]; c is a count, not a register
+	OP_FILL,	// R[a] = [R[b]; R[c]], R[c] copies of R[b]
+	OP_INDEX,	// R[a] = R[b][R[c]]
+	OP_LEN,		// R[a] = len(R[b])
+	OP_VADD,	// R[a] = R[b] + R[c] element by element; a number on either side applies to every element
+	OP_VSUB,	// R[a] = R[b] - R[c] likewise
+	OP_VMUL,	// R[a] = R[b] * R[c] likewise
+	OP_VDIV,	// R[a] = R[b] / R[c] likewise
+	OP_VNEG,	// R[a] = -R[b] element by element
+	OP_JMP,		// pc = a
+	OP_JMPF,	// if (R[a] == 0) pc = b
+	OP_JMPT,	// if (R[a] != 0) pc = b
+	OP_HALT,
+
+	OP_COUNT
+} opcode_t;
+
+typedef struct {
+	uint32_t op;
+	uint32_t a;
+	uint32_t b;
+	uint32_t c;
+} instruction_t;
+
+typedef enum {
+	REDUCE_SUM,		// partial results start at -0.0 and are added
+	REDUCE_PRODUCT	// partial results start at 1 and are multiplied
+} reduction_kind;
+
+typedef struct {
+	uint32_t reg;
+	uint32_t kind;	// reduction_kind
+} loop_reduction;
+
+/*
+ * A for loop whose iterations the compiler proved independent apart from
+ * sum and product reductions (see parallel.h). Its code is an ordinary
+ * loop laid out as
+ *
+ *   entry:  JMP test
+ *           body and update
+ *   test:   <compare> t induction limit
+ *           JMPT t body
+ *   exit:
+ *
+ * where limit holds the loop bound, evaluated once before entry. Run with
+ * a pool, the VM splits the trip count into slices and runs each slice on
+ * its own copy of the registers, from test, with induction and limit set
+ * to the slice's first and end values.
+ */
+typedef struct {
+	uint32_t entry;
+	uint32_t test;
+	uint32_t exit;
+	uint32_t induction;
+	uint32_t limit;
+	uint32_t compare;		// OP_LT, OP_GT, OP_LE or OP_GE
+	int32_t step;			// added to induction once per iteration
+
+	// reductions[first_reduction, first_reduction + reduction_count) of the chunk
+	uint32_t first_reduction;
+	uint32_t reduction_count;
+} parallel_loop;
+
+typedef struct {
+	instruction_t *code;
+	uint32_t code_count;
+
+	double *constants;
+	uint32_t constant_count;
+
+	// Register i < variable_count holds variables[i]
+	symbol_id *variables;
+	uint32_t variable_count;
+
+	uint32_t constant_base;
+	uint32_t register_count;
+
+	// Loops the VM may split across a pool, in code order
+	parallel_loop *loops;
+	uint32_t loop_count;
+	loop_reduction *reductions;
+	uint32_t reduction_count;
+} chunk_t;
+
+void chunk_free(chunk_t *chunk);
+void chunk_disassemble(const chunk_t *chunk, FILE *out);
+const char *opcode_name(opcode_t op);
@@ -0,0 +1,61 @@
+/*
+ *
+ *		cache.h
+ *		LUMEN LANGUAGE PROJECT
+ *		Rainy101112 - 2025/7/20
+ *
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "flat_ast.h"
+#include "bytecode.h"
+#include "diag.h"
+
+/*
+ * Precompiled-program cache. A cache file holds the flat AST of a parsed
+ * source and, optionally, the bytecode compiled from it, in one versioned
+ * image made only of offsets and indices. Loading maps the file read-only
+ * and points the flat_ast columns and the chunk's code and constants
+ * straight into the mapping; only the names are interned again, once per
+ * distinct name. Files live in a cache directory and are named after a
+ * hash of the source text, which is checked again together with the
+ * source length when loading. Warnings the original compile produced
+ * are stored with it and reported again when the entry is used; sources
+ * with errors are never cached. An entry also records how deep the
+ * source nests, and is not used while the nesting limit is lower than
+ * that, so a warm cache accepts exactly what parsing would.
+ */
+
+#define CACHE_VERSION 7
+
+typedef struct {
+	// Columns point into the mapping; symbols is owned by the cache
+	flat_ast ast;
+
+	// Valid when has_chunk; code and constants point into the mapping
+	chunk_t chunk;
+	int has_chunk;
+
+	// Warning text of the compile that produced the entry, inside the mapping
+	const char *diagnostics;
+	size_t diagnostics_length;
+
+	void *mapping;
+	size_t mapping_size;
+} cache_t;
+
+uint64_t cache_hash(const char *text, size_t length);
+
+// NULL when there is no usable entry for this source
+cache_t *cache_load(const char *directory, const char *text, size_t length);
+void cache_close(cache_t *cache);
+
+// Reports the stored warnings through diag_report, one per line
+void cache_replay_diagnostics(const cache_t *cache);
+
+// nesting is parse_nesting right after parsing text; chunk and diagnostics may be NULL; creates the directory if needed. 0 on success
+int cache_store(const char *directory, const char *text, size_t length, uint32_t nesting,
+	const flat_ast *ast, const chunk_t *chunk, const diag_buffer *diagnostics);
@@ -0,0 +1,49 @@
+/*
+ *
+ *		cgen.h
+ *		LUMEN LANGUAGE PROJECT
+ *		Rainy101112 - 2025/7/20
+ *
+ */
+
+#pragma once
+
+#include <stdio.h>
+#include "ast.h"
+#include "resolve.h"
+
+/*
+ * Ahead-of-time backend. A resolved (and normally optimized) program is
+ * lowered to one standalone C translation unit: every variable becomes a
+ * local double, and if, while, for, break and continue map onto their C
+ * counterparts, so the C compiler sees the same structured code. Numbers
+ * are doubles throughout and operators keep the VM's meaning: comparisons
+ * and logic give 0 or 1, and && and || test against 0. Literals are
+ * written so they read back bit for bit. Arrays are not lowered yet, so a
+ * program that builds or indexes one is refused.
+ *
+ * The unit exports
+ *
+ *   const unsigned lumen_variable_count;
+ *   const char *const lumen_variable_names[];
+ *   void lumen_run(double *variables);
+ *
+ * lumen_run starts from the values in variables (the VM starts from 0)
+ * and leaves the final values there, in slot order. Unless LUMEN_NO_MAIN
+ * is defined it also has a main that runs the program from 0 and prints
+ * every variable the way `lumen run` does.
+ */
+
+// Writes the translation unit to out. 0, or -1 after a diagnostic or a failed write
+int cgen_emit(FILE *out, const ast_node *root, const resolve_result *scope);
+
+// The C compiler cgen_build runs: $CC when set, otherwise the one lumen was built with
+const char *cgen_compiler(void);
+
+/*
+ * Emits the unit and compiles it into output with cgen_compiler, as an
+ * executable, or with shared set as a shared object without main. The
+ * source is piped to the compiler, nothing is left behind but output.
+ * Returns 0 on success.
+ */
+int cgen_build(const ast_node *root, const resolve_result *scope, const char *output, int shared);
@@ -0,0 +1,19 @@
+/*
+ *
+ *		compiler.h
+ *		LUMEN LANGUAGE PROJECT
+ *		Rainy101112 - 2025/7/20
+ *
+ */
+
+#pragma once
+
+#include "ast.h"
+#include "bytecode.h"
+#include "resolve.h"
+
+/*
+ * The tree must have been through resolve_ast; variable slot i becomes
+ * register i. NULL on compile errors, which are reported on stderr.
+ */
+chunk_t *compile_program(const ast_node *root, const resolve_result *scope);
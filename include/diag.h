@@ -0,0 +1,52 @@
+/*
+ *
+ *		diag.h
+ *		LUMEN LANGUAGE PROJECT
+ *		Rainy101112 - 2025/7/20
+ *
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "lines.h"
+
+/*
+ * Diagnostics from the lexer, parser and later passes. They go to stderr
+ * unless the calling thread has installed a buffer with diag_capture, in
+ * which case they are collected there, so a driver compiling several files
+ * at once can print each file's messages together and in a fixed order.
+ *
+ * Passes that know where a problem is report it with diag_report_at and a
+ * byte offset. While the thread has a line table set with diag_locate the
+ * message is prefixed with "line:column: ", otherwise it is left as is.
+ */
+
+typedef enum {
+	DIAG_WARNING,
+	DIAG_ERROR
+} diag_severity;
+
+typedef struct {
+	char *text;
+	size_t length;
+	size_t capacity;
+
+	uint32_t warning_count;
+	uint32_t error_count;
+} diag_buffer;
+
+// Captures this thread's diagnostics into buffer, NULL goes back to stderr; returns the previous buffer
+diag_buffer *diag_capture(diag_buffer *buffer);
+
+// Locates diag_report_at offsets on this thread in table, NULL turns that off; returns the previous table
+line_table *diag_locate(line_table *table);
+
+void diag_report(diag_severity severity, const char *format, ...) __attribute__((format(printf, 2, 3)));
+void diag_report_at(diag_severity severity, size_t offset, const char *format, ...) __attribute__((format(printf, 3, 4)));
+
+// Writes every captured line to out, each prefixed with prefix and ": "
+void diag_flush(const diag_buffer *buffer, const char *prefix, FILE *out);
+void diag_buffer_free(diag_buffer *buffer);
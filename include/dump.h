@@ -0,0 +1,44 @@
+/*
+ *
+ *		dump.h
+ *		LUMEN LANGUAGE PROJECT
+ *		Rainy101112 - 2025/7/20
+ *
+ */
+
+#pragma once
+
+#include <stdio.h>
+#include "ast.h"
+#include "flat_ast.h"
+
+/*
+ * Tree dumps. Output is built in one large buffer and handed to the stream
+ * in big chunks, and both tree forms walk with an explicit stack, so huge
+ * or deeply nested trees dump quickly and without recursion.
+ *
+ *   DUMP_TEXT   the indented, LOG_LEVEL_LOGGER-prefixed listing
+ *   DUMP_SEXPR  one line: (block (= x (+ a 1)) (for nil c nil (block)))
+ *   DUMP_JSON   one line: {"type":"block","statements":[...]}
+ *
+ * In S-expressions variables are bare names, absent for-header parts are
+ * nil and a missing else is left out; [a, b] is (array a b) and [v; n] is
+ * (repeat v n), which JSON gives "elements" or "value" and "count". JSON
+ * leaves absent fields out and writes non-finite literals as the strings
+ * "inf", "-inf" and "nan".
+ * Float literals always carry a '.' or exponent, so the two literal kinds
+ * stay apart, and print with the fewest digits that read back exactly.
+ */
+
+typedef enum {
+	DUMP_TEXT,
+	DUMP_SEXPR,
+	DUMP_JSON
+} dump_format;
+
+// "text", "sexpr" or "json"; -1 for anything else
+int dump_format_parse(const char *name);
+
+// indent is the starting column of text dumps. Both return 0, or -1 if writing to out failed
+int dump_ast(FILE *out, ast_node *root, dump_format format, int indent);
+int dump_flat_ast(FILE *out, const flat_ast *ast, flat_index root, dump_format format, int indent);
@@ -0,0 +1,121 @@
+/*
+ *
+ *		flat_ast.h
+ *		LUMEN LANGUAGE PROJECT
+ *		Rainy101112 - 2025/7/20
+ *
+ */
+
+#pragma once
+
+#include "ast.h"
+#include "symbol.h"
+
+/*
+ * Compact structure-of-arrays form of an AST. Nodes are addressed by 32-bit
+ * indices and the root is node 0. The children of a node are always stored
+ * next to each other starting at first[i], so a block's statements form a
+ * contiguous index range.
+ *
+ *   kind            flags            first        payload
+ *   AST_BLOCK       -                statements   statement count
+ *   AST_ASSIGNMENT  -                value        symbol slot
+ *   AST_BINARY_OP   operator         left, right  -
+ *   AST_UNARY_OP    operator         operand      -
+ *   AST_VARIABLE    -                -            symbol slot
+ *   AST_LITERAL     literal_kind     -            literal slot
+ *   AST_ARRAY       FLAT_ARRAY_REPEAT  elements  element count
+ *   AST_IF_STMT     -                cond, then[, else]  child count
+ *   AST_FOR_LOOP    FLAT_FOR_* mask  present parts, body
+ *   AST_WHILE_LOOP  -                cond, body   -
+ *
+ * Symbol slots index a per-tree table of interned ids, which keeps the
+ * node arrays free of process-specific values.
+ */
+
+typedef uint32_t flat_index;
+
+#define FLAT_NONE ((flat_index)UINT32_MAX)
+
+#define FLAT_FOR_INIT		0x1
+#define FLAT_FOR_CONDITION	0x2
+#define FLAT_FOR_UPDATE		0x4
+
+// An array literal [value; count], with those two children
+#define FLAT_ARRAY_REPEAT	0x1
+
+typedef struct {
+	uint8_t *kinds;
+	uint8_t *flags;
+	uint32_t *first;
+	uint32_t *payload;
+	uint32_t count;
+
+	literal_payload *literals;
+	uint32_t literal_count;
+
+	symbol_id *symbols;
+	uint32_t symbol_count;
+} flat_ast;
+
+flat_ast *flat_ast_build(const ast_node *root);
+void flat_ast_free(flat_ast *ast);
+
+// Bytes held by the node, literal and symbol arrays
+size_t flat_ast_bytes(const flat_ast *ast);
+
+static inline ast_node_type flat_kind(const flat_ast *ast, flat_index i) {
+	return (ast_node_type)ast->kinds[i];
+}
+
+static inline uint32_t flat_child_count(const flat_ast *ast, flat_index i) {
+	switch (flat_kind(ast, i)) {
+		case AST_BLOCK:
+		case AST_ARRAY:
+		case AST_IF_STMT:
+			return ast->payload[i];
+		case AST_ASSIGNMENT:
+		case AST_UNARY_OP:
+			return 1;
+		case AST_BINARY_OP:
+		case AST_WHILE_LOOP:
+			return 2;
+		case AST_FOR_LOOP:
+			return 1 + __builtin_popcount(ast->flags[i]);
+		default:
+			return 0;
+	}
+}
+
+static inline flat_index flat_child(const flat_ast *ast, flat_index i, uint32_t n) {
+	return ast->first[i] + n;
+}
+
+static inline token_type_t flat_operator(const flat_ast *ast, flat_index i) {
+	return (token_type_t)ast->flags[i];
+}
+
+static inline symbol_id flat_symbol(const flat_ast *ast, flat_index i) {
+	return ast->symbols[ast->payload[i]];
+}
+
+static inline literal_value flat_literal(const flat_ast *ast, flat_index i) {
+	literal_value value = { .kind = (literal_kind)ast->flags[i], .as = ast->literals[ast->payload[i]] };
+	return value;
+}
+
+// FLAT_NONE if the if statement has no else block
+static inline flat_index flat_else_block(const flat_ast *ast, flat_index i) {
+	return ast->payload[i] > 2 ? ast->first[i] + 2 : FLAT_NONE;
+}
+
+// part is one of FLAT_FOR_*; FLAT_NONE if that part was omitted
+static inline flat_index flat_for_part(const flat_ast *ast, flat_index i, uint8_t part) {
+	uint8_t mask = ast->flags[i];
+	if (!(mask & part)) return FLAT_NONE;
+	return ast->first[i] + __builtin_popcount(mask & (part - 1));
+}
+
+static inline flat_index flat_for_body(const flat_ast *ast, flat_index i) {
+	return ast->first[i] + __builtin_popcount(ast->flags[i]);
+}
@@ -0,0 +1,42 @@
+/*
+ *
+ *		jit.h
+ *		LUMEN LANGUAGE PROJECT
+ *		Rainy101112 - 2025/7/20
+ *
+ */
+
+#pragma once
+
+#include "bytecode.h"
+
+/*
+ * Loop JIT for x86-64. The VM reports every taken backward jump; once a
+ * loop has gone round JIT_HOT_THRESHOLD times, its bytecode range is
+ * translated to native code that keeps the most used registers in SSE
+ * registers. Native code runs until control leaves the loop and returns
+ * the bytecode pc to resume at. Loops that contain anything the JIT does
+ * not handle keep running in the interpreter.
+ */
+
+#define JIT_HOT_THRESHOLD 64
+
+typedef struct jit jit_t;
+
+// Returns the pc the interpreter continues at
+typedef uint32_t (*jit_entry)(double *registers);
+
+int jit_available(void);
+
+// NULL if the JIT is not available on this platform
+jit_t *jit_create(const chunk_t *chunk);
+void jit_destroy(jit_t *jit);
+
+// Never translate a loop that contains pc, so the interpreter always reaches it
+void jit_exclude(jit_t *jit, uint32_t pc);
+
+// Back-edge from pc to header was taken; native entry for the loop if it is compiled
+jit_entry jit_back_edge(jit_t *jit, uint32_t header, uint32_t pc);
+
+// Number of loops translated so far
+uint32_t jit_compiled_loops(const jit_t *jit);
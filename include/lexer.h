@@ -1,13 +1,57 @@
-/*
- *
- *		lexer.h
- *		LUMEN LANGUAGE PROJECT
- *		Rainy101112 - 2025/7/20
- *
- */
-
-#pragma once
-
-#include <token.h>
-
-token_t *get_next_token(const char *source_code, int *index);
+/*
+ *
+ *		lexer.h
+ *		LUMEN LANGUAGE PROJECT
+ *		Rainy101112 - 2025/7/20
+ *
+ */
+
+#pragma once
+
+#include <token.h>
+
+token_t get_next_token(const char *source_code, size_t *index);
+
+// Upper-case name of a token type, e.g. "IDENTIFIER" or "OPEN_PAREN"
+const char *token_type_name(token_type_t type);
+
+/*
+ * Pre-lexed tokens in structure-of-arrays form: kind, start and length in
+ * separate dense columns, filled by one tight lexing loop. A stream starts
+ * at any offset and can be filled in steps; once the source is exhausted
+ * its last token is TOKEN_END_OF_FILE.
+ *
+ * Starts and lengths are 32-bit to keep the columns dense, so a stream
+ * covers at most the first 4 GiB of a source. The first token that would
+ * reach past that is reported as "Source is larger than 4 GiB" and the
+ * stream ends there. parse, reparse and every lumen command lex through a
+ * stream, so 4 GiB is the largest program lumen accepts; get_next_token
+ * alone has no such limit.
+ */
+typedef struct {
+	const char *source;
+	size_t position;	// Where lexing resumes
+
+	uint8_t *kinds;
+	uint32_t *starts;
+	uint32_t *lengths;
+	uint32_t count;
+	uint32_t capacity;
+
+	int finished;		// TOKEN_END_OF_FILE has been stored
+} token_stream;
+
+void token_stream_init(token_stream *stream, const char *source_code, size_t from);
+void token_stream_free(token_stream *stream);
+
+/*
+ * Lexes until at least at_least more tokens are stored and the last one
+ * starts at or after until (SIZE_MAX lexes everything), or the source
+ * ends. Returns 0 if the columns could not grow.
+ */
+int token_stream_fill(token_stream *stream, size_t until, uint32_t at_least);
+
+static inline token_t token_stream_at(const token_stream *stream, uint32_t i) {
+	token_t token = { (token_type_t)stream->kinds[i], stream->starts[i], stream->lengths[i] };
+	return token;
+}
@@ -0,0 +1,40 @@
+/*
+ *
+ *		lines.h
+ *		LUMEN LANGUAGE PROJECT
+ *		Rainy101112 - 2025/7/20
+ *
+ */
+
+#pragma once
+
+#include <stddef.h>
+
+/*
+ * Maps byte offsets to line and column. Tokens and nodes only record
+ * offsets, so nothing is counted while lexing; the table of line starts is
+ * built with one vector newline scan on the first lookup, and each lookup
+ * is then a binary search. Lines and columns count from 1, columns in
+ * bytes.
+ */
+
+typedef struct {
+	size_t line;
+	size_t column;
+} source_position;
+
+typedef struct {
+	const char *text;
+	size_t length;
+
+	// starts[i] is the offset of line i + 1; NULL until the first lookup
+	size_t *starts;
+	size_t count;
+} line_table;
+
+// Does not scan yet; text must outlive the table
+void line_table_init(line_table *table, const char *text, size_t length);
+void line_table_free(line_table *table);
+
+// Offsets past the end land on the last line; line 0 means the table could not be built
+source_position line_table_lookup(line_table *table, size_t offset);
@@ -0,0 +1,35 @@
+/*
+ *
+ *		mem.h
+ *		LUMEN LANGUAGE PROJECT
+ *		Rainy101112 - 2025/7/20
+ *
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Heap allocation hook used by the lexer, parser, arena and compiler
+ * passes. The functions behave like their libc counterparts; while
+ * tracking is on they also count calls and requested bytes, process-wide
+ * and from any thread.
+ */
+
+typedef struct {
+	uint64_t allocations;	// mem_alloc and mem_calloc calls
+	uint64_t reallocations;
+	uint64_t frees;			// mem_free calls with a non-NULL pointer
+	uint64_t bytes;			// requested by allocations and reallocations
+} mem_counters;
+
+void *mem_alloc(size_t size);
+void *mem_calloc(size_t count, size_t size);
+void *mem_realloc(void *pointer, size_t size);
+void mem_free(void *pointer);
+
+// Counting is off until enabled; enable before starting worker threads
+void mem_track(int enable);
+mem_counters mem_stats(void);
@@ -0,0 +1,45 @@
+/*
+ *
+ *		number.h
+ *		LUMEN LANGUAGE PROJECT
+ *		Rainy101112 - 2025/7/20
+ *
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Numeric literals. An integer literal that fits in 64 bits keeps its
+ * exact value; every other literal, and an integer that overflows, is a
+ * correctly rounded double. Execution is in doubles either way, so the
+ * kind never changes what a program computes.
+ */
+
+typedef enum {
+	LITERAL_INTEGER,
+	LITERAL_FLOAT
+} literal_kind;
+
+typedef union {
+	int64_t integer;
+	double number;
+} literal_payload;
+
+typedef struct {
+	literal_kind kind;
+	literal_payload as;
+} literal_value;
+
+/*
+ * Converts the text of a TOKEN_INTEGER or TOKEN_FLOAT token in place:
+ * digits[.digits][(e|E)[+-]digits], optionally signed. No copy is made unless a float
+ * needs more than 19 significant digits or falls outside the fast paths.
+ */
+literal_value number_parse(const char *text, size_t length);
+
+static inline double literal_as_double(literal_value value) {
+	return value.kind == LITERAL_INTEGER ? (double)value.as.integer : value.as.number;
+}
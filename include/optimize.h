@@ -0,0 +1,24 @@
+/*
+ *
+ *		optimize.h
+ *		LUMEN LANGUAGE PROJECT
+ *		Rainy101112 - 2025/7/20
+ *
+ */
+
+#pragma once
+
+#include "ast.h"
+#include "arena.h"
+
+/*
+ * Rewrites the tree rooted at the program block in place: folds constant
+ * expressions, applies IEEE-exact algebraic identities, removes branches
+ * and loops with constant conditions, statements after break/continue and
+ * expression statements that cannot fail. Those that read a variable or
+ * use an array literal, an index or len stay, since their array errors
+ * at run time are their only effect. Pass the arena the tree was parsed
+ * into (or NULL for a heap tree) so dropped nodes are released the right
+ * way. Returns the number of nodes removed from the tree.
+ */
+size_t optimize_ast(ast_node *root, arena_t *arena);
@@ -0,0 +1,49 @@
+/*
+ *
+ *		parallel.h
+ *		LUMEN LANGUAGE PROJECT
+ *		Rainy101112 - 2025/7/20
+ *
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "ast.h"
+#include "bytecode.h"
+
+/*
+ * Dependence analysis for for loops. A loop can have its iterations split
+ * across threads when it has the shape
+ *
+ *   for (init; i <op> bound; i = i + step) body
+ *
+ * with <op> one of < <= > >= (either way round), a nonzero integer literal
+ * step that moves i towards the bound, a bound that reads nothing the body
+ * assigns, and no break or continue in the body that belongs to this loop.
+ * The body must leave i alone, and every variable it assigns must be
+ *
+ *   - a reduction: only ever used in statements v = v + e, v = e + v and
+ *     v = v - e (a sum) or v = v * e and v = e * v (a product), where e
+ *     does not read v; or
+ *   - private: assigned on every path through the body before any read,
+ *     so no iteration sees a value an earlier one left behind, and the
+ *     last iteration's value is the one the loop ends with.
+ *
+ * Everything else the body reads is the same in every iteration.
+ */
+
+typedef struct {
+	uint32_t induction;		// slot of i
+	token_type_t compare;	// as induction <compare> bound
+	const ast_node *bound;
+	int32_t step;
+
+	// Reductions by variable slot; release with parallel_plan_free
+	loop_reduction *reductions;
+	uint32_t reduction_count;
+} parallel_plan;
+
+// loop is an AST_FOR_LOOP of a resolved tree. 1 and a plan if it qualifies, 0 if it must run serially
+int parallel_analyze(const ast_node *loop, uint32_t slot_count, parallel_plan *plan);
+void parallel_plan_free(parallel_plan *plan);
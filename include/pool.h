@@ -0,0 +1,35 @@
+/*
+ *
+ *		pool.h
+ *		LUMEN LANGUAGE PROJECT
+ *		Rainy101112 - 2025/7/20
+ *
+ */
+
+#pragma once
+
+#include <stddef.h>
+
+/*
+ * Fixed-size work-stealing thread pool. pool_run hands out the indices
+ * [0, count) in one contiguous range per worker; a worker takes indices
+ * off the back of its own range and, once that is empty, steals the front
+ * half of another worker's range. The calling thread works as worker 0.
+ */
+
+typedef struct pool pool_t;
+
+// worker is in [0, pool_thread_count) and stable for the task's duration
+typedef void (*pool_task)(void *context, size_t index, unsigned worker);
+
+// Online processor count, at least 1
+unsigned pool_default_threads(void);
+
+// thread_count 0 means pool_default_threads(); NULL on failure
+pool_t *pool_create(unsigned thread_count);
+void pool_destroy(pool_t *pool);
+
+unsigned pool_thread_count(const pool_t *pool);
+
+// Runs task for every index and returns once all of them have finished
+void pool_run(pool_t *pool, size_t count, pool_task task, void *context);
@@ -0,0 +1,16 @@
+/*
+ *
+ *		print.h
+ *		LUMEN LANGUAGE PROJECT
+ *		Rainy101112 - 2025/7/20
+ *
+ */
+
+#pragma once
+
+#include "ast.h"
+#include "flat_ast.h"
+
+// Human-readable tree dumps on stdout, one LOG_LEVEL_LOGGER line per field (DUMP_TEXT of dump.h)
+void print_ast(ast_node *node, int indent);
+void print_flat_ast(const flat_ast *ast, flat_index node, int indent);
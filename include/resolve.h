@@ -0,0 +1,34 @@
+/*
+ *
+ *		resolve.h
+ *		LUMEN LANGUAGE PROJECT
+ *		Rainy101112 - 2025/7/20
+ *
+ */
+
+#pragma once
+
+#include "ast.h"
+
+/*
+ * Maps every variable to a dense slot and stores it in the slot field of
+ * AST_VARIABLE and AST_ASSIGNMENT nodes. Lumen has a single program scope
+ * (blocks do not open one), so slots are numbered per program in order of
+ * first appearance.
+ *
+ * Also runs a definite-assignment analysis and warns on stderr for every
+ * variable that may be read before it is assigned on some path; such reads
+ * see the initial value, 0 or the empty array.
+ */
+
+typedef struct {
+	// Slot i holds the variable names[i]
+	symbol_id *names;
+	uint32_t slot_count;
+
+	uint32_t warning_count;
+} resolve_result;
+
+// Returns 0 on success; result must be released with resolve_result_free
+int resolve_ast(ast_node *root, resolve_result *result);
+void resolve_result_free(resolve_result *result);
@@ -0,0 +1,33 @@
+/*
+ *
+ *		scan.h
+ *		LUMEN LANGUAGE PROJECT
+ *		Rainy101112 - 2025/7/20
+ *
+ */
+
+#pragma once
+
+#include <stddef.h>
+
+/*
+ * Run scanners used by the lexer. Each returns a pointer to the first byte
+ * that is not part of the run; the input must be NUL-terminated. SSE2/AVX2
+ * kernels are picked at runtime and match the scalar versions byte for byte.
+ */
+
+// ' ', '\t', '\n', '\v', '\f', '\r'
+const char *scan_whitespace(const char *p);
+
+// [A-Za-z0-9_]
+const char *scan_identifier(const char *p);
+
+// [0-9]
+const char *scan_digits(const char *p);
+
+/*
+ * Line index for line tables: stores the offset just past each '\n' in
+ * [p, p + length) to starts, in order, and returns how many there were.
+ * With starts NULL it only counts. Never reads outside the range.
+ */
+size_t scan_line_starts(const char *p, size_t length, size_t *starts);
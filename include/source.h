@@ -0,0 +1,30 @@
+/*
+ *
+ *		source.h
+ *		LUMEN LANGUAGE PROJECT
+ *		Rainy101112 - 2025/7/20
+ *
+ */
+
+#pragma once
+
+#include <stddef.h>
+
+/*
+ * A source file loaded for lexing. Regular files are memory-mapped
+ * read-only; pipes, terminals and "-" (stdin) are read in chunks. Either
+ * way text is followed by a NUL byte, which the lexer treats as end of
+ * input, and the bytes up to the end of the page after it are readable.
+ */
+typedef struct {
+	const char *text;
+	size_t length;
+
+	// Non-NULL when text points into a mapping of mapping_size bytes
+	void *mapping;
+	size_t mapping_size;
+} source_t;
+
+// NULL on failure, after printing why
+source_t *source_open(const char *path);
+void source_close(source_t *source);
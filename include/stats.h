@@ -0,0 +1,61 @@
+/*
+ *
+ *		stats.h
+ *		LUMEN LANGUAGE PROJECT
+ *		Rainy101112 - 2025/7/20
+ *
+ */
+
+#pragma once
+
+#include <stdio.h>
+#include "ast.h"
+#include "mem.h"
+#include "token.h"
+#include "lexer.h"
+
+/*
+ * Per-file counters for `lumen --stats`. Phase times are monotonic wall
+ * clock. Lexing fills the token stream the parser then reads, so the two
+ * phases no longer overlap.
+ */
+
+typedef enum {
+	STATS_LEX,
+	STATS_PARSE,
+	STATS_PASSES,	// optimizer, resolver, compiler, flat layout
+	STATS_EXECUTE,
+	STATS_OUTPUT,	// printing the tree, bytecode or variables
+	STATS_TEARDOWN,
+
+	STATS_PHASE_COUNT
+} stats_phase;
+
+typedef struct {
+	const char *path;
+	size_t source_bytes;
+	int cached;
+
+	double seconds[STATS_PHASE_COUNT];
+
+	uint64_t tokens[TOKEN_TYPE_COUNT];
+	uint64_t nodes[AST_NODE_TYPE_COUNT];
+	uint32_t max_depth;		// deepest node, the root being 1
+
+	// Filled in by stats_finish
+	mem_counters memory;
+	long peak_rss_kib;
+} stats_t;
+
+double stats_now(void);
+
+// Adds the time since *mark to phase and moves *mark to now; no-op for NULL stats
+void stats_lap(stats_t *stats, stats_phase phase, double *mark);
+
+void stats_count_tokens(stats_t *stats, const token_stream *tokens);
+void stats_count_nodes(stats_t *stats, ast_node *root);
+
+// Takes the allocation counters relative to start, and the peak RSS
+void stats_finish(stats_t *stats, const mem_counters *start);
+
+void stats_print(const stats_t *stats, int json, FILE *out);
@@ -0,0 +1,33 @@
+/*
+ *
+ *		symbol.h
+ *		LUMEN LANGUAGE PROJECT
+ *		Rainy101112 - 2025/7/20
+ *
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Process-wide identifier interning. Every distinct name is stored once and
+ * gets a dense id, so equal names compare equal as integers.
+ *
+ * symbol_intern, symbol_name and symbol_length may be called from any
+ * number of threads at once; symbol_table_free may not.
+ */
+
+typedef uint32_t symbol_id;
+
+#define SYMBOL_INVALID ((symbol_id)UINT32_MAX)
+
+symbol_id symbol_intern(const char *text, size_t length);
+
+// The returned string is NUL-terminated and lives until symbol_table_free
+const char *symbol_name(symbol_id id);
+size_t symbol_length(symbol_id id);
+uint32_t symbol_count(void);
+
+void symbol_table_free(void);
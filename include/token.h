@@ -13,7 +13,8 @@
 
 typedef enum token_type {
 	TOKEN_IDENTIFIER,
-	TOKEN_NUMBER,
+	TOKEN_INTEGER,
+	TOKEN_FLOAT,
 
 	TOKEN_KEYWORD_IF,
 	TOKEN_KEYWORD_ELSE,
@@ -21,22 +22,42 @@ typedef enum token_type {
 	TOKEN_KEYWORD_WHILE,
 	TOKEN_KEYWORD_BREAK,
 	TOKEN_KEYWORD_CONTINUE,
+	TOKEN_KEYWORD_LEN,
 
 	TOKEN_OPERATOR_PLUS,
 	TOKEN_OPERATOR_MINUS,
 	TOKEN_OPERATOR_MULTIPLY,
 	TOKEN_OPERATOR_DIVIDE,
+	TOKEN_OPERATOR_LESS,
+	TOKEN_OPERATOR_GREATER,
+	TOKEN_OPERATOR_LESS_EQUAL,
+	TOKEN_OPERATOR_GREATER_EQUAL,
+	TOKEN_OPERATOR_EQUAL,
+	TOKEN_OPERATOR_NOT_EQUAL,
+	TOKEN_OPERATOR_AND,
+	TOKEN_OPERATOR_OR,
+	TOKEN_OPERATOR_NOT,
 
 	TOKEN_SEMICOLON,
 	TOKEN_ASSIGN,
 
 	TOKEN_OPEN_PAREN,
 	TOKEN_CLOSE_PAREN,
+	TOKEN_OPEN_BRACE,
+	TOKEN_CLOSE_BRACE,
+	TOKEN_OPEN_BRACKET,
+	TOKEN_CLOSE_BRACKET,
+	TOKEN_COMMA,
 
 	TOKEN_END_OF_FILE
 } token_type_t;
 
+// TOKEN_END_OF_FILE stays last so per-type tables can be sized by this
+#define TOKEN_TYPE_COUNT (TOKEN_END_OF_FILE + 1)
+
+// Tokens never own memory: the text is source[start, start + length)
 typedef struct token {
 	token_type_t type;
-	char *text;
+	size_t start;
+	size_t length;
 } token_t;
@@ -0,0 +1,103 @@
+/*
+ *
+ *		visit.h
+ *		LUMEN LANGUAGE PROJECT
+ *		Rainy101112 - 2025/7/20
+ *
+ */
+
+#pragma once
+
+#include "ast.h"
+
+/*
+ * Children of a pointer AST node by position. Absent optional children
+ * (a missing else block or for-header part) are NULL but keep their index.
+ *
+ *   kind            children
+ *   AST_BLOCK       statements
+ *   AST_ASSIGNMENT  value
+ *   AST_BINARY_OP   left, right
+ *   AST_UNARY_OP    operand
+ *   AST_ARRAY       elements (value, count for a repeat)
+ *   AST_IF_STMT     cond, then, else
+ *   AST_FOR_LOOP    init, cond, update, body
+ *   AST_WHILE_LOOP  cond, body
+ */
+
+static inline int ast_child_count(const ast_node *node) {
+	switch (node->type) {
+		case AST_PROGRAM:
+		case AST_BLOCK:
+			return node->data.block.count;
+		case AST_ARRAY:
+			return node->data.array.count;
+		case AST_ASSIGNMENT:
+		case AST_UNARY_OP:
+			return 1;
+		case AST_BINARY_OP:
+		case AST_WHILE_LOOP:
+			return 2;
+		case AST_IF_STMT:
+			return 3;
+		case AST_FOR_LOOP:
+			return 4;
+		default:
+			return 0;
+	}
+}
+
+static inline ast_node *ast_child(const ast_node *node, int index) {
+	switch (node->type) {
+		case AST_PROGRAM:
+		case AST_BLOCK:
+			return node->data.block.statements[index];
+		case AST_ARRAY:
+			return node->data.array.elements[index];
+		case AST_ASSIGNMENT:
+			return node->data.assign.value;
+		case AST_BINARY_OP:
+			return index ? node->data.binop.right : node->data.binop.left;
+		case AST_UNARY_OP:
+			return node->data.unop.operand;
+		case AST_IF_STMT:
+			return index == 0 ? node->data.if_stmt.condition
+				: index == 1 ? node->data.if_stmt.then_block : node->data.if_stmt.else_block;
+		case AST_FOR_LOOP:
+			return index == 0 ? node->data.for_loop.init
+				: index == 1 ? node->data.for_loop.condition
+				: index == 2 ? node->data.for_loop.update : node->data.for_loop.body;
+		case AST_WHILE_LOOP:
+			return index ? node->data.while_loop.body : node->data.while_loop.condition;
+		default:
+			return NULL;
+	}
+}
+
+/*
+ * Depth-first walk that keeps its own stack on the heap, so the C stack
+ * stays flat however deeply the tree nests. enter runs before a node's
+ * children and leave after them; either may be NULL. leave may free the
+ * node it is given, since the walk never looks at it again.
+ */
+
+typedef enum {
+	AST_VISIT_CONTINUE,	// Walk into the children
+	AST_VISIT_SKIP,		// Leave the children out; leave still runs
+	AST_VISIT_STOP		// End the walk with no further callbacks
+} ast_visit_action;
+
+// Where a node hangs: its parent (NULL at the root), child index and depth (0 at the root)
+typedef struct {
+	ast_node *parent;
+	int index;
+	uint32_t depth;
+} ast_visit_position;
+
+typedef struct {
+	ast_visit_action (*enter)(ast_node *node, const ast_visit_position *at, void *context);
+	void (*leave)(ast_node *node, const ast_visit_position *at, void *context);
+} ast_visitor;
+
+// Returns 1 after a complete walk, 0 if enter stopped it or the stack could not grow
+int ast_visit(ast_node *root, const ast_visitor *visitor, void *context);
@@ -0,0 +1,57 @@
+/*
+ *
+ *		vm.h
+ *		LUMEN LANGUAGE PROJECT
+ *		Rainy101112 - 2025/7/20
+ *
+ */
+
+#pragma once
+
+#include <stdio.h>
+#include "array.h"
+#include "bytecode.h"
+#include "jit.h"
+#include "pool.h"
+
+typedef enum {
+	VM_OK,
+	VM_ERROR
+} vm_status;
+
+typedef struct {
+	const chunk_t *chunk;
+
+	// chunk->register_count slots; variables start out as 0
+	double *registers;
+
+	// Every array the program builds; registers are the roots of its collections
+	array_heap *arrays;
+
+	// Optional; when set, hot loops are handed to the JIT on their back-edge
+	jit_t *jit;
+
+	/*
+	 * Optional; when set, the chunk's parallel loops run as VM_SLICES
+	 * slices on the pool, each slice with a JIT of its own when jit is
+	 * set. The slice count depends only on the trip count, so results
+	 * do not change with the number of threads, but reductions are
+	 * combined slice by slice and may round differently from a serial
+	 * run. Loops of fewer than 2 * VM_SLICE_MIN trips run serially, and
+	 * so does one where a slice fails, to report the error in order.
+	 */
+	pool_t *pool;
+	struct vm_parallel *parallel;
+} vm_t;
+
+#define VM_SLICES		64
+#define VM_SLICE_MIN	1024
+
+vm_t *vm_create(const chunk_t *chunk);
+void vm_destroy(vm_t *vm);
+
+// Runtime errors, such as an index out of range, are reported before VM_ERROR is returned
+vm_status vm_run(vm_t *vm);
+
+// Writes a register as `lumen run` prints variables: %.17g, or [a, b, c] for an array
+void vm_print_value(const vm_t *vm, double value, FILE *out);
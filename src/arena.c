@@ -0,0 +1,122 @@
+/*
+ *
+ *		arena.c
+ *		LUMEN LANGUAGE PROJECT
+ *		Rainy101112 - 2025/7/20
+ *
+ */
+
+#include <arena.h>
+#include <mem.h>
+#include <stdalign.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ARENA_DEFAULT_CHUNK (64 * 1024)
+#define ARENA_ALIGN alignof(max_align_t)
+
+typedef struct arena_chunk {
+	struct arena_chunk *next;
+	size_t size;
+	alignas(max_align_t) unsigned char data[];
+} arena_chunk;
+
+struct arena {
+	arena_chunk *chunks;
+	unsigned char *cursor;
+	unsigned char *limit;
+	size_t next_size;
+	size_t used;
+};
+
+static arena_chunk *new_chunk(size_t size) {
+	arena_chunk *chunk = mem_alloc(sizeof(arena_chunk) + size);
+	if (!chunk) {
+		fprintf(stderr, "Memory allocate failed at %s:%d", __FILE__, __LINE__);
+		return NULL;
+	}
+	chunk->next = NULL;
+	chunk->size = size;
+	return chunk;
+}
+
+arena_t *arena_create(size_t chunk_size) {
+	arena_t *arena = mem_alloc(sizeof(arena_t));
+	if (!arena) {
+		fprintf(stderr, "Memory allocate failed at %s:%d", __FILE__, __LINE__);
+		return NULL;
+	}
+
+	arena->chunks = NULL;
+	arena->cursor = NULL;
+	arena->limit = NULL;
+	arena->next_size = chunk_size ? chunk_size : ARENA_DEFAULT_CHUNK;
+	arena->used = 0;
+	return arena;
+}
+
+void arena_destroy(arena_t *arena) {
+	if (!arena) return;
+
+	arena_chunk *chunk = arena->chunks;
+	while (chunk) {
+		arena_chunk *next = chunk->next;
+		mem_free(chunk);
+		chunk = next;
+	}
+	mem_free(arena);
+}
+
+void arena_reset(arena_t *arena) {
+	// Chunks are pushed in growing order, so the head is the largest
+	arena_chunk *keep = arena->chunks;
+	if (!keep) return;
+
+	arena_chunk *chunk = keep->next;
+	while (chunk) {
+		arena_chunk *next = chunk->next;
+		mem_free(chunk);
+		chunk = next;
+	}
+
+	keep->next = NULL;
+	arena->chunks = keep;
+	arena->cursor = keep->data;
+	arena->limit = keep->data + keep->size;
+	arena->used = 0;
+}
+
+void *arena_alloc(arena_t *arena, size_t size) {
+	size = (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+
+	if (!arena->cursor || (size_t)(arena->limit - arena->cursor) < size) {
+		size_t chunk_size = arena->next_size;
+		while (chunk_size < size) chunk_size *= 2;
+
+		arena_chunk *chunk = new_chunk(chunk_size);
+		if (!chunk) return NULL;
+
+		chunk->next = arena->chunks;
+		arena->chunks = chunk;
+		arena->cursor = chunk->data;
+		arena->limit = chunk->data + chunk_size;
+		arena->next_size = chunk_size * 2;
+	}
+
+	void *memory = arena->cursor;
+	arena->cursor += size;
+	arena->used += size;
+	return memory;
+}
+
+void *arena_memdup(arena_t *arena, const void *data, size_t size) {
+	void *copy = arena_alloc(arena, size);
+	if (copy && size) memcpy(copy, data, size);
+	return copy;
+}
+
+size_t arena_bytes_used(const arena_t *arena) {
+	return arena->used;
+}
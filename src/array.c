@@ -0,0 +1,348 @@
+/*
+ *
+ *		array.c
+ *		LUMEN LANGUAGE PROJECT
+ *		Rainy101112 - 2025/7/20
+ *
+ */
+
+#include <array.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define ARRAY_X86 1
+#include <immintrin.h>
+#endif
+
+#define SLOT_LIVE	0x1
+#define SLOT_MARKED	0x2
+
+struct array_heap {
+	array_t *arrays;
+	uint8_t *flags;		// SLOT_* per slot
+	uint32_t count;		// Slots ever handed out
+	uint32_t capacity;
+
+	// Freed slots, reused before count grows
+	uint32_t *free_slots;
+	uint32_t free_count;
+
+	// Bytes held after the last collection, and allocated since
+	size_t live_bytes;
+	size_t allocated;
+};
+
+array_heap *array_heap_create(void) {
+	array_heap *heap = calloc(1, sizeof(array_heap));
+	if (!heap) fprintf(stderr, "Memory allocate failed at %s:%d", __FILE__, __LINE__);
+	return heap;
+}
+
+void array_heap_destroy(array_heap *heap) {
+	if (!heap) return;
+
+	for (uint32_t slot = 0; slot < heap->count; slot++) free(heap->arrays[slot].items);
+	free(heap->arrays);
+	free(heap->flags);
+	free(heap->free_slots);
+	free(heap);
+}
+
+// What an array counts for against the collection threshold
+static size_t array_bytes(uint64_t length) {
+	return sizeof(array_t) + (size_t)length * sizeof(double);
+}
+
+static int grow_slots(array_heap *heap) {
+	if (heap->capacity >= UINT32_MAX / 2) {
+		fprintf(stderr, "Too many arrays\n");
+		return 0;
+	}
+
+	uint32_t capacity = heap->capacity ? heap->capacity * 2 : 64;
+	array_t *arrays = realloc(heap->arrays, capacity * sizeof(array_t));
+	if (arrays) heap->arrays = arrays;
+	uint8_t *flags = realloc(heap->flags, capacity * sizeof(uint8_t));
+	if (flags) heap->flags = flags;
+	uint32_t *free_slots = realloc(heap->free_slots, capacity * sizeof(uint32_t));
+	if (free_slots) heap->free_slots = free_slots;
+
+	if (!arrays || !flags || !free_slots) {
+		fprintf(stderr, "Memory allocate failed at %s:%d", __FILE__, __LINE__);
+		return 0;
+	}
+	heap->capacity = capacity;
+	return 1;
+}
+
+array_t *array_alloc(array_heap *heap, uint64_t length, double *handle) {
+	double *items = NULL;
+	if (length) {
+		size_t bytes = ((size_t)length * sizeof(double) + ARRAY_ALIGN - 1) & ~(size_t)(ARRAY_ALIGN - 1);
+		items = aligned_alloc(ARRAY_ALIGN, bytes);
+		if (!items) {
+			fprintf(stderr, "Memory allocate failed at %s:%d", __FILE__, __LINE__);
+			return NULL;
+		}
+	}
+
+	uint32_t slot;
+	if (heap->free_count) {
+		slot = heap->free_slots[--heap->free_count];
+	} else {
+		if (heap->count == heap->capacity && !grow_slots(heap)) {
+			free(items);
+			return NULL;
+		}
+		slot = heap->count++;
+	}
+
+	heap->arrays[slot] = (array_t){ items, length };
+	heap->flags[slot] = SLOT_LIVE;
+	heap->allocated += array_bytes(length);
+	*handle = array_handle(slot);
+	return &heap->arrays[slot];
+}
+
+// Slot of a live array's handle, or UINT32_MAX
+static uint32_t live_slot(const array_heap *heap, double value) {
+	if (!array_is_handle(value)) return UINT32_MAX;
+
+	uint64_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	uint32_t slot = (uint32_t)bits;
+	if (slot >= heap->count || !(heap->flags[slot] & SLOT_LIVE)) return UINT32_MAX;
+	return slot;
+}
+
+const array_t *array_lookup(const array_heap *heap, double value) {
+	uint32_t slot = live_slot(heap, value);
+	return slot == UINT32_MAX ? NULL : &heap->arrays[slot];
+}
+
+int array_heap_should_collect(const array_heap *heap) {
+	return heap->allocated >= ARRAY_GC_MIN_BYTES && heap->allocated >= heap->live_bytes;
+}
+
+void array_heap_collect(array_heap *heap, const double *roots, size_t count) {
+	for (size_t i = 0; i < count; i++) {
+		uint32_t slot = live_slot(heap, roots[i]);
+		if (slot != UINT32_MAX) heap->flags[slot] |= SLOT_MARKED;
+	}
+
+	heap->live_bytes = 0;
+	for (uint32_t slot = 0; slot < heap->count; slot++) {
+		uint8_t flags = heap->flags[slot];
+		if (!(flags & SLOT_LIVE)) continue;
+
+		if (flags & SLOT_MARKED) {
+			heap->flags[slot] = SLOT_LIVE;
+			heap->live_bytes += array_bytes(heap->arrays[slot].length);
+			continue;
+		}
+
+		free(heap->arrays[slot].items);
+		heap->arrays[slot] = (array_t){ NULL, 0 };
+		heap->flags[slot] = 0;
+		heap->free_slots[heap->free_count++] = slot;
+	}
+	heap->allocated = 0;
+}
+
+/*
+ * Kernels come in three shapes: both sides arrays (vv), a number on the
+ * left (sv) or on the right (vs). The vector loops finish their last few
+ * elements with the scalar expression, which the hardware rounds exactly
+ * like the packed instruction.
+ */
+
+typedef void (*binary_kernel)(double *out, const double *left, const double *right, size_t count);
+typedef void (*negate_kernel)(double *out, const double *in, size_t count);
+
+enum {
+	SHAPE_VV,
+	SHAPE_SV,
+	SHAPE_VS,
+
+	SHAPE_COUNT
+};
+
+typedef struct {
+	binary_kernel binary[ARRAY_OP_COUNT][SHAPE_COUNT];
+	negate_kernel negate;
+} kernel_set;
+
+#define SCALAR_KERNELS(name, op) \
+	static void name##_vv_scalar(double *out, const double *l, const double *r, size_t n) { \
+		for (size_t i = 0; i < n; i++) out[i] = l[i] op r[i]; \
+	} \
+	static void name##_sv_scalar(double *out, const double *l, const double *r, size_t n) { \
+		const double s = *l; \
+		for (size_t i = 0; i < n; i++) out[i] = s op r[i]; \
+	} \
+	static void name##_vs_scalar(double *out, const double *l, const double *r, size_t n) { \
+		const double s = *r; \
+		for (size_t i = 0; i < n; i++) out[i] = l[i] op s; \
+	}
+
+SCALAR_KERNELS(add, +)
+SCALAR_KERNELS(sub, -)
+SCALAR_KERNELS(mul, *)
+SCALAR_KERNELS(div, /)
+
+static void negate_scalar(double *out, const double *in, size_t n) {
+	for (size_t i = 0; i < n; i++) out[i] = -in[i];
+}
+
+static const kernel_set scalar_kernels = {
+	.binary = {
+		[ARRAY_ADD] = { add_vv_scalar, add_sv_scalar, add_vs_scalar },
+		[ARRAY_SUB] = { sub_vv_scalar, sub_sv_scalar, sub_vs_scalar },
+		[ARRAY_MUL] = { mul_vv_scalar, mul_sv_scalar, mul_vs_scalar },
+		[ARRAY_DIV] = { div_vv_scalar, div_sv_scalar, div_vs_scalar }
+	},
+	.negate = negate_scalar
+};
+
+#ifdef ARRAY_X86
+
+#define SSE2_KERNELS(name, op, packed) \
+	static void name##_vv_sse2(double *out, const double *l, const double *r, size_t n) { \
+		size_t i = 0; \
+		for (; i + 4 <= n; i += 4) { \
+			_mm_storeu_pd(out + i, packed(_mm_loadu_pd(l + i), _mm_loadu_pd(r + i))); \
+			_mm_storeu_pd(out + i + 2, packed(_mm_loadu_pd(l + i + 2), _mm_loadu_pd(r + i + 2))); \
+		} \
+		for (; i < n; i++) out[i] = l[i] op r[i]; \
+	} \
+	static void name##_sv_sse2(double *out, const double *l, const double *r, size_t n) { \
+		const __m128d s = _mm_set1_pd(*l); \
+		size_t i = 0; \
+		for (; i + 4 <= n; i += 4) { \
+			_mm_storeu_pd(out + i, packed(s, _mm_loadu_pd(r + i))); \
+			_mm_storeu_pd(out + i + 2, packed(s, _mm_loadu_pd(r + i + 2))); \
+		} \
+		for (; i < n; i++) out[i] = *l op r[i]; \
+	} \
+	static void name##_vs_sse2(double *out, const double *l, const double *r, size_t n) { \
+		const __m128d s = _mm_set1_pd(*r); \
+		size_t i = 0; \
+		for (; i + 4 <= n; i += 4) { \
+			_mm_storeu_pd(out + i, packed(_mm_loadu_pd(l + i), s)); \
+			_mm_storeu_pd(out + i + 2, packed(_mm_loadu_pd(l + i + 2), s)); \
+		} \
+		for (; i < n; i++) out[i] = l[i] op *r; \
+	}
+
+SSE2_KERNELS(add, +, _mm_add_pd)
+SSE2_KERNELS(sub, -, _mm_sub_pd)
+SSE2_KERNELS(mul, *, _mm_mul_pd)
+SSE2_KERNELS(div, /, _mm_div_pd)
+
+// Flipping the sign bit is what scalar negation does too, NaNs included
+static void negate_sse2(double *out, const double *in, size_t n) {
+	const __m128d sign = _mm_set1_pd(-0.0);
+	size_t i = 0;
+	for (; i + 2 <= n; i += 2) _mm_storeu_pd(out + i, _mm_xor_pd(_mm_loadu_pd(in + i), sign));
+	for (; i < n; i++) out[i] = -in[i];
+}
+
+static const kernel_set sse2_kernels = {
+	.binary = {
+		[ARRAY_ADD] = { add_vv_sse2, add_sv_sse2, add_vs_sse2 },
+		[ARRAY_SUB] = { sub_vv_sse2, sub_sv_sse2, sub_vs_sse2 },
+		[ARRAY_MUL] = { mul_vv_sse2, mul_sv_sse2, mul_vs_sse2 },
+		[ARRAY_DIV] = { div_vv_sse2, div_sv_sse2, div_vs_sse2 }
+	},
+	.negate = negate_sse2
+};
+
+#define AVX __attribute__((target("avx")))
+
+#define AVX_KERNELS(name, op, packed) \
+	static AVX void name##_vv_avx(double *out, const double *l, const double *r, size_t n) { \
+		size_t i = 0; \
+		for (; i + 8 <= n; i += 8) { \
+			_mm256_storeu_pd(out + i, packed(_mm256_loadu_pd(l + i), _mm256_loadu_pd(r + i))); \
+			_mm256_storeu_pd(out + i + 4, packed(_mm256_loadu_pd(l + i + 4), _mm256_loadu_pd(r + i + 4))); \
+		} \
+		for (; i < n; i++) out[i] = l[i] op r[i]; \
+	} \
+	static AVX void name##_sv_avx(double *out, const double *l, const double *r, size_t n) { \
+		const __m256d s = _mm256_set1_pd(*l); \
+		size_t i = 0; \
+		for (; i + 8 <= n; i += 8) { \
+			_mm256_storeu_pd(out + i, packed(s, _mm256_loadu_pd(r + i))); \
+			_mm256_storeu_pd(out + i + 4, packed(s, _mm256_loadu_pd(r + i + 4))); \
+		} \
+		for (; i < n; i++) out[i] = *l op r[i]; \
+	} \
+	static AVX void name##_vs_avx(double *out, const double *l, const double *r, size_t n) { \
+		const __m256d s = _mm256_set1_pd(*r); \
+		size_t i = 0; \
+		for (; i + 8 <= n; i += 8) { \
+			_mm256_storeu_pd(out + i, packed(_mm256_loadu_pd(l + i), s)); \
+			_mm256_storeu_pd(out + i + 4, packed(_mm256_loadu_pd(l + i + 4), s)); \
+		} \
+		for (; i < n; i++) out[i] = l[i] op *r; \
+	}
+
+AVX_KERNELS(add, +, _mm256_add_pd)
+AVX_KERNELS(sub, -, _mm256_sub_pd)
+AVX_KERNELS(mul, *, _mm256_mul_pd)
+AVX_KERNELS(div, /, _mm256_div_pd)
+
+static AVX void negate_avx(double *out, const double *in, size_t n) {
+	const __m256d sign = _mm256_set1_pd(-0.0);
+	size_t i = 0;
+	for (; i + 4 <= n; i += 4) _mm256_storeu_pd(out + i, _mm256_xor_pd(_mm256_loadu_pd(in + i), sign));
+	for (; i < n; i++) out[i] = -in[i];
+}
+
+static const kernel_set avx_kernels = {
+	.binary = {
+		[ARRAY_ADD] = { add_vv_avx, add_sv_avx, add_vs_avx },
+		[ARRAY_SUB] = { sub_vv_avx, sub_sv_avx, sub_vs_avx },
+		[ARRAY_MUL] = { mul_vv_avx, mul_sv_avx, mul_vs_avx },
+		[ARRAY_DIV] = { div_vv_avx, div_sv_avx, div_vs_avx }
+	},
+	.negate = negate_avx
+};
+
+#endif
+
+// NULL until the first kernel call picks a set
+static const kernel_set *selected_kernels;
+
+static const kernel_set *select_kernels(void) {
+	const kernel_set *kernels = &scalar_kernels;
+
+#ifdef ARRAY_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx")) {
+		kernels = &avx_kernels;
+	} else if (__builtin_cpu_supports("sse2")) {
+		kernels = &sse2_kernels;
+	}
+#endif
+
+	// Racing threads all store the same value, so a plain store is fine
+	__atomic_store_n(&selected_kernels, kernels, __ATOMIC_RELAXED);
+	return kernels;
+}
+
+static inline const kernel_set *active_kernels(void) {
+	const kernel_set *kernels = __atomic_load_n(&selected_kernels, __ATOMIC_RELAXED);
+	return kernels ? kernels : select_kernels();
+}
+
+void array_binary(array_op op, double *out, const double *left, int left_scalar,
+	const double *right, int right_scalar, size_t count) {
+	int shape = left_scalar ? SHAPE_SV : right_scalar ? SHAPE_VS : SHAPE_VV;
+	active_kernels()->binary[op][shape](out, left, right, count);
+}
+
+void array_negate(double *out, const double *in, size_t count) {
+	active_kernels()->negate(out, in, count);
+}
@@ -0,0 +1,171 @@
+/*
+ *
+ *		batch.c
+ *		LUMEN LANGUAGE PROJECT
+ *		Rainy101112 - 2025/7/20
+ *
+ */
+
+#include <batch.h>
+#include <arena.h>
+#include <ast.h>
+#include <cache.h>
+#include <compiler.h>
+#include <diag.h>
+#include <lines.h>
+#include <optimize.h>
+#include <pool.h>
+#include <resolve.h>
+#include <source.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+typedef struct {
+	const char *path;
+	diag_buffer diagnostics;
+	size_t bytes;
+	int failed;
+	int cached;
+} batch_file;
+
+typedef struct {
+	batch_file *files;
+	const batch_options *options;
+
+	// One per worker, reset after every file
+	arena_t **arenas;
+} batch_job;
+
+// Resolves and compiles to bytecode; 0 on success. The chunk is kept only for the cache
+static int compile_tree(ast_node *program, chunk_t **kept) {
+	resolve_result scope;
+	if (resolve_ast(program, &scope) != 0) return 1;
+
+	chunk_t *chunk = compile_program(program, &scope);
+	resolve_result_free(&scope);
+	if (!chunk) return 1;
+
+	if (kept) *kept = chunk;
+	else chunk_free(chunk);
+	return 0;
+}
+
+static void compile_one(void *context, size_t index, unsigned worker) {
+	batch_job *job = context;
+	const batch_options *options = job->options;
+	batch_file *file = &job->files[index];
+	arena_t *arena = job->arenas[worker];
+
+	diag_capture(&file->diagnostics);
+
+	source_t *source = source_open(file->path);
+	if (source) file->bytes = source->length;
+
+	// A cached entry stands for a clean earlier compile of the same text
+	cache_t *cache = source && options->cache_dir ? cache_load(options->cache_dir, source->text, source->length) : NULL;
+	if (cache && (cache->has_chunk || !options->compile)) {
+		file->cached = 1;
+		if (options->compile) cache_replay_diagnostics(cache);
+		cache_close(cache);
+		source_close(source);
+		diag_capture(NULL);
+		return;
+	}
+	cache_close(cache);
+
+	line_table lines;
+	line_table_init(&lines, source ? source->text : "", source ? source->length : 0);
+	diag_locate(&lines);
+
+	ast_node *program = source ? parse(source->text, arena) : NULL;
+	uint32_t nesting = parse_nesting();
+	if (program) {
+		flat_ast *layout = options->cache_dir ? flat_ast_build(program) : NULL;
+		chunk_t *chunk = NULL;
+
+		if (options->optimize || options->compile) optimize_ast(program, arena);
+		if (options->compile) file->failed = compile_tree(program, layout ? &chunk : NULL);
+
+		if (layout && !file->failed && !file->diagnostics.error_count) {
+			cache_store(options->cache_dir, source->text, source->length, nesting, layout, chunk, &file->diagnostics);
+		}
+		chunk_free(chunk);
+		flat_ast_free(layout);
+	} else {
+		file->failed = 1;
+	}
+
+	if (file->diagnostics.error_count) file->failed = 1;
+
+	diag_locate(NULL);
+	line_table_free(&lines);
+	source_close(source);
+	arena_reset(arena);
+	diag_capture(NULL);
+}
+
+static double now_seconds(void) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+int batch_compile(const char *const *paths, size_t count, const batch_options *options) {
+	pool_t *pool = pool_create(options->threads);
+	batch_file *files = calloc(count ? count : 1, sizeof(batch_file));
+	arena_t **arenas = pool ? calloc(pool_thread_count(pool), sizeof(arena_t *)) : NULL;
+	int status = 1;
+
+	if (!pool || !files || !arenas) {
+		fprintf(stderr, "Memory allocate failed at %s:%d", __FILE__, __LINE__);
+		goto done;
+	}
+
+	for (unsigned i = 0; i < pool_thread_count(pool); i++) {
+		arenas[i] = arena_create(0);
+		if (!arenas[i]) goto done;
+	}
+	for (size_t i = 0; i < count; i++) files[i].path = paths[i];
+
+	batch_job job = {
+		.files = files,
+		.options = options,
+		.arenas = arenas
+	};
+
+	double start = now_seconds();
+	pool_run(pool, count, compile_one, &job);
+	double elapsed = now_seconds() - start;
+
+	size_t bytes = 0, failed = 0, cached = 0;
+	uint32_t errors = 0, warnings = 0;
+	for (size_t i = 0; i < count; i++) {
+		diag_flush(&files[i].diagnostics, files[i].path, stderr);
+		bytes += files[i].bytes;
+		failed += files[i].failed;
+		cached += files[i].cached;
+		errors += files[i].diagnostics.error_count;
+		warnings += files[i].diagnostics.warning_count;
+	}
+
+	if (options->summary) {
+		fprintf(stderr, "%zu file(s), %zu failed, %zu from cache, %u error(s), %u warning(s)\n", count, failed, cached, errors, warnings);
+		fprintf(stderr, "%.2f MiB in %.3f s on %u thread(s): %.1f files/s, %.2f MiB/s\n",
+			bytes / (1024.0 * 1024.0), elapsed, pool_thread_count(pool),
+			elapsed > 0 ? count / elapsed : 0.0, elapsed > 0 ? bytes / (1024.0 * 1024.0) / elapsed : 0.0);
+	}
+	status = failed ? 1 : 0;
+
+done:
+	if (arenas) {
+		for (unsigned i = 0; i < pool_thread_count(pool); i++) arena_destroy(arenas[i]);
+	}
+	if (files) {
+		for (size_t i = 0; i < count; i++) diag_buffer_free(&files[i].diagnostics);
+	}
+	free(arenas);
+	free(files);
+	pool_destroy(pool);
+	return status;
+}
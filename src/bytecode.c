@@ -0,0 +1,128 @@
+/*
+ *
+ *		bytecode.c
+ *		LUMEN LANGUAGE PROJECT
+ *		Rainy101112 - 2025/7/20
+ *
+ */
+
+#include <bytecode.h>
+#include <mem.h>
+#include <stdlib.h>
+
+const char *opcode_name(opcode_t op) {
+	static const char *names[OP_COUNT] = {
+		[OP_MOVE] = "MOVE",
+		[OP_ADD] = "ADD",
+		[OP_SUB] = "SUB",
+		[OP_MUL] = "MUL",
+		[OP_DIV] = "DIV",
+		[OP_LT] = "LT",
+		[OP_GT] = "GT",
+		[OP_LE] = "LE",
+		[OP_GE] = "GE",
+		[OP_EQ] = "EQ",
+		[OP_NE] = "NE",
+		[OP_AND] = "AND",
+		[OP_OR] = "OR",
+		[OP_NOT] = "NOT",
+		[OP_NEG] = "NEG",
+		[OP_ARRAY] = "ARRAY",
+		[OP_FILL] = "FILL",
+		[OP_INDEX] = "INDEX",
+		[OP_LEN] = "LEN",
+		[OP_VADD] = "VADD",
+		[OP_VSUB] = "VSUB",
+		[OP_VMUL] = "VMUL",
+		[OP_VDIV] = "VDIV",
+		[OP_VNEG] = "VNEG",
+		[OP_JMP] = "JMP",
+		[OP_JMPF] = "JMPF",
+		[OP_JMPT] = "JMPT",
+		[OP_HALT] = "HALT"
+	};
+
+	if (op >= OP_COUNT || !names[op]) return "UNKNOWN";
+	return names[op];
+}
+
+void chunk_free(chunk_t *chunk) {
+	if (!chunk) return;
+
+	mem_free(chunk->code);
+	mem_free(chunk->constants);
+	mem_free(chunk->variables);
+	mem_free(chunk->loops);
+	mem_free(chunk->reductions);
+	mem_free(chunk);
+}
+
+static void print_register(const chunk_t *chunk, uint32_t reg, FILE *out) {
+	if (reg < chunk->variable_count) {
+		fprintf(out, " %s", symbol_name(chunk->variables[reg]));
+	} else if (reg >= chunk->constant_base) {
+		fprintf(out, " #%g", chunk->constants[reg - chunk->constant_base]);
+	} else {
+		fprintf(out, " r%u", reg);
+	}
+}
+
+void chunk_disassemble(const chunk_t *chunk, FILE *out) {
+	for (uint32_t pc = 0; pc < chunk->code_count; pc++) {
+		const instruction_t *ins = &chunk->code[pc];
+		fprintf(out, "%04u  %-5s", pc, opcode_name(ins->op));
+
+		switch (ins->op) {
+			case OP_MOVE:
+			case OP_NOT:
+			case OP_NEG:
+			case OP_LEN:
+			case OP_VNEG:
+				print_register(chunk, ins->a, out);
+				print_register(chunk, ins->b, out);
+				break;
+
+			case OP_ARRAY:
+				print_register(chunk, ins->a, out);
+				print_register(chunk, ins->b, out);
+				fprintf(out, " x%u", ins->c);
+				break;
+
+			case OP_JMP:
+				fprintf(out, " ->%04u", ins->a);
+				break;
+
+			case OP_JMPF:
+			case OP_JMPT:
+				print_register(chunk, ins->a, out);
+				fprintf(out, " ->%04u", ins->b);
+				break;
+
+			case OP_HALT:
+				break;
+
+			default:
+				print_register(chunk, ins->a, out);
+				print_register(chunk, ins->b, out);
+				print_register(chunk, ins->c, out);
+				break;
+		}
+		fputc('\n', out);
+	}
+
+	for (uint32_t i = 0; i < chunk->loop_count; i++) {
+		const parallel_loop *loop = &chunk->loops[i];
+		fprintf(out, "parallel %04u..%04u:", loop->entry, loop->exit);
+		print_register(chunk, loop->induction, out);
+		fprintf(out, " %s", opcode_name(loop->compare));
+		print_register(chunk, loop->limit, out);
+		fprintf(out, " step %d", loop->step);
+
+		for (uint32_t r = 0; r < loop->reduction_count; r++) {
+			const loop_reduction *reduction = &chunk->reductions[loop->first_reduction + r];
+			fprintf(out, ", %s", reduction->kind == REDUCE_SUM ? "sum" : "product");
+			print_register(chunk, reduction->reg, out);
+		}
+		fputc('\n', out);
+	}
+}
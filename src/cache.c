@@ -0,0 +1,553 @@
+/*
+ *
+ *		cache.c
+ *		LUMEN LANGUAGE PROJECT
+ *		Rainy101112 - 2025/7/20
+ *
+ */
+
+#include <cache.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define CACHE_MAGIC "LUMENAST"
+#define CACHE_BYTE_ORDER 0x01020304u
+
+/*
+ * File layout: the header, then each section at the offset the header
+ * gives, aligned for its element type. Names are stored as a table of
+ * name_count + 1 offsets into one byte blob; the first tree_symbol_count
+ * names are the flat AST's symbol table and chunk variables index into
+ * the whole list.
+ */
+typedef struct {
+	char magic[8];
+	uint32_t version;
+	uint32_t byte_order;
+	uint64_t source_hash;
+	uint64_t source_length;
+
+	uint32_t node_count;
+	uint32_t literal_count;
+	uint32_t tree_symbol_count;
+	uint32_t name_count;
+	uint32_t name_bytes;
+
+	uint32_t has_chunk;
+	uint32_t code_count;
+	uint32_t constant_count;
+	uint32_t variable_count;
+	uint32_t constant_base;
+	uint32_t register_count;
+	uint32_t loop_count;
+	uint32_t reduction_count;
+	uint32_t diagnostics_length;
+	uint32_t nesting;			// parse_nesting of the source
+
+	uint64_t literals;
+	uint64_t code;
+	uint64_t constants;
+	uint64_t loops;
+	uint64_t reductions;
+	uint64_t first;
+	uint64_t payload;
+	uint64_t name_offsets;
+	uint64_t variables;
+	uint64_t kinds;
+	uint64_t flags;
+	uint64_t names;
+	uint64_t diagnostics;
+	uint64_t file_size;
+} cache_header;
+
+// Word-at-a-time multiplicative hash; a cache key, not a checksum against tampering
+uint64_t cache_hash(const char *text, size_t length) {
+	const uint64_t multiplier = 0x9E3779B97F4A7C15ull;
+	uint64_t hash = 0xCBF29CE484222325ull ^ length;
+	size_t i = 0;
+
+	for (; i + 8 <= length; i += 8) {
+		uint64_t word;
+		memcpy(&word, text + i, sizeof(word));
+		hash = (hash ^ word) * multiplier;
+		hash ^= hash >> 29;
+	}
+
+	uint64_t tail = 0;
+	memcpy(&tail, text + i, length - i);
+	hash = (hash ^ tail) * multiplier;
+
+	hash ^= hash >> 32;
+	hash *= 0xD6E8FEB86659FD93ull;
+	hash ^= hash >> 32;
+	return hash;
+}
+
+static char *entry_path(const char *directory, uint64_t hash) {
+	size_t length = strlen(directory) + 1 + 16 + sizeof(".lumenc");
+	char *path = malloc(length);
+	if (!path) {
+		fprintf(stderr, "Memory allocate failed at %s:%d", __FILE__, __LINE__);
+		return NULL;
+	}
+	snprintf(path, length, "%s/%016llx.lumenc", directory, (unsigned long long)hash);
+	return path;
+}
+
+static int section_fits(const cache_header *header, uint64_t offset, uint64_t count, size_t element, size_t align) {
+	if (offset % align) return 0;
+	if (offset < sizeof(cache_header) || offset > header->file_size) return 0;
+	return count <= (header->file_size - offset) / element;
+}
+
+static int operand_ok(const cache_header *header, uint32_t reg) {
+	return reg < header->register_count;
+}
+
+/*
+ * Children always follow their parent, and every node but the root has
+ * exactly one parent, so the nodes form a tree rooted at 0 and no walk
+ * over them can loop.
+ */
+static int tree_shaped(const flat_ast *ast) {
+	uint8_t *parented = calloc(ast->count / 8 + 1, 1);
+	if (!parented) {
+		fprintf(stderr, "Memory allocate failed at %s:%d", __FILE__, __LINE__);
+		return 0;
+	}
+
+	int ok = 1;
+	uint32_t linked = 0;
+	for (uint32_t i = 0; ok && i < ast->count; i++) {
+		uint32_t children = flat_child_count(ast, i);
+		if (!children) continue;
+		if (ast->first[i] <= i) ok = 0;
+
+		for (uint32_t c = ast->first[i]; ok && c < ast->first[i] + children; c++) {
+			if (parented[c / 8] & (1u << (c % 8))) ok = 0;
+			parented[c / 8] |= (uint8_t)(1u << (c % 8));
+			linked++;
+		}
+	}
+
+	free(parented);
+	return ok && linked + 1 == ast->count;
+}
+
+// Checks every index the tree and the bytecode hold, so a damaged file cannot send readers out of bounds
+static int validate(const cache_header *header, const flat_ast *ast, const chunk_t *chunk) {
+	for (uint32_t i = 0; i < ast->count; i++) {
+		if (ast->kinds[i] > AST_CONTINUE) return 0;
+
+		uint32_t children = flat_child_count(ast, i);
+		if (children && (ast->first[i] >= ast->count || children > ast->count - ast->first[i])) return 0;
+
+		switch (flat_kind(ast, i)) {
+			case AST_ASSIGNMENT:
+			case AST_VARIABLE:
+				if (ast->payload[i] >= ast->symbol_count) return 0;
+				break;
+			case AST_LITERAL:
+				if (ast->payload[i] >= ast->literal_count || ast->flags[i] > LITERAL_FLOAT) return 0;
+				break;
+			case AST_IF_STMT:
+				if (ast->payload[i] < 2 || ast->payload[i] > 3) return 0;
+				break;
+			case AST_ARRAY:
+				if (ast->flags[i] > FLAT_ARRAY_REPEAT || (ast->flags[i] && ast->payload[i] != 2)) return 0;
+				break;
+			default:
+				break;
+		}
+	}
+	if (ast->count && !tree_shaped(ast)) return 0;
+
+	if (!header->has_chunk) return 1;
+
+	if (header->variable_count > header->constant_base || header->constant_base > header->register_count) return 0;
+	if (header->register_count - header->constant_base != header->constant_count) return 0;
+	if (!chunk->code_count || chunk->code[chunk->code_count - 1].op != OP_HALT) return 0;
+
+	for (uint32_t pc = 0; pc < chunk->code_count; pc++) {
+		const instruction_t *ins = &chunk->code[pc];
+		switch (ins->op) {
+			case OP_MOVE:
+			case OP_NOT:
+			case OP_NEG:
+			case OP_LEN:
+			case OP_VNEG:
+				if (!operand_ok(header, ins->a) || !operand_ok(header, ins->b)) return 0;
+				break;
+			case OP_ADD:
+			case OP_SUB:
+			case OP_MUL:
+			case OP_DIV:
+			case OP_LT:
+			case OP_GT:
+			case OP_LE:
+			case OP_GE:
+			case OP_EQ:
+			case OP_NE:
+			case OP_AND:
+			case OP_OR:
+			case OP_FILL:
+			case OP_INDEX:
+			case OP_VADD:
+			case OP_VSUB:
+			case OP_VMUL:
+			case OP_VDIV:
+				if (!operand_ok(header, ins->a) || !operand_ok(header, ins->b) || !operand_ok(header, ins->c)) return 0;
+				break;
+			case OP_ARRAY:
+				if (!operand_ok(header, ins->a) || ins->b > header->register_count || ins->c > header->register_count - ins->b) return 0;
+				break;
+			case OP_JMP:
+				if (ins->a >= chunk->code_count) return 0;
+				break;
+			case OP_JMPF:
+			case OP_JMPT:
+				if (!operand_ok(header, ins->a) || ins->b >= chunk->code_count) return 0;
+				break;
+			case OP_HALT:
+				break;
+			default:
+				return 0;
+		}
+	}
+
+	// The VM runs parallel loops from their test with its own bound, so their shape is checked too
+	for (uint32_t i = 0; i < chunk->loop_count; i++) {
+		const parallel_loop *loop = &chunk->loops[i];
+		if (loop->entry >= chunk->code_count || loop->test >= chunk->code_count || loop->test + 2 != loop->exit || loop->exit >= chunk->code_count) return 0;
+		if (loop->compare < OP_LT || loop->compare > OP_GE || loop->step == 0) return 0;
+		if (loop->induction >= header->variable_count) return 0;
+		if (loop->limit < header->variable_count || loop->limit >= header->constant_base) return 0;
+
+		const instruction_t *entry = &chunk->code[loop->entry], *test = &chunk->code[loop->test];
+		if (entry->op != OP_JMP || entry->a != loop->test) return 0;
+		if (test[0].op != loop->compare || test[0].b != loop->induction || test[0].c != loop->limit) return 0;
+		if (test[1].op != OP_JMPT || test[1].a != test[0].a) return 0;
+
+		if (loop->first_reduction > chunk->reduction_count || loop->reduction_count > chunk->reduction_count - loop->first_reduction) return 0;
+		for (uint32_t r = 0; r < loop->reduction_count; r++) {
+			const loop_reduction *reduction = &chunk->reductions[loop->first_reduction + r];
+			if (reduction->reg >= header->variable_count || reduction->kind > REDUCE_PRODUCT) return 0;
+		}
+	}
+	return 1;
+}
+
+cache_t *cache_load(const char *directory, const char *text, size_t length) {
+	uint64_t hash = cache_hash(text, length);
+	char *path = entry_path(directory, hash);
+	if (!path) return NULL;
+
+	int fd = open(path, O_RDONLY);
+	free(path);
+	if (fd < 0) return NULL;
+
+	struct stat info;
+	void *mapping = MAP_FAILED;
+	size_t size = 0;
+	if (fstat(fd, &info) == 0 && info.st_size >= (off_t)sizeof(cache_header)) {
+		size = (size_t)info.st_size;
+		mapping = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	}
+	close(fd);
+	if (mapping == MAP_FAILED) return NULL;
+
+	const char *base = mapping;
+	const cache_header *header = mapping;
+	cache_t *cache = NULL;
+
+	if (memcmp(header->magic, CACHE_MAGIC, 8) != 0 || header->version != CACHE_VERSION
+		|| header->byte_order != CACHE_BYTE_ORDER || header->file_size != size
+		|| header->source_hash != hash || header->source_length != length) {
+		goto reject;
+	}
+
+	// Parsing again would fail under the current limit, and must report that itself
+	if (header->nesting > parse_nesting_limit()) goto reject;
+
+	if (!section_fits(header, header->kinds, header->node_count, 1, 1)
+		|| !section_fits(header, header->flags, header->node_count, 1, 1)
+		|| !section_fits(header, header->first, header->node_count, 4, 4)
+		|| !section_fits(header, header->payload, header->node_count, 4, 4)
+		|| !section_fits(header, header->literals, header->literal_count, 8, 8)
+		|| !section_fits(header, header->name_offsets, (uint64_t)header->name_count + 1, 4, 4)
+		|| !section_fits(header, header->names, header->name_bytes, 1, 1)
+		|| !section_fits(header, header->diagnostics, header->diagnostics_length, 1, 1)
+		|| header->tree_symbol_count > header->name_count || header->node_count == 0) {
+		goto reject;
+	}
+	if (header->has_chunk && (!section_fits(header, header->code, header->code_count, sizeof(instruction_t), 16)
+		|| !section_fits(header, header->constants, header->constant_count, 8, 8)
+		|| !section_fits(header, header->variables, header->variable_count, 4, 4)
+		|| !section_fits(header, header->loops, header->loop_count, sizeof(parallel_loop), 4)
+		|| !section_fits(header, header->reductions, header->reduction_count, sizeof(loop_reduction), 4))) {
+		goto reject;
+	}
+
+	cache = calloc(1, sizeof(cache_t));
+	symbol_id *names = malloc((header->name_count ? header->name_count : 1) * sizeof(symbol_id));
+	if (!cache || !names) {
+		fprintf(stderr, "Memory allocate failed at %s:%d", __FILE__, __LINE__);
+		free(names);
+		goto reject;
+	}
+
+	// Names are the only part that has to be translated into this process
+	const uint32_t *name_offsets = (const uint32_t *)(base + header->name_offsets);
+	for (uint32_t i = 0; i < header->name_count; i++) {
+		uint32_t from = name_offsets[i], to = name_offsets[i + 1];
+		if (from > to || to > header->name_bytes) {
+			free(names);
+			goto reject;
+		}
+		names[i] = symbol_intern(base + header->names + from, to - from);
+	}
+
+	cache->ast = (flat_ast){
+		.kinds = (uint8_t *)(base + header->kinds),
+		.flags = (uint8_t *)(base + header->flags),
+		.first = (uint32_t *)(base + header->first),
+		.payload = (uint32_t *)(base + header->payload),
+		.count = header->node_count,
+		.literals = (literal_payload *)(base + header->literals),
+		.literal_count = header->literal_count,
+		.symbols = names,
+		.symbol_count = header->tree_symbol_count
+	};
+
+	if (header->has_chunk) {
+		symbol_id *variables = malloc((header->variable_count ? header->variable_count : 1) * sizeof(symbol_id));
+		if (!variables) {
+			fprintf(stderr, "Memory allocate failed at %s:%d", __FILE__, __LINE__);
+			free(names);
+			goto reject;
+		}
+
+		const uint32_t *indices = (const uint32_t *)(base + header->variables);
+		for (uint32_t i = 0; i < header->variable_count; i++) {
+			variables[i] = indices[i] < header->name_count ? names[indices[i]] : SYMBOL_INVALID;
+		}
+
+		cache->chunk = (chunk_t){
+			.code = (instruction_t *)(base + header->code),
+			.code_count = header->code_count,
+			.constants = (double *)(base + header->constants),
+			.constant_count = header->constant_count,
+			.variables = variables,
+			.variable_count = header->variable_count,
+			.constant_base = header->constant_base,
+			.register_count = header->register_count,
+			.loops = (parallel_loop *)(base + header->loops),
+			.loop_count = header->loop_count,
+			.reductions = (loop_reduction *)(base + header->reductions),
+			.reduction_count = header->reduction_count
+		};
+		cache->has_chunk = 1;
+	}
+
+	cache->diagnostics = base + header->diagnostics;
+	cache->diagnostics_length = header->diagnostics_length;
+	cache->mapping = mapping;
+	cache->mapping_size = size;
+	if (!validate(header, &cache->ast, &cache->chunk)) {
+		cache->mapping = NULL;
+		cache_close(cache);
+		cache = NULL;
+		goto reject;
+	}
+	return cache;
+
+reject:
+	free(cache);
+	munmap(mapping, size);
+	return NULL;
+}
+
+void cache_close(cache_t *cache) {
+	if (!cache) return;
+
+	free(cache->ast.symbols);
+	free(cache->chunk.variables);
+	if (cache->mapping) munmap(cache->mapping, cache->mapping_size);
+	free(cache);
+}
+
+void cache_replay_diagnostics(const cache_t *cache) {
+	const char *line = cache->diagnostics;
+	const char *end = cache->diagnostics + cache->diagnostics_length;
+
+	while (line < end) {
+		const char *newline = memchr(line, '\n', (size_t)(end - line));
+		size_t length = newline ? (size_t)(newline - line) : (size_t)(end - line);
+		diag_report(DIAG_WARNING, "%.*s\n", (int)length, line);
+		line += length + 1;
+	}
+}
+
+static uint64_t place(uint64_t *cursor, uint64_t bytes, uint64_t align) {
+	uint64_t offset = (*cursor + align - 1) & ~(align - 1);
+	*cursor = offset + bytes;
+	return offset;
+}
+
+static int write_at(FILE *file, uint64_t offset, const void *data, size_t bytes) {
+	if (!bytes) return 1;
+	if (fseeko(file, (off_t)offset, SEEK_SET) != 0) return 0;
+	return fwrite(data, 1, bytes, file) == bytes;
+}
+
+int cache_store(const char *directory, const char *text, size_t length, uint32_t nesting,
+	const flat_ast *ast, const chunk_t *chunk, const diag_buffer *diagnostics) {
+	if (!ast || !ast->count) return 1;
+	if (diagnostics && diagnostics->error_count) return 1;
+
+	size_t diagnostics_length = diagnostics ? diagnostics->length : 0;
+	if (diagnostics_length > UINT32_MAX) return 1;
+
+	// Name list: the tree's symbols, then any chunk variable the tree lacks
+	uint32_t name_count = ast->symbol_count;
+	uint32_t *variable_indices = NULL;
+	symbol_id *names = malloc((ast->symbol_count + (chunk ? chunk->variable_count : 0) + 1) * sizeof(symbol_id));
+	if (!names) goto out_of_memory;
+	memcpy(names, ast->symbols, ast->symbol_count * sizeof(symbol_id));
+
+	if (chunk) {
+		variable_indices = malloc((chunk->variable_count ? chunk->variable_count : 1) * sizeof(uint32_t));
+		if (!variable_indices) goto out_of_memory;
+
+		for (uint32_t v = 0; v < chunk->variable_count; v++) {
+			uint32_t i = 0;
+			while (i < name_count && names[i] != chunk->variables[v]) i++;
+			if (i == name_count) names[name_count++] = chunk->variables[v];
+			variable_indices[v] = i;
+		}
+	}
+
+	uint32_t *name_offsets = malloc((name_count + 1) * sizeof(uint32_t));
+	if (!name_offsets) goto out_of_memory;
+	uint64_t name_bytes = 0;
+	for (uint32_t i = 0; i < name_count; i++) {
+		name_offsets[i] = (uint32_t)name_bytes;
+		name_bytes += symbol_length(names[i]);
+	}
+	name_offsets[name_count] = (uint32_t)name_bytes;
+
+	cache_header header = {
+		.version = CACHE_VERSION,
+		.byte_order = CACHE_BYTE_ORDER,
+		.source_hash = cache_hash(text, length),
+		.source_length = length,
+		.node_count = ast->count,
+		.literal_count = ast->literal_count,
+		.tree_symbol_count = ast->symbol_count,
+		.name_count = name_count,
+		.name_bytes = (uint32_t)name_bytes,
+		.has_chunk = chunk != NULL,
+		.diagnostics_length = (uint32_t)diagnostics_length,
+		.nesting = nesting
+	};
+	memcpy(header.magic, CACHE_MAGIC, 8);
+
+	// Widest alignment first, so padding stays small
+	uint64_t cursor = sizeof(cache_header);
+	header.literals = place(&cursor, ast->literal_count * sizeof(literal_payload), 16);
+	if (chunk) {
+		header.code_count = chunk->code_count;
+		header.constant_count = chunk->constant_count;
+		header.variable_count = chunk->variable_count;
+		header.constant_base = chunk->constant_base;
+		header.register_count = chunk->register_count;
+		header.loop_count = chunk->loop_count;
+		header.reduction_count = chunk->reduction_count;
+		header.code = place(&cursor, chunk->code_count * sizeof(instruction_t), 16);
+		header.constants = place(&cursor, chunk->constant_count * sizeof(double), 8);
+		header.variables = place(&cursor, chunk->variable_count * sizeof(uint32_t), 4);
+		header.loops = place(&cursor, chunk->loop_count * sizeof(parallel_loop), 4);
+		header.reductions = place(&cursor, chunk->reduction_count * sizeof(loop_reduction), 4);
+	}
+	header.first = place(&cursor, ast->count * sizeof(uint32_t), 4);
+	header.payload = place(&cursor, ast->count * sizeof(uint32_t), 4);
+	header.name_offsets = place(&cursor, (name_count + 1) * sizeof(uint32_t), 4);
+	header.kinds = place(&cursor, ast->count, 1);
+	header.flags = place(&cursor, ast->count, 1);
+	header.names = place(&cursor, name_bytes, 1);
+	header.diagnostics = place(&cursor, diagnostics_length, 1);
+	header.file_size = cursor;
+
+	char *path = entry_path(directory, header.source_hash);
+	size_t temp_length = path ? strlen(path) + 48 : 0;
+	char *temp = path ? malloc(temp_length) : NULL;
+	if (!temp) {
+		free(path);
+		free(name_offsets);
+		goto out_of_memory;
+	}
+	// Unique per store, not just per process: batch workers may store the same entry at once
+	static uint32_t store_count;
+	snprintf(temp, temp_length, "%s.%ld.%u.tmp", path, (long)getpid(), __atomic_fetch_add(&store_count, 1, __ATOMIC_RELAXED));
+
+	if (mkdir(directory, 0777) != 0 && errno != EEXIST) {
+		fprintf(stderr, "Cannot create cache directory %s: %s\n", directory, strerror(errno));
+	}
+
+	// Written under a temporary name and renamed, so readers never see a partial file
+	int ok = 0;
+	int fd = open(temp, O_WRONLY | O_CREAT | O_EXCL, 0666);
+	FILE *file = fd >= 0 ? fdopen(fd, "wb") : NULL;
+	if (fd >= 0 && !file) close(fd);
+	if (file) {
+		ok = write_at(file, 0, &header, sizeof(header))
+			&& write_at(file, header.literals, ast->literals, ast->literal_count * sizeof(literal_payload))
+			&& write_at(file, header.first, ast->first, ast->count * sizeof(uint32_t))
+			&& write_at(file, header.payload, ast->payload, ast->count * sizeof(uint32_t))
+			&& write_at(file, header.name_offsets, name_offsets, (name_count + 1) * sizeof(uint32_t))
+			&& write_at(file, header.kinds, ast->kinds, ast->count)
+			&& write_at(file, header.flags, ast->flags, ast->count)
+			&& (!diagnostics_length || write_at(file, header.diagnostics, diagnostics->text, diagnostics_length));
+
+		for (uint32_t i = 0; ok && i < name_count; i++) {
+			ok = write_at(file, header.names + name_offsets[i], symbol_name(names[i]), symbol_length(names[i]));
+		}
+
+		if (ok && chunk) {
+			ok = write_at(file, header.code, chunk->code, chunk->code_count * sizeof(instruction_t))
+				&& write_at(file, header.constants, chunk->constants, chunk->constant_count * sizeof(double))
+				&& write_at(file, header.variables, variable_indices, chunk->variable_count * sizeof(uint32_t))
+				&& write_at(file, header.loops, chunk->loops, chunk->loop_count * sizeof(parallel_loop))
+				&& write_at(file, header.reductions, chunk->reductions, chunk->reduction_count * sizeof(loop_reduction));
+		}
+
+		// Trailing empty sections were never written; extend the file over them
+		if (ok) ok = fflush(file) == 0 && ftruncate(fileno(file), (off_t)header.file_size) == 0;
+		if (fclose(file) != 0) ok = 0;
+	}
+
+	if (ok) ok = rename(temp, path) == 0;
+	if (!ok) {
+		fprintf(stderr, "Cannot write cache file %s: %s\n", path, strerror(errno));
+		if (fd >= 0) unlink(temp);
+	}
+
+	free(temp);
+	free(path);
+	free(name_offsets);
+	free(names);
+	free(variable_indices);
+	return ok ? 0 : 1;
+
+out_of_memory:
+	fprintf(stderr, "Memory allocate failed at %s:%d", __FILE__, __LINE__);
+	free(names);
+	free(variable_indices);
+	return 1;
+}
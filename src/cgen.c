@@ -0,0 +1,471 @@
+/*
+ *
+ *		cgen.c
+ *		LUMEN LANGUAGE PROJECT
+ *		Rainy101112 - 2025/7/20
+ *
+ */
+
+#include <cgen.h>
+#include <diag.h>
+#include <symbol.h>
+#include <math.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+
+// Set from the Makefile's $(CC)
+#ifndef LUMEN_CC
+#define LUMEN_CC "cc"
+#endif
+
+// Rounding and NaN handling are pinned by pragmas in the unit itself, so --emit-c output keeps them too
+#define CGEN_FLAGS "-O2"
+
+typedef struct {
+	FILE *out;
+	uint32_t variable_count;
+	uint32_t loop_depth;
+	int indent;
+	int failed;
+} cgen_state;
+
+static void emit_indent(cgen_state *state) {
+	for (int i = 0; i < state->indent; i++) fputc('\t', state->out);
+}
+
+// Shortest of 15 to 17 significant digits that reads back exactly; non-finite values go through their bits, out of the C compiler's sight
+static void emit_number(cgen_state *state, double value) {
+	if (!isfinite(value)) {
+		uint64_t bits;
+		memcpy(&bits, &value, sizeof(bits));
+		fprintf(state->out, "lumen_opaque(0x%016llxull)", (unsigned long long)bits);
+		return;
+	}
+
+	char text[32];
+	for (int precision = 15; precision <= 17; precision++) {
+		snprintf(text, sizeof(text), "%.*g", precision, value);
+		if (strtod(text, NULL) == value) break;
+	}
+
+	// Negative literals are parenthesised so "a - -1.0" never reads as "a--1.0"
+	int negative = signbit(value) != 0;
+	fprintf(state->out, "%s%s%s%s", negative ? "(" : "", text, strpbrk(text, ".e") ? "" : ".0", negative ? ")" : "");
+}
+
+static uint32_t variable_slot(cgen_state *state, symbol_id name, uint32_t slot) {
+	if (slot >= state->variable_count) {
+		diag_report(DIAG_ERROR, "Unresolved variable '%s'\n", symbol_name(name));
+		state->failed = 1;
+		return 0;
+	}
+	return slot;
+}
+
+static const char *binary_operator(token_type_t op) {
+	switch (op) {
+		case TOKEN_OPERATOR_PLUS: return "+";
+		case TOKEN_OPERATOR_MINUS: return "-";
+		case TOKEN_OPERATOR_MULTIPLY: return "*";
+		case TOKEN_OPERATOR_DIVIDE: return "/";
+		case TOKEN_OPERATOR_LESS: return "<";
+		case TOKEN_OPERATOR_GREATER: return ">";
+		case TOKEN_OPERATOR_LESS_EQUAL: return "<=";
+		case TOKEN_OPERATOR_GREATER_EQUAL: return ">=";
+		case TOKEN_OPERATOR_EQUAL: return "==";
+		case TOKEN_OPERATOR_NOT_EQUAL: return "!=";
+		case TOKEN_OPERATOR_AND: return "&&";
+		case TOKEN_OPERATOR_OR: return "||";
+		default: return NULL;
+	}
+}
+
+// Operators whose VM result is 0 or 1; in C they give an int truth value
+static int is_truth_operator(const ast_node *node) {
+	if (node->type == AST_UNARY_OP) return node->data.unop.op == TOKEN_OPERATOR_NOT;
+	if (node->type != AST_BINARY_OP) return 0;
+
+	switch (node->data.binop.op) {
+		case TOKEN_OPERATOR_PLUS:
+		case TOKEN_OPERATOR_MINUS:
+		case TOKEN_OPERATOR_MULTIPLY:
+		case TOKEN_OPERATOR_DIVIDE:
+			return 0;
+		default:
+			return 1;
+	}
+}
+
+static void emit_expression(cgen_state *state, const ast_node *node);
+
+// Emits node as a C int that is nonzero exactly when the VM would see a nonzero value
+static void emit_condition(cgen_state *state, const ast_node *node) {
+	if (!is_truth_operator(node)) {
+		fputc('(', state->out);
+		emit_expression(state, node);
+		fputs(" != 0)", state->out);
+		return;
+	}
+
+	if (node->type == AST_UNARY_OP) {
+		fputs("(!", state->out);
+		emit_condition(state, node->data.unop.operand);
+		fputc(')', state->out);
+		return;
+	}
+
+	// The VM evaluates both sides of && and ||; they have no side effects, so short-circuiting is the same
+	token_type_t op = node->data.binop.op;
+	int logical = op == TOKEN_OPERATOR_AND || op == TOKEN_OPERATOR_OR;
+	const char *text = binary_operator(op);
+	if (!text) {
+		diag_report(DIAG_ERROR, "Unsupported binary operator %d\n", op);
+		state->failed = 1;
+		return;
+	}
+
+	fputc('(', state->out);
+	if (logical) emit_condition(state, node->data.binop.left);
+	else emit_expression(state, node->data.binop.left);
+	fprintf(state->out, " %s ", text);
+	if (logical) emit_condition(state, node->data.binop.right);
+	else emit_expression(state, node->data.binop.right);
+	fputc(')', state->out);
+}
+
+// Every array starts at a literal, so refusing those (and indexing) keeps arrays out of the C code
+static void unsupported_array(cgen_state *state, const ast_node *node) {
+	diag_report_at(DIAG_ERROR, node->start, "Arrays are not supported by lumen build\n");
+	state->failed = 1;
+}
+
+// Emits node as a C double
+static void emit_expression(cgen_state *state, const ast_node *node) {
+	if (state->failed) return;
+
+	switch (node->type) {
+		case AST_VARIABLE:
+			fprintf(state->out, "v%u", variable_slot(state, node->data.variable.name, node->data.variable.slot));
+			break;
+
+		case AST_LITERAL:
+			emit_number(state, literal_as_double(node->data.literal));
+			break;
+
+		case AST_BINARY_OP:
+		case AST_UNARY_OP:
+			if ((node->type == AST_BINARY_OP && node->data.binop.op == TOKEN_OPEN_BRACKET)
+				|| (node->type == AST_UNARY_OP && node->data.unop.op == TOKEN_KEYWORD_LEN)) {
+				unsupported_array(state, node);
+			} else if (is_truth_operator(node)) {
+				fputs("(double)", state->out);
+				emit_condition(state, node);
+			} else if (node->type == AST_UNARY_OP) {
+				if (node->data.unop.op != TOKEN_OPERATOR_MINUS) {
+					diag_report(DIAG_ERROR, "Unsupported unary operator %d\n", node->data.unop.op);
+					state->failed = 1;
+					return;
+				}
+				fputs("lumen_neg(", state->out);
+				emit_expression(state, node->data.unop.operand);
+				fputc(')', state->out);
+			} else {
+				fputc('(', state->out);
+				emit_expression(state, node->data.binop.left);
+				fprintf(state->out, " %s ", binary_operator(node->data.binop.op));
+				emit_expression(state, node->data.binop.right);
+				fputc(')', state->out);
+			}
+			break;
+
+		case AST_ARRAY:
+			unsupported_array(state, node);
+			break;
+
+		default:
+			diag_report(DIAG_ERROR, "Node type %d is not an expression\n", node->type);
+			state->failed = 1;
+			break;
+	}
+}
+
+// An assignment as a C expression, or any other simple statement cast to void
+static void emit_simple(cgen_state *state, const ast_node *node) {
+	if (node->type == AST_ASSIGNMENT) {
+		fprintf(state->out, "v%u = ", variable_slot(state, node->data.assign.name, node->data.assign.slot));
+		emit_expression(state, node->data.assign.value);
+	} else {
+		fputs("(void)", state->out);
+		emit_expression(state, node);
+	}
+}
+
+static void emit_statement(cgen_state *state, const ast_node *node);
+
+// Statements after if, else and loop headers; always braced so an else can never attach to the wrong if
+static void emit_body(cgen_state *state, const ast_node *node) {
+	if (node && node->type == AST_BLOCK) {
+		emit_statement(state, node);
+		return;
+	}
+
+	fputs("{\n", state->out);
+	state->indent++;
+	if (node) {
+		emit_indent(state);
+		emit_statement(state, node);
+	}
+	state->indent--;
+	emit_indent(state);
+	fputs("}\n", state->out);
+}
+
+static void emit_statement(cgen_state *state, const ast_node *node) {
+	if (!node || state->failed) return;
+
+	switch (node->type) {
+		case AST_BLOCK:
+			fputs("{\n", state->out);
+			state->indent++;
+			for (int i = 0; i < node->data.block.count; i++) {
+				emit_indent(state);
+				emit_statement(state, node->data.block.statements[i]);
+			}
+			state->indent--;
+			emit_indent(state);
+			fputs("}\n", state->out);
+			break;
+
+		case AST_IF_STMT: {
+			fputs("if ", state->out);
+			emit_condition(state, node->data.if_stmt.condition);
+			fputc(' ', state->out);
+			emit_body(state, node->data.if_stmt.then_block);
+			if (node->data.if_stmt.else_block) {
+				emit_indent(state);
+				fputs("else ", state->out);
+				emit_body(state, node->data.if_stmt.else_block);
+			}
+			break;
+		}
+
+		case AST_WHILE_LOOP:
+		case AST_FOR_LOOP: {
+			const ast_node *condition, *update = NULL, *body;
+			if (node->type == AST_WHILE_LOOP) {
+				condition = node->data.while_loop.condition;
+				body = node->data.while_loop.body;
+			} else {
+				condition = node->data.for_loop.condition;
+				update = node->data.for_loop.update;
+				body = node->data.for_loop.body;
+
+				// The init runs once before the loop, in its own block so the loop stays one statement
+				if (node->data.for_loop.init) {
+					fputs("{\n", state->out);
+					state->indent++;
+					emit_indent(state);
+					emit_simple(state, node->data.for_loop.init);
+					fputs(";\n", state->out);
+					emit_indent(state);
+				}
+			}
+
+			// A continue runs the update, then the test, as the VM does
+			if (node->type == AST_WHILE_LOOP && condition) {
+				fputs("while ", state->out);
+				emit_condition(state, condition);
+				fputc(' ', state->out);
+			} else {
+				fputs("for (;", state->out);
+				if (condition) {
+					fputc(' ', state->out);
+					emit_condition(state, condition);
+				}
+				fputc(';', state->out);
+				if (update) {
+					fputc(' ', state->out);
+					emit_simple(state, update);
+				}
+				fputs(") ", state->out);
+			}
+
+			state->loop_depth++;
+			emit_body(state, body);
+			state->loop_depth--;
+
+			if (node->type == AST_FOR_LOOP && node->data.for_loop.init) {
+				state->indent--;
+				emit_indent(state);
+				fputs("}\n", state->out);
+			}
+			break;
+		}
+
+		case AST_BREAK:
+		case AST_CONTINUE:
+			if (!state->loop_depth) {
+				diag_report_at(DIAG_ERROR, node->start, "'%s' outside of a loop\n", node->type == AST_BREAK ? "break" : "continue");
+				state->failed = 1;
+				return;
+			}
+			fputs(node->type == AST_BREAK ? "break;\n" : "continue;\n", state->out);
+			break;
+
+		default:
+			emit_simple(state, node);
+			fputs(";\n", state->out);
+			break;
+	}
+}
+
+int cgen_emit(FILE *out, const ast_node *root, const resolve_result *scope) {
+	cgen_state state = { .out = out, .variable_count = scope->slot_count };
+	uint32_t count = scope->slot_count;
+
+	/*
+	 * Every operation rounds on its own (no fused multiply-add), and no
+	 * folding may change the sign of a NaN or a zero: x * -1.0 must not
+	 * become -x, a negation stays a sign flip instead of merging into
+	 * a - b, and 0.0 - x is not -x. GCC needs rounding-math for the last
+	 * one even at -O0. NaN and infinity constants go through lumen_opaque,
+	 * since folded NaN arithmetic does not keep signs the way the
+	 * hardware does.
+	 */
+	fputs("/* Generated by lumen build; do not edit. */\n\n"
+		"#include <stdio.h>\n"
+		"#include <string.h>\n\n"
+		"#if defined(__clang__)\n"
+		"#pragma STDC FP_CONTRACT OFF\n"
+		"#elif defined(__GNUC__)\n"
+		"#pragma GCC optimize(\"fp-contract=off\", \"signaling-nans\", \"rounding-math\")\n"
+		"#endif\n\n", out);
+
+	fprintf(out, "const unsigned lumen_variable_count = %u;\n", count);
+	fputs("const char *const lumen_variable_names[] = {", out);
+	for (uint32_t i = 0; i < count; i++) {
+		fprintf(out, "%s\"%s\"", i ? ", " : " ", symbol_name(scope->names[i]));
+	}
+	fputs(count ? " };\n\n" : " 0 };\n\n", out);
+
+	fputs("static inline double lumen_bits(unsigned long long bits) {\n"
+		"\tdouble value;\n"
+		"\tmemcpy(&value, &bits, sizeof(value));\n"
+		"\treturn value;\n"
+		"}\n\n"
+		"static inline double lumen_neg(double value) {\n"
+		"\tunsigned long long bits;\n"
+		"\tmemcpy(&bits, &value, sizeof(bits));\n"
+		"\treturn lumen_bits(bits ^ 0x8000000000000000ull);\n"
+		"}\n\n"
+		"static inline double lumen_opaque(unsigned long long bits) {\n"
+		"#if defined(__GNUC__)\n"
+		"\t__asm__(\"\" : \"+r\"(bits));\n"
+		"#endif\n"
+		"\treturn lumen_bits(bits);\n"
+		"}\n\n", out);
+
+	fputs("void lumen_run(double *variables) {\n", out);
+	for (uint32_t i = 0; i < count; i++) {
+		fprintf(out, "\tdouble v%u = variables[%u];\t// %s\n", i, i, symbol_name(scope->names[i]));
+	}
+	if (count) fputc('\n', out);
+
+	state.indent = 1;
+	emit_indent(&state);
+	emit_body(&state, root);
+
+	if (count) fputc('\n', out);
+	for (uint32_t i = 0; i < count; i++) {
+		fprintf(out, "\tvariables[%u] = v%u;\n", i, i);
+	}
+	fputs("}\n\n", out);
+
+	fprintf(out, "#ifndef LUMEN_NO_MAIN\n"
+		"int main(void) {\n"
+		"\tdouble variables[%u] = { 0 };\n"
+		"\tlumen_run(variables);\n"
+		"\tfor (unsigned i = 0; i < lumen_variable_count; i++) {\n"
+		"\t\tprintf(\"%%s = %%.17g\\n\", lumen_variable_names[i], variables[i]);\n"
+		"\t}\n"
+		"\treturn 0;\n"
+		"}\n"
+		"#endif\n", count ? count : 1);
+
+	if (state.failed) return -1;
+	return ferror(out) ? -1 : 0;
+}
+
+const char *cgen_compiler(void) {
+	const char *cc = getenv("CC");
+	return cc && *cc ? cc : LUMEN_CC;
+}
+
+// Appends text to the command in single quotes, for the shell popen runs
+static void append_quoted(char *command, const char *text) {
+	char *end = command + strlen(command);
+	*end++ = '\'';
+	for (; *text; text++) {
+		if (*text == '\'') {
+			memcpy(end, "'\\''", 4);
+			end += 4;
+		} else {
+			*end++ = *text;
+		}
+	}
+	*end++ = '\'';
+	*end = '\0';
+}
+
+int cgen_build(const ast_node *root, const resolve_result *scope, const char *output, int shared) {
+	// Emit in full first, so a program that fails to lower never reaches the compiler
+	char *text = NULL;
+	size_t length = 0;
+	FILE *memory = open_memstream(&text, &length);
+	if (!memory) {
+		fprintf(stderr, "Memory allocate failed at %s:%d", __FILE__, __LINE__);
+		return 1;
+	}
+	int emitted = cgen_emit(memory, root, scope);
+	if (fclose(memory) != 0) emitted = -1;
+	if (emitted != 0) {
+		free(text);
+		return 1;
+	}
+
+	const char *cc = cgen_compiler();
+	const char *target = shared ? " -fPIC -shared -DLUMEN_NO_MAIN" : "";
+	char *command = malloc(strlen(cc) + strlen(CGEN_FLAGS) + strlen(target) + 4 * strlen(output) + 32);
+	if (!command) {
+		fprintf(stderr, "Memory allocate failed at %s:%d", __FILE__, __LINE__);
+		free(text);
+		return 1;
+	}
+	sprintf(command, "%s %s%s -x c -o ", cc, CGEN_FLAGS, target);
+	append_quoted(command, output);
+	strcat(command, " -");
+
+	// A compiler that stops reading early must fail the build, not kill it with SIGPIPE
+	void (*previous)(int) = signal(SIGPIPE, SIG_IGN);
+	int status = 1;
+	FILE *pipe = popen(command, "w");
+	if (!pipe) {
+		diag_report(DIAG_ERROR, "Cannot run %s\n", cc);
+	} else {
+		int written = fwrite(text, 1, length, pipe) == length;
+		int result = pclose(pipe);
+		if (result == -1 || !WIFEXITED(result) || WEXITSTATUS(result) != 0) {
+			diag_report(DIAG_ERROR, "C compiler failed: %s\n", command);
+		} else if (written) {
+			status = 0;
+		}
+	}
+
+	signal(SIGPIPE, previous);
+
+	free(command);
+	free(text);
+	return status;
+}
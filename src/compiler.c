@@ -0,0 +1,785 @@
+/*
+ *
+ *		compiler.c
+ *		LUMEN LANGUAGE PROJECT
+ *		Rainy101112 - 2025/7/20
+ *
+ */
+
+#include <compiler.h>
+#include <parallel.h>
+#include <mem.h>
+#include <diag.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Until compilation finishes the number of variables and temporaries is
+ * unknown, so temporaries and constants are emitted as tagged operands and
+ * renumbered into the final register layout by fixup_operands().
+ */
+#define OPERAND_TEMP		0x40000000u
+#define OPERAND_CONSTANT	0x80000000u
+#define OPERAND_INDEX		0x3FFFFFFFu
+
+
+typedef struct {
+	uint32_t *items;
+	uint32_t count;
+	uint32_t capacity;
+} patch_list;
+
+typedef struct {
+	patch_list breaks;
+	patch_list continues;
+} loop_context;
+
+/*
+ * Every expression is typed while it is compiled, and a variable has one
+ * type for the whole program: an array if it is ever assigned one. So
+ * scalar code compiles to exactly the instructions it always did, and the
+ * VM and JIT never meet an array where they expect a number.
+ */
+typedef enum {
+	VALUE_NUMBER,
+	VALUE_ARRAY
+} value_type;
+
+typedef struct {
+	instruction_t *code;
+	uint32_t code_count;
+	uint32_t code_capacity;
+
+	double *constants;
+	uint32_t constant_count;
+	uint32_t constant_capacity;
+
+	// Constant dedup: open addressing over constant index + 1
+	uint32_t *constant_buckets;
+	uint32_t constant_bucket_count;
+
+	uint32_t variable_count;
+
+	// value_type per variable slot
+	uint8_t *slot_types;
+
+	uint32_t temp_top;
+	uint32_t temp_max;
+
+	loop_context *loops;
+	uint32_t loop_count;
+	uint32_t loop_capacity;
+
+	// Loops parallel_analyze accepted; limit is a tagged operand until fixup
+	parallel_loop *parallel;
+	uint32_t parallel_count;
+	uint32_t parallel_capacity;
+	loop_reduction *reductions;
+	uint32_t reduction_count;
+	uint32_t reduction_capacity;
+
+	int failed;
+} compiler_state;
+
+static void *grow_array(compiler_state *state, void *items, uint32_t *capacity, size_t item_size) {
+	uint32_t new_capacity = *capacity ? *capacity * 2 : 16;
+	void *grown = mem_realloc(items, new_capacity * item_size);
+	if (!grown) {
+		fprintf(stderr, "Memory allocate failed at %s:%d", __FILE__, __LINE__);
+		state->failed = 1;
+		return NULL;
+	}
+	*capacity = new_capacity;
+	return grown;
+}
+
+static uint32_t emit(compiler_state *state, opcode_t op, uint32_t a, uint32_t b, uint32_t c) {
+	if (state->code_count == state->code_capacity) {
+		instruction_t *code = grow_array(state, state->code, &state->code_capacity, sizeof(instruction_t));
+		if (!code) return 0;
+		state->code = code;
+	}
+
+	instruction_t *ins = &state->code[state->code_count];
+	ins->op = op;
+	ins->a = a;
+	ins->b = b;
+	ins->c = c;
+	return state->code_count++;
+}
+
+static void patch_jump(compiler_state *state, uint32_t at, uint32_t target) {
+	if (state->failed) return;
+
+	if (state->code[at].op == OP_JMP) state->code[at].a = target;
+	else state->code[at].b = target;
+}
+
+static void patch_list_add(compiler_state *state, patch_list *list, uint32_t at) {
+	if (list->count == list->capacity) {
+		uint32_t *items = grow_array(state, list->items, &list->capacity, sizeof(uint32_t));
+		if (!items) return;
+		list->items = items;
+	}
+	list->items[list->count++] = at;
+}
+
+static void patch_list_resolve(compiler_state *state, patch_list *list, uint32_t target) {
+	for (uint32_t i = 0; i < list->count; i++) {
+		patch_jump(state, list->items[i], target);
+	}
+	mem_free(list->items);
+	memset(list, 0, sizeof(*list));
+}
+
+static uint32_t hash_constant(double value) {
+	uint64_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	bits ^= bits >> 33;
+	bits *= 0xff51afd7ed558ccdULL;
+	bits ^= bits >> 33;
+	return (uint32_t)bits;
+}
+
+static int grow_constant_buckets(compiler_state *state) {
+	uint32_t bucket_count = state->constant_bucket_count ? state->constant_bucket_count * 2 : 64;
+	uint32_t *buckets = mem_calloc(bucket_count, sizeof(uint32_t));
+	if (!buckets) {
+		fprintf(stderr, "Memory allocate failed at %s:%d", __FILE__, __LINE__);
+		state->failed = 1;
+		return 0;
+	}
+
+	for (uint32_t k = 0; k < state->constant_count; k++) {
+		uint32_t slot = hash_constant(state->constants[k]) & (bucket_count - 1);
+		while (buckets[slot]) slot = (slot + 1) & (bucket_count - 1);
+		buckets[slot] = k + 1;
+	}
+
+	mem_free(state->constant_buckets);
+	state->constant_buckets = buckets;
+	state->constant_bucket_count = bucket_count;
+	return 1;
+}
+
+static uint32_t constant_operand(compiler_state *state, double value) {
+	if ((state->constant_count + 1) * 2 > state->constant_bucket_count && !grow_constant_buckets(state)) {
+		return OPERAND_CONSTANT;
+	}
+
+	// Compare bit patterns so -0.0 and NaN payloads stay distinct
+	uint32_t mask = state->constant_bucket_count - 1;
+	uint32_t slot = hash_constant(value) & mask;
+	while (state->constant_buckets[slot]) {
+		uint32_t k = state->constant_buckets[slot] - 1;
+		if (memcmp(&state->constants[k], &value, sizeof(double)) == 0) {
+			return OPERAND_CONSTANT | k;
+		}
+		slot = (slot + 1) & mask;
+	}
+
+	if (state->constant_count == state->constant_capacity) {
+		double *constants = grow_array(state, state->constants, &state->constant_capacity, sizeof(double));
+		if (!constants) return OPERAND_CONSTANT;
+		state->constants = constants;
+	}
+
+	uint32_t k = state->constant_count++;
+	state->constants[k] = value;
+	state->constant_buckets[slot] = k + 1;
+	return OPERAND_CONSTANT | k;
+}
+
+static uint32_t variable_operand(compiler_state *state, symbol_id name, uint32_t slot) {
+	if (slot >= state->variable_count) {
+		diag_report(DIAG_ERROR, "Unresolved variable '%s'\n", symbol_name(name));
+		state->failed = 1;
+		return 0;
+	}
+	return slot;
+}
+
+static uint32_t alloc_temp(compiler_state *state) {
+	uint32_t temp = state->temp_top++;
+	if (state->temp_top > state->temp_max) state->temp_max = state->temp_top;
+	return OPERAND_TEMP | temp;
+}
+
+static opcode_t binary_opcode(token_type_t op) {
+	switch (op) {
+		case TOKEN_OPERATOR_PLUS: return OP_ADD;
+		case TOKEN_OPERATOR_MINUS: return OP_SUB;
+		case TOKEN_OPERATOR_MULTIPLY: return OP_MUL;
+		case TOKEN_OPERATOR_DIVIDE: return OP_DIV;
+		case TOKEN_OPERATOR_LESS: return OP_LT;
+		case TOKEN_OPERATOR_GREATER: return OP_GT;
+		case TOKEN_OPERATOR_LESS_EQUAL: return OP_LE;
+		case TOKEN_OPERATOR_GREATER_EQUAL: return OP_GE;
+		case TOKEN_OPERATOR_EQUAL: return OP_EQ;
+		case TOKEN_OPERATOR_NOT_EQUAL: return OP_NE;
+		case TOKEN_OPERATOR_AND: return OP_AND;
+		case TOKEN_OPERATOR_OR: return OP_OR;
+		default: return OP_COUNT;
+	}
+}
+
+static opcode_t unary_opcode(token_type_t op) {
+	switch (op) {
+		case TOKEN_OPERATOR_MINUS: return OP_NEG;
+		case TOKEN_OPERATOR_NOT: return OP_NOT;
+		case TOKEN_KEYWORD_LEN: return OP_LEN;
+		default: return OP_COUNT;
+	}
+}
+
+// The element-wise form of a scalar opcode, OP_COUNT where arrays are not allowed
+static opcode_t elementwise_opcode(opcode_t op) {
+	switch (op) {
+		case OP_ADD: return OP_VADD;
+		case OP_SUB: return OP_VSUB;
+		case OP_MUL: return OP_VMUL;
+		case OP_DIV: return OP_VDIV;
+		case OP_NEG: return OP_VNEG;
+		default: return OP_COUNT;
+	}
+}
+
+static value_type slot_type(const compiler_state *state, uint32_t slot) {
+	return slot < state->variable_count ? (value_type)state->slot_types[slot] : VALUE_NUMBER;
+}
+
+static void type_error(compiler_state *state, const ast_node *node, const char *message) {
+	diag_report_at(DIAG_ERROR, node->start, "%s\n", message);
+	state->failed = 1;
+}
+
+static value_type expression_type(const compiler_state *state, const ast_node *node) {
+	switch (node->type) {
+		case AST_VARIABLE:
+			return slot_type(state, node->data.variable.slot);
+
+		case AST_ARRAY:
+			return VALUE_ARRAY;
+
+		case AST_BINARY_OP:
+			if (elementwise_opcode(binary_opcode(node->data.binop.op)) == OP_COUNT) return VALUE_NUMBER;
+			if (expression_type(state, node->data.binop.left) == VALUE_ARRAY) return VALUE_ARRAY;
+			return expression_type(state, node->data.binop.right);
+
+		case AST_UNARY_OP:
+			if (node->data.unop.op != TOKEN_OPERATOR_MINUS) return VALUE_NUMBER;
+			return expression_type(state, node->data.unop.operand);
+
+		default:
+			return VALUE_NUMBER;
+	}
+}
+
+// Marks the variables some assignment gives an array; 1 if that found any new ones
+static int infer_slot_types(compiler_state *state, const ast_node *node) {
+	if (!node) return 0;
+
+	int changed = 0;
+	switch (node->type) {
+		case AST_BLOCK:
+			for (int i = 0; i < node->data.block.count; i++) {
+				changed |= infer_slot_types(state, node->data.block.statements[i]);
+			}
+			break;
+
+		case AST_ASSIGNMENT: {
+			uint32_t slot = node->data.assign.slot;
+			if (slot < state->variable_count && state->slot_types[slot] != VALUE_ARRAY
+				&& expression_type(state, node->data.assign.value) == VALUE_ARRAY) {
+				state->slot_types[slot] = VALUE_ARRAY;
+				changed = 1;
+			}
+			break;
+		}
+
+		case AST_IF_STMT:
+			changed |= infer_slot_types(state, node->data.if_stmt.then_block);
+			changed |= infer_slot_types(state, node->data.if_stmt.else_block);
+			break;
+
+		case AST_FOR_LOOP:
+			changed |= infer_slot_types(state, node->data.for_loop.init);
+			changed |= infer_slot_types(state, node->data.for_loop.update);
+			changed |= infer_slot_types(state, node->data.for_loop.body);
+			break;
+
+		case AST_WHILE_LOOP:
+			changed |= infer_slot_types(state, node->data.while_loop.body);
+			break;
+
+		default:
+			break;
+	}
+	return changed;
+}
+
+static value_type compile_expression_into(compiler_state *state, const ast_node *node, uint32_t dest);
+
+// Returns a register holding the value of node, and its type in *type; may allocate a temporary
+static uint32_t compile_operand(compiler_state *state, const ast_node *node, value_type *type) {
+	switch (node->type) {
+		case AST_VARIABLE:
+			*type = slot_type(state, node->data.variable.slot);
+			return variable_operand(state, node->data.variable.name, node->data.variable.slot);
+
+		case AST_LITERAL:
+			*type = VALUE_NUMBER;
+			return constant_operand(state, literal_as_double(node->data.literal));
+
+		default: {
+			uint32_t temp = alloc_temp(state);
+			*type = compile_expression_into(state, node, temp);
+			return temp;
+		}
+	}
+}
+
+// compile_operand for a place that only takes numbers
+static uint32_t compile_number(compiler_state *state, const ast_node *node, const char *message) {
+	value_type type;
+	uint32_t reg = compile_operand(state, node, &type);
+	if (type != VALUE_NUMBER) type_error(state, node, message);
+	return reg;
+}
+
+// [a, b, c] evaluates its elements into consecutive temporaries
+static void compile_array(compiler_state *state, const ast_node *node, uint32_t dest) {
+	const array_literal *array = &node->data.array;
+	uint32_t saved_top = state->temp_top;
+
+	if (array->repeat) {
+		uint32_t value = compile_number(state, array->elements[0], "Array elements must be numbers");
+		uint32_t count = compile_number(state, array->elements[1], "Array length must be a number");
+		emit(state, OP_FILL, dest, value, count);
+	} else {
+		uint32_t first = dest;
+		for (int i = 0; i < array->count; i++) {
+			uint32_t temp = alloc_temp(state);
+			if (i == 0) first = temp;
+			if (compile_expression_into(state, array->elements[i], temp) != VALUE_NUMBER) {
+				type_error(state, array->elements[i], "Array elements must be numbers");
+			}
+		}
+		emit(state, OP_ARRAY, dest, first, (uint32_t)array->count);
+	}
+	state->temp_top = saved_top;
+}
+
+static value_type compile_expression_into(compiler_state *state, const ast_node *node, uint32_t dest) {
+	switch (node->type) {
+		case AST_VARIABLE:
+		case AST_LITERAL: {
+			value_type type;
+			emit(state, OP_MOVE, dest, compile_operand(state, node, &type), 0);
+			return type;
+		}
+
+		case AST_ARRAY:
+			compile_array(state, node, dest);
+			return VALUE_ARRAY;
+
+		case AST_BINARY_OP: {
+			uint32_t saved_top = state->temp_top;
+			value_type left_type, right_type;
+
+			if (node->data.binop.op == TOKEN_OPEN_BRACKET) {
+				uint32_t array = compile_operand(state, node->data.binop.left, &left_type);
+				uint32_t index = compile_number(state, node->data.binop.right, "Array index must be a number");
+				if (left_type != VALUE_ARRAY) type_error(state, node->data.binop.left, "Only arrays can be indexed");
+				emit(state, OP_INDEX, dest, array, index);
+				state->temp_top = saved_top;
+				return VALUE_NUMBER;
+			}
+
+			opcode_t op = binary_opcode(node->data.binop.op);
+			if (op == OP_COUNT) {
+				diag_report(DIAG_ERROR, "Unsupported binary operator %d\n", node->data.binop.op);
+				state->failed = 1;
+				return VALUE_NUMBER;
+			}
+
+			uint32_t left = compile_operand(state, node->data.binop.left, &left_type);
+			uint32_t right = compile_operand(state, node->data.binop.right, &right_type);
+			value_type type = VALUE_NUMBER;
+			if (left_type == VALUE_ARRAY || right_type == VALUE_ARRAY) {
+				if (elementwise_opcode(op) == OP_COUNT) {
+					type_error(state, node, "Arrays only take + - * / and indexing");
+				} else {
+					op = elementwise_opcode(op);
+					type = VALUE_ARRAY;
+				}
+			}
+			emit(state, op, dest, left, right);
+			state->temp_top = saved_top;
+			return type;
+		}
+
+		case AST_UNARY_OP: {
+			opcode_t op = unary_opcode(node->data.unop.op);
+			if (op == OP_COUNT) {
+				diag_report(DIAG_ERROR, "Unsupported unary operator %d\n", node->data.unop.op);
+				state->failed = 1;
+				return VALUE_NUMBER;
+			}
+
+			uint32_t saved_top = state->temp_top;
+			value_type operand_type;
+			uint32_t operand = compile_operand(state, node->data.unop.operand, &operand_type);
+			value_type type = VALUE_NUMBER;
+			if (op == OP_LEN) {
+				if (operand_type != VALUE_ARRAY) type_error(state, node->data.unop.operand, "len() takes an array");
+			} else if (operand_type == VALUE_ARRAY) {
+				if (elementwise_opcode(op) == OP_COUNT) {
+					type_error(state, node, "Arrays only take + - * / and indexing");
+				} else {
+					op = elementwise_opcode(op);
+					type = VALUE_ARRAY;
+				}
+			}
+			emit(state, op, dest, operand, 0);
+			state->temp_top = saved_top;
+			return type;
+		}
+
+		default:
+			diag_report(DIAG_ERROR, "Node type %d is not an expression\n", node->type);
+			state->failed = 1;
+			return VALUE_NUMBER;
+	}
+}
+
+static void compile_statement(compiler_state *state, const ast_node *node);
+
+static loop_context *push_loop(compiler_state *state) {
+	if (state->loop_count == state->loop_capacity) {
+		loop_context *loops = grow_array(state, state->loops, &state->loop_capacity, sizeof(loop_context));
+		if (!loops) return NULL;
+		state->loops = loops;
+	}
+
+	loop_context *loop = &state->loops[state->loop_count++];
+	memset(loop, 0, sizeof(*loop));
+	return loop;
+}
+
+static void pop_loop(compiler_state *state, uint32_t continue_target, uint32_t break_target) {
+	loop_context *loop = &state->loops[--state->loop_count];
+	patch_list_resolve(state, &loop->continues, continue_target);
+	patch_list_resolve(state, &loop->breaks, break_target);
+}
+
+// Bottom-tested loop tail: jump back to body_start while cond holds
+static void compile_loop_test(compiler_state *state, const ast_node *cond, uint32_t body_start) {
+	if (!cond) {
+		emit(state, OP_JMP, body_start, 0, 0);
+		return;
+	}
+
+	uint32_t saved_top = state->temp_top;
+	uint32_t reg = compile_number(state, cond, "An array cannot be a condition");
+	emit(state, OP_JMPT, reg, body_start, 0);
+	state->temp_top = saved_top;
+}
+
+static void record_parallel_loop(compiler_state *state, const parallel_loop *loop, const parallel_plan *plan) {
+	if (state->parallel_count == state->parallel_capacity) {
+		parallel_loop *loops = grow_array(state, state->parallel, &state->parallel_capacity, sizeof(parallel_loop));
+		if (!loops) return;
+		state->parallel = loops;
+	}
+	while (state->reduction_count + plan->reduction_count > state->reduction_capacity) {
+		loop_reduction *reductions = grow_array(state, state->reductions, &state->reduction_capacity, sizeof(loop_reduction));
+		if (!reductions) return;
+		state->reductions = reductions;
+	}
+
+	parallel_loop *recorded = &state->parallel[state->parallel_count++];
+	*recorded = *loop;
+	recorded->first_reduction = state->reduction_count;
+	recorded->reduction_count = plan->reduction_count;
+	if (plan->reduction_count) {
+		memcpy(state->reductions + state->reduction_count, plan->reductions, plan->reduction_count * sizeof(loop_reduction));
+	}
+	state->reduction_count += plan->reduction_count;
+}
+
+// Slices run on their own threads and must not touch the array heap, which only reading does not
+static int allocates_arrays(const compiler_state *state, uint32_t from, uint32_t to) {
+	for (uint32_t pc = from; pc < to; pc++) {
+		switch (state->code[pc].op) {
+			case OP_ARRAY:
+			case OP_FILL:
+			case OP_VADD:
+			case OP_VSUB:
+			case OP_VMUL:
+			case OP_VDIV:
+			case OP_VNEG:
+				return 1;
+			default:
+				break;
+		}
+	}
+	return 0;
+}
+
+/*
+ * Same control flow as any for loop, but the bound is evaluated once into
+ * a temporary that stays reserved for the whole loop, and the test always
+ * has the shape the VM expects of a parallel_loop.
+ */
+static void compile_parallel_for(compiler_state *state, const ast_node *node, const parallel_plan *plan) {
+	compile_statement(state, node->data.for_loop.init);
+
+	uint32_t saved_top = state->temp_top;
+	uint32_t limit = alloc_temp(state);
+	if (compile_expression_into(state, plan->bound, limit) != VALUE_NUMBER) {
+		type_error(state, plan->bound, "An array cannot be compared");
+	}
+
+	parallel_loop loop = {
+		.entry = emit(state, OP_JMP, 0, 0, 0),
+		.induction = plan->induction,
+		.limit = limit,
+		.compare = binary_opcode(plan->compare),
+		.step = plan->step
+	};
+	uint32_t body_start = state->code_count;
+
+	if (!push_loop(state)) return;
+	compile_statement(state, node->data.for_loop.body);
+
+	uint32_t update = state->code_count;
+	compile_statement(state, node->data.for_loop.update);
+
+	loop.test = state->code_count;
+	patch_jump(state, loop.entry, loop.test);
+	uint32_t holds = alloc_temp(state);
+	emit(state, (opcode_t)loop.compare, holds, plan->induction, limit);
+	emit(state, OP_JMPT, holds, body_start, 0);
+	pop_loop(state, update, state->code_count);
+
+	loop.exit = state->code_count;
+	state->temp_top = saved_top;
+	if (!state->failed && !allocates_arrays(state, body_start, loop.test)) record_parallel_loop(state, &loop, plan);
+}
+
+static void compile_statement(compiler_state *state, const ast_node *node) {
+	if (!node || state->failed) return;
+
+	switch (node->type) {
+		case AST_BLOCK:
+			for (int i = 0; i < node->data.block.count; i++) {
+				compile_statement(state, node->data.block.statements[i]);
+			}
+			break;
+
+		case AST_ASSIGNMENT: {
+			uint32_t dest = variable_operand(state, node->data.assign.name, node->data.assign.slot);
+			value_type type = compile_expression_into(state, node->data.assign.value, dest);
+			if (type != slot_type(state, node->data.assign.slot)) {
+				diag_report_at(DIAG_ERROR, node->start, "'%s' holds an array and cannot be assigned a number\n", symbol_name(node->data.assign.name));
+				state->failed = 1;
+			}
+			break;
+		}
+
+		case AST_IF_STMT: {
+			uint32_t saved_top = state->temp_top;
+			uint32_t cond = compile_number(state, node->data.if_stmt.condition, "An array cannot be a condition");
+			state->temp_top = saved_top;
+
+			uint32_t to_else = emit(state, OP_JMPF, cond, 0, 0);
+			compile_statement(state, node->data.if_stmt.then_block);
+
+			if (node->data.if_stmt.else_block) {
+				uint32_t to_end = emit(state, OP_JMP, 0, 0, 0);
+				patch_jump(state, to_else, state->code_count);
+				compile_statement(state, node->data.if_stmt.else_block);
+				patch_jump(state, to_end, state->code_count);
+			} else {
+				patch_jump(state, to_else, state->code_count);
+			}
+			break;
+		}
+
+		case AST_WHILE_LOOP: {
+			uint32_t to_test = emit(state, OP_JMP, 0, 0, 0);
+			uint32_t body_start = state->code_count;
+
+			if (!push_loop(state)) return;
+			compile_statement(state, node->data.while_loop.body);
+
+			uint32_t test = state->code_count;
+			patch_jump(state, to_test, test);
+			compile_loop_test(state, node->data.while_loop.condition, body_start);
+			pop_loop(state, test, state->code_count);
+			break;
+		}
+
+		case AST_FOR_LOOP: {
+			// An array induction variable is an error the ordinary path reports
+			parallel_plan plan;
+			if (parallel_analyze(node, state->variable_count, &plan)) {
+				if (slot_type(state, plan.induction) == VALUE_NUMBER) {
+					compile_parallel_for(state, node, &plan);
+					parallel_plan_free(&plan);
+					break;
+				}
+				parallel_plan_free(&plan);
+			}
+
+			compile_statement(state, node->data.for_loop.init);
+
+			uint32_t to_test = emit(state, OP_JMP, 0, 0, 0);
+			uint32_t body_start = state->code_count;
+
+			if (!push_loop(state)) return;
+			compile_statement(state, node->data.for_loop.body);
+
+			uint32_t update = state->code_count;
+			compile_statement(state, node->data.for_loop.update);
+
+			patch_jump(state, to_test, state->code_count);
+			compile_loop_test(state, node->data.for_loop.condition, body_start);
+			pop_loop(state, update, state->code_count);
+			break;
+		}
+
+		case AST_BREAK:
+		case AST_CONTINUE: {
+			if (!state->loop_count) {
+				diag_report_at(DIAG_ERROR, node->start, "'%s' outside of a loop\n", node->type == AST_BREAK ? "break" : "continue");
+				state->failed = 1;
+				return;
+			}
+
+			loop_context *loop = &state->loops[state->loop_count - 1];
+			uint32_t jump = emit(state, OP_JMP, 0, 0, 0);
+			patch_list_add(state, node->type == AST_BREAK ? &loop->breaks : &loop->continues, jump);
+			break;
+		}
+
+		default: {
+			// Expression statement: evaluated only for the errors it may raise
+			uint32_t saved_top = state->temp_top;
+			value_type type;
+			compile_operand(state, node, &type);
+			state->temp_top = saved_top;
+			break;
+		}
+	}
+}
+
+static uint32_t fixup_register(const chunk_t *chunk, uint32_t operand) {
+	if (operand & OPERAND_CONSTANT) return chunk->constant_base + (operand & OPERAND_INDEX);
+	if (operand & OPERAND_TEMP) return chunk->variable_count + (operand & OPERAND_INDEX);
+	return operand;
+}
+
+static void fixup_operands(chunk_t *chunk) {
+	for (uint32_t pc = 0; pc < chunk->code_count; pc++) {
+		instruction_t *ins = &chunk->code[pc];
+		switch (ins->op) {
+			case OP_JMP:
+			case OP_HALT:
+				break;
+
+			case OP_JMPF:
+			case OP_JMPT:
+				ins->a = fixup_register(chunk, ins->a);
+				break;
+
+			case OP_MOVE:
+			case OP_NOT:
+			case OP_NEG:
+			case OP_LEN:
+			case OP_VNEG:
+			case OP_ARRAY:
+				ins->a = fixup_register(chunk, ins->a);
+				ins->b = fixup_register(chunk, ins->b);
+				break;
+
+			default:
+				ins->a = fixup_register(chunk, ins->a);
+				ins->b = fixup_register(chunk, ins->b);
+				ins->c = fixup_register(chunk, ins->c);
+				break;
+		}
+	}
+}
+
+static void release_state(compiler_state *state) {
+	for (uint32_t i = 0; i < state->loop_count; i++) {
+		mem_free(state->loops[i].breaks.items);
+		mem_free(state->loops[i].continues.items);
+	}
+	mem_free(state->loops);
+	mem_free(state->parallel);
+	mem_free(state->reductions);
+	mem_free(state->code);
+	mem_free(state->constants);
+	mem_free(state->constant_buckets);
+	mem_free(state->slot_types);
+}
+
+chunk_t *compile_program(const ast_node *root, const resolve_result *scope) {
+	if (!root) return NULL;
+
+	compiler_state state = {0};
+	state.variable_count = scope->slot_count;
+	state.slot_types = mem_calloc(scope->slot_count ? scope->slot_count : 1, sizeof(uint8_t));
+	if (!state.slot_types) {
+		fprintf(stderr, "Memory allocate failed at %s:%d", __FILE__, __LINE__);
+		return NULL;
+	}
+
+	// An assignment can make a variable an array only once others are known to be
+	while (infer_slot_types(&state, root)) continue;
+
+	// Array variables start out empty, as number variables start out 0
+	for (uint32_t slot = 0; slot < state.variable_count; slot++) {
+		if (state.slot_types[slot] == VALUE_ARRAY) emit(&state, OP_ARRAY, slot, slot, 0);
+	}
+
+	compile_statement(&state, root);
+	emit(&state, OP_HALT, 0, 0, 0);
+
+	chunk_t *chunk = state.failed ? NULL : mem_alloc(sizeof(chunk_t));
+	symbol_id *variables = chunk ? mem_alloc((scope->slot_count ? scope->slot_count : 1) * sizeof(symbol_id)) : NULL;
+	if (!chunk || !variables) {
+		mem_free(chunk);
+		release_state(&state);
+		return NULL;
+	}
+	if (scope->slot_count) memcpy(variables, scope->names, scope->slot_count * sizeof(symbol_id));
+
+	chunk->code = state.code;
+	chunk->code_count = state.code_count;
+	chunk->constants = state.constants;
+	chunk->constant_count = state.constant_count;
+	chunk->variables = variables;
+	chunk->variable_count = state.variable_count;
+	chunk->constant_base = state.variable_count + state.temp_max;
+	chunk->register_count = chunk->constant_base + state.constant_count;
+	chunk->loops = state.parallel;
+	chunk->loop_count = state.parallel_count;
+	chunk->reductions = state.reductions;
+	chunk->reduction_count = state.reduction_count;
+	fixup_operands(chunk);
+	for (uint32_t i = 0; i < chunk->loop_count; i++) {
+		chunk->loops[i].limit = fixup_register(chunk, chunk->loops[i].limit);
+	}
+
+	state.code = NULL;
+	state.constants = NULL;
+	state.parallel = NULL;
+	state.reductions = NULL;
+	release_state(&state);
+	return chunk;
+}
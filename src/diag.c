@@ -0,0 +1,108 @@
+/*
+ *
+ *		diag.c
+ *		LUMEN LANGUAGE PROJECT
+ *		Rainy101112 - 2025/7/20
+ *
+ */
+
+#include <diag.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+
+static _Thread_local diag_buffer *current;
+static _Thread_local line_table *located;
+
+diag_buffer *diag_capture(diag_buffer *buffer) {
+	diag_buffer *previous = current;
+	current = buffer;
+	return previous;
+}
+
+static int reserve(diag_buffer *buffer, size_t extra) {
+	if (buffer->length + extra <= buffer->capacity) return 1;
+
+	size_t capacity = buffer->capacity ? buffer->capacity : 256;
+	while (capacity < buffer->length + extra) capacity *= 2;
+
+	char *text = realloc(buffer->text, capacity);
+	if (!text) {
+		fprintf(stderr, "Memory allocate failed at %s:%d", __FILE__, __LINE__);
+		return 0;
+	}
+	buffer->text = text;
+	buffer->capacity = capacity;
+	return 1;
+}
+
+line_table *diag_locate(line_table *table) {
+	line_table *previous = located;
+	located = table;
+	return previous;
+}
+
+// prefix, which may be empty, goes in front of the formatted message
+static void report(diag_severity severity, const char *prefix, const char *format, va_list args) {
+	diag_buffer *buffer = current;
+
+	if (!buffer) {
+		fputs(prefix, stderr);
+		vfprintf(stderr, format, args);
+		return;
+	}
+
+	if (severity == DIAG_ERROR) buffer->error_count++;
+	else buffer->warning_count++;
+
+	va_list again;
+	va_copy(again, args);
+	int length = vsnprintf(NULL, 0, format, args);
+	size_t prefix_length = strlen(prefix);
+	if (length < 0 || !reserve(buffer, prefix_length + (size_t)length + 1)) {
+		va_end(again);
+		return;
+	}
+
+	memcpy(buffer->text + buffer->length, prefix, prefix_length);
+	vsnprintf(buffer->text + buffer->length + prefix_length, (size_t)length + 1, format, again);
+	va_end(again);
+	buffer->length += prefix_length + (size_t)length;
+}
+
+void diag_report(diag_severity severity, const char *format, ...) {
+	va_list args;
+	va_start(args, format);
+	report(severity, "", format, args);
+	va_end(args);
+}
+
+void diag_report_at(diag_severity severity, size_t offset, const char *format, ...) {
+	char prefix[48] = "";
+	if (located) {
+		source_position position = line_table_lookup(located, offset);
+		if (position.line) snprintf(prefix, sizeof(prefix), "%zu:%zu: ", position.line, position.column);
+	}
+
+	va_list args;
+	va_start(args, format);
+	report(severity, prefix, format, args);
+	va_end(args);
+}
+
+void diag_flush(const diag_buffer *buffer, const char *prefix, FILE *out) {
+	const char *line = buffer->text;
+	const char *end = buffer->text + buffer->length;
+
+	while (line < end) {
+		const char *newline = memchr(line, '\n', (size_t)(end - line));
+		size_t length = newline ? (size_t)(newline - line) : (size_t)(end - line);
+		fprintf(out, "%s: %.*s\n", prefix, (int)length, line);
+		line += length + 1;
+	}
+}
+
+void diag_buffer_free(diag_buffer *buffer) {
+	free(buffer->text);
+	memset(buffer, 0, sizeof(diag_buffer));
+}
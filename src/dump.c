@@ -0,0 +1,608 @@
+/*
+ *
+ *		dump.c
+ *		LUMEN LANGUAGE PROJECT
+ *		Rainy101112 - 2025/7/20
+ *
+ */
+
+#include <dump.h>
+#include <visit.h>
+#include <lumen.h>
+#include <mem.h>
+#include <symbol.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// The buffer is handed to the stream whenever it would grow past this
+#define DUMP_CHUNK_SIZE (1 << 20)
+
+// Flat walk frames kept on the C stack before it moves to the heap
+#define FLAT_STACK_INLINE 64
+
+typedef struct {
+	char *data;
+	size_t length;
+	size_t capacity;
+	FILE *out;
+	int failed;
+
+	dump_format format;
+	int indent;
+} dump_writer;
+
+/*
+ * Both tree forms are walked into the same events, so each format is
+ * written once. A node's role is the field it fills in its parent.
+ */
+
+typedef enum {
+	ROLE_STATEMENT,
+	ROLE_VALUE,
+	ROLE_LEFT,
+	ROLE_RIGHT,
+	ROLE_OPERAND,
+	ROLE_CONDITION,
+	ROLE_THEN,
+	ROLE_ELSE,
+	ROLE_INIT,
+	ROLE_UPDATE,
+	ROLE_BODY,
+	ROLE_ELEMENT,
+	ROLE_COUNT
+} child_role;
+
+// Text field names; statements, unary operands and array elements have none
+static const char *const role_labels[] = {
+	NULL, "Value", "Left", "Right", NULL, "Condition", "Then", "Else", "Init", "Update", "Body", NULL, "Count"
+};
+
+static const char *const role_keys[] = {
+	NULL, "value", "left", "right", "operand", "condition", "then", "else", "init", "update", "body", NULL, "count"
+};
+
+static const child_role binop_roles[] = { ROLE_LEFT, ROLE_RIGHT };
+static const child_role if_roles[] = { ROLE_CONDITION, ROLE_THEN, ROLE_ELSE };
+static const child_role for_roles[] = { ROLE_INIT, ROLE_CONDITION, ROLE_UPDATE, ROLE_BODY };
+static const child_role while_roles[] = { ROLE_CONDITION, ROLE_BODY };
+static const child_role repeat_roles[] = { ROLE_VALUE, ROLE_COUNT };
+
+typedef struct {
+	ast_node_type kind;
+	token_type_t op;
+	symbol_id name;
+	literal_value literal;
+
+	uint32_t depth;		// 0 at the root, where role, first and skipped mean nothing
+	child_role role;
+	uint8_t first;		// First statement of its block
+	uint8_t skipped;	// Absent for-header parts right before this child
+	uint8_t repeat;		// An array written [value; count]
+} dump_node;
+
+static int flush(dump_writer *w) {
+	if (w->length && !w->failed && fwrite(w->data, 1, w->length, w->out) != w->length) w->failed = 1;
+	w->length = 0;
+	return !w->failed;
+}
+
+// Room for n more bytes at the end of the buffer, or NULL once output has failed
+static char *reserve(dump_writer *w, size_t n) {
+	if (w->length + n > w->capacity) {
+		if (!flush(w)) return NULL;
+		if (n > w->capacity) {
+			char *grown = mem_realloc(w->data, n);
+			if (!grown) {
+				fprintf(stderr, "Memory allocate failed at %s:%d", __FILE__, __LINE__);
+				w->failed = 1;
+				return NULL;
+			}
+			w->data = grown;
+			w->capacity = n;
+		}
+	}
+	return w->data + w->length;
+}
+
+static void put_bytes(dump_writer *w, const char *bytes, size_t n) {
+	char *at = reserve(w, n);
+	if (!at) return;
+	memcpy(at, bytes, n);
+	w->length += n;
+}
+
+static void put_string(dump_writer *w, const char *text) {
+	put_bytes(w, text, strlen(text));
+}
+
+static void put_char(dump_writer *w, char c) {
+	char *at = reserve(w, 1);
+	if (!at) return;
+	*at = c;
+	w->length++;
+}
+
+static void put_spaces(dump_writer *w, int n) {
+	if (n <= 0) return;
+	char *at = reserve(w, (size_t)n);
+	if (!at) return;
+	memset(at, ' ', (size_t)n);
+	w->length += (size_t)n;
+}
+
+static void put_integer(dump_writer *w, int64_t value) {
+	char digits[24];
+	char *end = digits + sizeof(digits), *p = end;
+
+	// Negate as unsigned so INT64_MIN does not overflow
+	uint64_t magnitude = value < 0 ? -(uint64_t)value : (uint64_t)value;
+	do {
+		*--p = (char)('0' + magnitude % 10);
+		magnitude /= 10;
+	} while (magnitude);
+	if (value < 0) *--p = '-';
+
+	put_bytes(w, p, (size_t)(end - p));
+}
+
+// Shortest of 15 to 17 significant digits that reads back exactly, keeping a '.' or exponent
+static void put_float(dump_writer *w, double value) {
+	if (isnan(value)) {
+		put_string(w, "nan");
+		return;
+	}
+	if (isinf(value)) {
+		put_string(w, value < 0 ? "-inf" : "inf");
+		return;
+	}
+
+	char text[32];
+	for (int precision = 15; precision <= 17; precision++) {
+		snprintf(text, sizeof(text), "%.*g", precision, value);
+		if (strtod(text, NULL) == value) break;
+	}
+	put_string(w, text);
+	if (!strpbrk(text, ".e")) put_string(w, ".0");
+}
+
+static void put_json_name(dump_writer *w, symbol_id name) {
+	const char *text = symbol_name(name);
+	size_t length = symbol_length(name);
+
+	put_char(w, '"');
+	for (size_t i = 0; i < length; i++) {
+		unsigned char c = (unsigned char)text[i];
+		if (c == '"' || c == '\\') {
+			put_char(w, '\\');
+			put_char(w, (char)c);
+		} else if (c < 0x20) {
+			char escape[8];
+			snprintf(escape, sizeof(escape), "\\u%04x", c);
+			put_string(w, escape);
+		} else {
+			put_char(w, (char)c);
+		}
+	}
+	put_char(w, '"');
+}
+
+static const char *operator_string(token_type_t op) {
+	switch (op) {
+		case TOKEN_OPERATOR_PLUS: return "+";
+		case TOKEN_OPERATOR_MINUS: return "-";
+		case TOKEN_OPERATOR_MULTIPLY: return "*";
+		case TOKEN_OPERATOR_DIVIDE: return "/";
+		case TOKEN_OPERATOR_LESS: return "<";
+		case TOKEN_OPERATOR_GREATER: return ">";
+		case TOKEN_OPERATOR_LESS_EQUAL: return "<=";
+		case TOKEN_OPERATOR_GREATER_EQUAL: return ">=";
+		case TOKEN_OPERATOR_EQUAL: return "==";
+		case TOKEN_OPERATOR_NOT_EQUAL: return "!=";
+		case TOKEN_OPERATOR_AND: return "&&";
+		case TOKEN_OPERATOR_OR: return "||";
+		case TOKEN_OPERATOR_NOT: return "!";
+		case TOKEN_OPEN_BRACKET: return "[]";
+		case TOKEN_KEYWORD_LEN: return "len";
+		default: return "UNKNOWN";
+	}
+}
+
+// Starts a text line at the given column
+static void put_line_start(dump_writer *w, int column) {
+	put_bytes(w, LOG_LEVEL_LOGGER, sizeof(LOG_LEVEL_LOGGER) - 1);
+	put_spaces(w, column);
+}
+
+/*
+ * DUMP_TEXT. Children sit 4 columns right of their parent, under a field
+ * name 2 columns in. Integers print exactly, floats with %f.
+ */
+static void enter_text(dump_writer *w, const dump_node *n) {
+	int indent = w->indent + 4 * (int)n->depth;
+
+	if (n->depth && role_labels[n->role]) {
+		put_line_start(w, indent - 2);
+		put_string(w, role_labels[n->role]);
+		put_string(w, ":\n");
+	}
+
+	put_line_start(w, indent);
+	switch (n->kind) {
+		case AST_BLOCK:
+			put_string(w, "BLOCK:\n");
+			break;
+
+		case AST_ASSIGNMENT:
+			put_string(w, "ASSIGNMENT:\n");
+			put_line_start(w, indent + 2);
+			put_string(w, "Variable: ");
+			put_string(w, symbol_name(n->name));
+			put_char(w, '\n');
+			break;
+
+		case AST_BINARY_OP:
+		case AST_UNARY_OP:
+			put_string(w, n->kind == AST_BINARY_OP ? "BINARY_OP (" : "UNARY_OP (");
+			put_string(w, operator_string(n->op));
+			put_string(w, "):\n");
+			break;
+
+		case AST_VARIABLE:
+			put_string(w, "VARIABLE: ");
+			put_string(w, symbol_name(n->name));
+			put_char(w, '\n');
+			break;
+
+		case AST_LITERAL:
+			put_string(w, "LITERAL: ");
+			if (n->literal.kind == LITERAL_INTEGER) {
+				put_integer(w, n->literal.as.integer);
+			} else {
+				// %f of the largest double needs 309 digits before the point
+				char *at = reserve(w, 320);
+				if (at) w->length += (size_t)snprintf(at, 320, "%f", n->literal.as.number);
+			}
+			put_char(w, '\n');
+			break;
+
+		case AST_ARRAY:
+			put_string(w, n->repeat ? "ARRAY (repeat):\n" : "ARRAY:\n");
+			break;
+
+		case AST_IF_STMT:
+			put_string(w, "IF_STATEMENT:\n");
+			break;
+
+		case AST_FOR_LOOP:
+			put_string(w, "FOR_LOOP:\n");
+			break;
+
+		case AST_WHILE_LOOP:
+			put_string(w, "WHILE_LOOP:\n");
+			break;
+
+		case AST_BREAK:
+			put_string(w, "BREAK\n");
+			break;
+
+		case AST_CONTINUE:
+			put_string(w, "CONTINUE\n");
+			break;
+
+		default:
+			put_string(w, "UNKNOWN_NODE_TYPE: ");
+			put_integer(w, n->kind);
+			put_char(w, '\n');
+			break;
+	}
+}
+
+// DUMP_SEXPR. Leaves are atoms, everything else a list opened here and closed in leave_sexpr
+static void enter_sexpr(dump_writer *w, const dump_node *n) {
+	if (n->depth) {
+		for (int i = 0; i < n->skipped; i++) put_string(w, " nil");
+		put_char(w, ' ');
+	}
+
+	switch (n->kind) {
+		case AST_BLOCK: put_string(w, "(block"); break;
+		case AST_IF_STMT: put_string(w, "(if"); break;
+		case AST_FOR_LOOP: put_string(w, "(for"); break;
+		case AST_WHILE_LOOP: put_string(w, "(while"); break;
+		case AST_BREAK: put_string(w, "(break"); break;
+		case AST_CONTINUE: put_string(w, "(continue"); break;
+		case AST_ARRAY: put_string(w, n->repeat ? "(repeat" : "(array"); break;
+
+		case AST_ASSIGNMENT:
+			put_string(w, "(= ");
+			put_string(w, symbol_name(n->name));
+			break;
+
+		case AST_BINARY_OP:
+		case AST_UNARY_OP:
+			put_char(w, '(');
+			put_string(w, operator_string(n->op));
+			break;
+
+		case AST_VARIABLE:
+			put_string(w, symbol_name(n->name));
+			break;
+
+		case AST_LITERAL:
+			if (n->literal.kind == LITERAL_INTEGER) put_integer(w, n->literal.as.integer);
+			else put_float(w, n->literal.as.number);
+			break;
+
+		default:
+			put_string(w, "(unknown ");
+			put_integer(w, n->kind);
+			break;
+	}
+}
+
+static void leave_sexpr(dump_writer *w, const dump_node *n) {
+	if (n->kind != AST_VARIABLE && n->kind != AST_LITERAL) put_char(w, ')');
+}
+
+// A block's statements and an array's elements are JSON arrays rather than fields
+static int listed_role(child_role role) {
+	return role == ROLE_STATEMENT || role == ROLE_ELEMENT;
+}
+
+// DUMP_JSON. Every field but list items follows "type", so only list items can come first
+static void enter_json(dump_writer *w, const dump_node *n) {
+	if (n->depth) {
+		if (!listed_role(n->role) || !n->first) put_char(w, ',');
+		if (!listed_role(n->role)) {
+			put_char(w, '"');
+			put_string(w, role_keys[n->role]);
+			put_string(w, "\":");
+		}
+	}
+
+	switch (n->kind) {
+		case AST_BLOCK: put_string(w, "{\"type\":\"block\",\"statements\":["); break;
+		case AST_IF_STMT: put_string(w, "{\"type\":\"if\""); break;
+		case AST_FOR_LOOP: put_string(w, "{\"type\":\"for\""); break;
+		case AST_WHILE_LOOP: put_string(w, "{\"type\":\"while\""); break;
+		case AST_BREAK: put_string(w, "{\"type\":\"break\""); break;
+		case AST_CONTINUE: put_string(w, "{\"type\":\"continue\""); break;
+		case AST_ARRAY: put_string(w, n->repeat ? "{\"type\":\"array\"" : "{\"type\":\"array\",\"elements\":["); break;
+
+		case AST_ASSIGNMENT:
+		case AST_VARIABLE:
+			put_string(w, n->kind == AST_ASSIGNMENT ? "{\"type\":\"assignment\",\"name\":" : "{\"type\":\"variable\",\"name\":");
+			put_json_name(w, n->name);
+			break;
+
+		case AST_BINARY_OP:
+		case AST_UNARY_OP:
+			put_string(w, n->kind == AST_BINARY_OP ? "{\"type\":\"binary\",\"op\":\"" : "{\"type\":\"unary\",\"op\":\"");
+			put_string(w, operator_string(n->op));
+			put_char(w, '"');
+			break;
+
+		case AST_LITERAL:
+			if (n->literal.kind == LITERAL_INTEGER) {
+				put_string(w, "{\"type\":\"literal\",\"kind\":\"integer\",\"value\":");
+				put_integer(w, n->literal.as.integer);
+			} else {
+				put_string(w, "{\"type\":\"literal\",\"kind\":\"float\",\"value\":");
+				int finite = isfinite(n->literal.as.number);
+				if (!finite) put_char(w, '"');
+				put_float(w, n->literal.as.number);
+				if (!finite) put_char(w, '"');
+			}
+			break;
+
+		default:
+			put_string(w, "{\"type\":\"unknown\",\"kind\":");
+			put_integer(w, n->kind);
+			break;
+	}
+}
+
+static void leave_json(dump_writer *w, const dump_node *n) {
+	put_string(w, n->kind == AST_BLOCK || (n->kind == AST_ARRAY && !n->repeat) ? "]}" : "}");
+}
+
+static void enter(dump_writer *w, const dump_node *n) {
+	switch (w->format) {
+		case DUMP_SEXPR: enter_sexpr(w, n); break;
+		case DUMP_JSON: enter_json(w, n); break;
+		default: enter_text(w, n); break;
+	}
+}
+
+static void leave(dump_writer *w, const dump_node *n) {
+	switch (w->format) {
+		case DUMP_SEXPR: leave_sexpr(w, n); break;
+		case DUMP_JSON: leave_json(w, n); break;
+		default: break;
+	}
+}
+
+// Role of child position index (the positions of ast_child) under a parent of kind
+static child_role positional_role(ast_node_type kind, int repeat, int index) {
+	switch (kind) {
+		case AST_ARRAY: return repeat ? repeat_roles[index] : ROLE_ELEMENT;
+		case AST_ASSIGNMENT: return ROLE_VALUE;
+		case AST_BINARY_OP: return binop_roles[index];
+		case AST_UNARY_OP: return ROLE_OPERAND;
+		case AST_IF_STMT: return if_roles[index];
+		case AST_FOR_LOOP: return for_roles[index];
+		case AST_WHILE_LOOP: return while_roles[index];
+		default: return ROLE_STATEMENT;
+	}
+}
+
+static ast_visit_action enter_pointer(ast_node *node, const ast_visit_position *at, void *context) {
+	dump_node n = { .kind = node->type, .depth = at->depth };
+
+	switch (node->type) {
+		case AST_ARRAY: n.repeat = node->data.array.repeat; break;
+		case AST_ASSIGNMENT: n.name = node->data.assign.name; break;
+		case AST_BINARY_OP: n.op = node->data.binop.op; break;
+		case AST_UNARY_OP: n.op = node->data.unop.op; break;
+		case AST_VARIABLE: n.name = node->data.variable.name; break;
+		case AST_LITERAL: n.literal = node->data.literal; break;
+		default: break;
+	}
+
+	if (at->parent) {
+		int repeat = at->parent->type == AST_ARRAY && at->parent->data.array.repeat;
+		n.role = positional_role(at->parent->type, repeat, at->index);
+		n.first = at->index == 0;
+		if (at->parent->type == AST_FOR_LOOP) {
+			for (int i = at->index - 1; i >= 0 && !ast_child(at->parent, i); i--) n.skipped++;
+		}
+	}
+
+	enter(context, &n);
+	return AST_VISIT_CONTINUE;
+}
+
+static void leave_pointer(ast_node *node, const ast_visit_position *at, void *context) {
+	dump_node n = { .kind = node->type, .depth = at->depth };
+	if (node->type == AST_ARRAY) n.repeat = node->data.array.repeat;
+	leave(context, &n);
+}
+
+static int begin(dump_writer *w, FILE *out, dump_format format, int indent) {
+	*w = (dump_writer){ .out = out, .format = format, .indent = indent };
+	w->data = mem_alloc(DUMP_CHUNK_SIZE);
+	if (!w->data) {
+		fprintf(stderr, "Memory allocate failed at %s:%d", __FILE__, __LINE__);
+		return 0;
+	}
+	w->capacity = DUMP_CHUNK_SIZE;
+	return 1;
+}
+
+static int finish(dump_writer *w, int empty) {
+	if (w->format != DUMP_TEXT) {
+		if (empty) put_string(w, w->format == DUMP_JSON ? "null" : "nil");
+		put_char(w, '\n');
+	}
+	flush(w);
+	mem_free(w->data);
+	return w->failed ? -1 : 0;
+}
+
+int dump_format_parse(const char *name) {
+	if (strcmp(name, "text") == 0) return DUMP_TEXT;
+	if (strcmp(name, "sexpr") == 0) return DUMP_SEXPR;
+	if (strcmp(name, "json") == 0) return DUMP_JSON;
+	return -1;
+}
+
+int dump_ast(FILE *out, ast_node *root, dump_format format, int indent) {
+	static const ast_visitor visitor = { enter_pointer, leave_pointer };
+
+	dump_writer w;
+	if (!begin(&w, out, format, indent)) return -1;
+	if (!ast_visit(root, &visitor, &w)) w.failed = 1;
+	return finish(&w, root == NULL);
+}
+
+typedef struct {
+	flat_index node;
+	uint32_t next;
+	uint32_t count;
+} flat_frame;
+
+static void describe_flat(const flat_ast *ast, flat_index node, dump_node *n) {
+	n->kind = flat_kind(ast, node);
+	switch (n->kind) {
+		case AST_ASSIGNMENT:
+		case AST_VARIABLE:
+			n->name = flat_symbol(ast, node);
+			break;
+		case AST_BINARY_OP:
+		case AST_UNARY_OP:
+			n->op = flat_operator(ast, node);
+			break;
+		case AST_LITERAL:
+			n->literal = flat_literal(ast, node);
+			break;
+		case AST_ARRAY:
+			n->repeat = (ast->flags[node] & FLAT_ARRAY_REPEAT) != 0;
+			break;
+		default:
+			break;
+	}
+}
+
+// Role of the index-th stored child; for loops store only their present header parts
+static void flat_role(const flat_ast *ast, flat_index parent, uint32_t index, dump_node *n) {
+	n->first = index == 0;
+	if (flat_kind(ast, parent) != AST_FOR_LOOP) {
+		int repeat = flat_kind(ast, parent) == AST_ARRAY && (ast->flags[parent] & FLAT_ARRAY_REPEAT);
+		n->role = positional_role(flat_kind(ast, parent), repeat, (int)index);
+		return;
+	}
+
+	uint8_t mask = ast->flags[parent] | 0x8;	// The body is always there
+	int position = 0;
+	for (uint32_t seen = 0;; position++) {
+		if (mask & (1u << position)) {
+			if (seen == index) break;
+			seen++;
+		}
+	}
+	n->role = for_roles[position];
+	for (int i = position - 1; i >= 0 && !(mask & (1u << i)); i--) n->skipped++;
+}
+
+int dump_flat_ast(FILE *out, const flat_ast *ast, flat_index root, dump_format format, int indent) {
+	dump_writer w;
+	if (!begin(&w, out, format, indent)) return -1;
+
+	int empty = !ast || root == FLAT_NONE;
+	flat_frame inline_frames[FLAT_STACK_INLINE];
+	flat_frame *frames = inline_frames;
+	uint32_t count = 0, capacity = FLAT_STACK_INLINE;
+
+	dump_node n = { 0 };
+	flat_index node = empty ? FLAT_NONE : root;
+	while (node != FLAT_NONE) {
+		describe_flat(ast, node, &n);
+		n.depth = count;
+		enter(&w, &n);
+
+		if (count == capacity) {
+			flat_frame *grown = mem_alloc(2 * capacity * sizeof(flat_frame));
+			if (!grown) {
+				fprintf(stderr, "Memory allocate failed at %s:%d", __FILE__, __LINE__);
+				w.failed = 1;
+				break;
+			}
+			memcpy(grown, frames, count * sizeof(flat_frame));
+			if (frames != inline_frames) mem_free(frames);
+			frames = grown;
+			capacity *= 2;
+		}
+		frames[count++] = (flat_frame){ node, 0, flat_child_count(ast, node) };
+
+		// Close finished nodes until one has a child left, then step into it
+		node = FLAT_NONE;
+		while (count) {
+			flat_frame *top = &frames[count - 1];
+			if (top->next < top->count) {
+				n = (dump_node){ 0 };
+				flat_role(ast, top->node, top->next, &n);
+				node = flat_child(ast, top->node, top->next++);
+				break;
+			}
+
+			count--;
+			dump_node closing = { .kind = flat_kind(ast, top->node), .depth = count };
+			describe_flat(ast, top->node, &closing);
+			leave(&w, &closing);
+		}
+	}
+
+	if (frames != inline_frames) mem_free(frames);
+	return finish(&w, empty);
+}
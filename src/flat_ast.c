@@ -0,0 +1,259 @@
+/*
+ *
+ *		flat_ast.c
+ *		LUMEN LANGUAGE PROJECT
+ *		Rainy101112 - 2025/7/20
+ *
+ */
+
+#include <flat_ast.h>
+#include <mem.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+	flat_ast *ast;
+	flat_index next_node;
+
+	// Maps interned ids to this tree's symbol slots
+	uint32_t *symbol_slots;
+	uint32_t symbol_slot_count;
+} flat_builder;
+
+static void count_nodes(const ast_node *node, uint32_t *nodes, uint32_t *literals) {
+	if (!node) return;
+
+	(*nodes)++;
+	switch (node->type) {
+		case AST_BLOCK:
+			for (int i = 0; i < node->data.block.count; i++) {
+				count_nodes(node->data.block.statements[i], nodes, literals);
+			}
+			break;
+
+		case AST_ASSIGNMENT:
+			count_nodes(node->data.assign.value, nodes, literals);
+			break;
+
+		case AST_BINARY_OP:
+			count_nodes(node->data.binop.left, nodes, literals);
+			count_nodes(node->data.binop.right, nodes, literals);
+			break;
+
+		case AST_UNARY_OP:
+			count_nodes(node->data.unop.operand, nodes, literals);
+			break;
+
+		case AST_LITERAL:
+			(*literals)++;
+			break;
+
+		case AST_ARRAY:
+			for (int i = 0; i < node->data.array.count; i++) {
+				count_nodes(node->data.array.elements[i], nodes, literals);
+			}
+			break;
+
+		case AST_IF_STMT:
+			count_nodes(node->data.if_stmt.condition, nodes, literals);
+			count_nodes(node->data.if_stmt.then_block, nodes, literals);
+			count_nodes(node->data.if_stmt.else_block, nodes, literals);
+			break;
+
+		case AST_FOR_LOOP:
+			count_nodes(node->data.for_loop.init, nodes, literals);
+			count_nodes(node->data.for_loop.condition, nodes, literals);
+			count_nodes(node->data.for_loop.update, nodes, literals);
+			count_nodes(node->data.for_loop.body, nodes, literals);
+			break;
+
+		case AST_WHILE_LOOP:
+			count_nodes(node->data.while_loop.condition, nodes, literals);
+			count_nodes(node->data.while_loop.body, nodes, literals);
+			break;
+
+		default:
+			break;
+	}
+}
+
+static uint32_t symbol_slot(flat_builder *builder, symbol_id symbol) {
+	uint32_t *slot = &builder->symbol_slots[symbol];
+	if (*slot == FLAT_NONE) {
+		*slot = builder->ast->symbol_count;
+		builder->ast->symbols[builder->ast->symbol_count++] = symbol;
+	}
+	return *slot;
+}
+
+// Reserves count consecutive node slots and returns the first one
+static flat_index reserve_nodes(flat_builder *builder, uint32_t count) {
+	flat_index first = builder->next_node;
+	builder->next_node += count;
+	return first;
+}
+
+static void fill_node(flat_builder *builder, flat_index index, const ast_node *node) {
+	flat_ast *ast = builder->ast;
+	const ast_node *children[4];
+	uint32_t child_count = 0;
+
+	ast->kinds[index] = (uint8_t)node->type;
+	ast->flags[index] = 0;
+	ast->first[index] = FLAT_NONE;
+	ast->payload[index] = 0;
+
+	switch (node->type) {
+		case AST_BLOCK: {
+			// Statements are laid out as one range before recursing into any of them
+			uint32_t count = (uint32_t)node->data.block.count;
+			flat_index first = reserve_nodes(builder, count);
+			ast->first[index] = first;
+			ast->payload[index] = count;
+			for (uint32_t i = 0; i < count; i++) {
+				fill_node(builder, first + i, node->data.block.statements[i]);
+			}
+			return;
+		}
+
+		case AST_ARRAY: {
+			uint32_t count = (uint32_t)node->data.array.count;
+			flat_index first = reserve_nodes(builder, count);
+			ast->flags[index] = node->data.array.repeat ? FLAT_ARRAY_REPEAT : 0;
+			ast->first[index] = first;
+			ast->payload[index] = count;
+			for (uint32_t i = 0; i < count; i++) {
+				fill_node(builder, first + i, node->data.array.elements[i]);
+			}
+			return;
+		}
+
+		case AST_ASSIGNMENT:
+			ast->payload[index] = symbol_slot(builder, node->data.assign.name);
+			children[child_count++] = node->data.assign.value;
+			break;
+
+		case AST_BINARY_OP:
+			ast->flags[index] = (uint8_t)node->data.binop.op;
+			children[child_count++] = node->data.binop.left;
+			children[child_count++] = node->data.binop.right;
+			break;
+
+		case AST_UNARY_OP:
+			ast->flags[index] = (uint8_t)node->data.unop.op;
+			children[child_count++] = node->data.unop.operand;
+			break;
+
+		case AST_VARIABLE:
+			ast->payload[index] = symbol_slot(builder, node->data.variable.name);
+			break;
+
+		case AST_LITERAL:
+			ast->flags[index] = (uint8_t)node->data.literal.kind;
+			ast->payload[index] = ast->literal_count;
+			ast->literals[ast->literal_count++] = node->data.literal.as;
+			break;
+
+		case AST_IF_STMT:
+			children[child_count++] = node->data.if_stmt.condition;
+			children[child_count++] = node->data.if_stmt.then_block;
+			if (node->data.if_stmt.else_block) {
+				children[child_count++] = node->data.if_stmt.else_block;
+			}
+			ast->payload[index] = child_count;
+			break;
+
+		case AST_FOR_LOOP:
+			if (node->data.for_loop.init) {
+				ast->flags[index] |= FLAT_FOR_INIT;
+				children[child_count++] = node->data.for_loop.init;
+			}
+			if (node->data.for_loop.condition) {
+				ast->flags[index] |= FLAT_FOR_CONDITION;
+				children[child_count++] = node->data.for_loop.condition;
+			}
+			if (node->data.for_loop.update) {
+				ast->flags[index] |= FLAT_FOR_UPDATE;
+				children[child_count++] = node->data.for_loop.update;
+			}
+			children[child_count++] = node->data.for_loop.body;
+			break;
+
+		case AST_WHILE_LOOP:
+			children[child_count++] = node->data.while_loop.condition;
+			children[child_count++] = node->data.while_loop.body;
+			break;
+
+		default:
+			return;
+	}
+
+	if (child_count) {
+		flat_index first = reserve_nodes(builder, child_count);
+		ast->first[index] = first;
+		for (uint32_t i = 0; i < child_count; i++) {
+			fill_node(builder, first + i, children[i]);
+		}
+	}
+}
+
+flat_ast *flat_ast_build(const ast_node *root) {
+	if (!root) return NULL;
+
+	uint32_t node_count = 0;
+	uint32_t literal_count = 0;
+	count_nodes(root, &node_count, &literal_count);
+
+	flat_ast *ast = mem_calloc(1, sizeof(flat_ast));
+	flat_builder builder = {
+		.ast = ast,
+		.symbol_slot_count = symbol_count()
+	};
+	if (!ast) goto fail;
+
+	ast->kinds = mem_alloc(node_count * sizeof(uint8_t));
+	ast->flags = mem_alloc(node_count * sizeof(uint8_t));
+	ast->first = mem_alloc(node_count * sizeof(uint32_t));
+	ast->payload = mem_alloc(node_count * sizeof(uint32_t));
+	ast->literals = mem_alloc((literal_count ? literal_count : 1) * sizeof(literal_payload));
+	ast->symbols = mem_alloc((builder.symbol_slot_count ? builder.symbol_slot_count : 1) * sizeof(symbol_id));
+	builder.symbol_slots = mem_alloc((builder.symbol_slot_count ? builder.symbol_slot_count : 1) * sizeof(uint32_t));
+	if (!ast->kinds || !ast->flags || !ast->first || !ast->payload || !ast->literals || !ast->symbols || !builder.symbol_slots) {
+		goto fail;
+	}
+	memset(builder.symbol_slots, 0xFF, builder.symbol_slot_count * sizeof(uint32_t));
+
+	ast->count = node_count;
+	fill_node(&builder, reserve_nodes(&builder, 1), root);
+
+	mem_free(builder.symbol_slots);
+
+	symbol_id *symbols = mem_realloc(ast->symbols, (ast->symbol_count ? ast->symbol_count : 1) * sizeof(symbol_id));
+	if (symbols) ast->symbols = symbols;
+	return ast;
+
+fail:
+	fprintf(stderr, "Memory allocate failed at %s:%d", __FILE__, __LINE__);
+	mem_free(builder.symbol_slots);
+	flat_ast_free(ast);
+	return NULL;
+}
+
+void flat_ast_free(flat_ast *ast) {
+	if (!ast) return;
+
+	mem_free(ast->kinds);
+	mem_free(ast->flags);
+	mem_free(ast->first);
+	mem_free(ast->payload);
+	mem_free(ast->literals);
+	mem_free(ast->symbols);
+	mem_free(ast);
+}
+
+size_t flat_ast_bytes(const flat_ast *ast) {
+	return ast->count * (2 * sizeof(uint8_t) + 2 * sizeof(uint32_t))
+		+ ast->literal_count * sizeof(literal_payload)
+		+ ast->symbol_count * sizeof(symbol_id);
+}
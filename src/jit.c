@@ -0,0 +1,666 @@
+/*
+ *
+ *		jit.c
+ *		LUMEN LANGUAGE PROJECT
+ *		Rainy101112 - 2025/7/20
+ *
+ */
+
+#include <jit.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) && (defined(__linux__) || defined(__APPLE__) || defined(__FreeBSD__))
+#define JIT_X86_64 1
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+enum {
+	LOOP_COLD,
+	LOOP_COMPILED,
+	LOOP_REJECTED
+};
+
+typedef struct jit_region {
+	struct jit_region *next;
+	void *memory;
+	size_t size;
+} jit_region;
+
+struct jit {
+	const chunk_t *chunk;
+
+	// Indexed by pc: back-edge counters, and state/entry for loop headers
+	uint32_t *counters;
+	uint8_t *states;
+	jit_entry *entries;
+
+	// Indexed by pc, NULL until jit_exclude; loops containing a set pc stay interpreted
+	uint8_t *excluded;
+
+	jit_region *regions;
+	uint32_t compiled;
+};
+
+#ifdef JIT_X86_64
+
+/*
+ * Code generation. The only general purpose register in use is rdi, which
+ * holds the register file; every VM register lives at [rdi + 8 * r].
+ * xmm0 and xmm1 are scratch, xmm2-xmm15 cache VM registers for the loop.
+ */
+
+#define CACHE_FIRST_XMM	2
+#define CACHE_SLOTS		14
+#define REG_RDI			7
+#define NOT_CACHED		0xFF
+
+typedef struct {
+	uint8_t *bytes;
+	size_t length;
+	size_t capacity;
+	int failed;
+} code_buffer;
+
+typedef struct {
+	size_t at;			// offset of the rel32 field
+	uint32_t target;	// bytecode pc
+} jump_patch;
+
+typedef struct {
+	const chunk_t *chunk;
+	uint32_t header;
+	uint32_t back_edge;
+
+	code_buffer code;
+
+	// Per register: cache xmm (or NOT_CACHED); per cached xmm: VM register and written flag
+	uint8_t *xmm_of;
+	uint32_t cached_register[CACHE_SLOTS];
+	uint8_t cached_dirty[CACHE_SLOTS];
+	uint32_t cached_count;
+
+	// Native offset of each region pc, and the pcs that some jump lands on
+	size_t *offsets;
+	uint8_t *is_target;
+
+	jump_patch *patches;
+	uint32_t patch_count;
+	uint32_t patch_capacity;
+
+	uint32_t *exits;
+	size_t *exit_offsets;
+	uint32_t exit_count;
+	uint32_t exit_capacity;
+} jit_compiler;
+
+static void emit_byte(code_buffer *code, uint8_t byte) {
+	if (code->length == code->capacity) {
+		size_t capacity = code->capacity ? code->capacity * 2 : 1024;
+		uint8_t *bytes = realloc(code->bytes, capacity);
+		if (!bytes) {
+			code->failed = 1;
+			return;
+		}
+		code->bytes = bytes;
+		code->capacity = capacity;
+	}
+	code->bytes[code->length++] = byte;
+}
+
+static void emit_u32(code_buffer *code, uint32_t value) {
+	for (int i = 0; i < 4; i++) emit_byte(code, (uint8_t)(value >> (8 * i)));
+}
+
+static void patch_u32(code_buffer *code, size_t at, uint32_t value) {
+	if (code->failed) return;
+	for (int i = 0; i < 4; i++) code->bytes[at + i] = (uint8_t)(value >> (8 * i));
+}
+
+// An SSE operand: either an xmm register or the VM register slot in memory
+typedef struct {
+	int is_memory;
+	uint32_t value;
+} sse_operand;
+
+static sse_operand xmm_operand(uint32_t xmm) {
+	sse_operand operand = { 0, xmm };
+	return operand;
+}
+
+static sse_operand register_operand(jit_compiler *jc, uint32_t reg) {
+	uint8_t xmm = jc->xmm_of[reg];
+	if (xmm != NOT_CACHED) return xmm_operand(xmm);
+
+	sse_operand operand = { 1, reg };
+	return operand;
+}
+
+// prefix [REX] 0F opcode ModRM, with reg as the xmm in the reg field
+static void emit_sse(jit_compiler *jc, uint8_t prefix, uint8_t opcode, uint32_t reg, sse_operand rm) {
+	code_buffer *code = &jc->code;
+	if (prefix) emit_byte(code, prefix);
+
+	uint8_t rex = 0x40;
+	if (reg >= 8) rex |= 0x04;
+	if (!rm.is_memory && rm.value >= 8) rex |= 0x01;
+	if (rex != 0x40) emit_byte(code, rex);
+
+	emit_byte(code, 0x0F);
+	emit_byte(code, opcode);
+
+	if (rm.is_memory) {
+		emit_byte(code, (uint8_t)(0x80 | ((reg & 7) << 3) | REG_RDI));
+		emit_u32(code, rm.value * 8);
+	} else {
+		emit_byte(code, (uint8_t)(0xC0 | ((reg & 7) << 3) | (rm.value & 7)));
+	}
+}
+
+#define SSE_MOVSD_LOAD	0x10
+#define SSE_MOVSD_STORE	0x11
+#define SSE_MOVAPD		0x28
+#define SSE_UCOMISD		0x2E
+#define SSE_XORPD		0x57
+#define SSE_ADDSD		0x58
+#define SSE_MULSD		0x59
+#define SSE_SUBSD		0x5C
+#define SSE_DIVSD		0x5E
+
+// xmm <- operand
+static void emit_load(jit_compiler *jc, uint32_t xmm, sse_operand from) {
+	if (from.is_memory) emit_sse(jc, 0xF2, SSE_MOVSD_LOAD, xmm, from);
+	else if (from.value != xmm) emit_sse(jc, 0x66, SSE_MOVAPD, xmm, from);
+}
+
+// VM register <- xmm
+static void emit_store_register(jit_compiler *jc, uint32_t reg, uint32_t xmm) {
+	uint8_t cached = jc->xmm_of[reg];
+	if (cached != NOT_CACHED) {
+		if (cached != xmm) emit_sse(jc, 0x66, SSE_MOVAPD, cached, xmm_operand(xmm));
+		return;
+	}
+
+	sse_operand slot = { 1, reg };
+	emit_sse(jc, 0xF2, SSE_MOVSD_STORE, xmm, slot);
+}
+
+static void emit_jump_to(jit_compiler *jc, uint32_t target) {
+	if (jc->patch_count == jc->patch_capacity) {
+		uint32_t capacity = jc->patch_capacity ? jc->patch_capacity * 2 : 32;
+		jump_patch *patches = realloc(jc->patches, capacity * sizeof(jump_patch));
+		if (!patches) {
+			jc->code.failed = 1;
+			return;
+		}
+		jc->patches = patches;
+		jc->patch_capacity = capacity;
+	}
+
+	jump_patch *patch = &jc->patches[jc->patch_count++];
+	patch->at = jc->code.length;
+	patch->target = target;
+	emit_u32(&jc->code, 0);
+}
+
+static void emit_jmp(jit_compiler *jc, uint32_t target) {
+	emit_byte(&jc->code, 0xE9);
+	emit_jump_to(jc, target);
+}
+
+// Condition codes for 0F 8x / 0F 9x
+#define CC_B	0x2
+#define CC_AE	0x3
+#define CC_P	0xA
+#define CC_E	0x4
+#define CC_NE	0x5
+#define CC_BE	0x6
+#define CC_A	0x7
+
+static void emit_jcc(jit_compiler *jc, uint8_t cc, uint32_t target) {
+	emit_byte(&jc->code, 0x0F);
+	emit_byte(&jc->code, (uint8_t)(0x80 | cc));
+	emit_jump_to(jc, target);
+}
+
+// Sets flags from comparing the VM register against 0.0
+static void emit_test_zero(jit_compiler *jc, uint32_t reg) {
+	sse_operand value = register_operand(jc, reg);
+	uint32_t xmm = value.is_memory ? 0 : value.value;
+	emit_load(jc, xmm, value);
+	emit_sse(jc, 0x66, SSE_XORPD, 1, xmm_operand(1));
+	emit_sse(jc, 0x66, SSE_UCOMISD, xmm, xmm_operand(1));
+}
+
+static int region_contains(const jit_compiler *jc, uint32_t pc) {
+	return pc >= jc->header && pc <= jc->back_edge;
+}
+
+static int is_supported(opcode_t op) {
+	switch (op) {
+		case OP_MOVE:
+		case OP_ADD:
+		case OP_SUB:
+		case OP_MUL:
+		case OP_DIV:
+		case OP_LT:
+		case OP_GT:
+		case OP_LE:
+		case OP_GE:
+		case OP_JMP:
+		case OP_JMPF:
+		case OP_JMPT:
+		case OP_HALT:
+			return 1;
+		default:
+			return 0;
+	}
+}
+
+static int count_operands(const instruction_t *ins, uint32_t regs[3]) {
+	switch (ins->op) {
+		case OP_MOVE:
+			regs[0] = ins->a;
+			regs[1] = ins->b;
+			return 2;
+		case OP_JMPF:
+		case OP_JMPT:
+			regs[0] = ins->a;
+			return 1;
+		case OP_JMP:
+		case OP_HALT:
+			return 0;
+		default:
+			regs[0] = ins->a;
+			regs[1] = ins->b;
+			regs[2] = ins->c;
+			return 3;
+	}
+}
+
+// Picks the most used registers of the loop for the xmm cache
+static int choose_cached_registers(jit_compiler *jc) {
+	const chunk_t *chunk = jc->chunk;
+	uint32_t *uses = calloc(chunk->register_count ? chunk->register_count : 1, sizeof(uint32_t));
+	if (!uses) return 0;
+
+	for (uint32_t pc = jc->header; pc <= jc->back_edge; pc++) {
+		uint32_t regs[3];
+		int n = count_operands(&chunk->code[pc], regs);
+		for (int i = 0; i < n; i++) uses[regs[i]]++;
+	}
+
+	for (uint32_t slot = 0; slot < CACHE_SLOTS; slot++) {
+		uint32_t best = 0, best_uses = 0;
+		for (uint32_t reg = 0; reg < chunk->register_count; reg++) {
+			if (uses[reg] > best_uses) {
+				best = reg;
+				best_uses = uses[reg];
+			}
+		}
+		if (!best_uses) break;
+
+		uses[best] = 0;
+		jc->xmm_of[best] = (uint8_t)(CACHE_FIRST_XMM + slot);
+		jc->cached_register[slot] = best;
+		jc->cached_dirty[slot] = 0;
+		jc->cached_count++;
+	}
+
+	for (uint32_t pc = jc->header; pc <= jc->back_edge; pc++) {
+		const instruction_t *ins = &chunk->code[pc];
+		uint32_t regs[3];
+		if (ins->op == OP_JMP || ins->op == OP_JMPF || ins->op == OP_JMPT || ins->op == OP_HALT) continue;
+		if (count_operands(ins, regs) && jc->xmm_of[regs[0]] != NOT_CACHED) {
+			jc->cached_dirty[jc->xmm_of[regs[0]] - CACHE_FIRST_XMM] = 1;
+		}
+	}
+
+	free(uses);
+	return 1;
+}
+
+static uint32_t exit_index(jit_compiler *jc, uint32_t target) {
+	for (uint32_t i = 0; i < jc->exit_count; i++) {
+		if (jc->exits[i] == target) return i;
+	}
+
+	if (jc->exit_count == jc->exit_capacity) {
+		uint32_t capacity = jc->exit_capacity ? jc->exit_capacity * 2 : 8;
+		uint32_t *exits = realloc(jc->exits, capacity * sizeof(uint32_t));
+		size_t *offsets = exits ? realloc(jc->exit_offsets, capacity * sizeof(size_t)) : NULL;
+		if (exits) jc->exits = exits;
+		if (!exits || !offsets) {
+			jc->code.failed = 1;
+			return 0;
+		}
+		jc->exit_offsets = offsets;
+		jc->exit_capacity = capacity;
+	}
+
+	jc->exits[jc->exit_count] = target;
+	return jc->exit_count++;
+}
+
+static void emit_instruction(jit_compiler *jc, uint32_t pc, int *flags_from) {
+	const instruction_t *ins = &jc->chunk->code[pc];
+
+	// A compare directly followed by a branch on its result reuses the flags
+	int fused = *flags_from >= 0 && (uint32_t)*flags_from == pc - 1
+		&& !jc->is_target[pc - jc->header] && jc->chunk->code[pc - 1].a == ins->a;
+	int inclusive = fused && (jc->chunk->code[pc - 1].op == OP_LE || jc->chunk->code[pc - 1].op == OP_GE);
+	*flags_from = -1;
+
+	switch (ins->op) {
+		case OP_MOVE: {
+			sse_operand from = register_operand(jc, ins->b);
+			uint8_t to = jc->xmm_of[ins->a];
+			if (to != NOT_CACHED) {
+				emit_load(jc, to, from);
+			} else if (!from.is_memory) {
+				emit_store_register(jc, ins->a, from.value);
+			} else {
+				emit_load(jc, 0, from);
+				emit_store_register(jc, ins->a, 0);
+			}
+			break;
+		}
+
+		case OP_ADD:
+		case OP_SUB:
+		case OP_MUL:
+		case OP_DIV: {
+			static const uint8_t opcodes[] = {
+				[OP_ADD] = SSE_ADDSD, [OP_SUB] = SSE_SUBSD, [OP_MUL] = SSE_MULSD, [OP_DIV] = SSE_DIVSD
+			};
+			emit_load(jc, 0, register_operand(jc, ins->b));
+			emit_sse(jc, 0xF2, opcodes[ins->op], 0, register_operand(jc, ins->c));
+			emit_store_register(jc, ins->a, 0);
+			break;
+		}
+
+		case OP_LT:
+		case OP_GT:
+		case OP_LE:
+		case OP_GE: {
+			// b < c is c > b and b <= c is c >= b; "above (or equal)" is false for unordered operands, as in C
+			int swap = ins->op == OP_LT || ins->op == OP_LE;
+			uint32_t first = swap ? ins->c : ins->b;
+			uint32_t second = swap ? ins->b : ins->c;
+			emit_load(jc, 0, register_operand(jc, first));
+			emit_sse(jc, 0x66, SSE_UCOMISD, 0, register_operand(jc, second));
+
+			// seta/setae al; movzx eax, al; cvtsi2sd xmm0, eax (none of these touch flags)
+			uint8_t set = ins->op == OP_LT || ins->op == OP_GT ? 0x97 : 0x93;
+			emit_byte(&jc->code, 0x0F); emit_byte(&jc->code, set); emit_byte(&jc->code, 0xC0);
+			emit_byte(&jc->code, 0x0F); emit_byte(&jc->code, 0xB6); emit_byte(&jc->code, 0xC0);
+			emit_byte(&jc->code, 0xF2); emit_byte(&jc->code, 0x0F); emit_byte(&jc->code, 0x2A); emit_byte(&jc->code, 0xC0);
+			emit_store_register(jc, ins->a, 0);
+			*flags_from = (int)pc;
+			break;
+		}
+
+		case OP_JMP:
+			emit_jmp(jc, ins->a);
+			break;
+
+		case OP_JMPT:
+			if (fused) {
+				emit_jcc(jc, inclusive ? CC_AE : CC_A, ins->b);
+			} else {
+				// Jump unless the value is exactly zero; NaN is truthy
+				emit_test_zero(jc, ins->a);
+				emit_jcc(jc, CC_NE, ins->b);
+				emit_jcc(jc, CC_P, ins->b);
+			}
+			break;
+
+		case OP_JMPF:
+			if (fused) {
+				emit_jcc(jc, inclusive ? CC_B : CC_BE, ins->b);
+			} else {
+				emit_test_zero(jc, ins->a);
+				emit_byte(&jc->code, 0x7A);	// jp +6 over the je
+				emit_byte(&jc->code, 0x06);
+				emit_jcc(jc, CC_E, ins->b);
+			}
+			break;
+
+		case OP_HALT:
+			// Let the interpreter execute the HALT itself
+			emit_jmp(jc, pc);
+			break;
+
+		default:
+			jc->code.failed = 1;
+			break;
+	}
+}
+
+static void emit_cache_load(jit_compiler *jc) {
+	for (uint32_t slot = 0; slot < jc->cached_count; slot++) {
+		sse_operand from = { 1, jc->cached_register[slot] };
+		emit_sse(jc, 0xF2, SSE_MOVSD_LOAD, CACHE_FIRST_XMM + slot, from);
+	}
+}
+
+static void emit_exit(jit_compiler *jc, uint32_t target) {
+	for (uint32_t slot = 0; slot < jc->cached_count; slot++) {
+		if (!jc->cached_dirty[slot]) continue;
+		sse_operand to = { 1, jc->cached_register[slot] };
+		emit_sse(jc, 0xF2, SSE_MOVSD_STORE, CACHE_FIRST_XMM + slot, to);
+	}
+
+	emit_byte(&jc->code, 0xB8);	// mov eax, target
+	emit_u32(&jc->code, target);
+	emit_byte(&jc->code, 0xC3);	// ret
+}
+
+static jit_entry install(jit_t *jit, const code_buffer *code) {
+	size_t page = (size_t)sysconf(_SC_PAGESIZE);
+	size_t size = (code->length + page - 1) & ~(page - 1);
+
+	void *memory = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (memory == MAP_FAILED) return NULL;
+
+	memcpy(memory, code->bytes, code->length);
+	if (mprotect(memory, size, PROT_READ | PROT_EXEC) != 0) {
+		munmap(memory, size);
+		return NULL;
+	}
+
+	jit_region *region = malloc(sizeof(jit_region));
+	if (!region) {
+		munmap(memory, size);
+		return NULL;
+	}
+	region->memory = memory;
+	region->size = size;
+	region->next = jit->regions;
+	jit->regions = region;
+
+	jit_entry entry;
+	memcpy(&entry, &memory, sizeof(entry));
+	return entry;
+}
+
+static jit_entry compile_loop(jit_t *jit, uint32_t header, uint32_t back_edge) {
+	const chunk_t *chunk = jit->chunk;
+	uint32_t length = back_edge - header + 1;
+
+	// Every register must be addressable with a 32-bit displacement
+	if (chunk->register_count > INT32_MAX / 8) return NULL;
+
+	for (uint32_t pc = header; pc <= back_edge; pc++) {
+		if (!is_supported(chunk->code[pc].op) || (jit->excluded && jit->excluded[pc])) return NULL;
+	}
+
+	jit_compiler jc = {
+		.chunk = chunk,
+		.header = header,
+		.back_edge = back_edge
+	};
+	jit_entry entry = NULL;
+
+	jc.xmm_of = malloc(chunk->register_count ? chunk->register_count : 1);
+	jc.offsets = malloc(length * sizeof(size_t));
+	jc.is_target = calloc(length, 1);
+	if (!jc.xmm_of || !jc.offsets || !jc.is_target) goto done;
+	memset(jc.xmm_of, NOT_CACHED, chunk->register_count);
+
+	for (uint32_t pc = header; pc <= back_edge; pc++) {
+		const instruction_t *ins = &chunk->code[pc];
+		uint32_t target = ins->op == OP_JMP ? ins->a : ins->b;
+		if ((ins->op == OP_JMP || ins->op == OP_JMPF || ins->op == OP_JMPT) && region_contains(&jc, target)) {
+			jc.is_target[target - header] = 1;
+		}
+	}
+
+	if (!choose_cached_registers(&jc)) goto done;
+
+	emit_cache_load(&jc);
+
+	int flags_from = -1;
+	for (uint32_t pc = header; pc <= back_edge; pc++) {
+		jc.offsets[pc - header] = jc.code.length;
+		emit_instruction(&jc, pc, &flags_from);
+	}
+	emit_jmp(&jc, back_edge + 1);
+
+	// Resolve jumps: inside the loop to the instruction, outside to an exit stub
+	for (uint32_t i = 0; i < jc.patch_count; i++) {
+		if (!region_contains(&jc, jc.patches[i].target) || chunk->code[jc.patches[i].target].op == OP_HALT) {
+			exit_index(&jc, jc.patches[i].target);
+		}
+	}
+	for (uint32_t i = 0; i < jc.exit_count && !jc.code.failed; i++) {
+		jc.exit_offsets[i] = jc.code.length;
+		emit_exit(&jc, jc.exits[i]);
+	}
+	if (jc.code.failed) goto done;
+
+	for (uint32_t i = 0; i < jc.patch_count; i++) {
+		uint32_t target = jc.patches[i].target;
+		size_t destination;
+		if (region_contains(&jc, target) && chunk->code[target].op != OP_HALT) {
+			destination = jc.offsets[target - header];
+		} else {
+			destination = jc.exit_offsets[exit_index(&jc, target)];
+		}
+		patch_u32(&jc.code, jc.patches[i].at, (uint32_t)(destination - (jc.patches[i].at + 4)));
+	}
+
+	if (!jc.code.failed) entry = install(jit, &jc.code);
+
+done:
+	free(jc.code.bytes);
+	free(jc.xmm_of);
+	free(jc.offsets);
+	free(jc.is_target);
+	free(jc.patches);
+	free(jc.exits);
+	free(jc.exit_offsets);
+	return entry;
+}
+
+int jit_available(void) {
+	return 1;
+}
+
+#else
+
+static jit_entry compile_loop(jit_t *jit, uint32_t header, uint32_t back_edge) {
+	(void)jit;
+	(void)header;
+	(void)back_edge;
+	return NULL;
+}
+
+int jit_available(void) {
+	return 0;
+}
+
+#endif
+
+jit_t *jit_create(const chunk_t *chunk) {
+	if (!jit_available()) return NULL;
+
+	jit_t *jit = calloc(1, sizeof(jit_t));
+	if (!jit) {
+		fprintf(stderr, "Memory allocate failed at %s:%d", __FILE__, __LINE__);
+		return NULL;
+	}
+
+	size_t count = chunk->code_count ? chunk->code_count : 1;
+	jit->chunk = chunk;
+	jit->counters = calloc(count, sizeof(uint32_t));
+	jit->states = calloc(count, sizeof(uint8_t));
+	jit->entries = calloc(count, sizeof(jit_entry));
+	if (!jit->counters || !jit->states || !jit->entries) {
+		fprintf(stderr, "Memory allocate failed at %s:%d", __FILE__, __LINE__);
+		jit_destroy(jit);
+		return NULL;
+	}
+	return jit;
+}
+
+void jit_destroy(jit_t *jit) {
+	if (!jit) return;
+
+	jit_region *region = jit->regions;
+	while (region) {
+		jit_region *next = region->next;
+#ifdef JIT_X86_64
+		munmap(region->memory, region->size);
+#endif
+		free(region);
+		region = next;
+	}
+
+	free(jit->counters);
+	free(jit->states);
+	free(jit->entries);
+	free(jit->excluded);
+	free(jit);
+}
+
+void jit_exclude(jit_t *jit, uint32_t pc) {
+	if (pc >= jit->chunk->code_count) return;
+
+	if (!jit->excluded) {
+		jit->excluded = calloc(jit->chunk->code_count, 1);
+		if (!jit->excluded) {
+			fprintf(stderr, "Memory allocate failed at %s:%d", __FILE__, __LINE__);
+			return;
+		}
+	}
+	jit->excluded[pc] = 1;
+}
+
+jit_entry jit_back_edge(jit_t *jit, uint32_t header, uint32_t pc) {
+	switch (jit->states[header]) {
+		case LOOP_COMPILED:
+			return jit->entries[header];
+
+		case LOOP_REJECTED:
+			return NULL;
+
+		default:
+			if (++jit->counters[pc] < JIT_HOT_THRESHOLD) return NULL;
+
+			jit->entries[header] = compile_loop(jit, header, pc);
+			if (jit->entries[header]) {
+				jit->states[header] = LOOP_COMPILED;
+				jit->compiled++;
+			} else {
+				jit->states[header] = LOOP_REJECTED;
+			}
+			return jit->entries[header];
+	}
+}
+
+uint32_t jit_compiled_loops(const jit_t *jit) {
+	return jit->compiled;
+}
@@ -7,334 +7,402 @@
  */
 
 #include <token.h>
+#include <lexer.h>
+#include <scan.h>
+#include <diag.h>
+#include <mem.h>
 #include <string.h>
-#include <stdlib.h>
+#include <stdint.h>
 #include <stdio.h>
-#include <ctype.h>
-
-static token_type_t check_keyword(char *text);
-
-static token_type_t check_keyword(char *text) {
-	static const struct
-	{
-		const char *text;
-		token_type_t type;
-	} keywords[] = {
-		{"if", TOKEN_KEYWORD_IF},
-		{"else", TOKEN_KEYWORD_ELSE},
-		{"for", TOKEN_KEYWORD_FOR},
-		{"while", TOKEN_KEYWORD_WHILE},
-		{"break", TOKEN_KEYWORD_BREAK},
-		{"continue", TOKEN_KEYWORD_CONTINUE}
-	};
-
-	for (size_t i = 0; i < sizeof(keywords) / sizeof(keywords[0]); i++) {
-		if (strcmp(text, keywords[i].text) == 0) {
-			return keywords[i].type;
-		}
-	}
-
-	return TOKEN_IDENTIFIER;
-}
-
-token_t *get_next_token(const char *source_code, int *index) {
-	while (source_code[*index] != '\0') {
-		if (isspace(source_code[*index])) {
-			(*index)++;
-			continue;
-		}
-
-		if (isdigit(source_code[*index])) {
-			int start_index = *index;
 
-			while (isdigit(source_code[*index])) (*index)++;
-
-			token_t *token = (token_t *)malloc(sizeof(token_t));
-			if (!token){
-				printf("Memory allocate failed at %s:%d", __FILE__, __LINE__);
-			}
-
-			token->type = TOKEN_NUMBER;
-			token->text = strndup(source_code + start_index, *index - start_index);
-			if (!token->text){
-				free(token);
-				printf("Memory allocate failed at %s:%d", __FILE__, __LINE__);
-				return NULL;
+// Character classes; every input byte maps to exactly one of these
+enum {
+	CC_OTHER,
+	CC_NUL,
+	CC_SPACE,
+	CC_DIGIT,
+	CC_ALPHA,
+	CC_EXPONENT,	// 'e' and 'E': letters, and the exponent mark in numbers
+	CC_DOT,
+	CC_PLUS,
+	CC_MINUS,
+	CC_STAR,
+	CC_SLASH,
+	CC_SEMICOLON,
+	CC_EQUAL,
+	CC_LESS,
+	CC_GREATER,
+	CC_BANG,
+	CC_AMPERSAND,
+	CC_PIPE,
+	CC_OPEN_PAREN,
+	CC_CLOSE_PAREN,
+	CC_OPEN_BRACE,
+	CC_CLOSE_BRACE,
+	CC_OPEN_BRACKET,
+	CC_CLOSE_BRACKET,
+	CC_COMMA,
+	CC_EOF_MARK,
+
+	CC_COUNT
+};
+
+// DFA states. S_DONE is zero so that unlisted transitions terminate the token
+enum {
+	S_DONE,
+	S_START,
+	S_IDENTIFIER,
+	S_NUMBER,
+	S_FRACTION,
+	S_EXPONENT,
+	S_PLUS,
+	S_MINUS,
+	S_STAR,
+	S_SLASH,
+	S_SEMICOLON,
+	S_ASSIGN,
+	S_LESS,
+	S_GREATER,
+	S_LESS_EQUAL,
+	S_GREATER_EQUAL,
+	S_EQUAL,
+	S_NOT,
+	S_NOT_EQUAL,
+	S_AND,
+	S_OR,
+	S_OPEN_PAREN,
+	S_CLOSE_PAREN,
+	S_OPEN_BRACE,
+	S_CLOSE_BRACE,
+	S_OPEN_BRACKET,
+	S_CLOSE_BRACKET,
+	S_COMMA,
+	S_EOF_MARK,
+	S_ERROR,
+
+	// Half of "&&" or "||"
+	S_AMPERSAND,
+	S_PIPE,
+
+	// A number cut short after '.', 'e' or the exponent sign
+	S_DOT,
+	S_EXPONENT_MARK,
+	S_EXPONENT_SIGN,
+
+	S_COUNT
+};
+
+static const uint8_t char_classes[256] = {
+	['\0'] = CC_NUL,
+	[' '] = CC_SPACE, ['\t'] = CC_SPACE, ['\n'] = CC_SPACE,
+	['\v'] = CC_SPACE, ['\f'] = CC_SPACE, ['\r'] = CC_SPACE,
+	['0' ... '9'] = CC_DIGIT,
+	['a' ... 'd'] = CC_ALPHA, ['e'] = CC_EXPONENT, ['f' ... 'z'] = CC_ALPHA,
+	['A' ... 'D'] = CC_ALPHA, ['E'] = CC_EXPONENT, ['F' ... 'Z'] = CC_ALPHA,
+	['_'] = CC_ALPHA,
+	['.'] = CC_DOT,
+	['+'] = CC_PLUS,
+	['-'] = CC_MINUS,
+	['*'] = CC_STAR,
+	['/'] = CC_SLASH,
+	[';'] = CC_SEMICOLON,
+	['='] = CC_EQUAL,
+	['<'] = CC_LESS,
+	['>'] = CC_GREATER,
+	['!'] = CC_BANG,
+	['&'] = CC_AMPERSAND,
+	['|'] = CC_PIPE,
+	['('] = CC_OPEN_PAREN,
+	[')'] = CC_CLOSE_PAREN,
+	['{'] = CC_OPEN_BRACE,
+	['}'] = CC_CLOSE_BRACE,
+	['['] = CC_OPEN_BRACKET,
+	[']'] = CC_CLOSE_BRACKET,
+	[','] = CC_COMMA,
+	[0xFF] = CC_EOF_MARK
+};
+
+static const uint8_t transitions[S_COUNT][CC_COUNT] = {
+	[S_START] = {
+		[CC_OTHER] = S_ERROR,
+		[CC_DOT] = S_ERROR,
+		[CC_DIGIT] = S_NUMBER,
+		[CC_ALPHA] = S_IDENTIFIER,
+		[CC_EXPONENT] = S_IDENTIFIER,
+		[CC_PLUS] = S_PLUS,
+		[CC_MINUS] = S_MINUS,
+		[CC_STAR] = S_STAR,
+		[CC_SLASH] = S_SLASH,
+		[CC_SEMICOLON] = S_SEMICOLON,
+		[CC_EQUAL] = S_ASSIGN,
+		[CC_LESS] = S_LESS,
+		[CC_GREATER] = S_GREATER,
+		[CC_BANG] = S_NOT,
+		[CC_AMPERSAND] = S_AMPERSAND,
+		[CC_PIPE] = S_PIPE,
+		[CC_OPEN_PAREN] = S_OPEN_PAREN,
+		[CC_CLOSE_PAREN] = S_CLOSE_PAREN,
+		[CC_OPEN_BRACE] = S_OPEN_BRACE,
+		[CC_CLOSE_BRACE] = S_CLOSE_BRACE,
+		[CC_OPEN_BRACKET] = S_OPEN_BRACKET,
+		[CC_CLOSE_BRACKET] = S_CLOSE_BRACKET,
+		[CC_COMMA] = S_COMMA,
+		[CC_EOF_MARK] = S_EOF_MARK
+	},
+	[S_IDENTIFIER] = { [CC_ALPHA] = S_IDENTIFIER, [CC_EXPONENT] = S_IDENTIFIER, [CC_DIGIT] = S_IDENTIFIER },
+	[S_NUMBER] = { [CC_DIGIT] = S_NUMBER, [CC_DOT] = S_DOT, [CC_EXPONENT] = S_EXPONENT_MARK },
+	[S_DOT] = { [CC_DIGIT] = S_FRACTION },
+	[S_FRACTION] = { [CC_DIGIT] = S_FRACTION, [CC_EXPONENT] = S_EXPONENT_MARK },
+	[S_EXPONENT_MARK] = { [CC_DIGIT] = S_EXPONENT, [CC_PLUS] = S_EXPONENT_SIGN, [CC_MINUS] = S_EXPONENT_SIGN },
+	[S_EXPONENT_SIGN] = { [CC_DIGIT] = S_EXPONENT },
+	[S_EXPONENT] = { [CC_DIGIT] = S_EXPONENT },
+	[S_ASSIGN] = { [CC_EQUAL] = S_EQUAL },
+	[S_LESS] = { [CC_EQUAL] = S_LESS_EQUAL },
+	[S_GREATER] = { [CC_EQUAL] = S_GREATER_EQUAL },
+	[S_NOT] = { [CC_EQUAL] = S_NOT_EQUAL },
+	[S_AMPERSAND] = { [CC_AMPERSAND] = S_AND },
+	[S_PIPE] = { [CC_PIPE] = S_OR }
+};
+
+// Token produced when the DFA stops in a given state
+static const token_type_t accepting[S_COUNT] = {
+	[S_START] = TOKEN_END_OF_FILE,
+	[S_IDENTIFIER] = TOKEN_IDENTIFIER,
+	[S_NUMBER] = TOKEN_INTEGER,
+	[S_FRACTION] = TOKEN_FLOAT,
+	[S_EXPONENT] = TOKEN_FLOAT,
+	[S_PLUS] = TOKEN_OPERATOR_PLUS,
+	[S_MINUS] = TOKEN_OPERATOR_MINUS,
+	[S_STAR] = TOKEN_OPERATOR_MULTIPLY,
+	[S_SLASH] = TOKEN_OPERATOR_DIVIDE,
+	[S_SEMICOLON] = TOKEN_SEMICOLON,
+	[S_ASSIGN] = TOKEN_ASSIGN,
+	[S_LESS] = TOKEN_OPERATOR_LESS,
+	[S_GREATER] = TOKEN_OPERATOR_GREATER,
+	[S_LESS_EQUAL] = TOKEN_OPERATOR_LESS_EQUAL,
+	[S_GREATER_EQUAL] = TOKEN_OPERATOR_GREATER_EQUAL,
+	[S_EQUAL] = TOKEN_OPERATOR_EQUAL,
+	[S_NOT] = TOKEN_OPERATOR_NOT,
+	[S_NOT_EQUAL] = TOKEN_OPERATOR_NOT_EQUAL,
+	[S_AND] = TOKEN_OPERATOR_AND,
+	[S_OR] = TOKEN_OPERATOR_OR,
+	[S_OPEN_PAREN] = TOKEN_OPEN_PAREN,
+	[S_CLOSE_PAREN] = TOKEN_CLOSE_PAREN,
+	[S_OPEN_BRACE] = TOKEN_OPEN_BRACE,
+	[S_CLOSE_BRACE] = TOKEN_CLOSE_BRACE,
+	[S_OPEN_BRACKET] = TOKEN_OPEN_BRACKET,
+	[S_CLOSE_BRACKET] = TOKEN_CLOSE_BRACKET,
+	[S_COMMA] = TOKEN_COMMA,
+	[S_EOF_MARK] = TOKEN_END_OF_FILE
+};
+
+#define CHAR_CLASS(c) (char_classes[(unsigned char)(c)])
+
+static token_type_t check_keyword(const char *text, size_t length) {
+	switch (length) {
+		case 2:
+			if (text[0] == 'i' && text[1] == 'f') return TOKEN_KEYWORD_IF;
+			break;
+
+		case 3:
+			if (text[0] == 'f' && memcmp(text, "for", 3) == 0) return TOKEN_KEYWORD_FOR;
+			if (text[0] == 'l' && memcmp(text, "len", 3) == 0) return TOKEN_KEYWORD_LEN;
+			break;
+
+		case 4:
+			if (text[0] == 'e' && memcmp(text, "else", 4) == 0) return TOKEN_KEYWORD_ELSE;
+			break;
+
+		case 5:
+			switch (text[0]) {
+				case 'w':
+					if (memcmp(text, "while", 5) == 0) return TOKEN_KEYWORD_WHILE;
+					break;
+				case 'b':
+					if (memcmp(text, "break", 5) == 0) return TOKEN_KEYWORD_BREAK;
+					break;
 			}
+			break;
 
-			return token;
-		}
-
-		if (isalpha(source_code[*index]) || source_code[*index] == '_') {
-			int start_index = *index;
-
-			(*index)++;
+		case 8:
+			if (text[0] == 'c' && memcmp(text, "continue", 8) == 0) return TOKEN_KEYWORD_CONTINUE;
+			break;
+	}
 
-			while (isalnum(source_code[*index]) || source_code[*index] == '_') {
-				(*index)++;
-			}
+	return TOKEN_IDENTIFIER;
+}
 
-			char *text = strndup(source_code + start_index, *index - start_index);
+// Shared by get_next_token and the stream loop, which keeps position in a register
+static inline token_t lex_token(const char *source_code, size_t *index) {
+	// Work on a local copy; stores through index would alias the source bytes
+	size_t position = *index;
 
-			if (!text) {
-				fprintf(stderr, "Memory allocate failed at %s:%d", __FILE__, __LINE__);
-				return NULL;
-			}
+	for (;;) {
+		position = scan_whitespace(source_code + position) - source_code;
 
-			token_t *token = malloc(sizeof(token_t));
-			if (!token){
-				fprintf(stderr, "Memory allocate failed at %s:%d", __FILE__, __LINE__);
-				free(text);
-				return NULL;
-			}
+		size_t start_index = position;
+		uint8_t state = S_START;
 
-			token->type = check_keyword(text);
-			token->text = text;
+		for (;;) {
+			uint8_t next = transitions[state][CHAR_CLASS(source_code[position])];
+			if (next == S_DONE) break;
 
-			return token;
-		}
+			state = next;
+			position++;
 
-		if (source_code[*index] == '+') {
-			if (source_code[*index + 1] != '\0' && isdigit(source_code[*index + 1])) {
-				int start_index = *index;
-				(*index)++;
-
-				while (isdigit(source_code[*index])) (*index)++;
-
-				token_t *token = malloc(sizeof(token_t));
-				if (!token) {
-					fprintf(stderr, "Memory allocate failed at %s:%d", __FILE__, __LINE__);
-					return NULL;
-				}
-
-				token->type = TOKEN_NUMBER;
-				token->text = strndup(source_code + start_index, *index - start_index);
-				if (!token->text) {
-					free(token);
-					fprintf(stderr, "Memory allocate failed at %s:%d", __FILE__, __LINE__);
-					return NULL;
-				}
-				return token;
-			} 
-			else {
-				char *text = strndup(source_code + *index, 1);
-				if (!text) {
-					fprintf(stderr, "Memory allocate failed at %s:%d", __FILE__, __LINE__);
-					return NULL;
-				}
-
-				token_t *token = malloc(sizeof(token_t));
-				if (!token) {
-					fprintf(stderr, "Memory allocate failed at %s:%d", __FILE__, __LINE__);
-					free(text);
-					return NULL;
-				}
-
-				token->text = text;
-				token->type = TOKEN_OPERATOR_MINUS;
-
-				(*index)++;
-				return token;
+			// Self-looping states swallow their whole run at once
+			if (state == S_IDENTIFIER) {
+				position = scan_identifier(source_code + position) - source_code;
+			} else if (state == S_NUMBER || state == S_FRACTION || state == S_EXPONENT) {
+				position = scan_digits(source_code + position) - source_code;
 			}
 		}
 
-		if (source_code[*index] == '-') {
-			if (source_code[*index + 1] != '\0' && isdigit(source_code[*index + 1])) {
-				int start_index = *index;
-				(*index)++;
-
-				while (isdigit(source_code[*index])) (*index)++;
-
-				token_t *token = malloc(sizeof(token_t));
-				if (!token) {
-					fprintf(stderr, "Memory allocate failed at %s:%d", __FILE__, __LINE__);
-					return NULL;
-				}
-
-				token->type = TOKEN_NUMBER;
-				token->text = strndup(source_code + start_index, *index - start_index);
-				if (!token->text) {
-					free(token);
-					fprintf(stderr, "Memory allocate failed at %s:%d", __FILE__, __LINE__);
-					return NULL;
-				}
-				return token;
-			} 
-			else {
-				char *text = strndup(source_code + *index, 1);
-				if (!text) {
-					fprintf(stderr, "Memory allocate failed at %s:%d", __FILE__, __LINE__);
-					return NULL;
-				}
-
-				token_t *token = malloc(sizeof(token_t));
-				if (!token) {
-					fprintf(stderr, "Memory allocate failed at %s:%d", __FILE__, __LINE__);
-					free(text);
-					return NULL;
-				}
-
-				token->text = text;
-				token->type = TOKEN_OPERATOR_MINUS;
-
-				(*index)++;
-				return token;
-			}
+		if (state == S_ERROR || state == S_AMPERSAND || state == S_PIPE) {
+			diag_report_at(DIAG_ERROR, start_index, "Unrecognized character: %c\n", source_code[start_index]);
+			continue;
 		}
 
-		if (source_code[*index] == '*') {
-			char *text = strndup(source_code + *index, 1);
-			if (!text) {
-				fprintf(stderr, "Memory allocate failed at %s:%d", __FILE__, __LINE__);
-				return NULL;
-			}
-
-			token_t *token = malloc(sizeof(token_t));
-			if (!token){
-				fprintf(stderr, "Memory allocate failed at %s:%d", __FILE__, __LINE__);
-				free(text);
-				return NULL;
-			}
-
-			token->text = text;
-			token->type = TOKEN_OPERATOR_MULTIPLY;
-
-			(*index)++;
-			return token;
+		if (state >= S_DOT) {
+			diag_report_at(DIAG_ERROR, start_index, "Malformed number: %.*s\n", (int)(position - start_index), source_code + start_index);
+			continue;
 		}
 
-		if (source_code[*index] == '/') {
-			char *text = strndup(source_code + *index, 1);
-			if (!text) {
-				fprintf(stderr, "Memory allocate failed at %s:%d", __FILE__, __LINE__);
-				return NULL;
-			}
-
-			token_t *token = malloc(sizeof(token_t));
-			if (!token){
-				fprintf(stderr, "Memory allocate failed at %s:%d", __FILE__, __LINE__);
-				free(text);
-				return NULL;
-			}
-
-			token->text = text;
-			token->type = TOKEN_OPERATOR_DIVIDE;
+		token_t token = {
+			.type = accepting[state],
+			.start = start_index,
+			.length = position - start_index
+		};
 
-			(*index)++;
-			return token;
+		if (state == S_IDENTIFIER) {
+			token.type = check_keyword(source_code + start_index, token.length);
 		}
 
-		if (source_code[*index] == ';') {
-			char *text = strndup(source_code + *index, 1);
-			if (!text) {
-				fprintf(stderr, "Memory allocate failed at %s:%d", __FILE__, __LINE__);
-				return NULL;
-			}
-
-			token_t *token = malloc(sizeof(token_t));
-			if (!token){
-				fprintf(stderr, "Memory allocate failed at %s:%d", __FILE__, __LINE__);
-				free(text);
-				return NULL;
-			}
-
-			token->text = text;
-			token->type = TOKEN_SEMICOLON;
-
-			(*index)++;
-			return token;
-		}
+		*index = position;
+		return token;
+	}
+}
 
-		if (source_code[*index] == '=') {
-			char *text = strndup(source_code + *index, 1);
-			if (!text) {
-				fprintf(stderr, "Memory allocate failed at %s:%d", __FILE__, __LINE__);
-				return NULL;
-			}
+token_t get_next_token(const char *source_code, size_t *index) {
+	return lex_token(source_code, index);
+}
 
-			token_t *token = malloc(sizeof(token_t));
-			if (!token){
-				fprintf(stderr, "Memory allocate failed at %s:%d", __FILE__, __LINE__);
-				free(text);
-				return NULL;
-			}
+// Tokens a stream makes room for at first
+#define TOKEN_STREAM_INITIAL 1024
 
-			token->text = text;
-			token->type = TOKEN_ASSIGN;
+void token_stream_init(token_stream *stream, const char *source_code, size_t from) {
+	*stream = (token_stream){ .source = source_code, .position = from };
+}
 
-			(*index)++;
-			return token;
-		}
+void token_stream_free(token_stream *stream) {
+	mem_free(stream->kinds);
+	mem_free(stream->starts);
+	mem_free(stream->lengths);
+	stream->kinds = NULL;
+	stream->starts = stream->lengths = NULL;
+	stream->count = stream->capacity = 0;
+}
 
-		if (source_code[*index] == '{') {
-			char *text = strndup(source_code + *index, 1);
-			if (!text) {
-				fprintf(stderr, "Memory allocate failed at %s:%d", __FILE__, __LINE__);
-				return NULL;
-			}
+static int grow_columns(token_stream *stream, uint32_t wanted) {
+	uint32_t capacity = stream->capacity ? stream->capacity * 2 : TOKEN_STREAM_INITIAL;
+	if (capacity < wanted) capacity = wanted;
+	uint8_t *kinds = mem_realloc(stream->kinds, capacity * sizeof(uint8_t));
+	if (kinds) stream->kinds = kinds;
+	uint32_t *starts = mem_realloc(stream->starts, capacity * sizeof(uint32_t));
+	if (starts) stream->starts = starts;
+	uint32_t *lengths = mem_realloc(stream->lengths, capacity * sizeof(uint32_t));
+	if (lengths) stream->lengths = lengths;
+
+	if (!kinds || !starts || !lengths) {
+		fprintf(stderr, "Memory allocate failed at %s:%d", __FILE__, __LINE__);
+		return 0;
+	}
+	stream->capacity = capacity;
+	return 1;
+}
 
-			token_t *token = malloc(sizeof(token_t));
-			if (!token){
-				fprintf(stderr, "Memory allocate failed at %s:%d", __FILE__, __LINE__);
-				free(text);
-				return NULL;
+int token_stream_fill(token_stream *stream, size_t until, uint32_t at_least) {
+	// Columns live in locals: stores through the byte-wide kinds could alias *stream
+	const char *source = stream->source;
+	size_t position = stream->position;
+	uint8_t *kinds = stream->kinds;
+	uint32_t *starts = stream->starts, *lengths = stream->lengths;
+	uint32_t count = stream->count, capacity = stream->capacity;
+	uint32_t target = count + at_least;
+	int finished = stream->finished, grown = 1;
+
+	while (!finished) {
+		if (count >= target && count && starts[count - 1] >= until) break;
+		if (count == capacity) {
+			// A whole-source fill sizes the columns once, at about one token per 2 bytes left
+			uint32_t wanted = 0;
+			if (until == SIZE_MAX && !capacity) {
+				size_t left = strlen(source + position) / 2 + 16;
+				wanted = left < UINT32_MAX / 2 ? (uint32_t)left : UINT32_MAX / 2;
 			}
-
-			token->text = text;
-			token->type = TOKEN_OPEN_PAREN;
-
-			(*index)++;
-			return token;
+			stream->count = count;
+			grown = grow_columns(stream, wanted);
+			if (!grown) break;
+			kinds = stream->kinds;
+			starts = stream->starts;
+			lengths = stream->lengths;
+			capacity = stream->capacity;
 		}
 
-		if (source_code[*index] == '}') {
-			char *text = strndup(source_code + *index, 1);
-			if (!text) {
-				fprintf(stderr, "Memory allocate failed at %s:%d", __FILE__, __LINE__);
-				return NULL;
-			}
-
-			token_t *token = malloc(sizeof(token_t));
-			if (!token){
-				fprintf(stderr, "Memory allocate failed at %s:%d", __FILE__, __LINE__);
-				free(text);
-				return NULL;
-			}
-
-			token->text = text;
-			token->type = TOKEN_CLOSE_PAREN;
-
-			(*index)++;
-			return token;
+		token_t token = lex_token(source, &position);
+		if (token.start > UINT32_MAX - token.length) {
+			diag_report(DIAG_ERROR, "Source is larger than 4 GiB\n");
+			token = (token_t){ TOKEN_END_OF_FILE, UINT32_MAX, 0 };
 		}
 
+		kinds[count] = (uint8_t)token.type;
+		starts[count] = (uint32_t)token.start;
+		lengths[count] = (uint32_t)token.length;
+		count++;
+		finished = token.type == TOKEN_END_OF_FILE;
+	}
 
-		if (source_code[*index] == (char)EOF) {
-			char *text = strndup(source_code + *index, 1);
-			if (!text) {
-				fprintf(stderr, "Memory allocate failed at %s:%d", __FILE__, __LINE__);
-				return NULL;
-			}
-
-			token_t *token = malloc(sizeof(token_t));
-			if (!token){
-				fprintf(stderr, "Memory allocate failed at %s:%d", __FILE__, __LINE__);
-				free(text);
-				return NULL;
-			}
-
-			token->text = text;
-			token->type = TOKEN_END_OF_FILE;
-
-			(*index)++;
-			return token;
-		}
-
-		fprintf(stderr, "Unrecognized character: %c\n", source_code[*index]);
+	stream->count = count;
+	stream->position = position;
+	stream->finished = finished;
+	return grown;
+}
 
-		(*index)++;
-		continue;
+const char *token_type_name(token_type_t type) {
+	switch (type) {
+		case TOKEN_IDENTIFIER: return "IDENTIFIER";
+		case TOKEN_INTEGER: return "INTEGER";
+		case TOKEN_FLOAT: return "FLOAT";
+		case TOKEN_KEYWORD_IF: return "IF";
+		case TOKEN_KEYWORD_ELSE: return "ELSE";
+		case TOKEN_KEYWORD_FOR: return "FOR";
+		case TOKEN_KEYWORD_WHILE: return "WHILE";
+		case TOKEN_KEYWORD_BREAK: return "BREAK";
+		case TOKEN_KEYWORD_CONTINUE: return "CONTINUE";
+		case TOKEN_KEYWORD_LEN: return "LEN";
+		case TOKEN_OPERATOR_PLUS: return "PLUS";
+		case TOKEN_OPERATOR_MINUS: return "MINUS";
+		case TOKEN_OPERATOR_MULTIPLY: return "MULTIPLY";
+		case TOKEN_OPERATOR_DIVIDE: return "DIVIDE";
+		case TOKEN_OPERATOR_LESS: return "LESS";
+		case TOKEN_OPERATOR_GREATER: return "GREATER";
+		case TOKEN_OPERATOR_LESS_EQUAL: return "LESS_EQUAL";
+		case TOKEN_OPERATOR_GREATER_EQUAL: return "GREATER_EQUAL";
+		case TOKEN_OPERATOR_EQUAL: return "EQUAL";
+		case TOKEN_OPERATOR_NOT_EQUAL: return "NOT_EQUAL";
+		case TOKEN_OPERATOR_AND: return "AND";
+		case TOKEN_OPERATOR_OR: return "OR";
+		case TOKEN_OPERATOR_NOT: return "NOT";
+		case TOKEN_SEMICOLON: return "SEMICOLON";
+		case TOKEN_ASSIGN: return "ASSIGN";
+		case TOKEN_OPEN_PAREN: return "OPEN_PAREN";
+		case TOKEN_CLOSE_PAREN: return "CLOSE_PAREN";
+		case TOKEN_OPEN_BRACE: return "OPEN_BRACE";
+		case TOKEN_CLOSE_BRACE: return "CLOSE_BRACE";
+		case TOKEN_OPEN_BRACKET: return "OPEN_BRACKET";
+		case TOKEN_CLOSE_BRACKET: return "CLOSE_BRACKET";
+		case TOKEN_COMMA: return "COMMA";
+		case TOKEN_END_OF_FILE: return "END_OF_FILE";
+		default: return "UNKNOWN";
 	}
-
-	return NULL;
 }
@@ -0,0 +1,55 @@
+/*
+ *
+ *		lines.c
+ *		LUMEN LANGUAGE PROJECT
+ *		Rainy101112 - 2025/7/20
+ *
+ */
+
+#include <lines.h>
+#include <scan.h>
+#include <mem.h>
+#include <stdio.h>
+#include <string.h>
+
+void line_table_init(line_table *table, const char *text, size_t length) {
+	memset(table, 0, sizeof(line_table));
+	table->text = text;
+	table->length = length;
+}
+
+void line_table_free(line_table *table) {
+	mem_free(table->starts);
+	table->starts = NULL;
+	table->count = 0;
+}
+
+static int build(line_table *table) {
+	// Count first so the starts are stored exactly once, into an array of the right size
+	size_t count = scan_line_starts(table->text, table->length, NULL) + 1;
+	size_t *starts = mem_alloc(count * sizeof(size_t));
+	if (!starts) {
+		fprintf(stderr, "Memory allocate failed at %s:%d", __FILE__, __LINE__);
+		return 0;
+	}
+
+	starts[0] = 0;
+	scan_line_starts(table->text, table->length, starts + 1);
+	table->starts = starts;
+	table->count = count;
+	return 1;
+}
+
+source_position line_table_lookup(line_table *table, size_t offset) {
+	if (!table->starts && !build(table)) return (source_position){ 0, 0 };
+	if (offset > table->length) offset = table->length;
+
+	// Last line starting at or before offset
+	size_t low = 0, high = table->count;
+	while (high - low > 1) {
+		size_t middle = low + (high - low) / 2;
+		if (table->starts[middle] <= offset) low = middle;
+		else high = middle;
+	}
+	return (source_position){ low + 1, offset - table->starts[low] + 1 };
+}
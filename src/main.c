@@ -8,163 +8,631 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <token.h>
 #include <lexer.h>
 #include <lumen.h>
-#include <time.h>
 #include <ast.h>
+#include <flat_ast.h>
+#include <compiler.h>
+#include <optimize.h>
+#include <resolve.h>
+#include <vm.h>
+#include <symbol.h>
+#include <dump.h>
+#include <source.h>
+#include <batch.h>
+#include <cgen.h>
+#include <cache.h>
+#include <diag.h>
+#include <lines.h>
+#include <mem.h>
+#include <stats.h>
 
-void print_ast(ast_node *node, int indent) {
-	if (!node) return;
-	
-	char indent_str[32] = {0};
-	for (int i = 0; i < indent; i++) indent_str[i] = ' ';
-	
-	switch (node->type) {
-		case AST_BLOCK:
-			printf(LOG_LEVEL_LOGGER "%sBLOCK:\n", indent_str);
-			for (int i = 0; i < node->data.block.count; i++) {
-				print_ast(node->data.block.statements[i], indent + 4);
-			}
-			break;
-			
-		case AST_ASSIGNMENT:
-			printf(LOG_LEVEL_LOGGER "%sASSIGNMENT:\n", indent_str);
-			printf(LOG_LEVEL_LOGGER "%s  Variable: %s\n", indent_str, node->data.assign.name);
-			printf(LOG_LEVEL_LOGGER "%s  Value:\n", indent_str);
-			print_ast(node->data.assign.value, indent + 4);
-			break;
-			
-		case AST_BINARY_OP: {
-			const char *op_str = "UNKNOWN";
-			switch (node->data.binop.op) {
-				case TOKEN_OPERATOR_PLUS: op_str = "+"; break;
-				case TOKEN_OPERATOR_MINUS: op_str = "-"; break;
-				case TOKEN_OPERATOR_MULTIPLY: op_str = "*"; break;
-				case TOKEN_OPERATOR_DIVIDE: op_str = "/"; break;
-				default: break;
-			}
-			printf(LOG_LEVEL_LOGGER "%sBINARY_OP (%s):\n", indent_str, op_str);
-			printf(LOG_LEVEL_LOGGER "%s  Left:\n", indent_str);
-			print_ast(node->data.binop.left, indent + 4);
-			printf(LOG_LEVEL_LOGGER "%s  Right:\n", indent_str);
-			print_ast(node->data.binop.right, indent + 4);
-			break;
+// Values of --stats; 0 leaves stats off
+enum {
+	STATS_FORMAT_TEXT = 1,
+	STATS_FORMAT_JSON
+};
+
+// lumen tokens <file>... prints one token per line: offset, line:column, kind, text
+static int tokens_file(const char *path) {
+	source_t *source = source_open(path);
+	if (!source) return 1;
+
+	line_table lines;
+	line_table_init(&lines, source->text, source->length);
+	line_table *previous_lines = diag_locate(&lines);
+
+	size_t index = 0;
+	for (;;) {
+		token_t token = get_next_token(source->text, &index);
+		source_position position = line_table_lookup(&lines, token.start);
+		printf("%zu\t%zu:%zu\t%s\t%.*s\n", token.start, position.line, position.column,
+			token_type_name(token.type), (int)token.length, source->text + token.start);
+		if (token.type == TOKEN_END_OF_FILE) break;
+	}
+
+	diag_locate(previous_lines);
+	line_table_free(&lines);
+	source_close(source);
+	return 0;
+}
+
+// lumen parse [--flat] [--optimize] [--format=...] <file>... prints the syntax tree
+// Only the text format adds the LOGGER notes, so the others stay machine-readable; after errors the tree is still printed but 1 returned
+static int parse_file(const char *path, int flat, int optimize, dump_format format, const char *cache_dir, stats_t *stats) {
+	source_t *source = source_open(path);
+	if (!source) return 1;
+
+	double mark = stats ? stats_now() : 0;
+	if (stats) stats->source_bytes = source->length;
+
+	// Cache entries hold the tree as parsed, before any optimization
+	cache_t *cache = cache_dir && !optimize ? cache_load(cache_dir, source->text, source->length) : NULL;
+	if (cache) {
+		if (stats) stats->cached = 1;
+		stats_lap(stats, STATS_PARSE, &mark);
+		if (flat && format == DUMP_TEXT) printf(LOG_LEVEL_LOGGER "Flat layout: %u node(s), %zu byte(s)\n", cache->ast.count, flat_ast_bytes(&cache->ast));
+		int written = dump_flat_ast(stdout, &cache->ast, 0, format, 0);
+		stats_lap(stats, STATS_OUTPUT, &mark);
+		cache_close(cache);
+		source_close(source);
+		stats_lap(stats, STATS_TEARDOWN, &mark);
+		return written == 0 ? 0 : 1;
+	}
+
+	diag_buffer diagnostics = {0};
+	diag_buffer *previous = diag_capture(&diagnostics);
+	line_table lines;
+	line_table_init(&lines, source->text, source->length);
+	line_table *previous_lines = diag_locate(&lines);
+	token_stream tokens;
+	token_stream_init(&tokens, source->text, 0);
+	token_stream_fill(&tokens, SIZE_MAX, 0);
+	if (stats) stats_count_tokens(stats, &tokens);
+	stats_lap(stats, STATS_LEX, &mark);
+
+	arena_t *arena = arena_create(0);
+	ast_node *program = parse_stream(&tokens, arena);
+	uint32_t nesting = parse_nesting();
+	token_stream_free(&tokens);
+	diag_locate(previous_lines);
+	line_table_free(&lines);
+	diag_capture(previous);
+	if (diagnostics.length) fwrite(diagnostics.text, 1, diagnostics.length, stderr);
+
+	stats_lap(stats, STATS_PARSE, &mark);
+	if (stats) {
+		stats_count_nodes(stats, program);
+		mark = stats_now();
+	}
+
+	if (cache_dir && !optimize) {
+		flat_ast *layout = flat_ast_build(program);
+		cache_store(cache_dir, source->text, source->length, nesting, layout, NULL, &diagnostics);
+		flat_ast_free(layout);
+	}
+	int failed = diagnostics.error_count != 0;
+	diag_buffer_free(&diagnostics);
+
+	size_t removed = optimize ? optimize_ast(program, arena) : 0;
+	flat_ast *layout = flat ? flat_ast_build(program) : NULL;
+	stats_lap(stats, STATS_PASSES, &mark);
+
+	if (optimize && format == DUMP_TEXT) printf(LOG_LEVEL_LOGGER "Optimizer removed %zu node(s)\n", removed);
+	int written = 0;
+	if (layout) {
+		if (format == DUMP_TEXT) printf(LOG_LEVEL_LOGGER "Flat layout: %u node(s), %zu byte(s)\n", layout->count, flat_ast_bytes(layout));
+		written = dump_flat_ast(stdout, layout, 0, format, 0);
+	} else if (!flat) {
+		written = dump_ast(stdout, program, format, 0);
+	}
+	stats_lap(stats, STATS_OUTPUT, &mark);
+
+	flat_ast_free(layout);
+	arena_destroy(arena);
+	source_close(source);
+	stats_lap(stats, STATS_TEARDOWN, &mark);
+	return written == 0 && !failed ? 0 : 1;
+}
+
+// Parses, optimizes and compiles; NULL after any error. With a cache directory the result is stored there too
+static chunk_t *compile_source(const source_t *source, const char *cache_dir, stats_t *stats) {
+	double mark = stats ? stats_now() : 0;
+	diag_buffer diagnostics = {0};
+	diag_buffer *previous = diag_capture(&diagnostics);
+	line_table lines;
+	line_table_init(&lines, source->text, source->length);
+	line_table *previous_lines = diag_locate(&lines);
+
+	token_stream tokens;
+	token_stream_init(&tokens, source->text, 0);
+	token_stream_fill(&tokens, SIZE_MAX, 0);
+	if (stats) stats_count_tokens(stats, &tokens);
+	stats_lap(stats, STATS_LEX, &mark);
+
+	arena_t *arena = arena_create(0);
+	ast_node *program = parse_stream(&tokens, arena);
+	uint32_t nesting = parse_nesting();
+	token_stream_free(&tokens);
+	stats_lap(stats, STATS_PARSE, &mark);
+	if (stats) {
+		stats_count_nodes(stats, program);
+		mark = stats_now();
+	}
+
+	flat_ast *layout = cache_dir ? flat_ast_build(program) : NULL;
+	optimize_ast(program, arena);
+
+	resolve_result scope;
+	chunk_t *chunk = NULL;
+	if (resolve_ast(program, &scope) == 0) {
+		chunk = compile_program(program, &scope);
+		resolve_result_free(&scope);
+	}
+	stats_lap(stats, STATS_PASSES, &mark);
+	arena_destroy(arena);
+	stats_lap(stats, STATS_TEARDOWN, &mark);
+
+	diag_locate(previous_lines);
+	line_table_free(&lines);
+	diag_capture(previous);
+	if (diagnostics.length) fwrite(diagnostics.text, 1, diagnostics.length, stderr);
+
+	if (chunk && layout) cache_store(cache_dir, source->text, source->length, nesting, layout, chunk, &diagnostics);
+	flat_ast_free(layout);
+
+	// Every pass still ran, so all the errors were reported, but a partial program is never executed
+	if (diagnostics.error_count) {
+		chunk_free(chunk);
+		chunk = NULL;
+	}
+	diag_buffer_free(&diagnostics);
+	stats_lap(stats, STATS_PASSES, &mark);
+	return chunk;
+}
+
+// lumen run [--jit] [--parallel[=n]] <file> executes the program and prints every variable it set; parallel is a thread count, 0 for serial
+static int run_file(const char *path, int disassemble, int use_jit, unsigned parallel, const char *cache_dir, stats_t *stats) {
+	source_t *source = source_open(path);
+	if (!source) return 1;
+
+	double mark = stats ? stats_now() : 0;
+	if (stats) stats->source_bytes = source->length;
+
+	cache_t *cache = cache_dir ? cache_load(cache_dir, source->text, source->length) : NULL;
+	chunk_t *compiled = NULL;
+	const chunk_t *chunk;
+	if (cache && cache->has_chunk) {
+		cache_replay_diagnostics(cache);
+		chunk = &cache->chunk;
+		if (stats) stats->cached = 1;
+		stats_lap(stats, STATS_PARSE, &mark);
+	} else {
+		chunk = compiled = compile_source(source, cache_dir, stats);
+		if (stats) mark = stats_now();
+	}
+	source_close(source);
+	stats_lap(stats, STATS_TEARDOWN, &mark);
+
+	if (!chunk) {
+		cache_close(cache);
+		return 1;
+	}
+
+	int status = 0;
+	if (disassemble) {
+		chunk_disassemble(chunk, stdout);
+		stats_lap(stats, STATS_OUTPUT, &mark);
+	} else {
+		vm_t *vm = vm_create(chunk);
+		if (vm && use_jit) {
+			vm->jit = jit_create(chunk);
+			if (!vm->jit) fprintf(stderr, "JIT unavailable, interpreting\n");
 		}
-			
-		case AST_VARIABLE:
-			printf(LOG_LEVEL_LOGGER "%sVARIABLE: %s\n", indent_str, node->data.variable);
-			break;
-			
-		case AST_LITERAL:
-			printf(LOG_LEVEL_LOGGER "%sLITERAL: %f\n", indent_str, node->data.literal);
-			break;
-			
-		case AST_IF_STMT:
-			printf(LOG_LEVEL_LOGGER "%sIF_STATEMENT:\n", indent_str);
-			printf(LOG_LEVEL_LOGGER "%s  Condition:\n", indent_str);
-			print_ast(node->data.if_stmt.condition, indent + 4);
-			printf(LOG_LEVEL_LOGGER "%s  Then:\n", indent_str);
-			print_ast(node->data.if_stmt.then_block, indent + 4);
-			if (node->data.if_stmt.else_block) {
-				printf(LOG_LEVEL_LOGGER "%s  Else:\n", indent_str);
-				print_ast(node->data.if_stmt.else_block, indent + 4);
+		if (vm && parallel) {
+			vm->pool = pool_create(parallel);
+			if (!vm->pool) fprintf(stderr, "Thread pool unavailable, running serially\n");
+		}
+
+		if (!vm || vm_run(vm) != VM_OK) {
+			fprintf(stderr, "Execution failed\n");
+			status = 1;
+			stats_lap(stats, STATS_EXECUTE, &mark);
+		} else {
+			stats_lap(stats, STATS_EXECUTE, &mark);
+			for (uint32_t i = 0; i < chunk->variable_count; i++) {
+				printf("%s = ", symbol_name(chunk->variables[i]));
+				vm_print_value(vm, vm->registers[i], stdout);
+				putchar('\n');
 			}
+			stats_lap(stats, STATS_OUTPUT, &mark);
+		}
+		pool_t *pool = vm ? vm->pool : NULL;
+		if (vm) jit_destroy(vm->jit);
+		vm_destroy(vm);
+		pool_destroy(pool);
+	}
+
+	chunk_free(compiled);
+	cache_close(cache);
+	stats_lap(stats, STATS_TEARDOWN, &mark);
+	return status;
+}
+
+// Runs one parse, run or disasm of path, reporting its stats on stderr when stats_format is set
+static int process_file(const char *command, const char *path, int flat, int optimize, int use_jit,
+	unsigned parallel, dump_format format, const char *cache_dir, int stats_format) {
+	stats_t stats = { .path = path };
+	stats_t *collect = stats_format ? &stats : NULL;
+	mem_counters start = mem_stats();
+
+	int status;
+	if (command[0] == 'p') status = parse_file(path, flat, optimize, format, cache_dir, collect);
+	else status = run_file(path, command[0] == 'd', use_jit, parallel, cache_dir, collect);
+
+	if (collect) {
+		fflush(stdout);
+		stats_finish(&stats, &start);
+		stats_print(&stats, stats_format == STATS_FORMAT_JSON, stderr);
+	}
+	return status;
+}
+
+static void usage(FILE *out) {
+	fprintf(out,
+		"Usage: lumen <command> [options] <file>...\n"
+		"\n"
+		"Commands:\n"
+		"  tokens <file>...                       Print the token stream\n"
+		"  parse [--flat] [--optimize] <file>...  Print the syntax tree\n"
+		"        [--format=text|sexpr|json]       as indented text (default), one\n"
+		"                                         S-expression or one JSON object\n"
+		"  run [options] <file>                   Execute and print the variables\n"
+		"  disasm <file>                          Print the compiled bytecode\n"
+		"  batch [options] <file>...              Compile many files in parallel\n"
+		"  build [options] <file>                 Compile to a native executable\n"
+		"                                         through the system C compiler\n"
+		"\n"
+		"Options for parse, run, disasm and batch:\n"
+		"  --cache-dir <dir>       Reuse precompiled programs from dir, keyed by\n"
+		"                          source hash (default: $LUMEN_CACHE_DIR)\n"
+		"  --max-nesting <n>       Reject blocks, parentheses and operators nested\n"
+		"                          deeper than n levels (default: 1024)\n"
+		"\n"
+		"Options for parse, run and disasm:\n"
+		"  --stats[=json]          Report phase times, token and node counts,\n"
+		"                          allocations and peak RSS on stderr\n"
+		"\n"
+		"Run options:\n"
+		"  --jit                   Translate hot loops to native code\n"
+		"  --parallel[=n]          Split independent for loops across n threads\n"
+		"                          (default: one per processor); sums and\n"
+		"                          products are combined per slice and may\n"
+		"                          round differently from a serial run\n"
+		"\n"
+		"Batch options:\n"
+		"  -j <n>, --jobs <n>      Worker threads (default: one per processor)\n"
+		"  --optimize              Run the optimizer on each file\n"
+		"  --compile               Resolve and compile each file to bytecode\n"
+		"  --files-from <list>     Also read file names, one per line, from list\n"
+		"  --summary               Print totals and throughput\n"
+		"\n"
+		"Build options:\n"
+		"  -o <f>, --output <f>    Output path (default: the source name without\n"
+		"                          .lumen, or with .out or .so added)\n"
+		"  --shared                Build a shared object exporting lumen_run\n"
+		"  --emit-c                Write the C source instead, to -o or stdout\n"
+		"  --max-nesting <n>       As for the other commands\n"
+		"The C compiler is $CC, or else the one lumen was built with.\n"
+		"\n"
+		"A file name of - reads standard input. Sources larger than 4 GiB\n"
+		"are rejected.\n");
+}
+
+// Splits list into lines and appends the non-empty ones to paths
+static int read_path_list(const char *list, char **storage, const char ***paths, size_t *count) {
+	source_t *source = source_open(list);
+	if (!source) return 1;
+
+	char *text = malloc(source->length + 1);
+	size_t lines = 1;
+	for (size_t i = 0; i < source->length; i++) lines += source->text[i] == '\n';
+
+	const char **grown = realloc(*paths, (*count + lines) * sizeof(const char *));
+	if (!text || !grown) {
+		fprintf(stderr, "Memory allocate failed at %s:%d", __FILE__, __LINE__);
+		free(text);
+		if (grown) *paths = grown;
+		source_close(source);
+		return 1;
+	}
+	*paths = grown;
+	memcpy(text, source->text, source->length + 1);
+	source_close(source);
+
+	char *line = text;
+	while (*line) {
+		char *end = strchr(line, '\n');
+		if (end) *end = '\0';
+		if (end && end > line && end[-1] == '\r') end[-1] = '\0';
+
+		if (*line) (*paths)[(*count)++] = line;
+		if (!end) break;
+		line = end + 1;
+	}
+
+	*storage = text;
+	return 0;
+}
+
+static int batch_command(int argc, char *argv[]) {
+	batch_options options = { .cache_dir = getenv("LUMEN_CACHE_DIR") };
+	const char **paths = NULL;
+	size_t count = 0;
+	char *list_storage = NULL;
+	int status = 2;
+
+	int i = 2;
+	for (; i < argc && argv[i][0] == '-' && argv[i][1] != '\0'; i++) {
+		const char *option = argv[i];
+		if (strcmp(option, "--") == 0) {
+			i++;
 			break;
-			
-		case AST_FOR_LOOP:
-			printf(LOG_LEVEL_LOGGER "%sFOR_LOOP:\n", indent_str);
-			if (node->data.for_loop.init) {
-				printf(LOG_LEVEL_LOGGER "%s  Init:\n", indent_str);
-				print_ast(node->data.for_loop.init, indent + 4);
-			}
-			if (node->data.for_loop.condition) {
-				printf(LOG_LEVEL_LOGGER "%s  Condition:\n", indent_str);
-				print_ast(node->data.for_loop.condition, indent + 4);
-			}
-			if (node->data.for_loop.update) {
-				printf(LOG_LEVEL_LOGGER "%s  Update:\n", indent_str);
-				print_ast(node->data.for_loop.update, indent + 4);
+		} else if (strcmp(option, "-j") == 0 || strcmp(option, "--jobs") == 0) {
+			if (++i == argc) goto bad_option;
+			options.threads = (unsigned)strtoul(argv[i], NULL, 10);
+		} else if (strncmp(option, "-j", 2) == 0) {
+			options.threads = (unsigned)strtoul(option + 2, NULL, 10);
+		} else if (strcmp(option, "--optimize") == 0) {
+			options.optimize = 1;
+		} else if (strcmp(option, "--compile") == 0) {
+			options.compile = 1;
+		} else if (strcmp(option, "--summary") == 0) {
+			options.summary = 1;
+		} else if (strcmp(option, "--cache-dir") == 0) {
+			if (++i == argc) goto bad_option;
+			options.cache_dir = argv[i];
+		} else if (strcmp(option, "--max-nesting") == 0) {
+			if (++i == argc) goto bad_option;
+			parse_set_nesting_limit((uint32_t)strtoul(argv[i], NULL, 10));
+		} else if (strcmp(option, "--files-from") == 0) {
+			if (++i == argc || list_storage) goto bad_option;
+			if (read_path_list(argv[i], &list_storage, &paths, &count) != 0) goto done;
+		} else {
+			goto bad_option;
+		}
+	}
+
+	if (options.cache_dir && !*options.cache_dir) options.cache_dir = NULL;
+
+	const char **grown = realloc(paths, (count + (size_t)(argc - i) + 1) * sizeof(const char *));
+	if (!grown) {
+		fprintf(stderr, "Memory allocate failed at %s:%d", __FILE__, __LINE__);
+		goto done;
+	}
+	paths = grown;
+	for (; i < argc; i++) paths[count++] = argv[i];
+
+	if (count == 0) {
+		usage(stderr);
+		goto done;
+	}
+
+	status = batch_compile(paths, count, &options);
+	goto done;
+
+bad_option:
+	fprintf(stderr, "Bad or incomplete option: %s\n", argv[i - (i == argc)]);
+	usage(stderr);
+
+done:
+	free(paths);
+	free(list_storage);
+	return status;
+}
+
+// prog.lumen builds prog (prog.so when shared); any other name gets .out (.so) appended, stdin builds a.out (a.so)
+static char *default_output(const char *path, int shared) {
+	if (strcmp(path, "-") == 0) path = "a";
+	size_t length = strlen(path);
+	const char *suffix = shared ? ".so" : ".out";
+	if (length > 6 && strcmp(path + length - 6, ".lumen") == 0) {
+		length -= 6;
+		if (!shared) suffix = "";
+	}
+
+	char *output = malloc(length + strlen(suffix) + 1);
+	if (!output) {
+		fprintf(stderr, "Memory allocate failed at %s:%d", __FILE__, __LINE__);
+		return NULL;
+	}
+	memcpy(output, path, length);
+	strcpy(output + length, suffix);
+	return output;
+}
+
+// lumen build [-o <output>] [--shared] [--emit-c] <file> compiles the program ahead of time through C
+static int build_file(const char *path, const char *output, int shared, int emit_c) {
+	source_t *source = source_open(path);
+	if (!source) return 1;
+
+	diag_buffer diagnostics = {0};
+	diag_buffer *previous = diag_capture(&diagnostics);
+	line_table lines;
+	line_table_init(&lines, source->text, source->length);
+	line_table *previous_lines = diag_locate(&lines);
+
+	arena_t *arena = arena_create(0);
+	ast_node *program = parse(source->text, arena);
+	optimize_ast(program, arena);
+	resolve_result scope;
+	int resolved = resolve_ast(program, &scope) == 0;
+
+	// Printed now, before anything the C compiler has to say
+	diag_capture(previous);
+	if (diagnostics.length) fwrite(diagnostics.text, 1, diagnostics.length, stderr);
+
+	// As with run, nothing is built from a program with errors
+	int status = 1;
+	if (resolved && !diagnostics.error_count) {
+		if (!emit_c) {
+			status = cgen_build(program, &scope, output, shared);
+		} else {
+			FILE *out = output ? fopen(output, "w") : stdout;
+			if (!out) {
+				fprintf(stderr, "Cannot open %s\n", output);
+			} else {
+				status = cgen_emit(out, program, &scope) == 0 ? 0 : 1;
+				if (out != stdout && fclose(out) != 0) status = 1;
 			}
-			printf(LOG_LEVEL_LOGGER "%s  Body:\n", indent_str);
-			print_ast(node->data.for_loop.body, indent + 4);
-			break;
-			
-		case AST_WHILE_LOOP:
-			printf(LOG_LEVEL_LOGGER "%sWHILE_LOOP:\n", indent_str);
-			printf(LOG_LEVEL_LOGGER "%s  Condition:\n", indent_str);
-			print_ast(node->data.while_loop.condition, indent + 4);
-			printf(LOG_LEVEL_LOGGER "%s  Body:\n", indent_str);
-			print_ast(node->data.while_loop.body, indent + 4);
-			break;
-			
-		case AST_BREAK:
-			printf(LOG_LEVEL_LOGGER "%sBREAK\n", indent_str);
-			break;
-			
-		case AST_CONTINUE:
-			printf(LOG_LEVEL_LOGGER "%sCONTINUE\n", indent_str);
-			break;
-			
-		default:
-			printf(LOG_LEVEL_LOGGER "%sUNKNOWN_NODE_TYPE: %d\n", indent_str, node->type);
+		}
+	}
+	if (resolved) resolve_result_free(&scope);
+
+	diag_locate(previous_lines);
+	line_table_free(&lines);
+	diag_buffer_free(&diagnostics);
+	arena_destroy(arena);
+	source_close(source);
+	return status;
+}
+
+static int build_command(int argc, char *argv[]) {
+	const char *output = NULL;
+	int shared = 0, emit_c = 0;
+
+	int i = 2;
+	for (; i < argc && argv[i][0] == '-' && argv[i][1] != '\0'; i++) {
+		const char *option = argv[i];
+		if (strcmp(option, "--") == 0) {
+			i++;
 			break;
+		} else if (strcmp(option, "-o") == 0 || strcmp(option, "--output") == 0) {
+			if (++i == argc) goto bad_option;
+			output = argv[i];
+		} else if (strcmp(option, "--shared") == 0) {
+			shared = 1;
+		} else if (strcmp(option, "--emit-c") == 0) {
+			emit_c = 1;
+		} else if (strcmp(option, "--max-nesting") == 0) {
+			if (++i == argc) goto bad_option;
+			parse_set_nesting_limit((uint32_t)strtoul(argv[i], NULL, 10));
+		} else {
+			goto bad_option;
+		}
+	}
+
+	if (argc - i != 1) {
+		fprintf(stderr, "build takes exactly one file\n");
+		usage(stderr);
+		return 2;
 	}
+
+	// --emit-c writes to stdout unless given -o
+	char *named = output || emit_c ? NULL : default_output(argv[i], shared);
+	if (!output && !emit_c && !named) return 1;
+
+	int status = build_file(argv[i], output ? output : named, shared, emit_c);
+	free(named);
+	return status;
+
+bad_option:
+	fprintf(stderr, "Bad or incomplete option: %s\n", argv[i - (i == argc)]);
+	usage(stderr);
+	return 2;
 }
 
 int main(int argc, char *argv[]){
-	clock_t clock_start, clock_end;
-	double time_total;
-	clock_start = clock();
-
-
-	for (int i = 0; i <= argc; i++) printf(LOG_LEVEL_LOGGER "argv[%d] = %s\n", i, argv[i]);
-
-
-	int index = 0;
-	token_t *token = get_next_token("-100", &index);
-
-	printf("TOKEN_TYPE: %d\n", token->type);
-	printf("TOKEN_TEXT: %s\n", token->text);
-
-	free(token->text);
-	free(token);
-
-	const char *code1 = "{ x = 5 + 3 * 2; }";
-	printf(LOG_LEVEL_LOGGER "Parsing Code 1\n%s\n", code1);
-	ast_node *ast1 = parse(code1);
-	print_ast(ast1, 0);
-	free_ast(ast1);
-	
-	printf("\n\n");
-	
-	const char *code2 = 
-		"{"
-		"  a = 10;"
-		"  if (a > 5) {"
-		"	b = 20;"
-		"  } else {"
-		"	b = 0;"
-		"  }"
-		"  for (i = 0; i < 10; i = i + 1) {"
-		"	c = c + i;"
-		"	if (c > 15) {"
-		"	  break;"
-		"	}"
-		"  }"
-		"  while (c < 100) {"
-		"	c = c * 2;"
-		"  }"
-		"}";
-	
-	printf(LOG_LEVEL_LOGGER "Parsing Code 2\n%s\n", code2);
-	ast_node *ast2 = parse(code2);
-	print_ast(ast2, 0);
-	free_ast(ast2);
-
-	clock_end = clock();
-	time_total = (double)((clock_end - clock_start) / CLOCKS_PER_SEC);
-	printf(LOG_LEVEL_LOGGER "Program stopped. Time used: %.5f second(s).\n", time_total);
+	if (argc < 2) {
+		usage(stderr);
+		return 2;
+	}
 
-	return 0;
-}
\ No newline at end of file
+	const char *command = argv[1];
+	if (strcmp(command, "help") == 0 || strcmp(command, "--help") == 0 || strcmp(command, "-h") == 0) {
+		usage(stdout);
+		return 0;
+	}
+
+	if (strcmp(command, "batch") == 0) {
+		int status = batch_command(argc, argv);
+		symbol_table_free();
+		return status;
+	}
+
+	if (strcmp(command, "build") == 0) {
+		int status = build_command(argc, argv);
+		symbol_table_free();
+		return status;
+	}
+
+	int flat = 0, optimize = 0, use_jit = 0, stats_format = 0;
+	unsigned parallel = 0;
+	dump_format format = DUMP_TEXT;
+	const char *cache_dir = getenv("LUMEN_CACHE_DIR");
+	int first = 2;
+	for (; first < argc && argv[first][0] == '-' && argv[first][1] == '-'; first++) {
+		if (strcmp(argv[first], "--") == 0) {
+			first++;
+			break;
+		} else if (strcmp(argv[first], "--flat") == 0) {
+			flat = 1;
+		} else if (strcmp(argv[first], "--optimize") == 0) {
+			optimize = 1;
+		} else if (strcmp(argv[first], "--jit") == 0) {
+			use_jit = 1;
+		} else if (strcmp(argv[first], "--parallel") == 0) {
+			parallel = pool_default_threads();
+		} else if (strncmp(argv[first], "--parallel=", 11) == 0 && strtoul(argv[first] + 11, NULL, 10) > 0) {
+			parallel = (unsigned)strtoul(argv[first] + 11, NULL, 10);
+		} else if (strcmp(argv[first], "--stats") == 0 || strcmp(argv[first], "--stats=text") == 0) {
+			stats_format = STATS_FORMAT_TEXT;
+		} else if (strcmp(argv[first], "--stats=json") == 0) {
+			stats_format = STATS_FORMAT_JSON;
+		} else if (strncmp(argv[first], "--format=", 9) == 0 && dump_format_parse(argv[first] + 9) >= 0) {
+			format = (dump_format)dump_format_parse(argv[first] + 9);
+		} else if (strcmp(argv[first], "--cache-dir") == 0 && first + 1 < argc) {
+			cache_dir = argv[++first];
+		} else if (strcmp(argv[first], "--max-nesting") == 0 && first + 1 < argc) {
+			parse_set_nesting_limit((uint32_t)strtoul(argv[++first], NULL, 10));
+		} else {
+			fprintf(stderr, "Unknown option: %s\n", argv[first]);
+			usage(stderr);
+			return 2;
+		}
+	}
+
+	if (cache_dir && !*cache_dir) cache_dir = NULL;
+
+	int file_count = argc - first;
+	if (file_count < 1) {
+		usage(stderr);
+		return 2;
+	}
+
+	if (stats_format) mem_track(1);
+
+	int status = 0;
+	if (strcmp(command, "run") == 0 || strcmp(command, "disasm") == 0) {
+		if (file_count != 1) {
+			fprintf(stderr, "%s takes exactly one file\n", command);
+			return 2;
+		}
+		status = process_file(command, argv[first], flat, optimize, use_jit, parallel, format, cache_dir, stats_format);
+	} else if (strcmp(command, "tokens") == 0 || strcmp(command, "parse") == 0) {
+		for (int i = first; i < argc; i++) {
+			if (file_count > 1) printf("==> %s <==\n", argv[i]);
+			if (command[0] == 't') status |= tokens_file(argv[i]);
+			else status |= process_file(command, argv[i], flat, optimize, use_jit, parallel, format, cache_dir, stats_format);
+		}
+	} else {
+		fprintf(stderr, "Unknown command: %s\n", command);
+		usage(stderr);
+		return 2;
+	}
+
+	symbol_table_free();
+	return status;
+}
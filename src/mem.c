@@ -0,0 +1,54 @@
+/*
+ *
+ *		mem.c
+ *		LUMEN LANGUAGE PROJECT
+ *		Rainy101112 - 2025/7/20
+ *
+ */
+
+#include <mem.h>
+#include <stdlib.h>
+
+static int tracking;
+static mem_counters counters;
+
+// Relaxed atomics: the totals are only read once the work is done
+static inline void record(uint64_t *counter, size_t bytes) {
+	if (!__atomic_load_n(&tracking, __ATOMIC_RELAXED)) return;
+
+	__atomic_fetch_add(counter, 1, __ATOMIC_RELAXED);
+	__atomic_fetch_add(&counters.bytes, bytes, __ATOMIC_RELAXED);
+}
+
+void *mem_alloc(size_t size) {
+	record(&counters.allocations, size);
+	return malloc(size);
+}
+
+void *mem_calloc(size_t count, size_t size) {
+	record(&counters.allocations, count * size);
+	return calloc(count, size);
+}
+
+void *mem_realloc(void *pointer, size_t size) {
+	record(pointer ? &counters.reallocations : &counters.allocations, size);
+	return realloc(pointer, size);
+}
+
+void mem_free(void *pointer) {
+	if (pointer) record(&counters.frees, 0);
+	free(pointer);
+}
+
+void mem_track(int enable) {
+	__atomic_store_n(&tracking, enable, __ATOMIC_RELAXED);
+}
+
+mem_counters mem_stats(void) {
+	mem_counters snapshot;
+	snapshot.allocations = __atomic_load_n(&counters.allocations, __ATOMIC_RELAXED);
+	snapshot.reallocations = __atomic_load_n(&counters.reallocations, __ATOMIC_RELAXED);
+	snapshot.frees = __atomic_load_n(&counters.frees, __ATOMIC_RELAXED);
+	snapshot.bytes = __atomic_load_n(&counters.bytes, __ATOMIC_RELAXED);
+	return snapshot;
+}
@@ -0,0 +1,407 @@
+/*
+ *
+ *		optimize.c
+ *		LUMEN LANGUAGE PROJECT
+ *		Rainy101112 - 2025/7/20
+ *
+ */
+
+#include <optimize.h>
+#include <visit.h>
+#include <mem.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+	arena_t *arena;
+	size_t removed;
+} optimizer_state;
+
+static size_t count_nodes(const ast_node *node) {
+	if (!node) return 0;
+
+	size_t count = 1;
+	switch (node->type) {
+		case AST_BLOCK:
+			for (int i = 0; i < node->data.block.count; i++) {
+				count += count_nodes(node->data.block.statements[i]);
+			}
+			break;
+
+		case AST_ASSIGNMENT:
+			count += count_nodes(node->data.assign.value);
+			break;
+
+		case AST_BINARY_OP:
+			count += count_nodes(node->data.binop.left);
+			count += count_nodes(node->data.binop.right);
+			break;
+
+		case AST_UNARY_OP:
+			count += count_nodes(node->data.unop.operand);
+			break;
+
+		case AST_ARRAY:
+			for (int i = 0; i < node->data.array.count; i++) {
+				count += count_nodes(node->data.array.elements[i]);
+			}
+			break;
+
+		case AST_IF_STMT:
+			count += count_nodes(node->data.if_stmt.condition);
+			count += count_nodes(node->data.if_stmt.then_block);
+			count += count_nodes(node->data.if_stmt.else_block);
+			break;
+
+		case AST_FOR_LOOP:
+			count += count_nodes(node->data.for_loop.init);
+			count += count_nodes(node->data.for_loop.condition);
+			count += count_nodes(node->data.for_loop.update);
+			count += count_nodes(node->data.for_loop.body);
+			break;
+
+		case AST_WHILE_LOOP:
+			count += count_nodes(node->data.while_loop.condition);
+			count += count_nodes(node->data.while_loop.body);
+			break;
+
+		default:
+			break;
+	}
+	return count;
+}
+
+// Drops a whole subtree
+static void discard_tree(optimizer_state *state, ast_node *node) {
+	state->removed += count_nodes(node);
+	if (!state->arena) free_ast(node);
+}
+
+// Drops a single node whose children have been moved elsewhere
+static void discard_shell(optimizer_state *state, ast_node *node) {
+	state->removed++;
+	if (!state->arena) {
+		if (node->type == AST_BLOCK) mem_free(node->data.block.statements);
+		mem_free(node);
+	}
+}
+
+static int is_literal(const ast_node *node, double value) {
+	// Bitwise, so that 0.0 and -0.0 are told apart
+	if (node->type != AST_LITERAL) return 0;
+
+	double literal = literal_as_double(node->data.literal);
+	return memcmp(&literal, &value, sizeof(double)) == 0;
+}
+
+// Same semantics as the VM instructions for these operators
+static int fold_binary(token_type_t op, double left, double right, double *result) {
+	switch (op) {
+		case TOKEN_OPERATOR_PLUS: *result = left + right; return 1;
+		case TOKEN_OPERATOR_MINUS: *result = left - right; return 1;
+		case TOKEN_OPERATOR_MULTIPLY: *result = left * right; return 1;
+		case TOKEN_OPERATOR_DIVIDE: *result = left / right; return 1;
+		case TOKEN_OPERATOR_LESS: *result = left < right; return 1;
+		case TOKEN_OPERATOR_GREATER: *result = left > right; return 1;
+		case TOKEN_OPERATOR_LESS_EQUAL: *result = left <= right; return 1;
+		case TOKEN_OPERATOR_GREATER_EQUAL: *result = left >= right; return 1;
+		case TOKEN_OPERATOR_EQUAL: *result = left == right; return 1;
+		case TOKEN_OPERATOR_NOT_EQUAL: *result = left != right; return 1;
+		case TOKEN_OPERATOR_AND: *result = left != 0.0 && right != 0.0; return 1;
+		case TOKEN_OPERATOR_OR: *result = left != 0.0 || right != 0.0; return 1;
+		default: return 0;
+	}
+}
+
+static int fold_unary(token_type_t op, double operand, double *result) {
+	switch (op) {
+		case TOKEN_OPERATOR_MINUS: *result = -operand; return 1;
+		case TOKEN_OPERATOR_NOT: *result = operand == 0.0; return 1;
+		default: return 0;
+	}
+}
+
+// Integer operands give an integer when a double holds the result exactly; -0 stays a float
+static literal_value folded_literal(literal_value left, literal_value right, double result) {
+	literal_value value = { .kind = LITERAL_FLOAT, .as.number = result };
+
+	if (left.kind == LITERAL_INTEGER && right.kind == LITERAL_INTEGER
+		&& result >= -9007199254740992.0 && result <= 9007199254740992.0
+		&& (double)(int64_t)result == result && !(result == 0.0 && signbit(result))) {
+		value.kind = LITERAL_INTEGER;
+		value.as.integer = (int64_t)result;
+	}
+	return value;
+}
+
+/*
+ * Only identities that hold for every double, including NaN, infinities and
+ * signed zeros: x*1, 1*x, x/1, x-0, x+(-0) and (-0)+x. x+0 is not one of
+ * them (-0 + 0 is +0), and neither is x*0 (NaN, inf, and sign). Applied
+ * element by element they hold for arrays too.
+ */
+static ast_node *simplify_identity(optimizer_state *state, ast_node *node) {
+	ast_node *left = node->data.binop.left;
+	ast_node *right = node->data.binop.right;
+	ast_node *keep = NULL, *constant = NULL;
+
+	switch (node->data.binop.op) {
+		case TOKEN_OPERATOR_MULTIPLY:
+			if (is_literal(right, 1.0)) keep = left, constant = right;
+			else if (is_literal(left, 1.0)) keep = right, constant = left;
+			break;
+
+		case TOKEN_OPERATOR_DIVIDE:
+			if (is_literal(right, 1.0)) keep = left, constant = right;
+			break;
+
+		case TOKEN_OPERATOR_MINUS:
+			if (is_literal(right, 0.0)) keep = left, constant = right;
+			break;
+
+		case TOKEN_OPERATOR_PLUS:
+			if (is_literal(right, -0.0)) keep = left, constant = right;
+			else if (is_literal(left, -0.0)) keep = right, constant = left;
+			break;
+
+		default:
+			break;
+	}
+
+	if (!keep) return node;
+
+	discard_tree(state, constant);
+	discard_shell(state, node);
+	return keep;
+}
+
+static ast_node *optimize_expression(optimizer_state *state, ast_node *node) {
+	if (node && node->type == AST_ARRAY) {
+		for (int i = 0; i < node->data.array.count; i++) {
+			node->data.array.elements[i] = optimize_expression(state, node->data.array.elements[i]);
+		}
+		return node;
+	}
+
+	if (node && node->type == AST_UNARY_OP) {
+		ast_node *operand = optimize_expression(state, node->data.unop.operand);
+		node->data.unop.operand = operand;
+
+		double value;
+		if (operand->type == AST_LITERAL && fold_unary(node->data.unop.op, literal_as_double(operand->data.literal), &value)) {
+			// !x is 0 or 1 whatever x holds; -x keeps an integer an integer unless it gives -0
+			literal_value kind = operand->data.literal;
+			if (node->data.unop.op == TOKEN_OPERATOR_NOT) kind.kind = LITERAL_INTEGER;
+			literal_value folded = folded_literal(kind, kind, value);
+			discard_tree(state, operand);
+
+			node->type = AST_LITERAL;
+			node->data.literal = folded;
+		}
+		return node;
+	}
+
+	if (!node || node->type != AST_BINARY_OP) return node;
+
+	node->data.binop.left = optimize_expression(state, node->data.binop.left);
+	node->data.binop.right = optimize_expression(state, node->data.binop.right);
+
+	ast_node *left = node->data.binop.left;
+	ast_node *right = node->data.binop.right;
+	double value;
+
+	if (left->type == AST_LITERAL && right->type == AST_LITERAL
+		&& fold_binary(node->data.binop.op, literal_as_double(left->data.literal), literal_as_double(right->data.literal), &value)) {
+		literal_value folded = folded_literal(left->data.literal, right->data.literal, value);
+		discard_tree(state, left);
+		discard_tree(state, right);
+
+		// Reuse the operator node as the folded literal
+		node->type = AST_LITERAL;
+		node->data.literal = folded;
+		return node;
+	}
+
+	return simplify_identity(state, node);
+}
+
+// A constant condition is truthy exactly when the VM's JMPF would not jump
+static int constant_condition(const ast_node *node, int *truthy) {
+	if (!node || node->type != AST_LITERAL) return 0;
+	*truthy = literal_as_double(node->data.literal) != 0.0;
+	return 1;
+}
+
+static ast_node *optimize_statement(optimizer_state *state, ast_node *node);
+
+static int is_jump(const ast_node *node) {
+	return node->type == AST_BREAK || node->type == AST_CONTINUE;
+}
+
+static int push_statement(ast_node ***out, int *count, int *capacity, ast_node *stmt) {
+	if (*count == *capacity) {
+		*capacity = *capacity ? *capacity * 2 : 8;
+		ast_node **grown = mem_realloc(*out, *capacity * sizeof(ast_node *));
+		if (!grown) {
+			fprintf(stderr, "Memory allocate failed at %s:%d", __FILE__, __LINE__);
+			return 0;
+		}
+		*out = grown;
+	}
+	(*out)[(*count)++] = stmt;
+	return 1;
+}
+
+static void optimize_block(optimizer_state *state, ast_node *block) {
+	block_statement *list = &block->data.block;
+	ast_node **out = NULL;
+	int count = 0, capacity = 0;
+
+	// Set once a break/continue is kept; nothing after it in this block can run
+	int terminated = 0;
+
+	for (int i = 0; i < list->count; i++) {
+		ast_node *stmt = list->statements[i];
+		if (terminated) {
+			discard_tree(state, stmt);
+			continue;
+		}
+
+		stmt = optimize_statement(state, stmt);
+		if (!stmt) continue;
+
+		if (stmt->type != AST_BLOCK) {
+			if (!push_statement(&out, &count, &capacity, stmt)) return;
+			terminated = is_jump(stmt);
+			continue;
+		}
+
+		// Blocks do not open a scope, so nested blocks are spliced in
+		for (int j = 0; j < stmt->data.block.count; j++) {
+			ast_node *inner = stmt->data.block.statements[j];
+			if (terminated) {
+				discard_tree(state, inner);
+				continue;
+			}
+			if (!push_statement(&out, &count, &capacity, inner)) return;
+			terminated = is_jump(inner);
+		}
+		discard_shell(state, stmt);
+	}
+
+	if (!state->arena) {
+		mem_free(list->statements);
+		list->statements = out;
+	} else {
+		list->statements = count ? arena_memdup(state->arena, out, count * sizeof(ast_node *)) : NULL;
+		mem_free(out);
+	}
+	list->count = count;
+}
+
+// Variables may hold arrays, and literals, indexes and len work on them; anything else is plain arithmetic
+static ast_visit_action find_array_use(ast_node *node, const ast_visit_position *at, void *context) {
+	(void)at;
+	int uses_array = node->type == AST_VARIABLE || node->type == AST_ARRAY
+		|| (node->type == AST_BINARY_OP && node->data.binop.op == TOKEN_OPEN_BRACKET)
+		|| (node->type == AST_UNARY_OP && node->data.unop.op == TOKEN_KEYWORD_LEN);
+	if (!uses_array) return AST_VISIT_CONTINUE;
+
+	*(int *)context = 1;
+	return AST_VISIT_STOP;
+}
+
+static const ast_visitor array_use_finder = { find_array_use, NULL };
+
+static ast_node *optimize_statement(optimizer_state *state, ast_node *node) {
+	if (!node) return NULL;
+
+	int truthy;
+	switch (node->type) {
+		case AST_BLOCK:
+			optimize_block(state, node);
+			return node;
+
+		case AST_ASSIGNMENT:
+			node->data.assign.value = optimize_expression(state, node->data.assign.value);
+			return node;
+
+		case AST_IF_STMT: {
+			if_statement *stmt = &node->data.if_stmt;
+			stmt->condition = optimize_expression(state, stmt->condition);
+			stmt->then_block = optimize_statement(state, stmt->then_block);
+			stmt->else_block = optimize_statement(state, stmt->else_block);
+
+			if (!constant_condition(stmt->condition, &truthy)) return node;
+
+			ast_node *taken = truthy ? stmt->then_block : stmt->else_block;
+			ast_node *dropped = truthy ? stmt->else_block : stmt->then_block;
+			discard_tree(state, stmt->condition);
+			discard_tree(state, dropped);
+			discard_shell(state, node);
+			return taken;
+		}
+
+		case AST_WHILE_LOOP: {
+			while_loop *loop = &node->data.while_loop;
+			loop->condition = optimize_expression(state, loop->condition);
+			loop->body = optimize_statement(state, loop->body);
+
+			if (constant_condition(loop->condition, &truthy) && !truthy) {
+				discard_tree(state, node);
+				return NULL;
+			}
+			return node;
+		}
+
+		case AST_FOR_LOOP: {
+			for_loop *loop = &node->data.for_loop;
+			loop->init = optimize_statement(state, loop->init);
+			loop->condition = optimize_expression(state, loop->condition);
+			loop->update = optimize_statement(state, loop->update);
+			loop->body = optimize_statement(state, loop->body);
+
+			// The body never runs; only the initializer remains
+			if (constant_condition(loop->condition, &truthy) && !truthy) {
+				ast_node *init = loop->init;
+				loop->init = NULL;
+				discard_tree(state, node);
+				return init;
+			}
+			return node;
+		}
+
+		case AST_BREAK:
+		case AST_CONTINUE:
+			return node;
+
+		default: {
+			// A bare expression has no effect besides the array errors it may raise, so it stays only if it can raise one
+			ast_node *expression = optimize_expression(state, node);
+			int may_fail = 0;
+			ast_visit(expression, &array_use_finder, &may_fail);
+			if (may_fail) return expression;
+
+			discard_tree(state, expression);
+			return NULL;
+		}
+	}
+}
+
+size_t optimize_ast(ast_node *root, arena_t *arena) {
+	if (!root) return 0;
+
+	optimizer_state state = {
+		.arena = arena,
+		.removed = 0
+	};
+
+	if (root->type == AST_BLOCK) {
+		optimize_block(&state, root);
+	} else {
+		optimize_statement(&state, root);
+	}
+	return state.removed;
+}
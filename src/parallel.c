@@ -0,0 +1,436 @@
+/*
+ *
+ *		parallel.c
+ *		LUMEN LANGUAGE PROJECT
+ *		Rainy101112 - 2025/7/20
+ *
+ */
+
+#include <parallel.h>
+#include <mem.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// How the body uses a variable it assigns
+enum {
+	USE_NONE,
+	USE_SUM,
+	USE_PRODUCT,
+	USE_OTHER
+};
+
+typedef struct {
+	uint32_t slot_count;
+	uint32_t induction;
+
+	// Per slot: assigned in the body, USE_*, read other than as its own reduction operand
+	uint8_t *written;
+	uint8_t *use;
+	uint8_t *loose_read;
+
+	// Bitsets over slots, words_per_set 64-bit words each
+	size_t words_per_set;
+	uint64_t *private;
+
+	// Loops entered inside the body; break and continue at depth 0 are this loop's
+	uint32_t loop_depth;
+
+	int serial;
+} loop_scan;
+
+static int set_has(const uint64_t *set, uint32_t slot) {
+	return (set[slot / 64] >> (slot % 64)) & 1;
+}
+
+static void set_add(uint64_t *set, uint32_t slot) {
+	set[slot / 64] |= (uint64_t)1 << (slot % 64);
+}
+
+static uint64_t *set_clone(loop_scan *scan, const uint64_t *from) {
+	uint64_t *set = mem_alloc((scan->words_per_set ? scan->words_per_set : 1) * sizeof(uint64_t));
+	if (!set) {
+		fprintf(stderr, "Memory allocate failed at %s:%d", __FILE__, __LINE__);
+		scan->serial = 1;
+		return NULL;
+	}
+	memcpy(set, from, scan->words_per_set * sizeof(uint64_t));
+	return set;
+}
+
+static int is_variable(const ast_node *node, uint32_t slot) {
+	return node && node->type == AST_VARIABLE && node->data.variable.slot == slot;
+}
+
+// The operand of an assignment that makes it v = v + e, v = e + v, v = v - e, v = v * e or v = e * v
+static const ast_node *reduction_operand(const ast_node *assign, int *use) {
+	const ast_node *value = assign->data.assign.value;
+	uint32_t slot = assign->data.assign.slot;
+	if (value->type != AST_BINARY_OP) return NULL;
+
+	const ast_node *left = value->data.binop.left, *right = value->data.binop.right;
+	switch (value->data.binop.op) {
+		case TOKEN_OPERATOR_PLUS:
+		case TOKEN_OPERATOR_MULTIPLY:
+			*use = value->data.binop.op == TOKEN_OPERATOR_PLUS ? USE_SUM : USE_PRODUCT;
+			if (is_variable(left, slot)) return left;
+			if (is_variable(right, slot)) return right;
+			return NULL;
+
+		case TOKEN_OPERATOR_MINUS:
+			*use = USE_SUM;
+			return is_variable(left, slot) ? left : NULL;
+
+		default:
+			return NULL;
+	}
+}
+
+static void scan_expression(loop_scan *scan, const ast_node *node, const ast_node *operand) {
+	if (!node) return;
+
+	switch (node->type) {
+		case AST_VARIABLE:
+			if (node != operand) scan->loose_read[node->data.variable.slot] = 1;
+			break;
+
+		case AST_BINARY_OP:
+			scan_expression(scan, node->data.binop.left, operand);
+			scan_expression(scan, node->data.binop.right, operand);
+			break;
+
+		case AST_UNARY_OP:
+			scan_expression(scan, node->data.unop.operand, operand);
+			break;
+
+		case AST_ARRAY:
+			for (int i = 0; i < node->data.array.count; i++) {
+				scan_expression(scan, node->data.array.elements[i], operand);
+			}
+			break;
+
+		default:
+			break;
+	}
+}
+
+// First pass: what the body assigns and how, and whether it jumps out of this loop
+static void scan_statement(loop_scan *scan, const ast_node *node) {
+	if (!node || scan->serial) return;
+
+	switch (node->type) {
+		case AST_BLOCK:
+			for (int i = 0; i < node->data.block.count; i++) {
+				scan_statement(scan, node->data.block.statements[i]);
+			}
+			break;
+
+		case AST_ASSIGNMENT: {
+			uint32_t slot = node->data.assign.slot;
+			int use = USE_OTHER;
+			const ast_node *operand = reduction_operand(node, &use);
+			if (!operand) use = USE_OTHER;
+
+			scan->written[slot] = 1;
+			if (scan->use[slot] == USE_NONE) scan->use[slot] = (uint8_t)use;
+			else if (scan->use[slot] != use) scan->use[slot] = USE_OTHER;
+			scan_expression(scan, node->data.assign.value, operand);
+			break;
+		}
+
+		case AST_IF_STMT:
+			scan_expression(scan, node->data.if_stmt.condition, NULL);
+			scan_statement(scan, node->data.if_stmt.then_block);
+			scan_statement(scan, node->data.if_stmt.else_block);
+			break;
+
+		case AST_WHILE_LOOP:
+			scan_expression(scan, node->data.while_loop.condition, NULL);
+			scan->loop_depth++;
+			scan_statement(scan, node->data.while_loop.body);
+			scan->loop_depth--;
+			break;
+
+		case AST_FOR_LOOP:
+			scan_statement(scan, node->data.for_loop.init);
+			scan_expression(scan, node->data.for_loop.condition, NULL);
+			scan->loop_depth++;
+			scan_statement(scan, node->data.for_loop.update);
+			scan_statement(scan, node->data.for_loop.body);
+			scan->loop_depth--;
+			break;
+
+		case AST_BREAK:
+		case AST_CONTINUE:
+			if (!scan->loop_depth) scan->serial = 1;
+			break;
+
+		default:
+			scan_expression(scan, node, NULL);
+			break;
+	}
+}
+
+// Whether node reads the induction variable or anything the body assigns
+static int reads_written(const loop_scan *scan, const ast_node *node) {
+	if (!node) return 0;
+
+	switch (node->type) {
+		case AST_VARIABLE: {
+			uint32_t slot = node->data.variable.slot;
+			return slot == scan->induction || scan->written[slot];
+		}
+
+		case AST_BINARY_OP:
+			return reads_written(scan, node->data.binop.left) || reads_written(scan, node->data.binop.right);
+
+		case AST_UNARY_OP:
+			return reads_written(scan, node->data.unop.operand);
+
+		case AST_ARRAY:
+			for (int i = 0; i < node->data.array.count; i++) {
+				if (reads_written(scan, node->data.array.elements[i])) return 1;
+			}
+			return 0;
+
+		default:
+			return 0;
+	}
+}
+
+static void check_reads(loop_scan *scan, const ast_node *node, const uint64_t *assigned) {
+	if (!node || scan->serial) return;
+
+	switch (node->type) {
+		case AST_VARIABLE: {
+			uint32_t slot = node->data.variable.slot;
+			if (set_has(scan->private, slot) && !set_has(assigned, slot)) scan->serial = 1;
+			break;
+		}
+
+		case AST_BINARY_OP:
+			check_reads(scan, node->data.binop.left, assigned);
+			check_reads(scan, node->data.binop.right, assigned);
+			break;
+
+		case AST_UNARY_OP:
+			check_reads(scan, node->data.unop.operand, assigned);
+			break;
+
+		case AST_ARRAY:
+			for (int i = 0; i < node->data.array.count; i++) {
+				check_reads(scan, node->data.array.elements[i], assigned);
+			}
+			break;
+
+		default:
+			break;
+	}
+}
+
+/*
+ * Second pass: definite assignment of the private variables, as in the
+ * resolver but per iteration. Loops inside the body may run zero times,
+ * so what they assign does not count after them.
+ */
+static void check_statement(loop_scan *scan, const ast_node *node, uint64_t *assigned) {
+	if (!node || scan->serial) return;
+
+	switch (node->type) {
+		case AST_BLOCK:
+			for (int i = 0; i < node->data.block.count; i++) {
+				check_statement(scan, node->data.block.statements[i], assigned);
+			}
+			break;
+
+		case AST_ASSIGNMENT:
+			check_reads(scan, node->data.assign.value, assigned);
+			set_add(assigned, node->data.assign.slot);
+			break;
+
+		case AST_IF_STMT: {
+			check_reads(scan, node->data.if_stmt.condition, assigned);
+
+			uint64_t *else_set = set_clone(scan, assigned);
+			if (!else_set) return;
+
+			check_statement(scan, node->data.if_stmt.then_block, assigned);
+			check_statement(scan, node->data.if_stmt.else_block, else_set);
+			for (size_t i = 0; i < scan->words_per_set; i++) assigned[i] &= else_set[i];
+			mem_free(else_set);
+			break;
+		}
+
+		case AST_WHILE_LOOP: {
+			check_reads(scan, node->data.while_loop.condition, assigned);
+
+			uint64_t *body_set = set_clone(scan, assigned);
+			check_statement(scan, node->data.while_loop.body, body_set);
+			mem_free(body_set);
+			break;
+		}
+
+		case AST_FOR_LOOP: {
+			check_statement(scan, node->data.for_loop.init, assigned);
+			check_reads(scan, node->data.for_loop.condition, assigned);
+
+			// The update may follow a continue, so it only gets what held before the body
+			uint64_t *body_set = set_clone(scan, assigned);
+			uint64_t *update_set = set_clone(scan, assigned);
+			if (body_set && update_set) {
+				check_statement(scan, node->data.for_loop.body, body_set);
+				check_statement(scan, node->data.for_loop.update, update_set);
+			}
+			mem_free(body_set);
+			mem_free(update_set);
+			break;
+		}
+
+		case AST_BREAK:
+		case AST_CONTINUE:
+			// Only those of inner loops get here; nothing after them on this path runs
+			memset(assigned, 0xFF, scan->words_per_set * sizeof(uint64_t));
+			break;
+
+		default:
+			check_reads(scan, node, assigned);
+			break;
+	}
+}
+
+// i <op> bound, or bound <op> i turned around
+static int match_condition(const ast_node *condition, const ast_node *update, parallel_plan *plan) {
+	if (!condition || condition->type != AST_BINARY_OP || !update || update->type != AST_ASSIGNMENT) return 0;
+
+	token_type_t op = condition->data.binop.op, mirrored;
+	switch (op) {
+		case TOKEN_OPERATOR_LESS: mirrored = TOKEN_OPERATOR_GREATER; break;
+		case TOKEN_OPERATOR_GREATER: mirrored = TOKEN_OPERATOR_LESS; break;
+		case TOKEN_OPERATOR_LESS_EQUAL: mirrored = TOKEN_OPERATOR_GREATER_EQUAL; break;
+		case TOKEN_OPERATOR_GREATER_EQUAL: mirrored = TOKEN_OPERATOR_LESS_EQUAL; break;
+		default: return 0;
+	}
+
+	uint32_t slot = update->data.assign.slot;
+	if (is_variable(condition->data.binop.left, slot)) {
+		plan->compare = op;
+		plan->bound = condition->data.binop.right;
+	} else if (is_variable(condition->data.binop.right, slot)) {
+		plan->compare = mirrored;
+		plan->bound = condition->data.binop.left;
+	} else {
+		return 0;
+	}
+	plan->induction = slot;
+	return 1;
+}
+
+// i = i + c, i = c + i or i = i - c with c a nonzero integer literal
+static int match_step(const ast_node *update, parallel_plan *plan) {
+	const ast_node *value = update->data.assign.value;
+	if (value->type != AST_BINARY_OP) return 0;
+
+	const ast_node *left = value->data.binop.left, *right = value->data.binop.right;
+	const ast_node *literal;
+	double sign = 1.0;
+	if (value->data.binop.op == TOKEN_OPERATOR_PLUS && is_variable(left, plan->induction)) {
+		literal = right;
+	} else if (value->data.binop.op == TOKEN_OPERATOR_PLUS && is_variable(right, plan->induction)) {
+		literal = left;
+	} else if (value->data.binop.op == TOKEN_OPERATOR_MINUS && is_variable(left, plan->induction)) {
+		literal = right;
+		sign = -1.0;
+	} else {
+		return 0;
+	}
+	if (literal->type != AST_LITERAL) return 0;
+
+	double step = sign * literal_as_double(literal->data.literal);
+	if (step != floor(step) || step == 0.0 || fabs(step) > INT32_MAX) return 0;
+	plan->step = (int32_t)step;
+
+	// The step has to move i towards the bound, or the trip count means nothing
+	int upward = plan->compare == TOKEN_OPERATOR_LESS || plan->compare == TOKEN_OPERATOR_LESS_EQUAL;
+	return upward == (plan->step > 0);
+}
+
+static int collect_reductions(loop_scan *scan, parallel_plan *plan) {
+	uint32_t count = 0;
+	for (uint32_t slot = 0; slot < scan->slot_count; slot++) {
+		if (scan->written[slot] && scan->use[slot] != USE_OTHER && !scan->loose_read[slot]) count++;
+	}
+
+	plan->reductions = mem_alloc((count ? count : 1) * sizeof(loop_reduction));
+	if (!plan->reductions) {
+		fprintf(stderr, "Memory allocate failed at %s:%d", __FILE__, __LINE__);
+		return 0;
+	}
+
+	for (uint32_t slot = 0; slot < scan->slot_count; slot++) {
+		if (!scan->written[slot]) continue;
+
+		if (scan->use[slot] != USE_OTHER && !scan->loose_read[slot]) {
+			loop_reduction *reduction = &plan->reductions[plan->reduction_count++];
+			reduction->reg = slot;
+			reduction->kind = scan->use[slot] == USE_SUM ? REDUCE_SUM : REDUCE_PRODUCT;
+		} else {
+			set_add(scan->private, slot);
+		}
+	}
+	return 1;
+}
+
+int parallel_analyze(const ast_node *loop, uint32_t slot_count, parallel_plan *plan) {
+	memset(plan, 0, sizeof(*plan));
+	if (!loop || loop->type != AST_FOR_LOOP || !loop->data.for_loop.body) return 0;
+	if (!match_condition(loop->data.for_loop.condition, loop->data.for_loop.update, plan)) return 0;
+	if (!match_step(loop->data.for_loop.update, plan)) return 0;
+
+	loop_scan scan = {
+		.slot_count = slot_count,
+		.induction = plan->induction,
+		.words_per_set = (slot_count + 63) / 64
+	};
+	if (plan->induction >= slot_count) return 0;
+
+	size_t words = scan.words_per_set ? scan.words_per_set : 1;
+	scan.written = mem_calloc(slot_count, 1);
+	scan.use = mem_calloc(slot_count, 1);
+	scan.loose_read = mem_calloc(slot_count, 1);
+	scan.private = mem_calloc(words, sizeof(uint64_t));
+	uint64_t *assigned = mem_calloc(words, sizeof(uint64_t));
+	if (!scan.written || !scan.use || !scan.loose_read || !scan.private || !assigned) {
+		fprintf(stderr, "Memory allocate failed at %s:%d", __FILE__, __LINE__);
+		scan.serial = 1;
+	}
+
+	if (!scan.serial) scan_statement(&scan, loop->data.for_loop.body);
+	if (!scan.serial && (scan.written[plan->induction] || reads_written(&scan, plan->bound))) scan.serial = 1;
+	if (!scan.serial && !collect_reductions(&scan, plan)) scan.serial = 1;
+
+	if (!scan.serial) check_statement(&scan, loop->data.for_loop.body, assigned);
+
+	// Every iteration has to leave its own value in each private variable
+	for (size_t i = 0; i < scan.words_per_set && !scan.serial; i++) {
+		if (scan.private[i] & ~assigned[i]) scan.serial = 1;
+	}
+
+	mem_free(scan.written);
+	mem_free(scan.use);
+	mem_free(scan.loose_read);
+	mem_free(scan.private);
+	mem_free(assigned);
+
+	if (scan.serial) {
+		parallel_plan_free(plan);
+		return 0;
+	}
+	return 1;
+}
+
+void parallel_plan_free(parallel_plan *plan) {
+	mem_free(plan->reductions);
+	plan->reductions = NULL;
+	plan->reduction_count = 0;
+}
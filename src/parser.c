@@ -1,389 +1,1105 @@
-/*
- *
- *		parser.c
- *		LUMEN LANGUAGE PROJECT
- *		Rainy101112 - 2025/7/20
- *
- */
-
-#include <token.h>
-#include <lexer.h>
-#include <stdio.h>
-#include <stdlib.h>
-#include <string.h>
-#include <ast.h>
-
-typedef struct {
-	const char *source;
-	int index;
-	token_t *current_token;
-} parser_state;
-
-static void next_token(parser_state *state) {
-	if (state->current_token) {
-		free(state->current_token->text);
-		free(state->current_token);
-	}
-	state->current_token = get_next_token(state->source, &state->index);
-}
-
-static ast_node *parse_expression(parser_state *state);
-static ast_node *parse_statement(parser_state *state);
-static ast_node *parse_block(parser_state *state);
-
-static ast_node *create_ast_node(ast_node_type type) {
-	ast_node *node = malloc(sizeof(ast_node));
-	if (!node) {
-		fprintf(stderr, "Memory allocation failed\n");
-		return NULL;
-	}
-	node->type = type;
-	return node;
-}
-
-static ast_node *parse_primary(parser_state *state) {
-	if (!state->current_token) return NULL;
-
-	token_t *tok = state->current_token;
-	ast_node *node = NULL;
-	
-	switch (tok->type) {
-		case TOKEN_IDENTIFIER:
-			node = create_ast_node(AST_VARIABLE);
-			node->data.variable = strdup(tok->text);
-			next_token(state);
-			break;
-			
-		case TOKEN_NUMBER:
-			node = create_ast_node(AST_LITERAL);
-			node->data.literal = atof(tok->text);
-			next_token(state);
-			break;
-			
-		case TOKEN_OPEN_PAREN: {
-			next_token(state);  // Jump over '('
-			node = parse_expression(state);
-			if (!node) return NULL;
-			
-			if (state->current_token && state->current_token->type == TOKEN_CLOSE_PAREN) {
-				next_token(state);  // Jump over ')'
-			} else {
-				fprintf(stderr, "Expected ')' after expression\n");
-				free_ast(node);
-				return NULL;
-			}
-			break;
-		}
-			
-		default:
-			fprintf(stderr, "Unexpected token: %s\n", tok->text);
-			return NULL;
-	}
-	return node;
-}
-
-static ast_node *parse_binary_op(parser_state *state, ast_node *left, int min_prec) {
-	while (state->current_token) {
-		token_type_t op = state->current_token->type;
-		int prec = 0;
-		
-		// Define operators priority
-		if (op == TOKEN_OPERATOR_PLUS || op == TOKEN_OPERATOR_MINUS) prec = 1;
-		else if (op == TOKEN_OPERATOR_MULTIPLY || op == TOKEN_OPERATOR_DIVIDE) prec = 2;
-		else break;
-		
-		if (prec < min_prec) break;
-		
-		token_type_t current_op = op;
-		next_token(state);  // Consume operators
-		
-		ast_node *right = parse_primary(state);
-		if (!right) return NULL;
-		
-		// Handles higher priority operators
-		while (state->current_token) {
-			token_type_t next_op = state->current_token->type;
-			int next_prec = 0;
-			
-			if (next_op == TOKEN_OPERATOR_PLUS || next_op == TOKEN_OPERATOR_MINUS) next_prec = 1;
-			else if (next_op == TOKEN_OPERATOR_MULTIPLY || next_op == TOKEN_OPERATOR_DIVIDE) next_prec = 2;
-			else break;
-			
-			if (next_prec <= prec) break;
-			
-			right = parse_binary_op(state, right, prec + 1);
-			if (!right) return NULL;
-		}
-		
-		ast_node *new_node = create_ast_node(AST_BINARY_OP);
-		new_node->data.binop.op = current_op;
-		new_node->data.binop.left = left;
-		new_node->data.binop.right = right;
-		left = new_node;
-	}
-	return left;
-}
-
-static ast_node *parse_expression(parser_state *state) {
-	ast_node *left = parse_primary(state);
-	if (!left) return NULL;
-	
-	return parse_binary_op(state, left, 0);
-}
-
-static ast_node *parse_assignment(parser_state *state) {
-	if (!state->current_token || state->current_token->type != TOKEN_IDENTIFIER) {
-		return NULL;
-	}
-	
-	char *var_name = strdup(state->current_token->text);
-	next_token(state);  // 消耗标识符
-	
-	if (!state->current_token || state->current_token->type != TOKEN_ASSIGN) {
-		free(var_name);
-		return NULL;
-	}
-	
-	next_token(state);  // 消耗 '='
-	ast_node *expr = parse_expression(state);
-	if (!expr) {
-		free(var_name);
-		return NULL;
-	}
-	
-	ast_node *node = create_ast_node(AST_ASSIGNMENT);
-	node->data.assign.name = var_name;
-	node->data.assign.value = expr;
-	return node;
-}
-
-static ast_node *parse_control_structure(parser_state *state) {
-	token_type_t keyword = state->current_token->type;
-	next_token(state);  // 消耗关键字
-	
-	ast_node *node = NULL;
-	switch (keyword) {
-		case TOKEN_KEYWORD_IF: {
-			ast_node *cond = parse_expression(state);
-			if (!cond) return NULL;
-			
-			ast_node *then_block = parse_block(state);
-			if (!then_block) {
-				free_ast(cond);
-				return NULL;
-			}
-			
-			ast_node *else_block = NULL;
-			if (state->current_token && state->current_token->type == TOKEN_KEYWORD_ELSE) {
-				next_token(state);  // 消耗 else
-				else_block = parse_block(state);
-			}
-			
-			node = create_ast_node(AST_IF_STMT);
-			node->data.if_stmt.condition = cond;
-			node->data.if_stmt.then_block = then_block;
-			node->data.if_stmt.else_block = else_block;
-			break;
-		}
-			
-		case TOKEN_KEYWORD_FOR: {
-			// for(init; cond; update) body
-			if (!state->current_token || state->current_token->type != TOKEN_OPEN_PAREN) {
-				fprintf(stderr, "Expected '(' after for\n");
-				return NULL;
-			}
-			next_token(state);  // Consume '('
-			
-			ast_node *init = parse_statement(state);
-			ast_node *cond = parse_expression(state);
-			
-			// Consume semicolon
-			if (state->current_token && state->current_token->type == TOKEN_SEMICOLON) {
-				next_token(state);
-			}
-			
-			ast_node *update = parse_expression(state);
-			
-			if (!state->current_token || state->current_token->type != TOKEN_CLOSE_PAREN) {
-				fprintf(stderr, "Expected ')' after for conditions\n");
-				if (init) free_ast(init);
-				if (cond) free_ast(cond);
-				if (update) free_ast(update);
-				return NULL;
-			}
-			next_token(state);  // Consume ')'
-			
-			ast_node *body = parse_block(state);
-			if (!body) {
-				if (init) free_ast(init);
-				if (cond) free_ast(cond);
-				if (update) free_ast(update);
-				return NULL;
-			}
-			
-			node = create_ast_node(AST_FOR_LOOP);
-			node->data.for_loop.init = init;
-			node->data.for_loop.condition = cond;
-			node->data.for_loop.update = update;
-			node->data.for_loop.body = body;
-			break;
-		}
-			
-		case TOKEN_KEYWORD_WHILE: {
-			ast_node *cond = parse_expression(state);
-			if (!cond) return NULL;
-			
-			ast_node *body = parse_block(state);
-			if (!body) {
-				free_ast(cond);
-				return NULL;
-			}
-			
-			node = create_ast_node(AST_WHILE_LOOP);
-			node->data.while_loop.condition = cond;
-			node->data.while_loop.body = body;
-			break;
-		}
-			
-		case TOKEN_KEYWORD_BREAK:
-			node = create_ast_node(AST_BREAK);
-			next_token(state);
-			break;
-			
-		case TOKEN_KEYWORD_CONTINUE:
-			node = create_ast_node(AST_CONTINUE);
-			next_token(state);
-			break;
-			
-		default:
-			fprintf(stderr, "Unexpected control keyword\n");
-			return NULL;
-	}
-	return node;
-}
-
-static ast_node *parse_statement(parser_state *state) {
-	if (!state->current_token) return NULL;
-	
-	switch (state->current_token->type) {
-		case TOKEN_KEYWORD_IF:
-		case TOKEN_KEYWORD_FOR:
-		case TOKEN_KEYWORD_WHILE:
-		case TOKEN_KEYWORD_BREAK:
-		case TOKEN_KEYWORD_CONTINUE:
-			return parse_control_structure(state);
-			
-		case TOKEN_IDENTIFIER:
-			return parse_assignment(state);
-			
-		case TOKEN_OPEN_PAREN:
-			return parse_block(state);
-			
-		default:
-			return parse_expression(state);
-	}
-}
-
-static ast_node *parse_block(parser_state *state) {
-	if (!state->current_token || state->current_token->type != TOKEN_OPEN_PAREN) {
-		fprintf(stderr, "Expected '{' at block start\n");
-		return NULL;
-	}
-	next_token(state);  // Consume '{'
-	
-	ast_node *node = create_ast_node(AST_BLOCK);
-	block_statement block = {0};
-	
-	while (state->current_token && state->current_token->type != TOKEN_CLOSE_PAREN) {
-		ast_node *stmt = parse_statement(state);
-		if (!stmt) {
-			// Jump over till get '}'
-			while (state->current_token && state->current_token->type != TOKEN_CLOSE_PAREN) {
-				next_token(state);
-			}
-			break;
-		}
-		
-		// Add to list
-		block.count++;
-		block.statements = realloc(block.statements, block.count * sizeof(ast_node*));
-		block.statements[block.count - 1] = stmt;
-	}
-	
-	if (state->current_token && state->current_token->type == TOKEN_CLOSE_PAREN) {
-		next_token(state);  // Consume '}'
-	} else {
-		fprintf(stderr, "Expected '}' at block end\n");
-	}
-	
-	node->data.block = block;
-	return node;
-}
-
-ast_node *parse(const char *source_code) {
-	parser_state state = {
-		.source = source_code,
-		.index = 0,
-		.current_token = NULL
-	};
-	
-	next_token(&state);
-	ast_node *program = parse_block(&state);
-	
-	if (state.current_token) {
-		free(state.current_token->text);
-		free(state.current_token);
-	}
-	
-	return program;
-}
-
-void free_ast(ast_node *node) {
-	if (!node) return;
-	
-	switch (node->type) {
-		case AST_BLOCK:
-			for (int i = 0; i < node->data.block.count; i++) {
-				free_ast(node->data.block.statements[i]);
-			}
-			free(node->data.block.statements);
-			break;
-			
-		case AST_ASSIGNMENT:
-			free(node->data.assign.name);
-			free_ast(node->data.assign.value);
-			break;
-			
-		case AST_BINARY_OP:
-			free_ast(node->data.binop.left);
-			free_ast(node->data.binop.right);
-			break;
-			
-		case AST_VARIABLE:
-			free(node->data.variable);
-			break;
-			
-		case AST_IF_STMT:
-			free_ast(node->data.if_stmt.condition);
-			free_ast(node->data.if_stmt.then_block);
-			free_ast(node->data.if_stmt.else_block);
-			break;
-			
-		case AST_FOR_LOOP:
-			free_ast(node->data.for_loop.init);
-			free_ast(node->data.for_loop.condition);
-			free_ast(node->data.for_loop.update);
-			free_ast(node->data.for_loop.body);
-			break;
-			
-		case AST_WHILE_LOOP:
-			free_ast(node->data.while_loop.condition);
-			free_ast(node->data.while_loop.body);
-			break;
-			
-		default:
-			break;
-	}
-	
-	free(node);
-}
+/*
+ *
+ *		parser.c
+ *		LUMEN LANGUAGE PROJECT
+ *		Rainy101112 - 2025/7/20
+ *
+ */
+
+#include <token.h>
+#include <lexer.h>
+#include <diag.h>
+#include <mem.h>
+#include <number.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ast.h>
+#include <visit.h>
+#include <arena.h>
+#include <symbol.h>
+
+typedef struct {
+	const char *source;
+	token_stream *tokens;
+	uint32_t cursor;	// Index of current_token in tokens
+	token_t current_token;
+	arena_t *arena;
+
+	// End of the last consumed token, for node spans
+	size_t previous_end;
+
+	// Blocks and parentheses currently open
+	uint32_t depth;
+
+	// Operator levels in the expression parse_primary or parse_expression last returned
+	uint32_t height;
+
+	// Most levels any nesting check has needed so far
+	uint32_t deepest;
+} parser_state;
+
+static uint32_t nesting_limit = PARSE_DEFAULT_NESTING_LIMIT;
+static _Thread_local uint32_t last_nesting;
+
+uint32_t parse_set_nesting_limit(uint32_t limit) {
+	uint32_t previous = nesting_limit;
+	nesting_limit = limit ? limit : PARSE_DEFAULT_NESTING_LIMIT;
+	return previous;
+}
+
+uint32_t parse_nesting_limit(void) {
+	return nesting_limit;
+}
+
+uint32_t parse_nesting(void) {
+	return last_nesting;
+}
+
+// Tokens lexed at a time once a stream runs out ahead of the parser
+#define TOKEN_LOOKAHEAD_BATCH 256
+
+// The token n places after the current one; END_OF_FILE past the end
+static token_t peek_token(parser_state *state, uint32_t n) {
+	token_stream *tokens = state->tokens;
+	uint32_t i = state->cursor + n;
+
+	if (i >= tokens->count && !tokens->finished) {
+		token_stream_fill(tokens, 0, i - tokens->count + TOKEN_LOOKAHEAD_BATCH);
+	}
+	if (i < tokens->count) return token_stream_at(tokens, i);
+	if (tokens->finished) return token_stream_at(tokens, tokens->count - 1);
+	return (token_t){ TOKEN_END_OF_FILE, tokens->position, 0 };
+}
+
+static void next_token(parser_state *state) {
+	state->previous_end = state->current_token.start + state->current_token.length;
+	if (state->current_token.type != TOKEN_END_OF_FILE) state->cursor++;
+	state->current_token = peek_token(state, 0);
+}
+
+// Points the parser at the first token of a stream that starts at offset from
+static void start_tokens(parser_state *state, token_stream *tokens, size_t from) {
+	state->tokens = tokens;
+	state->cursor = 0;
+	state->previous_end = from;
+	state->current_token = peek_token(state, 0);
+}
+
+static int at_end(parser_state *state) {
+	return state->current_token.type == TOKEN_END_OF_FILE;
+}
+
+static const char *token_text(parser_state *state, token_t token) {
+	return state->source + token.start;
+}
+
+static ast_node *parse_expression(parser_state *state);
+static ast_node *parse_statement(parser_state *state);
+static ast_node *parse_block(parser_state *state);
+
+static void *parser_alloc(parser_state *state, size_t size) {
+	return state->arena ? arena_alloc(state->arena, size) : mem_alloc(size);
+}
+
+// Arena-owned nodes are released with the arena, never one by one
+static void discard_ast(parser_state *state, ast_node *node) {
+	if (!state->arena) free_ast(node);
+}
+
+static ast_node *create_ast_node(parser_state *state, ast_node_type type) {
+	ast_node *node = parser_alloc(state, sizeof(ast_node));
+	if (!node) {
+		fprintf(stderr, "Memory allocation failed\n");
+		return NULL;
+	}
+	node->type = type;
+	node->start = node->end = state->current_token.start;
+	return node;
+}
+
+// Opens one more level of blocks or brackets, failing past the limit
+static int enter_nesting(parser_state *state) {
+	if (state->depth >= nesting_limit) {
+		diag_report_at(DIAG_ERROR, state->current_token.start, "Nesting deeper than %u levels\n", nesting_limit);
+		return 0;
+	}
+	state->depth++;
+	if (state->depth > state->deepest) state->deepest = state->depth;
+	return 1;
+}
+
+/*
+ * An expression height levels tall, parsed at the current depth, has to
+ * fit in the limit too: the passes after the parser recurse on operators
+ * as they do on blocks.
+ */
+static int fits_nesting(parser_state *state, uint32_t height, size_t at) {
+	if (height > nesting_limit - state->depth) {
+		diag_report_at(DIAG_ERROR, at, "Nesting deeper than %u levels\n", nesting_limit);
+		return 0;
+	}
+	if (state->depth + height > state->deepest) state->deepest = state->depth + height;
+	return 1;
+}
+
+// Spans the node from start to the end of the last consumed token
+static void finish_node(parser_state *state, ast_node *node, size_t start) {
+	node->start = start;
+	node->end = state->previous_end;
+}
+
+static int push_element(array_literal *array, int *capacity, ast_node *element) {
+	if (array->count == *capacity) {
+		*capacity = *capacity ? *capacity * 2 : 8;
+		ast_node **elements = mem_realloc(array->elements, *capacity * sizeof(ast_node *));
+		if (!elements) {
+			fprintf(stderr, "Memory allocate failed at %s:%d", __FILE__, __LINE__);
+			return 0;
+		}
+		array->elements = elements;
+	}
+	array->elements[array->count++] = element;
+	return 1;
+}
+
+// [a, b, c] with an optional trailing comma, or [value; count]
+static ast_node *parse_array(parser_state *state) {
+	size_t start = state->current_token.start;
+	if (!enter_nesting(state)) return NULL;
+	next_token(state);  // Consume '['
+
+	ast_node *node = create_ast_node(state, AST_ARRAY);
+	if (!node) {
+		state->depth--;
+		return NULL;
+	}
+	array_literal array = {0};
+	int capacity = 0;
+	uint32_t height = 0;
+
+	while (state->current_token.type != TOKEN_CLOSE_BRACKET) {
+		ast_node *element = parse_expression(state);
+		if (!element) goto fail;
+		if (state->height > height) height = state->height;
+		if (!push_element(&array, &capacity, element)) {
+			discard_ast(state, element);
+			goto fail;
+		}
+
+		if (array.repeat) break;
+		if (state->current_token.type == TOKEN_SEMICOLON && array.count == 1) {
+			array.repeat = 1;
+		} else if (state->current_token.type != TOKEN_COMMA) {
+			break;
+		}
+		next_token(state);  // Consume ',' or ';'
+	}
+
+	if (array.repeat && array.count != 2) {
+		diag_report_at(DIAG_ERROR, state->previous_end, "Expected a count after ';' in array\n");
+		goto fail;
+	}
+	if (state->current_token.type != TOKEN_CLOSE_BRACKET) {
+		diag_report_at(DIAG_ERROR, state->previous_end, "Expected ']' after array elements\n");
+		goto fail;
+	}
+	next_token(state);  // Consume ']'
+
+	// Like a block's statements, the vector moves into the arena once its size is known
+	if (state->arena && array.elements) {
+		ast_node **elements = arena_memdup(state->arena, array.elements, array.count * sizeof(ast_node *));
+		mem_free(array.elements);
+		array.elements = elements;
+	}
+
+	node->data.array = array;
+	finish_node(state, node, start);
+	state->depth--;
+	state->height = height + 1;
+	return node;
+
+fail:
+	state->depth--;
+	if (state->arena) {
+		mem_free(array.elements);
+	} else {
+		node->data.array = array;
+		free_ast(node);
+	}
+	return NULL;
+}
+
+// array[index], applied to the primary before it
+static ast_node *parse_index(parser_state *state, ast_node *array) {
+	uint32_t height = state->height;
+	if (!fits_nesting(state, height + 1, state->current_token.start) || !enter_nesting(state)) {
+		discard_ast(state, array);
+		return NULL;
+	}
+	next_token(state);  // Consume '['
+	ast_node *index = parse_expression(state);
+	state->depth--;
+	if (!index) {
+		discard_ast(state, array);
+		return NULL;
+	}
+	if (state->height > height) height = state->height;
+
+	if (state->current_token.type != TOKEN_CLOSE_BRACKET) {
+		diag_report_at(DIAG_ERROR, state->previous_end, "Expected ']' after index\n");
+		discard_ast(state, array);
+		discard_ast(state, index);
+		return NULL;
+	}
+	next_token(state);  // Consume ']'
+
+	ast_node *node = create_ast_node(state, AST_BINARY_OP);
+	if (!node) {
+		discard_ast(state, array);
+		discard_ast(state, index);
+		return NULL;
+	}
+	node->data.binop.op = TOKEN_OPEN_BRACKET;
+	node->data.binop.left = array;
+	node->data.binop.right = index;
+	finish_node(state, node, array->start);
+	state->height = height + 1;
+	return node;
+}
+
+static ast_node *parse_primary(parser_state *state) {
+	if (at_end(state)) return NULL;
+
+	token_t tok = state->current_token;
+	ast_node *node = NULL;
+	
+	switch (tok.type) {
+		case TOKEN_IDENTIFIER:
+			node = create_ast_node(state, AST_VARIABLE);
+			node->data.variable.name = symbol_intern(token_text(state, tok), tok.length);
+			node->data.variable.slot = SLOT_UNRESOLVED;
+			next_token(state);
+			finish_node(state, node, tok.start);
+			state->height = 0;
+			break;
+			
+		case TOKEN_INTEGER:
+		case TOKEN_FLOAT:
+			node = create_ast_node(state, AST_LITERAL);
+			node->data.literal = number_parse(token_text(state, tok), tok.length);
+			next_token(state);
+			finish_node(state, node, tok.start);
+			state->height = 0;
+			break;
+			
+		case TOKEN_OPEN_PAREN: {
+			if (!enter_nesting(state)) return NULL;
+			next_token(state);  // Jump over '('
+			node = parse_expression(state);
+			state->depth--;
+			if (!node) return NULL;
+			
+			if (state->current_token.type == TOKEN_CLOSE_PAREN) {
+				next_token(state);  // Jump over ')'
+				finish_node(state, node, tok.start);
+			} else {
+				diag_report_at(DIAG_ERROR, state->previous_end, "Expected ')' after expression\n");
+				discard_ast(state, node);
+				return NULL;
+			}
+			break;
+		}
+			
+		case TOKEN_OPEN_BRACKET:
+			node = parse_array(state);
+			break;
+
+		case TOKEN_KEYWORD_LEN: {
+			next_token(state);  // Jump over len
+			if (state->current_token.type != TOKEN_OPEN_PAREN) {
+				diag_report_at(DIAG_ERROR, state->previous_end, "Expected '(' after len\n");
+				return NULL;
+			}
+			ast_node *operand = parse_primary(state);
+			if (!operand) return NULL;
+
+			node = create_ast_node(state, AST_UNARY_OP);
+			if (!node) {
+				discard_ast(state, operand);
+				return NULL;
+			}
+			node->data.unop.op = TOKEN_KEYWORD_LEN;
+			node->data.unop.operand = operand;
+			finish_node(state, node, tok.start);
+			state->height++;
+			break;
+		}
+
+		default:
+			diag_report_at(DIAG_ERROR, tok.start, "Unexpected token: %.*s\n", (int)tok.length, token_text(state, tok));
+			return NULL;
+	}
+	return node;
+}
+
+/*
+ * Operator table. infix is the binding power as a binary operator (0 when
+ * the token is not one); higher binds tighter. Prefix operators all bind
+ * tighter than any binary operator.
+ */
+typedef struct {
+	uint8_t infix;
+	uint8_t right_associative;
+	uint8_t prefix;
+} operator_info;
+
+#define PREFIX_PRECEDENCE 7
+
+static const operator_info operators[TOKEN_TYPE_COUNT] = {
+	[TOKEN_OPERATOR_OR] = { .infix = 1 },
+	[TOKEN_OPERATOR_AND] = { .infix = 2 },
+	[TOKEN_OPERATOR_EQUAL] = { .infix = 3 },
+	[TOKEN_OPERATOR_NOT_EQUAL] = { .infix = 3 },
+	[TOKEN_OPERATOR_LESS] = { .infix = 4 },
+	[TOKEN_OPERATOR_GREATER] = { .infix = 4 },
+	[TOKEN_OPERATOR_LESS_EQUAL] = { .infix = 4 },
+	[TOKEN_OPERATOR_GREATER_EQUAL] = { .infix = 4 },
+	[TOKEN_OPERATOR_PLUS] = { .infix = 5, .prefix = 1 },
+	[TOKEN_OPERATOR_MINUS] = { .infix = 5, .prefix = 1 },
+	[TOKEN_OPERATOR_MULTIPLY] = { .infix = 6 },
+	[TOKEN_OPERATOR_DIVIDE] = { .infix = 6 },
+	[TOKEN_OPERATOR_NOT] = { .prefix = 1 }
+};
+
+typedef struct {
+	token_type_t op;
+	uint8_t precedence;
+	uint8_t prefix;
+	size_t start;
+} pending_operator;
+
+#define EXPRESSION_STACK_INLINE 32
+
+typedef struct {
+	ast_node *node;
+	uint32_t height;
+} pending_operand;
+
+/*
+ * Operands and operators not yet combined. Operator chains are folded
+ * here instead of on the call stack, so the parser's own stack use does
+ * not grow with them; only parentheses recurse. Each operand keeps its
+ * height, and no tree taller than the nesting limit allows is built.
+ */
+typedef struct {
+	pending_operand *operands;
+	pending_operator *operators;
+	uint32_t operand_count;
+	uint32_t operator_count;
+	uint32_t operand_capacity;
+	uint32_t operator_capacity;
+
+	pending_operand operand_inline[EXPRESSION_STACK_INLINE];
+	pending_operator operator_inline[EXPRESSION_STACK_INLINE];
+} expression_stack;
+
+// Doubles a stack, moving it off its inline storage the first time
+static void *grow_stack(void *items, void *inline_items, uint32_t *capacity, size_t size) {
+	void *grown;
+	if (items == inline_items) {
+		grown = mem_alloc(*capacity * 2 * size);
+		if (grown) memcpy(grown, items, *capacity * size);
+	} else {
+		grown = mem_realloc(items, *capacity * 2 * size);
+	}
+
+	if (!grown) {
+		fprintf(stderr, "Memory allocate failed at %s:%d", __FILE__, __LINE__);
+		return NULL;
+	}
+	*capacity *= 2;
+	return grown;
+}
+
+static int push_operand(expression_stack *stack, ast_node *node, uint32_t height) {
+	if (stack->operand_count == stack->operand_capacity) {
+		pending_operand *operands = grow_stack(stack->operands, stack->operand_inline, &stack->operand_capacity, sizeof(pending_operand));
+		if (!operands) return 0;
+		stack->operands = operands;
+	}
+	stack->operands[stack->operand_count++] = (pending_operand){ node, height };
+	return 1;
+}
+
+static int push_operator(expression_stack *stack, pending_operator op) {
+	if (stack->operator_count == stack->operator_capacity) {
+		pending_operator *ops = grow_stack(stack->operators, stack->operator_inline, &stack->operator_capacity, sizeof(pending_operator));
+		if (!ops) return 0;
+		stack->operators = ops;
+	}
+	stack->operators[stack->operator_count++] = op;
+	return 1;
+}
+
+// A minus directly on a literal folds into it, as signed literals always have; -0 becomes the float -0.0
+static void negate_literal(literal_value *literal) {
+	if (literal->kind == LITERAL_INTEGER && literal->as.integer != 0 && literal->as.integer != INT64_MIN) {
+		literal->as.integer = -literal->as.integer;
+		return;
+	}
+
+	double value = literal_as_double(*literal);
+	literal->kind = LITERAL_FLOAT;
+	literal->as.number = -value;
+}
+
+static ast_node *apply_prefix(parser_state *state, pending_operator op, ast_node *operand) {
+	if (op.op == TOKEN_OPERATOR_PLUS) {
+		operand->start = op.start;
+		return operand;
+	}
+
+	if (op.op == TOKEN_OPERATOR_MINUS && operand->type == AST_LITERAL) {
+		negate_literal(&operand->data.literal);
+		operand->start = op.start;
+		return operand;
+	}
+
+	ast_node *node = create_ast_node(state, AST_UNARY_OP);
+	if (!node) return NULL;
+	node->data.unop.op = op.op;
+	node->data.unop.operand = operand;
+	node->start = op.start;
+	node->end = operand->end;
+	return node;
+}
+
+// Combines the top operator with its operands; on failure the operands stay on the stack
+static int reduce(parser_state *state, expression_stack *stack) {
+	pending_operator op = stack->operators[stack->operator_count - 1];
+	pending_operand *top = &stack->operands[stack->operand_count - 1];
+
+	if (op.prefix) {
+		// Only a prefix that makes a node adds a level; + and a minus folded into a literal do not
+		int adds_level = op.op != TOKEN_OPERATOR_PLUS && !(op.op == TOKEN_OPERATOR_MINUS && top->node->type == AST_LITERAL);
+		if (adds_level && !fits_nesting(state, top->height + 1, op.start)) return 0;
+		ast_node *node = apply_prefix(state, op, top->node);
+		if (!node) return 0;
+		top->node = node;
+		top->height += adds_level;
+	} else {
+		uint32_t height = 1 + (top[-1].height > top[0].height ? top[-1].height : top[0].height);
+		if (!fits_nesting(state, height, op.start)) return 0;
+		ast_node *node = create_ast_node(state, AST_BINARY_OP);
+		if (!node) return 0;
+		node->data.binop.op = op.op;
+		node->data.binop.left = top[-1].node;
+		node->data.binop.right = top[0].node;
+		node->start = top[-1].node->start;
+		node->end = top[0].node->end;
+		top[-1] = (pending_operand){ node, height };
+		stack->operand_count--;
+	}
+
+	stack->operator_count--;
+	return 1;
+}
+
+static ast_node *parse_expression(parser_state *state) {
+	expression_stack stack;
+	stack.operands = stack.operand_inline;
+	stack.operators = stack.operator_inline;
+	stack.operand_count = stack.operator_count = 0;
+	stack.operand_capacity = stack.operator_capacity = EXPRESSION_STACK_INLINE;
+
+	ast_node *result = NULL;
+
+	for (;;) {
+		// Operand position: prefix operators, then a primary
+		while (operators[state->current_token.type].prefix) {
+			pending_operator op = { state->current_token.type, PREFIX_PRECEDENCE, 1, state->current_token.start };
+			if (!push_operator(&stack, op)) goto fail;
+			next_token(state);
+		}
+
+		ast_node *operand = parse_primary(state);
+		while (operand && state->current_token.type == TOKEN_OPEN_BRACKET) {
+			operand = parse_index(state, operand);
+		}
+		if (!operand) goto fail;
+		if (!push_operand(&stack, operand, state->height)) {
+			discard_ast(state, operand);
+			goto fail;
+		}
+
+		// Operator position: fold everything that binds at least as tightly, then shift
+		token_type_t type = state->current_token.type;
+		const operator_info *info = &operators[type];
+		if (!info->infix) break;
+
+		while (stack.operator_count) {
+			uint8_t top = stack.operators[stack.operator_count - 1].precedence;
+			if (top < info->infix || (top == info->infix && info->right_associative)) break;
+			if (!reduce(state, &stack)) goto fail;
+		}
+
+		pending_operator op = { type, info->infix, 0, state->current_token.start };
+		if (!push_operator(&stack, op)) goto fail;
+		next_token(state);
+	}
+
+	while (stack.operator_count) {
+		if (!reduce(state, &stack)) goto fail;
+	}
+	result = stack.operands[0].node;
+	state->height = stack.operands[0].height;
+	goto done;
+
+fail:
+	for (uint32_t i = 0; i < stack.operand_count; i++) discard_ast(state, stack.operands[i].node);
+
+done:
+	if (stack.operands != stack.operand_inline) mem_free(stack.operands);
+	if (stack.operators != stack.operator_inline) mem_free(stack.operators);
+	return result;
+}
+
+static ast_node *parse_assignment(parser_state *state) {
+	if (state->current_token.type != TOKEN_IDENTIFIER) {
+		return NULL;
+	}
+	
+	token_t name = state->current_token;
+	symbol_id var_name = symbol_intern(token_text(state, name), name.length);
+	next_token(state);  // 消耗标识符
+	
+	if (state->current_token.type != TOKEN_ASSIGN) {
+		return NULL;
+	}
+	
+	next_token(state);  // 消耗 '='
+	ast_node *expr = parse_expression(state);
+	if (!expr) {
+		return NULL;
+	}
+	
+	ast_node *node = create_ast_node(state, AST_ASSIGNMENT);
+	node->data.assign.name = var_name;
+	node->data.assign.slot = SLOT_UNRESOLVED;
+	node->data.assign.value = expr;
+	node->start = name.start;
+	node->end = expr->end;
+	return node;
+}
+
+static int expect_semicolon(parser_state *state) {
+	if (state->current_token.type != TOKEN_SEMICOLON) {
+		diag_report_at(DIAG_ERROR, state->previous_end, "Expected ';' after statement\n");
+		return 0;
+	}
+	next_token(state);  // Consume ';'
+	return 1;
+}
+
+// Statement without its terminator, as used in for headers; one token of lookahead tells `x = ...` from `x + ...`
+static ast_node *parse_simple_statement(parser_state *state) {
+	if (state->current_token.type == TOKEN_IDENTIFIER && peek_token(state, 1).type == TOKEN_ASSIGN) {
+		return parse_assignment(state);
+	}
+	return parse_expression(state);
+}
+
+static ast_node *parse_control_structure(parser_state *state) {
+	token_type_t keyword = state->current_token.type;
+	size_t start = state->current_token.start;
+	next_token(state);  // 消耗关键字
+	
+	ast_node *node = NULL;
+	switch (keyword) {
+		case TOKEN_KEYWORD_IF: {
+			ast_node *cond = parse_expression(state);
+			if (!cond) return NULL;
+			
+			ast_node *then_block = parse_block(state);
+			if (!then_block) {
+				discard_ast(state, cond);
+				return NULL;
+			}
+			
+			ast_node *else_block = NULL;
+			if (state->current_token.type == TOKEN_KEYWORD_ELSE) {
+				next_token(state);  // 消耗 else
+				else_block = parse_block(state);
+			}
+			
+			node = create_ast_node(state, AST_IF_STMT);
+			node->data.if_stmt.condition = cond;
+			node->data.if_stmt.then_block = then_block;
+			node->data.if_stmt.else_block = else_block;
+			break;
+		}
+			
+		case TOKEN_KEYWORD_FOR: {
+			// for(init; cond; update) body
+			if (state->current_token.type != TOKEN_OPEN_PAREN) {
+				diag_report_at(DIAG_ERROR, state->previous_end, "Expected '(' after for\n");
+				return NULL;
+			}
+			next_token(state);  // Consume '('
+			
+			// Every part of the header may be left empty
+			ast_node *init = NULL;
+			if (state->current_token.type != TOKEN_SEMICOLON) {
+				init = parse_simple_statement(state);
+				if (!init) return NULL;
+			}
+			if (!expect_semicolon(state)) {
+				discard_ast(state, init);
+				return NULL;
+			}
+			
+			ast_node *cond = NULL;
+			if (state->current_token.type != TOKEN_SEMICOLON) {
+				cond = parse_expression(state);
+			}
+			if (!expect_semicolon(state)) {
+				discard_ast(state, init);
+				discard_ast(state, cond);
+				return NULL;
+			}
+			
+			ast_node *update = NULL;
+			if (state->current_token.type != TOKEN_CLOSE_PAREN) {
+				update = parse_simple_statement(state);
+			}
+			
+			if (state->current_token.type != TOKEN_CLOSE_PAREN) {
+				diag_report_at(DIAG_ERROR, state->previous_end, "Expected ')' after for conditions\n");
+				discard_ast(state, init);
+				discard_ast(state, cond);
+				discard_ast(state, update);
+				return NULL;
+			}
+			next_token(state);  // Consume ')'
+			
+			ast_node *body = parse_block(state);
+			if (!body) {
+				discard_ast(state, init);
+				discard_ast(state, cond);
+				discard_ast(state, update);
+				return NULL;
+			}
+			
+			node = create_ast_node(state, AST_FOR_LOOP);
+			node->data.for_loop.init = init;
+			node->data.for_loop.condition = cond;
+			node->data.for_loop.update = update;
+			node->data.for_loop.body = body;
+			break;
+		}
+			
+		case TOKEN_KEYWORD_WHILE: {
+			ast_node *cond = parse_expression(state);
+			if (!cond) return NULL;
+			
+			ast_node *body = parse_block(state);
+			if (!body) {
+				discard_ast(state, cond);
+				return NULL;
+			}
+			
+			node = create_ast_node(state, AST_WHILE_LOOP);
+			node->data.while_loop.condition = cond;
+			node->data.while_loop.body = body;
+			break;
+		}
+			
+		case TOKEN_KEYWORD_BREAK:
+			if (!expect_semicolon(state)) return NULL;
+			node = create_ast_node(state, AST_BREAK);
+			break;
+			
+		case TOKEN_KEYWORD_CONTINUE:
+			if (!expect_semicolon(state)) return NULL;
+			node = create_ast_node(state, AST_CONTINUE);
+			break;
+			
+		default:
+			diag_report_at(DIAG_ERROR, start, "Unexpected control keyword\n");
+			return NULL;
+	}
+	if (node) finish_node(state, node, start);
+	return node;
+}
+
+static ast_node *parse_statement(parser_state *state) {
+	if (at_end(state)) return NULL;
+	
+	switch (state->current_token.type) {
+		case TOKEN_KEYWORD_IF:
+		case TOKEN_KEYWORD_FOR:
+		case TOKEN_KEYWORD_WHILE:
+		case TOKEN_KEYWORD_BREAK:
+		case TOKEN_KEYWORD_CONTINUE:
+			return parse_control_structure(state);
+			
+		case TOKEN_OPEN_BRACE:
+			return parse_block(state);
+			
+		default: {
+			ast_node *node = parse_simple_statement(state);
+			if (node && !expect_semicolon(state)) {
+				discard_ast(state, node);
+				return NULL;
+			}
+			if (node) node->end = state->previous_end;
+			return node;
+		}
+	}
+}
+
+static ast_node *parse_block(parser_state *state) {
+	if (state->current_token.type != TOKEN_OPEN_BRACE) {
+		diag_report_at(DIAG_ERROR, state->current_token.start, "Expected '{' at block start\n");
+		return NULL;
+	}
+	if (!enter_nesting(state)) return NULL;
+	size_t start = state->current_token.start;
+	next_token(state);  // Consume '{'
+	
+	ast_node *node = create_ast_node(state, AST_BLOCK);
+	block_statement block = {0};
+	int capacity = 0;
+	
+	while (!at_end(state) && state->current_token.type != TOKEN_CLOSE_BRACE) {
+		ast_node *stmt = parse_statement(state);
+		if (!stmt) {
+			// Jump over till get '}'
+			while (!at_end(state) && state->current_token.type != TOKEN_CLOSE_BRACE) {
+				next_token(state);
+			}
+			break;
+		}
+		
+		// Add to list
+		if (block.count == capacity) {
+			capacity = capacity ? capacity * 2 : 8;
+			ast_node **statements = mem_realloc(block.statements, capacity * sizeof(ast_node*));
+			if (!statements) {
+				fprintf(stderr, "Memory allocate failed at %s:%d", __FILE__, __LINE__);
+				discard_ast(state, stmt);
+				break;
+			}
+			block.statements = statements;
+		}
+		block.statements[block.count++] = stmt;
+	}
+	
+	// The vector grows on the heap; move the final, exact-size copy into the arena
+	if (state->arena && block.statements) {
+		ast_node **statements = arena_memdup(state->arena, block.statements, block.count * sizeof(ast_node*));
+		mem_free(block.statements);
+		block.statements = statements;
+	}
+	
+	if (state->current_token.type == TOKEN_CLOSE_BRACE) {
+		next_token(state);  // Consume '}'
+	} else {
+		diag_report_at(DIAG_ERROR, state->current_token.start, "Expected '}' at block end\n");
+	}
+	
+	node->data.block = block;
+	finish_node(state, node, start);
+	state->depth--;
+	return node;
+}
+
+ast_node *parse_stream(token_stream *tokens, arena_t *arena) {
+	parser_state state = {
+		.source = tokens->source,
+		.arena = arena
+	};
+
+	start_tokens(&state, tokens, 0);
+	ast_node *root = parse_block(&state);
+	last_nesting = state.deepest;
+	return root;
+}
+
+ast_node *parse(const char *source_code, arena_t *arena) {
+	token_stream tokens;
+	token_stream_init(&tokens, source_code, 0);
+	token_stream_fill(&tokens, SIZE_MAX, 0);
+
+	ast_node *root = parse_stream(&tokens, arena);
+	token_stream_free(&tokens);
+	return root;
+}
+
+/*
+ * Incremental reparsing. The edits are merged into one damaged range
+ * [lo, hi) of the old source. The innermost block whose braces lie outside
+ * that range is found, and the statements of it that touch the range,
+ * including ones that merely end or begin at its edges, are parsed again
+ * from the new source. The new statements must end exactly where the next
+ * untouched statement (or the closing brace) now begins and must parse
+ * without errors; otherwise the same is tried one block further out.
+ */
+
+typedef struct {
+	ast_node **blocks;
+	int count;
+	int capacity;
+} block_path;
+
+static int push_block(block_path *path, ast_node *block) {
+	if (path->count == path->capacity) {
+		int capacity = path->capacity ? path->capacity * 2 : 16;
+		ast_node **blocks = mem_realloc(path->blocks, capacity * sizeof(ast_node *));
+		if (!blocks) {
+			fprintf(stderr, "Memory allocate failed at %s:%d", __FILE__, __LINE__);
+			return 0;
+		}
+		path->blocks = blocks;
+		path->capacity = capacity;
+	}
+	path->blocks[path->count++] = block;
+	return 1;
+}
+
+// Both braces of the block exist and lie outside [lo, hi)
+static int block_encloses(const ast_node *block, const char *source, size_t lo, size_t hi) {
+	if (!block || block->type != AST_BLOCK) return 0;
+	if (source[block->start] != '{' || source[block->end - 1] != '}') return 0;
+
+	// A block that lost its '}' ends with its last statement
+	int count = block->data.block.count;
+	if (count && block->data.block.statements[count - 1]->end == block->end) return 0;
+
+	return block->start < lo && hi < block->end;
+}
+
+static ast_node *child_block_enclosing(ast_node *stmt, const char *source, size_t lo, size_t hi) {
+	ast_node *candidates[2] = { NULL, NULL };
+
+	switch (stmt->type) {
+		case AST_BLOCK:
+			candidates[0] = stmt;
+			break;
+		case AST_IF_STMT:
+			candidates[0] = stmt->data.if_stmt.then_block;
+			candidates[1] = stmt->data.if_stmt.else_block;
+			break;
+		case AST_FOR_LOOP:
+			candidates[0] = stmt->data.for_loop.body;
+			break;
+		case AST_WHILE_LOOP:
+			candidates[0] = stmt->data.while_loop.body;
+			break;
+		default:
+			break;
+	}
+
+	for (int i = 0; i < 2; i++) {
+		if (block_encloses(candidates[i], source, lo, hi)) return candidates[i];
+	}
+	return NULL;
+}
+
+// Statements [*first, *last] of block touch [lo, hi]; *first > *last if none do
+static void damaged_statements(const ast_node *block, size_t lo, size_t hi, int *first, int *last) {
+	ast_node **stmts = block->data.block.statements;
+	int count = block->data.block.count;
+
+	int i = 0;
+	while (i < count && stmts[i]->end < lo) i++;
+	int j = i;
+	while (j < count && stmts[j]->start <= hi) j++;
+
+	*first = i;
+	*last = j - 1;
+}
+
+typedef struct {
+	size_t from;
+	size_t delta;
+} span_shift;
+
+/*
+ * Moves every span at or after old offset from by delta (negative deltas
+ * wrap, as intended). Children lie inside their parent's span, so a node
+ * ending before from has nothing to move below it.
+ */
+static ast_visit_action shift_node(ast_node *node, const ast_visit_position *at, void *context) {
+	const span_shift *shift = context;
+	(void)at;
+
+	if (node->start >= shift->from) node->start += shift->delta;
+	else if (node->end < shift->from) return AST_VISIT_SKIP;
+	node->end += shift->delta;
+	return AST_VISIT_CONTINUE;
+}
+
+static void shift_spans(ast_node *root, size_t from, size_t delta) {
+	static const ast_visitor visitor = { shift_node, NULL };
+	span_shift shift = { from, delta };
+	ast_visit(root, &visitor, &shift);
+}
+
+/*
+ * Parses statements from region_start up to the token at region_end. On a
+ * clean fit the statements are returned in *parsed (heap vector) and the
+ * function returns 1; otherwise everything parsed is discarded.
+ */
+static int parse_region(parser_state *state, size_t region_start, size_t region_end, block_statement *parsed) {
+	diag_buffer scratch = {0};
+	diag_buffer *previous = diag_capture(&scratch);
+	int capacity = 0, fits = 1;
+
+	// Lex just past the region; going further only happens when it does not fit
+	token_stream tokens;
+	token_stream_init(&tokens, state->source, region_start);
+	token_stream_fill(&tokens, region_end, 0);
+	start_tokens(state, &tokens, region_start);
+
+	while (state->current_token.start < region_end && !at_end(state)
+		&& state->current_token.type != TOKEN_CLOSE_BRACE) {
+		ast_node *stmt = parse_statement(state);
+		if (!stmt) {
+			fits = 0;
+			break;
+		}
+
+		if (parsed->count == capacity) {
+			capacity = capacity ? capacity * 2 : 8;
+			ast_node **statements = mem_realloc(parsed->statements, capacity * sizeof(ast_node *));
+			if (!statements) {
+				fprintf(stderr, "Memory allocate failed at %s:%d", __FILE__, __LINE__);
+				discard_ast(state, stmt);
+				fits = 0;
+				break;
+			}
+			parsed->statements = statements;
+		}
+		parsed->statements[parsed->count++] = stmt;
+	}
+
+	if (state->current_token.start != region_end || scratch.error_count) fits = 0;
+	token_stream_free(&tokens);
+
+	diag_capture(previous);
+	diag_buffer_free(&scratch);
+
+	if (!fits) {
+		for (int i = 0; i < parsed->count; i++) discard_ast(state, parsed->statements[i]);
+		mem_free(parsed->statements);
+		parsed->statements = NULL;
+		parsed->count = 0;
+	}
+	return fits;
+}
+
+// Replaces statements [first, last] of block with parsed; the vector is consumed
+static int splice_statements(parser_state *state, ast_node *block, int first, int last, block_statement *parsed) {
+	block_statement *old = &block->data.block;
+	int count = old->count - (last - first + 1) + parsed->count;
+	size_t bytes = (count ? count : 1) * sizeof(ast_node *);
+
+	ast_node **statements = parser_alloc(state, bytes);
+	if (!statements) {
+		fprintf(stderr, "Memory allocate failed at %s:%d", __FILE__, __LINE__);
+		for (int i = 0; i < parsed->count; i++) discard_ast(state, parsed->statements[i]);
+		mem_free(parsed->statements);
+		return 0;
+	}
+
+	if (first) memcpy(statements, old->statements, first * sizeof(ast_node *));
+	if (parsed->count) memcpy(statements + first, parsed->statements, parsed->count * sizeof(ast_node *));
+	if (last + 1 < old->count) {
+		memcpy(statements + first + parsed->count, old->statements + last + 1, (old->count - last - 1) * sizeof(ast_node *));
+	}
+
+	for (int i = first; i <= last; i++) discard_ast(state, old->statements[i]);
+	if (!state->arena) mem_free(old->statements);
+	mem_free(parsed->statements);
+
+	old->statements = statements;
+	old->count = count;
+	return 1;
+}
+
+ast_node *reparse(ast_node *root, const char *old_source, const char *new_source,
+	const source_edit *edits, size_t edit_count, arena_t *arena) {
+	if (!root) return parse(new_source, arena);
+	if (edit_count == 0) return root;
+
+	size_t lo = edits[0].start, hi = edits[0].start + edits[0].old_length;
+	size_t delta = 0;
+	int ordered = 1;
+	for (size_t i = 0; i < edit_count; i++) {
+		if (i && edits[i].start < hi) ordered = 0;
+		hi = edits[i].start + edits[i].old_length;
+		delta += edits[i].new_length - edits[i].old_length;
+	}
+
+	parser_state state = {
+		.source = new_source,
+		.arena = arena
+	};
+
+	block_path path = {0};
+	int done = 0;
+	if (ordered && block_encloses(root, old_source, lo, hi) && push_block(&path, root)) {
+		// Descend while a single statement holds the whole edit inside one of its blocks
+		for (;;) {
+			ast_node *block = path.blocks[path.count - 1];
+			int first, last;
+			damaged_statements(block, lo, hi, &first, &last);
+			if (first != last) break;
+
+			ast_node *inner = child_block_enclosing(block->data.block.statements[first], old_source, lo, hi);
+			if (!inner || !push_block(&path, inner)) break;
+		}
+
+		while (!done && path.count) {
+			ast_node *block = path.blocks[--path.count];
+			ast_node **stmts = block->data.block.statements;
+			int count = block->data.block.count;
+
+			int first, last;
+			damaged_statements(block, lo, hi, &first, &last);
+			size_t region_start = first > 0 ? stmts[first - 1]->end : block->start + 1;
+			size_t region_end = (last + 1 < count ? stmts[last + 1]->start : block->end - 1) + delta;
+
+			// The region sits inside path.count + 1 open blocks
+			block_statement parsed = {0};
+			state.depth = path.count + 1;
+			if (parse_region(&state, region_start, region_end, &parsed)) {
+				if (delta) shift_spans(root, hi, delta);
+				done = splice_statements(&state, block, first, last, &parsed);
+			}
+		}
+	}
+	mem_free(path.blocks);
+
+	if (done) return root;
+
+	ast_node *fresh = parse(new_source, arena);
+	if (!arena) free_ast(root);
+	return fresh;
+}
+
+// Children are gone by the time a node is left, so each node frees only itself
+static void free_node(ast_node *node, const ast_visit_position *at, void *context) {
+	(void)at;
+	(void)context;
+	if (node->type == AST_BLOCK) mem_free(node->data.block.statements);
+	if (node->type == AST_ARRAY) mem_free(node->data.array.elements);
+	mem_free(node);
+}
+
+void free_ast(ast_node *node) {
+	static const ast_visitor visitor = { NULL, free_node };
+	ast_visit(node, &visitor, NULL);
+}
@@ -0,0 +1,220 @@
+/*
+ *
+ *		pool.c
+ *		LUMEN LANGUAGE PROJECT
+ *		Rainy101112 - 2025/7/20
+ *
+ */
+
+#include <pool.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+// A worker's remaining indices [begin, end), padded to its own cache line
+typedef struct {
+	_Alignas(64) pthread_mutex_t lock;
+	size_t begin;
+	size_t end;
+} work_range;
+
+struct pool {
+	unsigned thread_count;
+	pthread_t *threads;
+	work_range *ranges;
+
+	pthread_mutex_t lock;
+	pthread_cond_t start;
+	pthread_cond_t finished;
+
+	// Current job; generation changes each pool_run, running counts busy helpers
+	pool_task task;
+	void *context;
+	unsigned long generation;
+	unsigned running;
+	int shutting_down;
+};
+
+typedef struct {
+	pool_t *pool;
+	unsigned worker;
+} worker_start;
+
+unsigned pool_default_threads(void) {
+	long count = sysconf(_SC_NPROCESSORS_ONLN);
+	return count > 0 ? (unsigned)count : 1;
+}
+
+static int take_own(work_range *range, size_t *index) {
+	pthread_mutex_lock(&range->lock);
+	int found = range->begin < range->end;
+	if (found) *index = --range->end;
+	pthread_mutex_unlock(&range->lock);
+	return found;
+}
+
+// Moves the front half of victim's range into own and takes one index of it
+static int steal(work_range *victim, work_range *own, size_t *index) {
+	pthread_mutex_lock(&victim->lock);
+	size_t available = victim->end - victim->begin;
+	if (victim->begin >= victim->end) {
+		pthread_mutex_unlock(&victim->lock);
+		return 0;
+	}
+
+	size_t begin = victim->begin;
+	size_t taken = (available + 1) / 2;
+	victim->begin += taken;
+	pthread_mutex_unlock(&victim->lock);
+
+	*index = begin;
+	pthread_mutex_lock(&own->lock);
+	own->begin = begin + 1;
+	own->end = begin + taken;
+	pthread_mutex_unlock(&own->lock);
+	return 1;
+}
+
+static void work(pool_t *pool, unsigned worker) {
+	work_range *own = &pool->ranges[worker];
+	size_t index;
+
+	for (;;) {
+		if (take_own(own, &index)) {
+			pool->task(pool->context, index, worker);
+			continue;
+		}
+
+		// No new work appears during a run, so one empty sweep means we are done
+		int stolen = 0;
+		for (unsigned i = 1; i < pool->thread_count && !stolen; i++) {
+			stolen = steal(&pool->ranges[(worker + i) % pool->thread_count], own, &index);
+		}
+		if (!stolen) return;
+
+		pool->task(pool->context, index, worker);
+	}
+}
+
+static void *worker_main(void *argument) {
+	worker_start start = *(worker_start *)argument;
+	free(argument);
+
+	pool_t *pool = start.pool;
+	unsigned long seen = 0;
+
+	pthread_mutex_lock(&pool->lock);
+	for (;;) {
+		while (pool->generation == seen && !pool->shutting_down) {
+			pthread_cond_wait(&pool->start, &pool->lock);
+		}
+		if (pool->shutting_down) break;
+		seen = pool->generation;
+		pthread_mutex_unlock(&pool->lock);
+
+		work(pool, start.worker);
+
+		pthread_mutex_lock(&pool->lock);
+		if (--pool->running == 0) pthread_cond_signal(&pool->finished);
+	}
+	pthread_mutex_unlock(&pool->lock);
+	return NULL;
+}
+
+pool_t *pool_create(unsigned thread_count) {
+	pool_t *pool = calloc(1, sizeof(pool_t));
+	if (!pool) {
+		fprintf(stderr, "Memory allocate failed at %s:%d", __FILE__, __LINE__);
+		return NULL;
+	}
+
+	pool->thread_count = thread_count ? thread_count : pool_default_threads();
+	pool->threads = calloc(pool->thread_count, sizeof(pthread_t));
+	pool->ranges = aligned_alloc(_Alignof(work_range), pool->thread_count * sizeof(work_range));
+	if (!pool->threads || !pool->ranges) {
+		fprintf(stderr, "Memory allocate failed at %s:%d", __FILE__, __LINE__);
+		free(pool->threads);
+		free(pool->ranges);
+		free(pool);
+		return NULL;
+	}
+
+	pthread_mutex_init(&pool->lock, NULL);
+	pthread_cond_init(&pool->start, NULL);
+	pthread_cond_init(&pool->finished, NULL);
+	for (unsigned i = 0; i < pool->thread_count; i++) {
+		pthread_mutex_init(&pool->ranges[i].lock, NULL);
+		pool->ranges[i].begin = pool->ranges[i].end = 0;
+	}
+
+	// Worker 0 is whoever calls pool_run
+	for (unsigned i = 1; i < pool->thread_count; i++) {
+		worker_start *start = malloc(sizeof(worker_start));
+		if (start) {
+			start->pool = pool;
+			start->worker = i;
+		}
+		if (!start || pthread_create(&pool->threads[i], NULL, worker_main, start) != 0) {
+			free(start);
+			fprintf(stderr, "Cannot start worker thread %u\n", i);
+
+			// Keep the workers that did start
+			pool->thread_count = i;
+			break;
+		}
+	}
+	return pool;
+}
+
+void pool_destroy(pool_t *pool) {
+	if (!pool) return;
+
+	pthread_mutex_lock(&pool->lock);
+	pool->shutting_down = 1;
+	pthread_cond_broadcast(&pool->start);
+	pthread_mutex_unlock(&pool->lock);
+
+	for (unsigned i = 1; i < pool->thread_count; i++) pthread_join(pool->threads[i], NULL);
+
+	for (unsigned i = 0; i < pool->thread_count; i++) pthread_mutex_destroy(&pool->ranges[i].lock);
+	pthread_mutex_destroy(&pool->lock);
+	pthread_cond_destroy(&pool->start);
+	pthread_cond_destroy(&pool->finished);
+	free(pool->threads);
+	free(pool->ranges);
+	free(pool);
+}
+
+unsigned pool_thread_count(const pool_t *pool) {
+	return pool->thread_count;
+}
+
+void pool_run(pool_t *pool, size_t count, pool_task task, void *context) {
+	if (count == 0) return;
+
+	unsigned threads = pool->thread_count;
+	for (unsigned i = 0; i < threads; i++) {
+		pool->ranges[i].begin = count * i / threads;
+		pool->ranges[i].end = count * (i + 1) / threads;
+	}
+
+	pool->task = task;
+	pool->context = context;
+
+	if (threads > 1) {
+		pthread_mutex_lock(&pool->lock);
+		pool->running = threads - 1;
+		pool->generation++;
+		pthread_cond_broadcast(&pool->start);
+		pthread_mutex_unlock(&pool->lock);
+	}
+
+	work(pool, 0);
+
+	if (threads > 1) {
+		pthread_mutex_lock(&pool->lock);
+		while (pool->running) pthread_cond_wait(&pool->finished, &pool->lock);
+		pthread_mutex_unlock(&pool->lock);
+	}
+}
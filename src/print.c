@@ -0,0 +1,19 @@
+/*
+ *
+ *		print.c
+ *		LUMEN LANGUAGE PROJECT
+ *		Rainy101112 - 2025/7/20
+ *
+ */
+
+#include <print.h>
+#include <dump.h>
+#include <stdio.h>
+
+void print_ast(ast_node *node, int indent) {
+	dump_ast(stdout, node, DUMP_TEXT, indent);
+}
+
+void print_flat_ast(const flat_ast *ast, flat_index node, int indent) {
+	dump_flat_ast(stdout, ast, node, DUMP_TEXT, indent);
+}
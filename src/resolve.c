@@ -0,0 +1,342 @@
+/*
+ *
+ *		resolve.c
+ *		LUMEN LANGUAGE PROJECT
+ *		Rainy101112 - 2025/7/20
+ *
+ */
+
+#include <resolve.h>
+#include <mem.h>
+#include <diag.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+	symbol_id name;
+	uint32_t slot;		// SLOT_UNRESOLVED marks an empty entry
+} slot_entry;
+
+typedef struct {
+	resolve_result *result;
+	uint32_t slot_capacity;
+
+	// Interned id -> slot, open addressing; grows with this tree, not the process-wide symbol table
+	slot_entry *slot_of;
+	uint32_t slot_mask;
+	uint32_t symbol_limit;
+
+	// Bitsets over slots, words_per_set 64-bit words each
+	size_t words_per_set;
+	uint64_t *reported;
+
+	// Per enclosing loop: slots assigned on every path reaching a continue
+	uint64_t **continue_sets;
+	uint32_t loop_depth;
+	uint32_t loop_capacity;
+
+	int failed;
+} resolver_state;
+
+// The entry holding name, or the empty one where it belongs
+static slot_entry *find_entry(slot_entry *table, uint32_t mask, symbol_id name) {
+	uint32_t at = (name * 2654435761u) & mask;
+	while (table[at].slot != SLOT_UNRESOLVED && table[at].name != name) at = (at + 1) & mask;
+	return &table[at];
+}
+
+static uint32_t slot_for(resolver_state *state, symbol_id name) {
+	if (name >= state->symbol_limit) {
+		diag_report(DIAG_ERROR, "Unknown symbol id %u\n", name);
+		state->failed = 1;
+		return 0;
+	}
+
+	// No table until the first name arrives
+	slot_entry *entry = state->slot_of ? find_entry(state->slot_of, state->slot_mask, name) : NULL;
+	if (entry && entry->slot != SLOT_UNRESOLVED) return entry->slot;
+
+	resolve_result *result = state->result;
+	if (result->slot_count == state->slot_capacity) {
+		uint32_t capacity = state->slot_capacity ? state->slot_capacity * 2 : 16;
+		symbol_id *names = mem_realloc(result->names, capacity * sizeof(symbol_id));
+		// Kept at most half full; the names list already holds every key to rehash
+		slot_entry *table = mem_alloc(capacity * 2 * sizeof(slot_entry));
+		if (!names || !table) {
+			fprintf(stderr, "Memory allocate failed at %s:%d", __FILE__, __LINE__);
+			if (names) result->names = names;
+			mem_free(table);
+			state->failed = 1;
+			return 0;
+		}
+		memset(table, 0xFF, capacity * 2 * sizeof(slot_entry));
+		for (uint32_t i = 0; i < result->slot_count; i++) {
+			*find_entry(table, capacity * 2 - 1, names[i]) = (slot_entry){ names[i], i };
+		}
+		mem_free(state->slot_of);
+		state->slot_of = table;
+		state->slot_mask = capacity * 2 - 1;
+		result->names = names;
+		state->slot_capacity = capacity;
+		entry = find_entry(table, state->slot_mask, name);
+	}
+
+	*entry = (slot_entry){ name, result->slot_count };
+	result->names[result->slot_count++] = name;
+	return entry->slot;
+}
+
+// First pass: number variables in order of appearance and annotate nodes
+static void assign_slots(resolver_state *state, ast_node *node) {
+	if (!node || state->failed) return;
+
+	switch (node->type) {
+		case AST_BLOCK:
+			for (int i = 0; i < node->data.block.count; i++) {
+				assign_slots(state, node->data.block.statements[i]);
+			}
+			break;
+
+		case AST_ASSIGNMENT:
+			node->data.assign.slot = slot_for(state, node->data.assign.name);
+			assign_slots(state, node->data.assign.value);
+			break;
+
+		case AST_VARIABLE:
+			node->data.variable.slot = slot_for(state, node->data.variable.name);
+			break;
+
+		case AST_BINARY_OP:
+			assign_slots(state, node->data.binop.left);
+			assign_slots(state, node->data.binop.right);
+			break;
+
+		case AST_UNARY_OP:
+			assign_slots(state, node->data.unop.operand);
+			break;
+
+		case AST_ARRAY:
+			for (int i = 0; i < node->data.array.count; i++) {
+				assign_slots(state, node->data.array.elements[i]);
+			}
+			break;
+
+		case AST_IF_STMT:
+			assign_slots(state, node->data.if_stmt.condition);
+			assign_slots(state, node->data.if_stmt.then_block);
+			assign_slots(state, node->data.if_stmt.else_block);
+			break;
+
+		case AST_FOR_LOOP:
+			assign_slots(state, node->data.for_loop.init);
+			assign_slots(state, node->data.for_loop.condition);
+			assign_slots(state, node->data.for_loop.update);
+			assign_slots(state, node->data.for_loop.body);
+			break;
+
+		case AST_WHILE_LOOP:
+			assign_slots(state, node->data.while_loop.condition);
+			assign_slots(state, node->data.while_loop.body);
+			break;
+
+		default:
+			break;
+	}
+}
+
+static uint64_t *set_create(resolver_state *state) {
+	uint64_t *set = mem_calloc(state->words_per_set ? state->words_per_set : 1, sizeof(uint64_t));
+	if (!set) {
+		fprintf(stderr, "Memory allocate failed at %s:%d", __FILE__, __LINE__);
+		state->failed = 1;
+	}
+	return set;
+}
+
+static uint64_t *set_clone(resolver_state *state, const uint64_t *from) {
+	uint64_t *set = set_create(state);
+	if (set) memcpy(set, from, state->words_per_set * sizeof(uint64_t));
+	return set;
+}
+
+// Unreachable code: every variable counts as assigned there
+static void set_fill(resolver_state *state, uint64_t *set) {
+	memset(set, 0xFF, state->words_per_set * sizeof(uint64_t));
+}
+
+static void set_intersect(resolver_state *state, uint64_t *into, const uint64_t *other) {
+	for (size_t i = 0; i < state->words_per_set; i++) into[i] &= other[i];
+}
+
+static int set_has(const uint64_t *set, uint32_t slot) {
+	return (set[slot / 64] >> (slot % 64)) & 1;
+}
+
+static void set_add(uint64_t *set, uint32_t slot) {
+	set[slot / 64] |= (uint64_t)1 << (slot % 64);
+}
+
+static void check_expression(resolver_state *state, const ast_node *node, const uint64_t *assigned) {
+	if (!node) return;
+
+	switch (node->type) {
+		case AST_VARIABLE: {
+			uint32_t slot = node->data.variable.slot;
+			if (!set_has(assigned, slot) && !set_has(state->reported, slot)) {
+				set_add(state->reported, slot);
+				state->result->warning_count++;
+				diag_report_at(DIAG_WARNING, node->start, "Warning: variable '%s' may be used before assignment\n", symbol_name(node->data.variable.name));
+			}
+			break;
+		}
+
+		case AST_BINARY_OP:
+			check_expression(state, node->data.binop.left, assigned);
+			check_expression(state, node->data.binop.right, assigned);
+			break;
+
+		case AST_UNARY_OP:
+			check_expression(state, node->data.unop.operand, assigned);
+			break;
+
+		case AST_ARRAY:
+			for (int i = 0; i < node->data.array.count; i++) {
+				check_expression(state, node->data.array.elements[i], assigned);
+			}
+			break;
+
+		default:
+			break;
+	}
+}
+
+static void analyze(resolver_state *state, const ast_node *node, uint64_t *assigned);
+
+// Body of a loop that may run zero times; the caller's set is left untouched
+static void analyze_loop_body(resolver_state *state, const ast_node *body, const ast_node *update, const uint64_t *assigned) {
+	if (state->loop_depth == state->loop_capacity) {
+		uint32_t capacity = state->loop_capacity ? state->loop_capacity * 2 : 8;
+		uint64_t **sets = mem_realloc(state->continue_sets, capacity * sizeof(uint64_t *));
+		if (!sets) {
+			fprintf(stderr, "Memory allocate failed at %s:%d", __FILE__, __LINE__);
+			state->failed = 1;
+			return;
+		}
+		state->continue_sets = sets;
+		state->loop_capacity = capacity;
+	}
+
+	uint64_t *body_set = set_clone(state, assigned);
+	uint64_t *continue_set = set_create(state);
+	if (!body_set || !continue_set) {
+		mem_free(body_set);
+		mem_free(continue_set);
+		return;
+	}
+	set_fill(state, continue_set);
+
+	state->continue_sets[state->loop_depth++] = continue_set;
+	analyze(state, body, body_set);
+	state->loop_depth--;
+
+	// The update runs after the body falls through or continues
+	if (update) {
+		set_intersect(state, body_set, continue_set);
+		analyze(state, update, body_set);
+	}
+
+	mem_free(body_set);
+	mem_free(continue_set);
+}
+
+static void analyze(resolver_state *state, const ast_node *node, uint64_t *assigned) {
+	if (!node || state->failed) return;
+
+	switch (node->type) {
+		case AST_BLOCK:
+			for (int i = 0; i < node->data.block.count; i++) {
+				analyze(state, node->data.block.statements[i], assigned);
+			}
+			break;
+
+		case AST_ASSIGNMENT:
+			check_expression(state, node->data.assign.value, assigned);
+			set_add(assigned, node->data.assign.slot);
+			break;
+
+		case AST_IF_STMT: {
+			check_expression(state, node->data.if_stmt.condition, assigned);
+
+			uint64_t *else_set = set_clone(state, assigned);
+			if (!else_set) return;
+
+			analyze(state, node->data.if_stmt.then_block, assigned);
+			analyze(state, node->data.if_stmt.else_block, else_set);
+			set_intersect(state, assigned, else_set);
+			mem_free(else_set);
+			break;
+		}
+
+		case AST_WHILE_LOOP:
+			check_expression(state, node->data.while_loop.condition, assigned);
+			analyze_loop_body(state, node->data.while_loop.body, NULL, assigned);
+			break;
+
+		case AST_FOR_LOOP:
+			analyze(state, node->data.for_loop.init, assigned);
+			check_expression(state, node->data.for_loop.condition, assigned);
+			analyze_loop_body(state, node->data.for_loop.body, node->data.for_loop.update, assigned);
+			break;
+
+		case AST_BREAK:
+			set_fill(state, assigned);
+			break;
+
+		case AST_CONTINUE:
+			if (state->loop_depth) {
+				set_intersect(state, state->continue_sets[state->loop_depth - 1], assigned);
+			}
+			set_fill(state, assigned);
+			break;
+
+		default:
+			check_expression(state, node, assigned);
+			break;
+	}
+}
+
+int resolve_ast(ast_node *root, resolve_result *result) {
+	memset(result, 0, sizeof(*result));
+	if (!root) return 1;
+
+	resolver_state state = {
+		.result = result,
+		.symbol_limit = symbol_count()
+	};
+
+	assign_slots(&state, root);
+	mem_free(state.slot_of);
+
+	if (!state.failed) {
+		state.words_per_set = (result->slot_count + 63) / 64;
+		state.reported = set_create(&state);
+		uint64_t *assigned = set_create(&state);
+		if (assigned) analyze(&state, root, assigned);
+		mem_free(assigned);
+	}
+
+	mem_free(state.reported);
+	mem_free(state.continue_sets);
+
+	if (state.failed) {
+		resolve_result_free(result);
+		return 1;
+	}
+	return 0;
+}
+
+void resolve_result_free(resolve_result *result) {
+	mem_free(result->names);
+	memset(result, 0, sizeof(*result));
+}
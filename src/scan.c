@@ -0,0 +1,270 @@
+/*
+ *
+ *		scan.c
+ *		LUMEN LANGUAGE PROJECT
+ *		Rainy101112 - 2025/7/20
+ *
+ */
+
+#include <scan.h>
+#include <stdint.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SCAN_X86 1
+#include <immintrin.h>
+#endif
+
+static inline int is_space_byte(unsigned char c) {
+	return c == ' ' || (unsigned char)(c - '\t') <= '\r' - '\t';
+}
+
+static inline int is_digit_byte(unsigned char c) {
+	return (unsigned char)(c - '0') <= 9;
+}
+
+static inline int is_identifier_byte(unsigned char c) {
+	return (unsigned char)((c | 0x20) - 'a') <= 'z' - 'a' || is_digit_byte(c) || c == '_';
+}
+
+static const char *scan_whitespace_scalar(const char *p) {
+	while (is_space_byte(*p)) p++;
+	return p;
+}
+
+static const char *scan_identifier_scalar(const char *p) {
+	while (is_identifier_byte(*p)) p++;
+	return p;
+}
+
+static const char *scan_digits_scalar(const char *p) {
+	while (is_digit_byte(*p)) p++;
+	return p;
+}
+
+// Finishes [i, length) a byte at a time, appending to starts after count entries
+static size_t line_starts_tail(const char *p, size_t i, size_t length, size_t *starts, size_t count) {
+	for (; i < length; i++) {
+		if (p[i] != '\n') continue;
+		if (starts) starts[count] = i + 1;
+		count++;
+	}
+	return count;
+}
+
+static size_t scan_line_starts_scalar(const char *p, size_t length, size_t *starts) {
+	return line_starts_tail(p, 0, length, starts, 0);
+}
+
+#ifdef SCAN_X86
+
+// Appends one line start per set bit of mask, a newline mask of the block at offset base
+static inline size_t add_line_starts(uint32_t mask, size_t base, size_t *starts, size_t count) {
+	if (!starts) return count + (size_t)__builtin_popcount(mask);
+	while (mask) {
+		starts[count++] = base + (size_t)__builtin_ctz(mask) + 1;
+		mask &= mask - 1;
+	}
+	return count;
+}
+
+/*
+ * The vector loops only issue aligned loads. An aligned block never crosses
+ * a page boundary, so reading past the terminating NUL (which always ends
+ * the run) cannot fault. Bytes before the first boundary are done scalar,
+ * which also keeps short tokens off the vector path entirely.
+ */
+
+// The over-read is intentional; keep ASan from flagging it
+#if defined(__has_feature)
+#if __has_feature(address_sanitizer)
+#define SCAN_NO_ASAN __attribute__((no_sanitize_address))
+#endif
+#elif defined(__SANITIZE_ADDRESS__)
+#define SCAN_NO_ASAN __attribute__((no_sanitize_address))
+#endif
+#ifndef SCAN_NO_ASAN
+#define SCAN_NO_ASAN
+#endif
+
+#define SCAN_HEAD(p, align, pred) \
+	while (((uintptr_t)(p) & ((align) - 1)) != 0) { \
+		if (!pred(*(p))) return (p); \
+		(p)++; \
+	}
+
+static inline __m128i sse2_in_range(__m128i v, char lo, char hi) {
+	return _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8(lo - 1)), _mm_cmplt_epi8(v, _mm_set1_epi8(hi + 1)));
+}
+
+static inline __m128i sse2_space_mask(__m128i v) {
+	return _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')), sse2_in_range(v, '\t', '\r'));
+}
+
+static inline __m128i sse2_identifier_mask(__m128i v) {
+	__m128i lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+	__m128i alpha = sse2_in_range(lower, 'a', 'z');
+	__m128i digit = sse2_in_range(v, '0', '9');
+	__m128i underscore = _mm_cmpeq_epi8(v, _mm_set1_epi8('_'));
+	return _mm_or_si128(_mm_or_si128(alpha, digit), underscore);
+}
+
+static inline __m128i sse2_digit_mask(__m128i v) {
+	return sse2_in_range(v, '0', '9');
+}
+
+#define SSE2_SCAN(name, pred, mask_fn) \
+	static SCAN_NO_ASAN const char *name(const char *p) { \
+		SCAN_HEAD(p, 16, pred) \
+		for (;;) { \
+			__m128i v = _mm_load_si128((const __m128i *)p); \
+			unsigned mask = (unsigned)_mm_movemask_epi8(mask_fn(v)) ^ 0xFFFFu; \
+			if (mask) return p + __builtin_ctz(mask); \
+			p += 16; \
+		} \
+	}
+
+SSE2_SCAN(scan_whitespace_sse2, is_space_byte, sse2_space_mask)
+SSE2_SCAN(scan_identifier_sse2, is_identifier_byte, sse2_identifier_mask)
+SSE2_SCAN(scan_digits_sse2, is_digit_byte, sse2_digit_mask)
+
+// Bounded by length rather than a NUL, so these use unaligned loads and finish scalar
+static size_t scan_line_starts_sse2(const char *p, size_t length, size_t *starts) {
+	const __m128i newline = _mm_set1_epi8('\n');
+	size_t count = 0, i = 0;
+
+	for (; i + 16 <= length; i += 16) {
+		__m128i v = _mm_loadu_si128((const __m128i *)(p + i));
+		uint32_t mask = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, newline));
+		if (mask) count = add_line_starts(mask, i, starts, count);
+	}
+	return line_starts_tail(p, i, length, starts, count);
+}
+
+#define AVX2 __attribute__((target("avx2")))
+
+static inline AVX2 __m256i avx2_in_range(__m256i v, char lo, char hi) {
+	return _mm256_and_si256(_mm256_cmpgt_epi8(v, _mm256_set1_epi8(lo - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8(hi + 1), v));
+}
+
+static inline AVX2 __m256i avx2_space_mask(__m256i v) {
+	return _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')), avx2_in_range(v, '\t', '\r'));
+}
+
+static inline AVX2 __m256i avx2_identifier_mask(__m256i v) {
+	__m256i lower = _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+	__m256i alpha = avx2_in_range(lower, 'a', 'z');
+	__m256i digit = avx2_in_range(v, '0', '9');
+	__m256i underscore = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('_'));
+	return _mm256_or_si256(_mm256_or_si256(alpha, digit), underscore);
+}
+
+static inline AVX2 __m256i avx2_digit_mask(__m256i v) {
+	return avx2_in_range(v, '0', '9');
+}
+
+#define AVX2_SCAN(name, pred, mask_fn) \
+	static AVX2 SCAN_NO_ASAN const char *name(const char *p) { \
+		SCAN_HEAD(p, 32, pred) \
+		for (;;) { \
+			__m256i v = _mm256_load_si256((const __m256i *)p); \
+			uint32_t mask = ~(uint32_t)_mm256_movemask_epi8(mask_fn(v)); \
+			if (mask) return p + __builtin_ctz(mask); \
+			p += 32; \
+		} \
+	}
+
+AVX2_SCAN(scan_whitespace_avx2, is_space_byte, avx2_space_mask)
+AVX2_SCAN(scan_identifier_avx2, is_identifier_byte, avx2_identifier_mask)
+AVX2_SCAN(scan_digits_avx2, is_digit_byte, avx2_digit_mask)
+
+static AVX2 size_t scan_line_starts_avx2(const char *p, size_t length, size_t *starts) {
+	const __m256i newline = _mm256_set1_epi8('\n');
+	size_t count = 0, i = 0;
+
+	for (; i + 32 <= length; i += 32) {
+		__m256i v = _mm256_loadu_si256((const __m256i *)(p + i));
+		uint32_t mask = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, newline));
+		if (mask) count = add_line_starts(mask, i, starts, count);
+	}
+	return line_starts_tail(p, i, length, starts, count);
+}
+
+#endif
+
+typedef const char *(*scan_fn)(const char *p);
+typedef size_t (*line_starts_fn)(const char *p, size_t length, size_t *starts);
+
+static const char *resolve_whitespace(const char *p);
+static const char *resolve_identifier(const char *p);
+static const char *resolve_digits(const char *p);
+static size_t resolve_line_starts(const char *p, size_t length, size_t *starts);
+
+// Start out pointing at the resolvers; the first call patches in the kernel
+static scan_fn whitespace_kernel = resolve_whitespace;
+static scan_fn identifier_kernel = resolve_identifier;
+static scan_fn digits_kernel = resolve_digits;
+static line_starts_fn line_starts_kernel = resolve_line_starts;
+
+static void select_kernels(void) {
+	scan_fn whitespace = scan_whitespace_scalar;
+	scan_fn identifier = scan_identifier_scalar;
+	scan_fn digits = scan_digits_scalar;
+	line_starts_fn line_starts = scan_line_starts_scalar;
+
+#ifdef SCAN_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2")) {
+		whitespace = scan_whitespace_avx2;
+		identifier = scan_identifier_avx2;
+		digits = scan_digits_avx2;
+		line_starts = scan_line_starts_avx2;
+	} else if (__builtin_cpu_supports("sse2")) {
+		whitespace = scan_whitespace_sse2;
+		identifier = scan_identifier_sse2;
+		digits = scan_digits_sse2;
+		line_starts = scan_line_starts_sse2;
+	}
+#endif
+
+	// Racing threads all store the same values, so plain stores are fine
+	__atomic_store_n(&whitespace_kernel, whitespace, __ATOMIC_RELAXED);
+	__atomic_store_n(&identifier_kernel, identifier, __ATOMIC_RELAXED);
+	__atomic_store_n(&digits_kernel, digits, __ATOMIC_RELAXED);
+	__atomic_store_n(&line_starts_kernel, line_starts, __ATOMIC_RELAXED);
+}
+
+static const char *resolve_whitespace(const char *p) {
+	select_kernels();
+	return whitespace_kernel(p);
+}
+
+static const char *resolve_identifier(const char *p) {
+	select_kernels();
+	return identifier_kernel(p);
+}
+
+static const char *resolve_digits(const char *p) {
+	select_kernels();
+	return digits_kernel(p);
+}
+
+static size_t resolve_line_starts(const char *p, size_t length, size_t *starts) {
+	select_kernels();
+	return line_starts_kernel(p, length, starts);
+}
+
+const char *scan_whitespace(const char *p) {
+	return __atomic_load_n(&whitespace_kernel, __ATOMIC_RELAXED)(p);
+}
+
+const char *scan_identifier(const char *p) {
+	return __atomic_load_n(&identifier_kernel, __ATOMIC_RELAXED)(p);
+}
+
+const char *scan_digits(const char *p) {
+	return __atomic_load_n(&digits_kernel, __ATOMIC_RELAXED)(p);
+}
+
+size_t scan_line_starts(const char *p, size_t length, size_t *starts) {
+	return __atomic_load_n(&line_starts_kernel, __ATOMIC_RELAXED)(p, length, starts);
+}
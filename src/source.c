@@ -0,0 +1,125 @@
+/*
+ *
+ *		source.c
+ *		LUMEN LANGUAGE PROJECT
+ *		Rainy101112 - 2025/7/20
+ *
+ */
+
+#include <source.h>
+#include <diag.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define READ_CHUNK (64 * 1024)
+
+/*
+ * Maps a regular file with at least one zero byte after it. A private
+ * anonymous reservation one byte larger than the file is made first and
+ * the file is mapped over its start, so even a file that ends exactly on
+ * a page boundary is followed by a zero page instead of unmapped memory.
+ */
+static int map_file(source_t *source, int fd, size_t size) {
+	size_t page = (size_t)sysconf(_SC_PAGESIZE);
+	size_t reserved = (size + 1 + page - 1) & ~(page - 1);
+
+	void *base = mmap(NULL, reserved, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (base == MAP_FAILED) return -1;
+
+	if (mmap(base, size, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+		munmap(base, reserved);
+		return -1;
+	}
+
+#ifdef MADV_SEQUENTIAL
+	madvise(base, size, MADV_SEQUENTIAL);
+#endif
+
+	source->text = base;
+	source->length = size;
+	source->mapping = base;
+	source->mapping_size = reserved;
+	return 0;
+}
+
+static int read_stream(source_t *source, int fd) {
+	size_t size = 0, capacity = READ_CHUNK;
+	char *buffer = malloc(capacity);
+
+	for (;;) {
+		if (!buffer) {
+			fprintf(stderr, "Memory allocate failed at %s:%d", __FILE__, __LINE__);
+			return -1;
+		}
+
+		ssize_t got = read(fd, buffer + size, capacity - size - 1);
+		if (got < 0) {
+			if (errno == EINTR) continue;
+			free(buffer);
+			return -1;
+		}
+		if (got == 0) break;
+
+		size += (size_t)got;
+		if (capacity - size - 1 == 0) {
+			capacity *= 2;
+			char *grown = realloc(buffer, capacity);
+			if (!grown) free(buffer);
+			buffer = grown;
+		}
+	}
+
+	buffer[size] = '\0';
+	source->text = buffer;
+	source->length = size;
+	source->mapping = NULL;
+	source->mapping_size = 0;
+	return 0;
+}
+
+source_t *source_open(const char *path) {
+	source_t *source = malloc(sizeof(source_t));
+	if (!source) {
+		fprintf(stderr, "Memory allocate failed at %s:%d", __FILE__, __LINE__);
+		return NULL;
+	}
+
+	int from_stdin = strcmp(path, "-") == 0;
+	int fd = from_stdin ? STDIN_FILENO : open(path, O_RDONLY);
+	if (fd < 0) {
+		diag_report(DIAG_ERROR, "Cannot open %s: %s\n", path, strerror(errno));
+		free(source);
+		return NULL;
+	}
+
+	// Empty files cannot be mapped; they take the stream path like pipes do
+	struct stat info;
+	int status = -1;
+	if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+		status = map_file(source, fd, (size_t)info.st_size);
+	}
+	if (status != 0) status = read_stream(source, fd);
+
+	if (status != 0) diag_report(DIAG_ERROR, "Cannot read %s: %s\n", path, strerror(errno));
+	if (!from_stdin) close(fd);
+
+	if (status != 0) {
+		free(source);
+		return NULL;
+	}
+	return source;
+}
+
+void source_close(source_t *source) {
+	if (!source) return;
+
+	if (source->mapping) munmap(source->mapping, source->mapping_size);
+	else free((char *)source->text);
+	free(source);
+}
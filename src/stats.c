@@ -0,0 +1,161 @@
+/*
+ *
+ *		stats.c
+ *		LUMEN LANGUAGE PROJECT
+ *		Rainy101112 - 2025/7/20
+ *
+ */
+
+#include <stats.h>
+#include <visit.h>
+#include <lexer.h>
+#include <sys/resource.h>
+#include <time.h>
+
+static const char *phase_names[STATS_PHASE_COUNT] = {
+	[STATS_LEX] = "lex",
+	[STATS_PARSE] = "parse",
+	[STATS_PASSES] = "passes",
+	[STATS_EXECUTE] = "execute",
+	[STATS_OUTPUT] = "output",
+	[STATS_TEARDOWN] = "teardown"
+};
+
+static const char *node_names[AST_NODE_TYPE_COUNT] = {
+	[AST_PROGRAM] = "PROGRAM",
+	[AST_BLOCK] = "BLOCK",
+	[AST_ASSIGNMENT] = "ASSIGNMENT",
+	[AST_BINARY_OP] = "BINARY_OP",
+	[AST_UNARY_OP] = "UNARY_OP",
+	[AST_VARIABLE] = "VARIABLE",
+	[AST_LITERAL] = "LITERAL",
+	[AST_ARRAY] = "ARRAY",
+	[AST_IF_STMT] = "IF",
+	[AST_FOR_LOOP] = "FOR",
+	[AST_WHILE_LOOP] = "WHILE",
+	[AST_BREAK] = "BREAK",
+	[AST_CONTINUE] = "CONTINUE"
+};
+
+double stats_now(void) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+void stats_lap(stats_t *stats, stats_phase phase, double *mark) {
+	if (!stats) return;
+
+	double now = stats_now();
+	stats->seconds[phase] += now - *mark;
+	*mark = now;
+}
+
+void stats_count_tokens(stats_t *stats, const token_stream *tokens) {
+	for (uint32_t i = 0; i < tokens->count; i++) stats->tokens[tokens->kinds[i]]++;
+}
+
+static ast_visit_action count_node(ast_node *node, const ast_visit_position *at, void *context) {
+	stats_t *stats = context;
+	stats->nodes[node->type]++;
+	if (at->depth + 1 > stats->max_depth) stats->max_depth = at->depth + 1;
+	return AST_VISIT_CONTINUE;
+}
+
+void stats_count_nodes(stats_t *stats, ast_node *root) {
+	static const ast_visitor visitor = { count_node, NULL };
+	ast_visit(root, &visitor, stats);
+}
+
+void stats_finish(stats_t *stats, const mem_counters *start) {
+	mem_counters now = mem_stats();
+	stats->memory.allocations = now.allocations - start->allocations;
+	stats->memory.reallocations = now.reallocations - start->reallocations;
+	stats->memory.frees = now.frees - start->frees;
+	stats->memory.bytes = now.bytes - start->bytes;
+
+	// ru_maxrss is in KiB on Linux
+	struct rusage usage;
+	stats->peak_rss_kib = getrusage(RUSAGE_SELF, &usage) == 0 ? usage.ru_maxrss : 0;
+}
+
+static uint64_t sum(const uint64_t *counts, size_t count) {
+	uint64_t total = 0;
+	for (size_t i = 0; i < count; i++) total += counts[i];
+	return total;
+}
+
+static void print_json_string(const char *text, FILE *out) {
+	fputc('"', out);
+	for (; *text; text++) {
+		unsigned char c = (unsigned char)*text;
+		if (c == '"' || c == '\\') fprintf(out, "\\%c", c);
+		else if (c < 0x20) fprintf(out, "\\u%04x", c);
+		else fputc(c, out);
+	}
+	fputc('"', out);
+}
+
+static void print_json(const stats_t *stats, FILE *out) {
+	fprintf(out, "{\"file\": ");
+	print_json_string(stats->path ? stats->path : "", out);
+	fprintf(out, ", \"bytes\": %zu, \"cached\": %s,\n", stats->source_bytes, stats->cached ? "true" : "false");
+
+	fprintf(out, " \"seconds\": {");
+	double total = 0;
+	for (int phase = 0; phase < STATS_PHASE_COUNT; phase++) {
+		fprintf(out, "\"%s\": %.9f, ", phase_names[phase], stats->seconds[phase]);
+		total += stats->seconds[phase];
+	}
+	fprintf(out, "\"total\": %.9f},\n", total);
+
+	fprintf(out, " \"tokens\": {\"total\": %llu", (unsigned long long)sum(stats->tokens, TOKEN_TYPE_COUNT));
+	for (int type = 0; type < TOKEN_TYPE_COUNT; type++) {
+		if (stats->tokens[type]) fprintf(out, ", \"%s\": %llu", token_type_name(type), (unsigned long long)stats->tokens[type]);
+	}
+	fprintf(out, "},\n");
+
+	fprintf(out, " \"nodes\": {\"total\": %llu", (unsigned long long)sum(stats->nodes, AST_NODE_TYPE_COUNT));
+	for (int type = 0; type < AST_NODE_TYPE_COUNT; type++) {
+		if (stats->nodes[type]) fprintf(out, ", \"%s\": %llu", node_names[type], (unsigned long long)stats->nodes[type]);
+	}
+	fprintf(out, "},\n");
+
+	fprintf(out, " \"max_depth\": %u,\n", stats->max_depth);
+	fprintf(out, " \"memory\": {\"allocations\": %llu, \"reallocations\": %llu, \"frees\": %llu, \"bytes\": %llu, \"peak_rss_kib\": %ld}}\n",
+		(unsigned long long)stats->memory.allocations, (unsigned long long)stats->memory.reallocations,
+		(unsigned long long)stats->memory.frees, (unsigned long long)stats->memory.bytes, stats->peak_rss_kib);
+}
+
+static void print_text(const stats_t *stats, FILE *out) {
+	fprintf(out, "stats: %s, %zu byte(s)%s\n", stats->path ? stats->path : "", stats->source_bytes,
+		stats->cached ? ", from cache" : "");
+
+	double total = 0;
+	for (int phase = 0; phase < STATS_PHASE_COUNT; phase++) total += stats->seconds[phase];
+	for (int phase = 0; phase < STATS_PHASE_COUNT; phase++) {
+		fprintf(out, "  %-10s %12.3f ms %6.1f%%\n", phase_names[phase], stats->seconds[phase] * 1e3,
+			total > 0 ? stats->seconds[phase] * 100 / total : 0.0);
+	}
+	fprintf(out, "  %-10s %12.3f ms\n", "total", total * 1e3);
+
+	fprintf(out, "  tokens     %12llu\n", (unsigned long long)sum(stats->tokens, TOKEN_TYPE_COUNT));
+	for (int type = 0; type < TOKEN_TYPE_COUNT; type++) {
+		if (stats->tokens[type]) fprintf(out, "    %-14s %10llu\n", token_type_name(type), (unsigned long long)stats->tokens[type]);
+	}
+
+	fprintf(out, "  nodes      %12llu  (max depth %u)\n", (unsigned long long)sum(stats->nodes, AST_NODE_TYPE_COUNT), stats->max_depth);
+	for (int type = 0; type < AST_NODE_TYPE_COUNT; type++) {
+		if (stats->nodes[type]) fprintf(out, "    %-14s %10llu\n", node_names[type], (unsigned long long)stats->nodes[type]);
+	}
+
+	fprintf(out, "  allocs     %12llu  (%llu realloc(s), %llu free(s))\n", (unsigned long long)stats->memory.allocations,
+		(unsigned long long)stats->memory.reallocations, (unsigned long long)stats->memory.frees);
+	fprintf(out, "  requested  %12.2f MiB\n", stats->memory.bytes / (1024.0 * 1024.0));
+	fprintf(out, "  peak RSS   %12.2f MiB\n", stats->peak_rss_kib / 1024.0);
+}
+
+void stats_print(const stats_t *stats, int json, FILE *out) {
+	if (json) print_json(stats, out);
+	else print_text(stats, out);
+}
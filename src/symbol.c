@@ -0,0 +1,220 @@
+/*
+ *
+ *		symbol.c
+ *		LUMEN LANGUAGE PROJECT
+ *		Rainy101112 - 2025/7/20
+ *
+ */
+
+#include <symbol.h>
+#include <mem.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define STRING_CHUNK_SIZE (64 * 1024)
+#define INITIAL_BUCKETS 256
+
+// Entries live in fixed pages that never move, so readers need no lock
+#define ENTRY_PAGE_BITS 12
+#define ENTRY_PAGE_SIZE (1u << ENTRY_PAGE_BITS)
+#define ENTRY_PAGE_COUNT (1u << 16)
+
+// Per-thread direct-mapped cache in front of the locked table
+#define CACHE_SIZE 512
+
+typedef struct string_chunk {
+	struct string_chunk *next;
+	size_t used;
+	size_t size;
+	char data[];
+} string_chunk;
+
+typedef struct {
+	const char *name;
+	uint32_t length;
+	uint32_t hash;
+} symbol_entry;
+
+typedef struct {
+	symbol_entry *pages[ENTRY_PAGE_COUNT];
+
+	// Published with release ordering once the entry is complete
+	uint32_t count;
+
+	// Open addressing; each bucket holds id + 1, zero marks an empty bucket
+	uint32_t *buckets;
+	uint32_t bucket_count;
+
+	string_chunk *chunks;
+
+	// Bumped by symbol_table_free so stale thread caches are ignored
+	uint32_t generation;
+} symbol_table;
+
+typedef struct {
+	const char *name;
+	uint32_t length;
+	uint32_t hash;
+	symbol_id id;
+	uint32_t generation;
+} cache_entry;
+
+static symbol_table table;
+static pthread_mutex_t table_lock = PTHREAD_MUTEX_INITIALIZER;
+static _Thread_local cache_entry cache[CACHE_SIZE];
+
+static symbol_entry *entry_at(uint32_t id) {
+	return &table.pages[id >> ENTRY_PAGE_BITS][id & (ENTRY_PAGE_SIZE - 1)];
+}
+
+static uint32_t hash_name(const char *text, size_t length) {
+	uint32_t hash = 2166136261u;
+	for (size_t i = 0; i < length; i++) {
+		hash ^= (unsigned char)text[i];
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+static char *store_name(const char *text, size_t length) {
+	string_chunk *chunk = table.chunks;
+
+	if (!chunk || chunk->size - chunk->used < length + 1) {
+		size_t size = length + 1 > STRING_CHUNK_SIZE ? length + 1 : STRING_CHUNK_SIZE;
+		chunk = mem_alloc(sizeof(string_chunk) + size);
+		if (!chunk) {
+			fprintf(stderr, "Memory allocate failed at %s:%d", __FILE__, __LINE__);
+			return NULL;
+		}
+		chunk->next = table.chunks;
+		chunk->used = 0;
+		chunk->size = size;
+		table.chunks = chunk;
+	}
+
+	char *name = chunk->data + chunk->used;
+	memcpy(name, text, length);
+	name[length] = '\0';
+	chunk->used += length + 1;
+	return name;
+}
+
+static int grow_buckets(void) {
+	uint32_t bucket_count = table.bucket_count ? table.bucket_count * 2 : INITIAL_BUCKETS;
+	uint32_t *buckets = mem_calloc(bucket_count, sizeof(uint32_t));
+	if (!buckets) {
+		fprintf(stderr, "Memory allocate failed at %s:%d", __FILE__, __LINE__);
+		return 0;
+	}
+
+	for (uint32_t id = 0; id < table.count; id++) {
+		uint32_t slot = entry_at(id)->hash & (bucket_count - 1);
+		while (buckets[slot]) slot = (slot + 1) & (bucket_count - 1);
+		buckets[slot] = id + 1;
+	}
+
+	mem_free(table.buckets);
+	table.buckets = buckets;
+	table.bucket_count = bucket_count;
+	return 1;
+}
+
+static symbol_id intern_locked(const char *text, size_t length, uint32_t hash) {
+	// Keep the load factor under one half
+	if ((table.count + 1) * 2 > table.bucket_count && !grow_buckets()) {
+		return SYMBOL_INVALID;
+	}
+
+	uint32_t mask = table.bucket_count - 1;
+	uint32_t slot = hash & mask;
+
+	while (table.buckets[slot]) {
+		symbol_entry *entry = entry_at(table.buckets[slot] - 1);
+		if (entry->hash == hash && entry->length == length && memcmp(entry->name, text, length) == 0) {
+			return table.buckets[slot] - 1;
+		}
+		slot = (slot + 1) & mask;
+	}
+
+	symbol_id id = table.count;
+	if (id == ENTRY_PAGE_COUNT * ENTRY_PAGE_SIZE - 1) return SYMBOL_INVALID;
+
+	symbol_entry **page = &table.pages[id >> ENTRY_PAGE_BITS];
+	if (!*page) {
+		*page = mem_alloc(ENTRY_PAGE_SIZE * sizeof(symbol_entry));
+		if (!*page) {
+			fprintf(stderr, "Memory allocate failed at %s:%d", __FILE__, __LINE__);
+			return SYMBOL_INVALID;
+		}
+	}
+
+	const char *name = store_name(text, length);
+	if (!name) return SYMBOL_INVALID;
+
+	symbol_entry *entry = entry_at(id);
+	entry->name = name;
+	entry->length = (uint32_t)length;
+	entry->hash = hash;
+	table.buckets[slot] = id + 1;
+	__atomic_store_n(&table.count, id + 1, __ATOMIC_RELEASE);
+	return id;
+}
+
+symbol_id symbol_intern(const char *text, size_t length) {
+	uint32_t hash = hash_name(text, length);
+	uint32_t generation = __atomic_load_n(&table.generation, __ATOMIC_ACQUIRE);
+
+	// Interned names never move, so a cached one can be compared without the lock
+	cache_entry *cached = &cache[hash & (CACHE_SIZE - 1)];
+	if (cached->name && cached->generation == generation && cached->hash == hash
+		&& cached->length == length && memcmp(cached->name, text, length) == 0) {
+		return cached->id;
+	}
+
+	pthread_mutex_lock(&table_lock);
+	symbol_id id = intern_locked(text, length, hash);
+	pthread_mutex_unlock(&table_lock);
+
+	if (id != SYMBOL_INVALID) {
+		cached->name = entry_at(id)->name;
+		cached->length = (uint32_t)length;
+		cached->hash = hash;
+		cached->id = id;
+		cached->generation = generation;
+	}
+	return id;
+}
+
+const char *symbol_name(symbol_id id) {
+	if (id >= __atomic_load_n(&table.count, __ATOMIC_ACQUIRE)) return "<invalid>";
+	return entry_at(id)->name;
+}
+
+size_t symbol_length(symbol_id id) {
+	if (id >= __atomic_load_n(&table.count, __ATOMIC_ACQUIRE)) return 0;
+	return entry_at(id)->length;
+}
+
+uint32_t symbol_count(void) {
+	return __atomic_load_n(&table.count, __ATOMIC_ACQUIRE);
+}
+
+void symbol_table_free(void) {
+	string_chunk *chunk = table.chunks;
+	while (chunk) {
+		string_chunk *next = chunk->next;
+		mem_free(chunk);
+		chunk = next;
+	}
+
+	for (uint32_t page = 0; page < ENTRY_PAGE_COUNT && table.pages[page]; page++) {
+		mem_free(table.pages[page]);
+	}
+	mem_free(table.buckets);
+
+	uint32_t generation = table.generation + 1;
+	memset(&table, 0, sizeof(table));
+	__atomic_store_n(&table.generation, generation, __ATOMIC_RELEASE);
+}
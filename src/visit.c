@@ -0,0 +1,78 @@
+/*
+ *
+ *		visit.c
+ *		LUMEN LANGUAGE PROJECT
+ *		Rainy101112 - 2025/7/20
+ *
+ */
+
+#include <visit.h>
+#include <mem.h>
+#include <stdio.h>
+#include <string.h>
+
+// Frames kept on the C stack before the walk moves to the heap
+#define VISIT_STACK_INLINE 64
+
+typedef struct {
+	ast_node *node;
+	ast_visit_position at;
+
+	// Next child to walk into, and the node's child count (next = children once skipped)
+	int next;
+	int children;
+} visit_frame;
+
+int ast_visit(ast_node *root, const ast_visitor *visitor, void *context) {
+	if (!root) return 1;
+
+	visit_frame inline_frames[VISIT_STACK_INLINE];
+	visit_frame *frames = inline_frames;
+	uint32_t count = 0, capacity = VISIT_STACK_INLINE;
+	int complete = 1;
+
+	ast_node *node = root;
+	ast_visit_position at = { NULL, 0, 0 };
+	for (;;) {
+		if (node) {
+			ast_visit_action action = visitor->enter ? visitor->enter(node, &at, context) : AST_VISIT_CONTINUE;
+			if (action == AST_VISIT_STOP) {
+				complete = 0;
+				break;
+			}
+
+			if (count == capacity) {
+				visit_frame *grown = mem_alloc(2 * capacity * sizeof(visit_frame));
+				if (!grown) {
+					fprintf(stderr, "Memory allocate failed at %s:%d", __FILE__, __LINE__);
+					complete = 0;
+					break;
+				}
+				memcpy(grown, frames, count * sizeof(visit_frame));
+				if (frames != inline_frames) mem_free(frames);
+				frames = grown;
+				capacity *= 2;
+			}
+			int children = ast_child_count(node);
+			frames[count++] = (visit_frame){ node, at, action == AST_VISIT_SKIP ? children : 0, children };
+		}
+
+		// Pop finished frames until one has a child left, then step into it
+		node = NULL;
+		while (count) {
+			visit_frame *top = &frames[count - 1];
+			if (top->next < top->children) {
+				at = (ast_visit_position){ top->node, top->next, top->at.depth + 1 };
+				node = ast_child(top->node, top->next++);
+				break;
+			}
+
+			count--;
+			if (visitor->leave) visitor->leave(top->node, &top->at, context);
+		}
+		if (!count) break;
+	}
+
+	if (frames != inline_frames) mem_free(frames);
+	return complete;
+}
@@ -0,0 +1,570 @@
+/*
+ *
+ *		vm.c
+ *		LUMEN LANGUAGE PROJECT
+ *		Rainy101112 - 2025/7/20
+ *
+ */
+
+#include <vm.h>
+#include <diag.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__GNUC__) || defined(__clang__)
+#define VM_COMPUTED_GOTO 1
+#endif
+
+vm_t *vm_create(const chunk_t *chunk) {
+	vm_t *vm = malloc(sizeof(vm_t));
+	if (!vm) {
+		fprintf(stderr, "Memory allocate failed at %s:%d", __FILE__, __LINE__);
+		return NULL;
+	}
+
+	vm->chunk = chunk;
+	vm->registers = calloc(chunk->register_count ? chunk->register_count : 1, sizeof(double));
+	if (!vm->registers) {
+		fprintf(stderr, "Memory allocate failed at %s:%d", __FILE__, __LINE__);
+		free(vm);
+		return NULL;
+	}
+
+	vm->arrays = array_heap_create();
+	if (!vm->arrays) {
+		free(vm->registers);
+		free(vm);
+		return NULL;
+	}
+
+	vm->jit = NULL;
+	vm->pool = NULL;
+	vm->parallel = NULL;
+	if (chunk->constant_count) memcpy(vm->registers + chunk->constant_base, chunk->constants, chunk->constant_count * sizeof(double));
+	return vm;
+}
+
+// Run state for parallel loops, made on the first vm_run with a pool
+typedef struct vm_parallel {
+	// Indexed by pc: loop index + 1 at each parallel loop's entry, 0 elsewhere
+	uint32_t *loop_at;
+
+	// Per loop, built on first use: the chunk's code with HALT at the loop exit
+	instruction_t **halted;
+
+	// Per pool worker, created on first use when the VM has a JIT
+	jit_t **jits;
+	unsigned worker_count;
+
+	// VM_SLICES register files, and whether each slice failed
+	double *files;
+	uint8_t *failed;
+} vm_parallel;
+
+typedef struct {
+	vm_t *vm;
+	const parallel_loop *loop;
+	const instruction_t *code;
+	const double *start;
+	double first;
+	uint64_t trips;
+	uint32_t slices;
+} parallel_run;
+
+static void parallel_destroy(vm_parallel *parallel, const chunk_t *chunk) {
+	if (!parallel) return;
+
+	for (uint32_t i = 0; parallel->halted && i < chunk->loop_count; i++) free(parallel->halted[i]);
+	for (unsigned w = 0; parallel->jits && w < parallel->worker_count; w++) jit_destroy(parallel->jits[w]);
+	free(parallel->loop_at);
+	free(parallel->halted);
+	free(parallel->jits);
+	free(parallel->files);
+	free(parallel->failed);
+	free(parallel);
+}
+
+static vm_parallel *parallel_create(vm_t *vm) {
+	const chunk_t *chunk = vm->chunk;
+	vm_parallel *parallel = calloc(1, sizeof(vm_parallel));
+	if (!parallel) {
+		fprintf(stderr, "Memory allocate failed at %s:%d", __FILE__, __LINE__);
+		return NULL;
+	}
+
+	parallel->worker_count = pool_thread_count(vm->pool);
+	parallel->loop_at = calloc(chunk->code_count, sizeof(uint32_t));
+	parallel->halted = calloc(chunk->loop_count, sizeof(instruction_t *));
+	parallel->jits = calloc(parallel->worker_count, sizeof(jit_t *));
+	parallel->files = malloc((size_t)VM_SLICES * (chunk->register_count ? chunk->register_count : 1) * sizeof(double));
+	parallel->failed = calloc(VM_SLICES, 1);
+	if (!parallel->loop_at || !parallel->halted || !parallel->jits || !parallel->files || !parallel->failed) {
+		fprintf(stderr, "Memory allocate failed at %s:%d", __FILE__, __LINE__);
+		parallel_destroy(parallel, chunk);
+		return NULL;
+	}
+
+	for (uint32_t i = 0; i < chunk->loop_count; i++) {
+		parallel->loop_at[chunk->loops[i].entry] = i + 1;
+
+		// Native code for an enclosing loop would run straight past the entry
+		if (vm->jit) jit_exclude(vm->jit, chunk->loops[i].entry);
+	}
+	return parallel;
+}
+
+void vm_destroy(vm_t *vm) {
+	if (!vm) return;
+
+	parallel_destroy(vm->parallel, vm->chunk);
+	array_heap_destroy(vm->arrays);
+	free(vm->registers);
+	free(vm);
+}
+
+static int loop_holds(uint32_t compare, double induction, double limit) {
+	switch (compare) {
+		case OP_LT: return induction < limit;
+		case OP_GT: return induction > limit;
+		case OP_LE: return induction <= limit;
+		default: return induction >= limit;
+	}
+}
+
+/*
+ * Iterations a parallel loop will run from first, when that is exact: first
+ * is an integer and every induction value up to the one that ends the loop
+ * is an integer below 2^53, so each slice can recompute its own start.
+ */
+static int count_trips(const parallel_loop *loop, double first, double limit, uint64_t *trips) {
+	const double exact = 9007199254740992.0;
+	double step = loop->step;
+	if (!(fabs(first) < exact) || first != floor(first) || !(fabs(limit) < exact)) return 0;
+
+	double n = 0.0;
+	if (loop_holds(loop->compare, first, limit)) {
+		n = (limit - first) / step;
+		n = loop->compare == OP_LT || loop->compare == OP_GT ? ceil(n) : floor(n) + 1.0;
+	}
+
+	// The division may round; settle on the exact count
+	while (n > 0.0 && !loop_holds(loop->compare, first + (n - 1.0) * step, limit)) n -= 1.0;
+	while (loop_holds(loop->compare, first + n * step, limit)) n += 1.0;
+
+	if (!(fabs(first + n * step) < exact)) return 0;
+	*trips = (uint64_t)n;
+	return 1;
+}
+
+static vm_status execute(vm_t *vm, const instruction_t *code, double *R, jit_t *jit, uint32_t pc, const uint32_t *loop_at, int report);
+
+static jit_t *worker_jit(vm_t *vm, unsigned worker) {
+	vm_parallel *parallel = vm->parallel;
+	if (!vm->jit || worker >= parallel->worker_count) return NULL;
+
+	if (!parallel->jits[worker]) parallel->jits[worker] = jit_create(vm->chunk);
+	return parallel->jits[worker];
+}
+
+static void run_slice(void *context, size_t index, unsigned worker) {
+	parallel_run *run = context;
+	const chunk_t *chunk = run->vm->chunk;
+	const parallel_loop *loop = run->loop;
+	double *R = run->vm->parallel->files + index * chunk->register_count;
+
+	uint64_t begin = run->trips * index / run->slices;
+	uint64_t end = run->trips * (index + 1) / run->slices;
+
+	memcpy(R, run->start, chunk->register_count * sizeof(double));
+	for (uint32_t r = 0; r < loop->reduction_count; r++) {
+		const loop_reduction *reduction = &chunk->reductions[loop->first_reduction + r];
+		R[reduction->reg] = reduction->kind == REDUCE_SUM ? -0.0 : 1.0;
+	}
+
+	// Inclusive tests stop one step before the next slice's first value
+	double last = loop->compare == OP_LE || loop->compare == OP_GE ? (double)(end - 1) : (double)end;
+	R[loop->induction] = run->first + (double)begin * loop->step;
+	R[loop->limit] = run->first + last * loop->step;
+
+	jit_t *jit = worker_jit(run->vm, worker);
+	run->vm->parallel->failed[index] = execute(run->vm, run->code, R, jit, loop->test, NULL, 0) != VM_OK;
+}
+
+// 1 when the loop ran on the pool and R holds its result, 0 to run it serially
+static int run_parallel(vm_t *vm, double *R, uint32_t index) {
+	const chunk_t *chunk = vm->chunk;
+	const parallel_loop *loop = &chunk->loops[index];
+	vm_parallel *parallel = vm->parallel;
+
+	// Most entries are of short inner loops; turn those away before counting exactly
+	double distance = fabs(R[loop->limit] - R[loop->induction]);
+	if (!(distance >= (2.0 * VM_SLICE_MIN - 1.0) * fabs((double)loop->step))) return 0;
+
+	uint64_t trips;
+	if (!count_trips(loop, R[loop->induction], R[loop->limit], &trips) || trips < 2 * VM_SLICE_MIN) return 0;
+
+	if (!parallel->halted[index]) {
+		instruction_t *halted = malloc(chunk->code_count * sizeof(instruction_t));
+		if (!halted) {
+			fprintf(stderr, "Memory allocate failed at %s:%d", __FILE__, __LINE__);
+			return 0;
+		}
+		memcpy(halted, chunk->code, chunk->code_count * sizeof(instruction_t));
+		halted[loop->exit] = (instruction_t){ .op = OP_HALT };
+		parallel->halted[index] = halted;
+	}
+
+	parallel_run run = {
+		.vm = vm,
+		.loop = loop,
+		.code = parallel->halted[index],
+		.start = R,
+		.first = R[loop->induction],
+		.trips = trips,
+		.slices = trips / VM_SLICE_MIN < VM_SLICES ? (uint32_t)(trips / VM_SLICE_MIN) : VM_SLICES
+	};
+	pool_run(vm->pool, run.slices, run_slice, &run);
+
+	// R is untouched until the merge, so the serial run starts over and reports the error itself
+	for (uint32_t k = 0; k < run.slices; k++) {
+		if (parallel->failed[k]) return 0;
+	}
+
+	// Reductions fold in slice order onto their value before the loop
+	double *last = parallel->files + (size_t)(run.slices - 1) * chunk->register_count;
+	for (uint32_t r = 0; r < loop->reduction_count; r++) {
+		const loop_reduction *reduction = &chunk->reductions[loop->first_reduction + r];
+		double value = R[reduction->reg];
+		for (uint32_t k = 0; k < run.slices; k++) {
+			double partial = parallel->files[(size_t)k * chunk->register_count + reduction->reg];
+			value = reduction->kind == REDUCE_SUM ? value + partial : value * partial;
+		}
+		last[reduction->reg] = value;
+	}
+
+	// Everything else, the induction variable included, is what the last iteration left
+	memcpy(R, last, chunk->variable_count * sizeof(double));
+	return 1;
+}
+
+#ifdef VM_COMPUTED_GOTO
+#define VM_DISPATCH()	goto *dispatch_table[ip->op]
+#define VM_CASE(op)		label_##op
+#else
+#define VM_DISPATCH()	goto dispatch
+#define VM_CASE(op)		case op
+#endif
+
+#define VM_NEXT()		do { ip++; VM_DISPATCH(); } while (0)
+
+// A taken jump to target; backward jumps close a loop and may enter native code
+#define VM_JUMP(target)	do { \
+		const instruction_t *next = code + (target); \
+		if (next <= ip && jit) { \
+			jit_entry entry = jit_back_edge(jit, (uint32_t)(next - code), (uint32_t)(ip - code)); \
+			if (entry) next = code + entry(R); \
+		} \
+		ip = next; \
+		VM_DISPATCH(); \
+	} while (0)
+
+vm_status vm_run(vm_t *vm) {
+	const uint32_t *loop_at = NULL;
+	if (vm->pool && vm->chunk->loop_count) {
+		if (!vm->parallel) vm->parallel = parallel_create(vm);
+		if (vm->parallel) loop_at = vm->parallel->loop_at;
+	}
+	return execute(vm, vm->chunk->code, vm->registers, vm->jit, 0, loop_at, 1);
+}
+
+void vm_print_value(const vm_t *vm, double value, FILE *out) {
+	const array_t *array = array_lookup(vm->arrays, value);
+	if (!array) {
+		fprintf(out, "%.17g", value);
+		return;
+	}
+
+	fputc('[', out);
+	for (uint64_t i = 0; i < array->length; i++) fprintf(out, i ? ", %.17g" : "%.17g", array->items[i]);
+	fputc(']', out);
+}
+
+/*
+ * The array instructions. Errors are only reported when report is set;
+ * slices run quietly, since a failed slice makes the loop run again
+ * serially and that run reports the first error in program order.
+ */
+
+// Collects first when due; the heap is the main thread's, so only the VM's own registers may build arrays
+static array_t *new_array(vm_t *vm, const double *R, uint64_t length, double *handle, int report) {
+	if (R != vm->registers) {
+		if (report) diag_report(DIAG_ERROR, "Runtime error: arrays cannot be built in a parallel loop\n");
+		return NULL;
+	}
+	if (array_heap_should_collect(vm->arrays)) array_heap_collect(vm->arrays, R, vm->chunk->register_count);
+	return array_alloc(vm->arrays, length, handle);
+}
+
+static const array_t *operand_array(vm_t *vm, double value, int report) {
+	const array_t *array = array_lookup(vm->arrays, value);
+	if (!array && report) diag_report(DIAG_ERROR, "Runtime error: %.17g is not an array\n", value);
+	return array;
+}
+
+static vm_status build_array(vm_t *vm, double *R, const instruction_t *ins, int report) {
+	double handle;
+	array_t *array = new_array(vm, R, ins->c, &handle, report);
+	if (!array) return VM_ERROR;
+
+	if (ins->c) memcpy(array->items, R + ins->b, ins->c * sizeof(double));
+	R[ins->a] = handle;
+	return VM_OK;
+}
+
+static vm_status fill_array(vm_t *vm, double *R, const instruction_t *ins, int report) {
+	double value = R[ins->b], count = R[ins->c];
+	if (!(count >= 0.0 && count <= (double)ARRAY_MAX_LENGTH) || count != floor(count)) {
+		if (report) diag_report(DIAG_ERROR, "Runtime error: array length %.17g is not a whole number from 0 to %u\n", count, ARRAY_MAX_LENGTH);
+		return VM_ERROR;
+	}
+
+	double handle;
+	array_t *array = new_array(vm, R, (uint64_t)count, &handle, report);
+	if (!array) return VM_ERROR;
+
+	for (uint64_t i = 0; i < array->length; i++) array->items[i] = value;
+	R[ins->a] = handle;
+	return VM_OK;
+}
+
+static vm_status index_array(vm_t *vm, double *R, const instruction_t *ins, int report) {
+	const array_t *array = operand_array(vm, R[ins->b], report);
+	if (!array) return VM_ERROR;
+
+	double index = R[ins->c];
+	if (!(index >= 0.0 && index < (double)array->length) || index != floor(index)) {
+		if (report) diag_report(DIAG_ERROR, "Runtime error: index %.17g is out of range for an array of length %llu\n", index, (unsigned long long)array->length);
+		return VM_ERROR;
+	}
+	R[ins->a] = array->items[(uint64_t)index];
+	return VM_OK;
+}
+
+static vm_status array_length(vm_t *vm, double *R, const instruction_t *ins, int report) {
+	const array_t *array = operand_array(vm, R[ins->b], report);
+	if (!array) return VM_ERROR;
+
+	R[ins->a] = (double)array->length;
+	return VM_OK;
+}
+
+// Either operand may be a number, which then applies to every element of the other
+static vm_status elementwise(vm_t *vm, double *R, const instruction_t *ins, array_op op, int report) {
+	double left_value = R[ins->b], right_value = R[ins->c];
+	const array_t *left = array_lookup(vm->arrays, left_value);
+	const array_t *right = array_lookup(vm->arrays, right_value);
+	if (!left && !right) {
+		operand_array(vm, left_value, report);
+		return VM_ERROR;
+	}
+	if (left && right && left->length != right->length) {
+		if (report) diag_report(DIAG_ERROR, "Runtime error: arrays of lengths %llu and %llu do not match\n", (unsigned long long)left->length, (unsigned long long)right->length);
+		return VM_ERROR;
+	}
+
+	// Element storage stays put when the heap grows its table, and both operands are roots
+	uint64_t length = left ? left->length : right->length;
+	const double *left_items = left ? left->items : &left_value;
+	const double *right_items = right ? right->items : &right_value;
+
+	double handle;
+	array_t *out = new_array(vm, R, length, &handle, report);
+	if (!out) return VM_ERROR;
+
+	array_binary(op, out->items, left_items, !left, right_items, !right, (size_t)length);
+	R[ins->a] = handle;
+	return VM_OK;
+}
+
+static vm_status negate_array(vm_t *vm, double *R, const instruction_t *ins, int report) {
+	const array_t *in = operand_array(vm, R[ins->b], report);
+	if (!in) return VM_ERROR;
+
+	const double *items = in->items;
+	double handle;
+	array_t *out = new_array(vm, R, in->length, &handle, report);
+	if (!out) return VM_ERROR;
+
+	array_negate(out->items, items, (size_t)out->length);
+	R[ins->a] = handle;
+	return VM_OK;
+}
+
+// Runs code on the register file R from pc; loop_at is NULL where loops must not go parallel, report is 0 in slices
+static vm_status execute(vm_t *vm, const instruction_t *code, double *R, jit_t *jit, uint32_t pc, const uint32_t *loop_at, int report) {
+	const instruction_t *ip = code + pc;
+
+#ifdef VM_COMPUTED_GOTO
+	static const void *dispatch_table[OP_COUNT] = {
+		[OP_MOVE] = &&label_OP_MOVE,
+		[OP_ADD] = &&label_OP_ADD,
+		[OP_SUB] = &&label_OP_SUB,
+		[OP_MUL] = &&label_OP_MUL,
+		[OP_DIV] = &&label_OP_DIV,
+		[OP_LT] = &&label_OP_LT,
+		[OP_GT] = &&label_OP_GT,
+		[OP_LE] = &&label_OP_LE,
+		[OP_GE] = &&label_OP_GE,
+		[OP_EQ] = &&label_OP_EQ,
+		[OP_NE] = &&label_OP_NE,
+		[OP_AND] = &&label_OP_AND,
+		[OP_OR] = &&label_OP_OR,
+		[OP_NOT] = &&label_OP_NOT,
+		[OP_NEG] = &&label_OP_NEG,
+		[OP_ARRAY] = &&label_OP_ARRAY,
+		[OP_FILL] = &&label_OP_FILL,
+		[OP_INDEX] = &&label_OP_INDEX,
+		[OP_LEN] = &&label_OP_LEN,
+		[OP_VADD] = &&label_OP_VADD,
+		[OP_VSUB] = &&label_OP_VSUB,
+		[OP_VMUL] = &&label_OP_VMUL,
+		[OP_VDIV] = &&label_OP_VDIV,
+		[OP_VNEG] = &&label_OP_VNEG,
+		[OP_JMP] = &&label_OP_JMP,
+		[OP_JMPF] = &&label_OP_JMPF,
+		[OP_JMPT] = &&label_OP_JMPT,
+		[OP_HALT] = &&label_OP_HALT
+	};
+
+	VM_DISPATCH();
+#else
+dispatch:
+	switch (ip->op)
+#endif
+	{
+		VM_CASE(OP_MOVE):
+			R[ip->a] = R[ip->b];
+			VM_NEXT();
+
+		VM_CASE(OP_ADD):
+			R[ip->a] = R[ip->b] + R[ip->c];
+			VM_NEXT();
+
+		VM_CASE(OP_SUB):
+			R[ip->a] = R[ip->b] - R[ip->c];
+			VM_NEXT();
+
+		VM_CASE(OP_MUL):
+			R[ip->a] = R[ip->b] * R[ip->c];
+			VM_NEXT();
+
+		VM_CASE(OP_DIV):
+			R[ip->a] = R[ip->b] / R[ip->c];
+			VM_NEXT();
+
+		VM_CASE(OP_LT):
+			R[ip->a] = R[ip->b] < R[ip->c];
+			VM_NEXT();
+
+		VM_CASE(OP_GT):
+			R[ip->a] = R[ip->b] > R[ip->c];
+			VM_NEXT();
+
+		VM_CASE(OP_LE):
+			R[ip->a] = R[ip->b] <= R[ip->c];
+			VM_NEXT();
+
+		VM_CASE(OP_GE):
+			R[ip->a] = R[ip->b] >= R[ip->c];
+			VM_NEXT();
+
+		VM_CASE(OP_EQ):
+			R[ip->a] = R[ip->b] == R[ip->c];
+			VM_NEXT();
+
+		VM_CASE(OP_NE):
+			R[ip->a] = R[ip->b] != R[ip->c];
+			VM_NEXT();
+
+		VM_CASE(OP_AND):
+			R[ip->a] = R[ip->b] != 0.0 && R[ip->c] != 0.0;
+			VM_NEXT();
+
+		VM_CASE(OP_OR):
+			R[ip->a] = R[ip->b] != 0.0 || R[ip->c] != 0.0;
+			VM_NEXT();
+
+		VM_CASE(OP_NOT):
+			R[ip->a] = R[ip->b] == 0.0;
+			VM_NEXT();
+
+		VM_CASE(OP_NEG):
+			R[ip->a] = -R[ip->b];
+			VM_NEXT();
+
+		VM_CASE(OP_ARRAY):
+			if (build_array(vm, R, ip, report) != VM_OK) return VM_ERROR;
+			VM_NEXT();
+
+		VM_CASE(OP_FILL):
+			if (fill_array(vm, R, ip, report) != VM_OK) return VM_ERROR;
+			VM_NEXT();
+
+		VM_CASE(OP_INDEX):
+			if (index_array(vm, R, ip, report) != VM_OK) return VM_ERROR;
+			VM_NEXT();
+
+		VM_CASE(OP_LEN):
+			if (array_length(vm, R, ip, report) != VM_OK) return VM_ERROR;
+			VM_NEXT();
+
+		VM_CASE(OP_VADD):
+			if (elementwise(vm, R, ip, ARRAY_ADD, report) != VM_OK) return VM_ERROR;
+			VM_NEXT();
+
+		VM_CASE(OP_VSUB):
+			if (elementwise(vm, R, ip, ARRAY_SUB, report) != VM_OK) return VM_ERROR;
+			VM_NEXT();
+
+		VM_CASE(OP_VMUL):
+			if (elementwise(vm, R, ip, ARRAY_MUL, report) != VM_OK) return VM_ERROR;
+			VM_NEXT();
+
+		VM_CASE(OP_VDIV):
+			if (elementwise(vm, R, ip, ARRAY_DIV, report) != VM_OK) return VM_ERROR;
+			VM_NEXT();
+
+		VM_CASE(OP_VNEG):
+			if (negate_array(vm, R, ip, report) != VM_OK) return VM_ERROR;
+			VM_NEXT();
+
+		VM_CASE(OP_JMP):
+			if (loop_at && loop_at[ip - code]) {
+				uint32_t index = loop_at[ip - code] - 1;
+				if (run_parallel(vm, R, index)) {
+					ip = code + vm->chunk->loops[index].exit;
+					VM_DISPATCH();
+				}
+			}
+			VM_JUMP(ip->a);
+
+		VM_CASE(OP_JMPF):
+			if (R[ip->a] == 0.0) VM_JUMP(ip->b);
+			VM_NEXT();
+
+		VM_CASE(OP_JMPT):
+			if (R[ip->a] != 0.0) VM_JUMP(ip->b);
+			VM_NEXT();
+
+		VM_CASE(OP_HALT):
+			return VM_OK;
+
+#ifndef VM_COMPUTED_GOTO
+		default:
+			return VM_ERROR;
+#endif
+	}
+
+	return VM_ERROR;
+}
@@ -0,0 +1,92 @@
+#!/bin/sh
+#
+#		build_test.sh
+#		LUMEN LANGUAGE PROJECT
+#		Rainy101112 - 2025/7/20
+#
+# Differential check of lumen build against lumen run. Generates programs
+# whose expressions mix signed zeros, infinities, NaN and values near the
+# ends of the double range, builds each with the C compiler given, and
+# expects the executable to print exactly what run prints. Prints the
+# first differing program and exits 1 on a mismatch.
+#
+# Usage: test/build_test.sh [lumen binary] [C compiler] [programs] [seed]
+
+LUMEN=${1:-./lumen}
+CC=${2:-${CC:-cc}}
+PROGRAMS=${3:-40}
+SEED=${4:-1}
+WORK=$(mktemp -d "${TMPDIR:-/tmp}/lumen-build-test.XXXXXX") || exit 1
+trap 'rm -rf "$WORK"' EXIT
+export CC
+
+# Constant folding by the C compiler once turned this +0 into -0
+printf '%s' '{ b = 2; d = 3; c = (0 && d) * 1e300 - !b; }' > "$WORK/p0.lumen"
+
+awk -v programs="$PROGRAMS" -v seed="$SEED" -v dir="$WORK" '
+function pick(n) { return int(rand() * n) }
+function literal() {
+	split("0 -0 1 -1 2 0.5 3 1e300 -1e300 1e-300 0.1 7", pool, " ")
+	return pool[pick(12) + 1]
+}
+function expr(depth,    r) {
+	r = pick(10)
+	if (depth > 3 || r < 3) return r < 2 ? "v" pick(8) : literal()
+	if (r == 3) return "-" expr(depth + 1)
+	if (r == 4) return "!" expr(depth + 1)
+	if (r == 5) return "(" expr(depth + 1) " " (pick(2) ? "&&" : "||") " " expr(depth + 1) ")"
+	split("+ - * / < > <= >= == !=", ops, " ")
+	return "(" expr(depth + 1) " " ops[pick(10) + 1] " " expr(depth + 1) ")"
+}
+function statement(depth,    r, k) {
+	r = pick(12)
+	if (depth < 2 && r == 0) {
+		printf "if (%s) { %s } else { %s }\n", expr(1), statement(depth + 1), statement(depth + 1) > path
+		return ""
+	}
+	if (depth < 2 && r == 1) {
+		k = pick(8)
+		printf "for (i = 0; i < %d; i = i + 1) { v%d = v%d %s %s; }\n", 1 + pick(5), k, k, pick(2) ? "+" : "*", expr(1) > path
+		return ""
+	}
+	return "v" pick(8) " = " expr(0) ";"
+}
+BEGIN {
+	srand(seed)
+	for (p = 1; p <= programs; p++) {
+		path = sprintf("%s/p%d.lumen", dir, p)
+		printf "{\n" > path
+		for (v = 0; v < 8; v++) printf "v%d = %s;\n", v, literal() > path
+		for (s = 0; s < 24; s++) {
+			line = statement(0)
+			if (line != "") printf "%s\n", line > path
+		}
+		printf "}\n" > path
+		close(path)
+	}
+}'
+
+p=0
+while [ "$p" -le "$PROGRAMS" ]; do
+	source="$WORK/p$p.lumen"
+	if ! "$LUMEN" run "$source" > "$WORK/run.out" 2> "$WORK/err"; then
+		echo "build: run failed on program $p"
+		cat "$WORK/err" "$source"
+		exit 1
+	fi
+	if ! "$LUMEN" build -o "$WORK/program" "$source" 2> "$WORK/err"; then
+		echo "build: $CC failed on program $p"
+		cat "$WORK/err" "$source"
+		exit 1
+	fi
+	"$WORK/program" > "$WORK/build.out"
+	if ! cmp -s "$WORK/run.out" "$WORK/build.out"; then
+		echo "build: program $p prints differently when built with $CC"
+		cat "$source"
+		diff "$WORK/run.out" "$WORK/build.out"
+		exit 1
+	fi
+	p=$((p + 1))
+done
+
+echo "build: $((PROGRAMS + 1)) programs print the same built with $CC"
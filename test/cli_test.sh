@@ -0,0 +1,115 @@
+#!/bin/sh
+#
+#		cli_test.sh
+#		LUMEN LANGUAGE PROJECT
+#		Rainy101112 - 2025/7/20
+#
+# Regression checks on the lumen command line: exit statuses, and that the
+# diagnostics expected are printed. Prints one line per failed check and
+# exits 1 if there was any.
+#
+# Usage: test/cli_test.sh [lumen binary]
+
+LUMEN=${1:-./lumen}
+WORK=$(mktemp -d "${TMPDIR:-/tmp}/lumen-cli-test.XXXXXX") || exit 1
+trap 'rm -rf "$WORK"' EXIT
+FAILED=0
+
+fail() {
+	echo "cli: $*"
+	FAILED=1
+}
+
+# expect <status> <stderr pattern or ""> <command> <source text> [options...]
+expect() {
+	want=$1
+	pattern=$2
+	command=$3
+	printf '%s' "$4" > "$WORK/case.lumen"
+	shift 4
+
+	"$LUMEN" "$command" "$@" "$WORK/case.lumen" > "$WORK/out" 2> "$WORK/err"
+	status=$?
+	if [ "$status" -ne "$want" ]; then
+		fail "$command $* on '$(head -c 60 "$WORK/case.lumen")': exit status $status, expected $want"
+		sed 's/^/    /' "$WORK/err" | head -5
+	elif [ -n "$pattern" ] && ! grep -q -- "$pattern" "$WORK/err"; then
+		fail "$command $* on '$(head -c 60 "$WORK/case.lumen")': no '$pattern' on stderr"
+	fi
+}
+
+# Errors stop run and disasm, and every command reports them in its status
+for command in run disasm parse; do
+	expect 1 "Unexpected token" $command '{ x = ; y = 2; }'
+	expect 1 "Unexpected token" $command '{ y = 2; x = 1 +* 3; }'
+	expect 0 "" $command '{ y = 2; }'
+done
+expect 0 "may be used before assignment" run '{ y = z; }'
+expect 1 "Unexpected token" run '{ x = ; }' --cache-dir "$WORK/cache"
+expect 1 "Unexpected token" run '{ x = ; }' --cache-dir "$WORK/cache"
+expect 1 "Runtime error" run '{ a = [1]; x = a[1]; }'
+
+# A bare expression is only there for its array errors, so the optimizer must keep them
+expect 1 "out of range" run '{ a = [1, 2]; a[5]; }'
+expect 1 "do not match" run '{ [1, 2] + [1, 2, 3]; }'
+expect 1 "out of range" run '{ a = [1, 2]; for (i = 0; i < 1000; i = i + 1) { a[i]; } }' --jit
+expect 0 "" run '{ x = 1; x + 2; 1 / 0; }'
+
+# Operators count toward the nesting limit, so no pass after the parser recurses past it
+chain=$(awk 'BEGIN { printf "{ a = 1; x = a"; for (i = 0; i < 100000; i++) printf " + a"; printf "; }" }')
+nots=$(awk 'BEGIN { printf "{ a = 1; x = "; for (i = 0; i < 200000; i++) printf "!"; printf "a; }" }')
+indexes=$(awk 'BEGIN { printf "{ a = [1]; x = a"; for (i = 0; i < 100000; i++) printf "[0]"; printf "; }" }')
+limit=$(awk 'BEGIN { printf "{ a = 1; x = a"; for (i = 0; i < 1023; i++) printf " + a"; printf "; }" }')
+for source in "$chain" "$nots" "$indexes"; do
+	expect 1 "Nesting deeper than 1024 levels" run "$source"
+	expect 1 "Nesting deeper than 1024 levels" parse "$source" --optimize
+	expect 1 "Nesting deeper than 1024 levels" parse "$source" --flat
+	expect 1 "Nesting deeper than 1024 levels" disasm "$source"
+	expect 1 "Nesting deeper than 1024 levels" build "$source" --emit-c
+done
+expect 0 "" run "$limit"
+expect 0 "" build "$limit" --emit-c
+expect 1 "Nesting deeper than 8 levels" run '{ x = 1 + 2 + 3 + 4 + 5 + 6 + 7 + 8 + 9; }' --max-nesting 8
+
+# A warm cache applies the same limit: an entry stored under a higher one is not used
+deep=$(awk 'BEGIN { printf "{ a = 1; x = a"; for (i = 0; i < 2000; i++) printf " + a"; printf "; }" }')
+for command in run parse batch; do
+	expect 0 "" $command "$deep" --max-nesting 5000 --cache-dir "$WORK/deep-$command"
+	expect 1 "Nesting deeper than 1024 levels" $command "$deep" --cache-dir "$WORK/deep-$command"
+	expect 1 "Nesting deeper than 2000 levels" $command "$deep" --max-nesting 2000 --cache-dir "$WORK/deep-$command"
+	expect 0 "" $command "$deep" --max-nesting 2001 --cache-dir "$WORK/deep-$command"
+done
+
+# Batch workers storing the same entry at once each write their own temporary file.
+# Large entries keep the writes long enough to overlap even on one processor
+mkdir "$WORK/same"
+awk 'BEGIN { printf "{ a = 1; "; for (i = 0; i < 20000; i++) printf "v%d = %d + a * %d; ", i % 300, i, i; printf "}" }' > "$WORK/same/f0.lumen"
+for i in 1 2 3 4 5 6 7; do
+	cp "$WORK/same/f0.lumen" "$WORK/same/f$i.lumen"
+done
+for round in 1 2 3; do
+	rm -rf "$WORK/same-cache"
+	if ! "$LUMEN" batch -j 8 --compile --cache-dir "$WORK/same-cache" "$WORK/same"/*.lumen > /dev/null 2> "$WORK/err" \
+		|| grep -q "Cannot write cache" "$WORK/err" || [ "$(ls "$WORK/same-cache" | wc -l)" -ne 1 ]; then
+		fail "batch of identical files into one cache: $(head -1 "$WORK/err")"
+		break
+	fi
+done
+
+# A cache entry whose root block lists itself as a child is rejected, not walked forever.
+# The offset of the first column is the header field at byte 136
+printf '%s' '{ x = 1 + 2; }' > "$WORK/cycle.lumen"
+"$LUMEN" parse --flat --cache-dir "$WORK/cycle" "$WORK/cycle.lumen" > "$WORK/expected" 2>&1
+entry=$(ls "$WORK/cycle"/*.lumenc)
+first=$(od -An -tu8 -j136 -N8 "$entry" | tr -d ' ')
+printf '\000\000\000\000' | dd of="$entry" bs=1 seek="$first" conv=notrunc 2> /dev/null
+timeout 10 "$LUMEN" parse --flat --cache-dir "$WORK/cycle" "$WORK/cycle.lumen" > "$WORK/out" 2>&1
+status=$?
+if [ "$status" -ne 0 ] || ! cmp -s "$WORK/expected" "$WORK/out"; then
+	fail "parse --flat on a cache entry with a cycle: exit status $status"
+fi
+
+if [ "$FAILED" -eq 0 ]; then
+	echo "cli: all checks passed"
+fi
+exit $FAILED
@@ -0,0 +1,391 @@
+/*
+ *
+ *		jit_test.c
+ *		LUMEN LANGUAGE PROJECT
+ *		Rainy101112 - 2025/7/20
+ *
+ */
+
+/*
+ * Execution checks, run by `make test`. Every program is compiled once and
+ * run three ways:
+ *
+ *   serial     the interpreter alone
+ *   jit        the interpreter with the loop JIT, which must leave every
+ *              variable bit for bit as the serial run did
+ *   parallel   the JIT and a thread pool, compared the same way for
+ *              programs whose parallel loops add up exact integers, so
+ *              that combining slices cannot round differently
+ *
+ * The fixed cases cover break and continue, NaN and -0 in conditions and
+ * loops keeping more variables live than the JIT has SSE registers for;
+ * each must get at least one loop compiled. Random programs follow.
+ * Exits 1 after printing the first mismatch.
+ *
+ * Usage: jit_test [--seed n] [--programs n]
+ */
+
+#include <arena.h>
+#include <ast.h>
+#include <bytecode.h>
+#include <compiler.h>
+#include <diag.h>
+#include <jit.h>
+#include <optimize.h>
+#include <pool.h>
+#include <resolve.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <symbol.h>
+#include <vm.h>
+
+typedef struct {
+	const char *name;
+	const char *source;
+	int exact;		// parallel loops only add up integers, so --parallel must match too
+	uint32_t loops;	// parallel loops the compiler must find at least
+} fixed_case;
+
+static const fixed_case fixed_cases[] = {
+	{ "break and continue",
+		"{ s = 0; k = 0; t = 0;"
+		"  for (i = 0; i < 5000; i = i + 1) {"
+		"    k = k + 1; if (k == 3) { k = 0; continue; }"
+		"    if (i > 4000) { break; }"
+		"    s = s + i;"
+		"  }"
+		"  j = 0;"
+		"  while (1) { j = j + 1; if (j < 200) { continue; } t = t + j; if (j >= 900) { break; } }"
+		"  for (a = 0; a < 100; a = a + 1) { for (b = 0; b < 100; b = b + 1) { if (b > a) { break; } if (b == 5) { continue; } t = t + b; } }"
+		"}", 1, 1 },
+	{ "NaN and -0 conditions",
+		"{ n = 0 / 0; z = 0 * -1; a = 0; b = 0; c = 0; d = 0; f = 0; g = 0; h = 0; y = 0;"
+		"  for (i = 0; i < 300; i = i + 1) {"
+		"    if (n) { a = a + 1; } if (n < 1) { b = b + 1; } if (n >= 1) { b = b - 1; }"
+		"    if (n > 1) { } else { c = c + 1; } if (1 <= n) { c = c - 1; }"
+		"    if (z) { f = f + 1; } if (z < 0) { g = g + 1; } if (z <= 0) { h = h + 1; }"
+		"    y = y + n * 0 + z;"
+		"    w = 0; while (n > 0) { w = w + 1; } while (z) { w = w - 1; }"
+		"    if (i + n) { d = d + 1; }"
+		"  }"
+		"  for (i = 0; i < 300; i = i + 1) {"
+		"    x = (n && i) + (z || n) * 2 + (n || 0) * 4 + (z && 1) * 8 + (n != n) * 16 + (n == n) * 32 + !n * 64 + !z * 128;"
+		"  }"
+		"  e = n; j = 0; while (e) { j = j + 1; if (j > 300) { e = 0; } }"
+		"  o = z; k = 0; while (o) { k = k + 1; } while (k < 300) { k = k + 1; if (k - 150) { } else { o = n; } }"
+		"  m = -z; q = 1 / z; r = 1 / m;"
+		"}", 0, 0 },
+	{ "more live variables than SSE registers",
+		"{ a = 1; b = 2; c = 3; d = 4; e = 5; f = 6; g = 7; h = 8; j = 9; k = 10;"
+		"  l = 11; m = 12; n = 13; o = 14; p = 15; q = 16; r = 17; s = 18; t = 19; u = 20;"
+		"  for (i = 0; i < 400; i = i + 1) {"
+		"    a = b + 1; b = c - 2; c = d * 0.5; d = e / 3; e = f + a; f = g - b; g = h * 0.25; h = j + c;"
+		"    j = k - d; k = l + e; l = m * 0.5; m = n - f; n = o + g; o = p / 7; p = q + h; q = r - j;"
+		"    r = s + k; s = t - l; t = u * 0.75; u = a + b + c + d + e + f + g + h + j + k + l + m + n + o + p + q + r + s + t;"
+		"    if (u > 1000) { u = u / 1000; } if (u < -1000) { u = u / 1000; }"
+		"  }"
+		"}", 0, 0 },
+	{ "parallel sums, products and privates",
+		"{ s = 0; p = 1; q = 1; t = 0; c = 0; n = 6000;"
+		"  for (i = 0; i < n; i = i + 1) { t = i * 3 - 7; s = s + (t * (i < 3000) + (i == 4096)); p = p * -1; q = q * (1 + (i == 77)); c = c + (t > 100 && i < 5000); }"
+		"  for (i = n; i > 0; i = i - 2) { s = s - i; }"
+		"  u = 0; for (i = 0; i <= 9000; i = i + 3) { if (i > 50) { u = u + 1; } else { u = u + 2; } }"
+		"}", 1, 3 }
+};
+
+#define FIXED_COUNT (sizeof(fixed_cases) / sizeof(fixed_cases[0]))
+
+static uint64_t rng_state = 0x2545F4914F6CDD1Du;
+
+static uint32_t next_random(void) {
+	rng_state ^= rng_state << 13;
+	rng_state ^= rng_state >> 7;
+	rng_state ^= rng_state << 17;
+	return (uint32_t)(rng_state >> 16);
+}
+
+typedef struct {
+	char *text;
+	size_t length;
+	size_t capacity;
+} text_buffer;
+
+static void append(text_buffer *buffer, const char *format, ...) {
+	va_list args;
+	va_start(args, format);
+	int length = vsnprintf(NULL, 0, format, args);
+	va_end(args);
+
+	if (buffer->length + (size_t)length + 1 > buffer->capacity) {
+		size_t capacity = buffer->capacity ? buffer->capacity : 1024;
+		while (capacity < buffer->length + (size_t)length + 1) capacity *= 2;
+		char *text = realloc(buffer->text, capacity);
+		if (!text) {
+			fprintf(stderr, "Memory allocate failed at %s:%d", __FILE__, __LINE__);
+			exit(1);
+		}
+		buffer->text = text;
+		buffer->capacity = capacity;
+	}
+
+	va_start(args, format);
+	vsnprintf(buffer->text + buffer->length, (size_t)length + 1, format, args);
+	va_end(args);
+	buffer->length += (size_t)length;
+}
+
+/*
+ * Random programs over 20 variables, more than the JIT keeps in registers.
+ * Loops use their own induction variable per depth and bounded trip
+ * counts, so every program ends; conditions reach break and continue.
+ */
+
+static const char *const variables[] = {
+	"a", "b", "c", "d", "e", "f", "g", "h", "j", "k",
+	"l", "m", "n", "o", "p", "q", "r", "s", "t", "u"
+};
+
+#define VARIABLE_COUNT (sizeof(variables) / sizeof(variables[0]))
+
+static const char *const binary_operators[] = { "+", "-", "*", "/", "<", ">", "<=", ">=", "==", "!=", "&&", "||" };
+
+static void random_expression(text_buffer *out, int depth, const char *induction) {
+	uint32_t pick = next_random() % 10;
+	if (depth > 2 || pick < 3) {
+		switch (next_random() % 5) {
+			case 0: append(out, "%u", next_random() % 10); break;
+			case 1: append(out, "0.%02u", next_random() % 100); break;
+			case 2: append(out, "%s", induction ? induction : "0"); break;
+			default: append(out, "%s", variables[next_random() % VARIABLE_COUNT]); break;
+		}
+		return;
+	}
+	if (pick == 3) {
+		append(out, "%s(", (next_random() & 1) ? "-" : "!");
+		random_expression(out, depth + 1, induction);
+		append(out, ")");
+		return;
+	}
+	append(out, "(");
+	random_expression(out, depth + 1, induction);
+	append(out, " %s ", binary_operators[next_random() % (sizeof(binary_operators) / sizeof(binary_operators[0]))]);
+	random_expression(out, depth + 1, induction);
+	append(out, ")");
+}
+
+static void random_statement(text_buffer *out, int depth, const char *induction) {
+	static const char *const inductions[] = { "i", "w", "x", "y", "z" };
+	uint32_t pick = next_random() % 20;
+
+	if (depth < 3 && pick < 4) {
+		const char *i = inductions[depth];
+		append(out, "for (%s = 0; %s < %u; %s = %s + %u) { ", i, i, next_random() % 120, i, i, 1 + next_random() % 2);
+		for (uint32_t n = 1 + next_random() % 4; n; n--) random_statement(out, depth + 1, i);
+		append(out, "} ");
+	} else if (depth < 3 && pick < 5) {
+		// A while loop with a counter of its own, so it always ends
+		const char *i = inductions[depth];
+		append(out, "%s = 0; while (%s < %u) { %s = %s + 1; ", i, i, next_random() % 100, i, i);
+		for (uint32_t n = 1 + next_random() % 3; n; n--) random_statement(out, depth + 1, i);
+		append(out, "} ");
+	} else if (depth < 3 && pick < 7) {
+		append(out, "if (");
+		random_expression(out, 0, induction);
+		append(out, ") { ");
+		random_statement(out, depth + 1, induction);
+		append(out, "} else { ");
+		random_statement(out, depth + 1, induction);
+		append(out, "} ");
+	} else if (induction && pick < 9) {
+		append(out, "if (");
+		random_expression(out, 1, induction);
+		append(out, ") { %s; } ", pick == 7 ? "break" : "continue");
+	} else {
+		append(out, "%s = ", variables[next_random() % VARIABLE_COUNT]);
+		random_expression(out, 0, induction);
+		append(out, "; ");
+	}
+}
+
+static void random_program(text_buffer *out) {
+	out->length = 0;
+	append(out, "{ ");
+	for (uint32_t n = 4 + next_random() % 10; n; n--) random_statement(out, 0, NULL);
+	append(out, "}");
+}
+
+/*
+ * Programs for --parallel: long counted loops whose sums only ever add
+ * integers well inside 2^53 and whose products are of -1 and 1, so any
+ * order of combining slices gives the same bits.
+ */
+static void random_parallel_program(text_buffer *out) {
+	out->length = 0;
+	append(out, "{ s = 0; p = 1; r = 0; k = %u; ", next_random() % 50);
+	for (uint32_t n = 1 + next_random() % 3; n; n--) {
+		uint32_t step = 1 + next_random() % 3;
+		int down = next_random() % 4 == 0;
+		if (down) {
+			append(out, "for (i = %u; i > %d; i = i - %u) { ", 2048 + next_random() % 6000, (int)(next_random() % 20) - 10, step);
+		} else {
+			append(out, "for (i = %d; i %s %u; i = i + %u) { ", (int)(next_random() % 20) - 10, (next_random() & 1) ? "<" : "<=", 2048 + next_random() % 6000, step);
+		}
+		if (next_random() & 1) append(out, "t = i * %u - k; s = s + t * (t > %u); ", next_random() % 9, next_random() % 500);
+		else append(out, "s = s + ((i < %u) * i - (i == k)); ", next_random() % 8000);
+		if (next_random() & 1) append(out, "p = p * ((i > %u) * 2 - 1); ", next_random() % 8000);
+		if (next_random() & 1) append(out, "r = r - (i >= k && i < %u); ", next_random() % 8000);
+		if (next_random() % 5 == 0) append(out, "if (i == %u) { break; } ", 3000 + next_random() % 3000);
+		append(out, "} ");
+	}
+	append(out, "}");
+}
+
+static chunk_t *compile_text(const char *text) {
+	diag_buffer messages = { 0 };
+	diag_buffer *previous = diag_capture(&messages);
+
+	arena_t *arena = arena_create(0);
+	ast_node *program = parse(text, arena);
+	chunk_t *chunk = NULL;
+	if (program && !messages.error_count) {
+		optimize_ast(program, arena);
+		resolve_result scope;
+		if (resolve_ast(program, &scope) == 0) {
+			chunk = compile_program(program, &scope);
+			resolve_result_free(&scope);
+		}
+	}
+	arena_destroy(arena);
+
+	diag_capture(previous);
+	if (messages.error_count) {
+		fwrite(messages.text, 1, messages.length, stdout);
+		chunk_free(chunk);
+		chunk = NULL;
+	}
+	diag_buffer_free(&messages);
+	return chunk;
+}
+
+typedef struct {
+	vm_status status;
+	double *values;			// chunk->variable_count of them
+	uint32_t compiled_loops;
+} outcome;
+
+static outcome run_chunk(const chunk_t *chunk, int use_jit, pool_t *pool) {
+	outcome result = { VM_ERROR, calloc(chunk->variable_count + 1, sizeof(double)), 0 };
+	vm_t *vm = vm_create(chunk);
+	if (!vm || !result.values) {
+		fprintf(stderr, "Memory allocate failed at %s:%d", __FILE__, __LINE__);
+		exit(1);
+	}
+	if (use_jit) vm->jit = jit_create(chunk);
+	vm->pool = pool;
+
+	result.status = vm_run(vm);
+	memcpy(result.values, vm->registers, chunk->variable_count * sizeof(double));
+	if (vm->jit) result.compiled_loops = jit_compiled_loops(vm->jit);
+
+	jit_destroy(vm->jit);
+	vm_destroy(vm);
+	return result;
+}
+
+// 1 if both runs ended the same way with the same bits in every variable
+static int same_outcome(const chunk_t *chunk, const outcome *expected, const outcome *actual, const char *mode, const char *source) {
+	if (expected->status == actual->status
+		&& memcmp(expected->values, actual->values, chunk->variable_count * sizeof(double)) == 0) return 1;
+
+	printf("%s run differs from the serial one for:\n%s\n", mode, source);
+	if (expected->status != actual->status) printf("  status %d, serial %d\n", actual->status, expected->status);
+	for (uint32_t i = 0; i < chunk->variable_count; i++) {
+		if (memcmp(&expected->values[i], &actual->values[i], sizeof(double)) == 0) continue;
+		printf("  %s = %.17g, serial %.17g\n", symbol_name(chunk->variables[i]), actual->values[i], expected->values[i]);
+	}
+	return 0;
+}
+
+// Runs source all three ways; a fixed case also fails when the JIT compiled nothing or its loops were not found
+static int check_program(const char *source, int exact, const fixed_case *fixed, pool_t *pool, uint32_t *compiled_loops, uint32_t *parallel_loops) {
+	chunk_t *chunk = compile_text(source);
+	if (!chunk) {
+		printf("could not compile:\n%s\n", source);
+		return 0;
+	}
+	if (fixed && chunk->loop_count < fixed->loops) {
+		printf("%u parallel loops found, expected %u or more, in:\n%s\n", chunk->loop_count, fixed->loops, source);
+		chunk_free(chunk);
+		return 0;
+	}
+
+	outcome serial = run_chunk(chunk, 0, NULL);
+	outcome jitted = run_chunk(chunk, 1, NULL);
+	int ok = same_outcome(chunk, &serial, &jitted, "jit", source);
+	if (ok && fixed && !jitted.compiled_loops) {
+		printf("the JIT compiled no loop of:\n%s\n", source);
+		ok = 0;
+	}
+	*compiled_loops += jitted.compiled_loops;
+
+	if (ok && exact && pool) {
+		*parallel_loops += chunk->loop_count;
+		outcome parallel = run_chunk(chunk, 1, pool);
+		ok = same_outcome(chunk, &serial, &parallel, "parallel", source);
+		free(parallel.values);
+	}
+
+	free(serial.values);
+	free(jitted.values);
+	chunk_free(chunk);
+	return ok;
+}
+
+int main(int argc, char **argv) {
+	uint32_t programs = 2000;
+
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+			rng_state = strtoull(argv[++i], NULL, 0) | 1;
+		} else if (strcmp(argv[i], "--programs") == 0 && i + 1 < argc) {
+			programs = (uint32_t)strtoul(argv[++i], NULL, 0);
+		} else {
+			fprintf(stderr, "Usage: %s [--seed n] [--programs n]\n", argv[0]);
+			return 2;
+		}
+	}
+
+	if (!jit_available()) {
+		printf("jit: not available on this platform, nothing to compare\n");
+		return 0;
+	}
+
+	pool_t *pool = pool_create(3);
+	if (!pool) fprintf(stderr, "Thread pool unavailable, skipping --parallel runs\n");
+
+	int ok = 1;
+	uint32_t compiled_loops = 0, parallel_loops = 0;
+	for (size_t i = 0; ok && i < FIXED_COUNT; i++) {
+		ok = check_program(fixed_cases[i].source, fixed_cases[i].exact, &fixed_cases[i], pool, &compiled_loops, &parallel_loops);
+		if (ok) printf("jit: %s\n", fixed_cases[i].name);
+	}
+
+	text_buffer source = { 0 };
+	for (uint32_t n = 0; ok && n < programs; n++) {
+		random_program(&source);
+		ok = check_program(source.text, 0, NULL, pool, &compiled_loops, &parallel_loops);
+	}
+	for (uint32_t n = 0; ok && n < programs / 10; n++) {
+		random_parallel_program(&source);
+		ok = check_program(source.text, 1, NULL, pool, &compiled_loops, &parallel_loops);
+	}
+	if (ok) printf("jit: %u random programs match, %u loops compiled, %u parallel loops\n", programs + programs / 10, compiled_loops, parallel_loops);
+
+	free(source.text);
+	pool_destroy(pool);
+	symbol_table_free();
+	return ok ? 0 : 1;
+}
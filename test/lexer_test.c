@@ -0,0 +1,391 @@
+/*
+ *
+ *		lexer_test.c
+ *		LUMEN LANGUAGE PROJECT
+ *		Rainy101112 - 2025/7/20
+ *
+ */
+
+/*
+ * Lexer checks, run by `make test`:
+ *
+ *   lexer    get_next_token against reference_next_token below, the lexer
+ *            as it was before the character-class DFA (ctype calls, an if
+ *            chain and a keyword table), with the tokens added since
+ *            written the same way. Both run over random inputs and must
+ *            agree on every token, every diagnostic and the final index.
+ *   scan     every SSE2 and AVX2 run scanner the CPU has against its
+ *            scalar version, from every offset of random buffers.
+ *
+ * scan.c is included rather than linked so its kernels can be called
+ * directly. Exits 1 after printing the first mismatch.
+ *
+ * Usage: lexer_test [--seed n] [--inputs n]
+ */
+
+#include <ctype.h>
+#include <diag.h>
+#include <lexer.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <token.h>
+
+#include "../src/scan.c"
+
+static uint64_t rng_state = 0x9E3779B97F4A7C15u;
+
+static uint32_t next_random(void) {
+	rng_state ^= rng_state << 13;
+	rng_state ^= rng_state >> 7;
+	rng_state ^= rng_state << 17;
+	return (uint32_t)(rng_state >> 16);
+}
+
+/*
+ * The reference lexer. Kept deliberately simple: it is the specification
+ * the table-driven lexer is held to, so it should stay obviously right
+ * rather than fast.
+ */
+
+static token_type_t reference_keyword(const char *text, size_t length) {
+	static const struct
+	{
+		const char *text;
+		token_type_t type;
+	} keywords[] = {
+		{"if", TOKEN_KEYWORD_IF},
+		{"else", TOKEN_KEYWORD_ELSE},
+		{"for", TOKEN_KEYWORD_FOR},
+		{"while", TOKEN_KEYWORD_WHILE},
+		{"break", TOKEN_KEYWORD_BREAK},
+		{"continue", TOKEN_KEYWORD_CONTINUE},
+		{"len", TOKEN_KEYWORD_LEN}
+	};
+
+	for (size_t i = 0; i < sizeof(keywords) / sizeof(keywords[0]); i++) {
+		if (strncmp(text, keywords[i].text, length) == 0 && keywords[i].text[length] == '\0') {
+			return keywords[i].type;
+		}
+	}
+
+	return TOKEN_IDENTIFIER;
+}
+
+static token_t reference_token(token_type_t type, size_t start, size_t length) {
+	token_t token = {
+		.type = type,
+		.start = start,
+		.length = length
+	};
+	return token;
+}
+
+static token_t reference_next_token(const char *source_code, size_t *index) {
+	for (;;) {
+		unsigned char c = (unsigned char)source_code[*index];
+
+		if (isspace(c)) {
+			(*index)++;
+			continue;
+		}
+
+		size_t start_index = *index;
+
+		if (c == '\0') return reference_token(TOKEN_END_OF_FILE, start_index, 0);
+
+		if (isdigit(c)) {
+			token_type_t type = TOKEN_INTEGER;
+			int malformed = 0;
+
+			while (isdigit((unsigned char)source_code[*index])) (*index)++;
+
+			if (source_code[*index] == '.') {
+				(*index)++;
+				if (!isdigit((unsigned char)source_code[*index])) malformed = 1;
+				while (isdigit((unsigned char)source_code[*index])) (*index)++;
+				type = TOKEN_FLOAT;
+			}
+
+			if (!malformed && (source_code[*index] == 'e' || source_code[*index] == 'E')) {
+				(*index)++;
+				if (source_code[*index] == '+' || source_code[*index] == '-') (*index)++;
+				if (!isdigit((unsigned char)source_code[*index])) malformed = 1;
+				while (isdigit((unsigned char)source_code[*index])) (*index)++;
+				type = TOKEN_FLOAT;
+			}
+
+			if (malformed) {
+				diag_report_at(DIAG_ERROR, start_index, "Malformed number: %.*s\n", (int)(*index - start_index), source_code + start_index);
+				continue;
+			}
+			return reference_token(type, start_index, *index - start_index);
+		}
+
+		if (isalpha(c) || c == '_') {
+			(*index)++;
+
+			while (isalnum((unsigned char)source_code[*index]) || source_code[*index] == '_') {
+				(*index)++;
+			}
+
+			size_t length = *index - start_index;
+			return reference_token(reference_keyword(source_code + start_index, length), start_index, length);
+		}
+
+		// Operators that may take a second character
+		if (c == '=' || c == '<' || c == '>' || c == '!') {
+			int pair = source_code[*index + 1] == '=';
+			token_type_t type;
+			switch (c) {
+				case '=': type = pair ? TOKEN_OPERATOR_EQUAL : TOKEN_ASSIGN; break;
+				case '<': type = pair ? TOKEN_OPERATOR_LESS_EQUAL : TOKEN_OPERATOR_LESS; break;
+				case '>': type = pair ? TOKEN_OPERATOR_GREATER_EQUAL : TOKEN_OPERATOR_GREATER; break;
+				default: type = pair ? TOKEN_OPERATOR_NOT_EQUAL : TOKEN_OPERATOR_NOT; break;
+			}
+			*index += pair ? 2 : 1;
+			return reference_token(type, start_index, *index - start_index);
+		}
+
+		if (c == '&' || c == '|') {
+			(*index)++;
+			if ((unsigned char)source_code[*index] == c) {
+				(*index)++;
+				return reference_token(c == '&' ? TOKEN_OPERATOR_AND : TOKEN_OPERATOR_OR, start_index, 2);
+			}
+			diag_report_at(DIAG_ERROR, start_index, "Unrecognized character: %c\n", source_code[start_index]);
+			continue;
+		}
+
+		token_type_t type;
+		switch (c) {
+			case '+': type = TOKEN_OPERATOR_PLUS; break;
+			case '-': type = TOKEN_OPERATOR_MINUS; break;
+			case '*': type = TOKEN_OPERATOR_MULTIPLY; break;
+			case '/': type = TOKEN_OPERATOR_DIVIDE; break;
+			case ';': type = TOKEN_SEMICOLON; break;
+			case '(': type = TOKEN_OPEN_PAREN; break;
+			case ')': type = TOKEN_CLOSE_PAREN; break;
+			case '{': type = TOKEN_OPEN_BRACE; break;
+			case '}': type = TOKEN_CLOSE_BRACE; break;
+			case '[': type = TOKEN_OPEN_BRACKET; break;
+			case ']': type = TOKEN_CLOSE_BRACKET; break;
+			case ',': type = TOKEN_COMMA; break;
+			case 0xFF: type = TOKEN_END_OF_FILE; break;
+			default:
+				diag_report_at(DIAG_ERROR, start_index, "Unrecognized character: %c\n", source_code[start_index]);
+				(*index)++;
+				continue;
+		}
+
+		(*index)++;
+		return reference_token(type, start_index, 1);
+	}
+}
+
+// Pieces random inputs are glued from, chosen to reach every state and its edges
+static const char *const fragments[] = {
+	"if", "else", "for", "while", "break", "continue", "len",
+	"iff", "els", "lenx", "_", "_a9", "x", "E", "e1", "whilee", "continue_",
+	"0", "7", "123", "1.", "1.5", "1.5.3", ".5", "1e", "1e5", "2E-3", "3e+", "4e-x", "5.e3", "6.0e",
+	"+", "-", "*", "/", ";", "=", "==", "===", "<", "<=", ">", ">=", "!", "!=", "!==",
+	"&", "&&", "&&&", "|", "||", "(", ")", "{", "}", "[", "]", ",",
+	" ", "  ", "\t", "\n", "\r\n", "\v", "\f",
+	"@", "#", "$", "\"", "'", "\\", "~", "?", ":", "^", "%", ".", "\x7F", "\x80", "\xC3\xA9", "\xFE", "\xFF"
+};
+
+#define FRAGMENT_COUNT (sizeof(fragments) / sizeof(fragments[0]))
+
+// Fills buffer with a NUL-terminated random input of at most size - 1 bytes
+static void random_input(char *buffer, size_t size) {
+	size_t length = 0, target = next_random() % (size - 1);
+
+	while (length < target) {
+		uint32_t pick = next_random() % 16;
+		const char *piece;
+		char run[96];
+
+		if (pick == 0) {
+			// Long runs cross the vector scanners' block boundaries
+			size_t n = 1 + next_random() % (sizeof(run) - 1);
+			const char *alphabet = (next_random() & 1) ? "0123456789" : (next_random() & 1) ? " \t\n" : "abz_AZ09e";
+			size_t alphabet_length = strlen(alphabet);
+			for (size_t i = 0; i < n; i++) run[i] = alphabet[next_random() % alphabet_length];
+			run[n] = '\0';
+			piece = run;
+		} else if (pick == 1) {
+			run[0] = (char)(1 + next_random() % 255);
+			run[1] = '\0';
+			piece = run;
+		} else {
+			piece = fragments[next_random() % FRAGMENT_COUNT];
+		}
+
+		size_t piece_length = strlen(piece);
+		if (length + piece_length > target) break;
+		memcpy(buffer + length, piece, piece_length);
+		length += piece_length;
+	}
+	buffer[length] = '\0';
+}
+
+static void print_escaped(const char *text) {
+	for (const unsigned char *p = (const unsigned char *)text; *p; p++) {
+		if (*p >= 0x20 && *p < 0x7F && *p != '\\') putchar(*p);
+		else printf("\\x%02X", *p);
+	}
+	putchar('\n');
+}
+
+// Lexes source to the end with next, recording the tokens and the diagnostics
+static size_t lex_all(token_t (*next)(const char *, size_t *), const char *source, token_t *tokens, size_t capacity, diag_buffer *messages, size_t *index) {
+	size_t count = 0;
+	*index = 0;
+
+	diag_buffer *previous = diag_capture(messages);
+	while (count < capacity) {
+		token_t token = next(source, index);
+		tokens[count++] = token;
+		if (token.type == TOKEN_END_OF_FILE) break;
+	}
+	diag_capture(previous);
+	return count;
+}
+
+static int check_lexer(uint32_t inputs) {
+	enum { INPUT_SIZE = 512 };
+	static char source[INPUT_SIZE];
+	static token_t expected[INPUT_SIZE + 1], actual[INPUT_SIZE + 1];
+
+	for (uint32_t n = 0; n < inputs; n++) {
+		random_input(source, sizeof(source));
+
+		diag_buffer expected_messages = { 0 }, actual_messages = { 0 };
+		size_t expected_index, actual_index;
+		size_t expected_count = lex_all(reference_next_token, source, expected, INPUT_SIZE + 1, &expected_messages, &expected_index);
+		size_t actual_count = lex_all(get_next_token, source, actual, INPUT_SIZE + 1, &actual_messages, &actual_index);
+
+		int same = expected_count == actual_count && expected_index == actual_index
+			&& expected_messages.length == actual_messages.length
+			&& (!expected_messages.length || memcmp(expected_messages.text, actual_messages.text, expected_messages.length) == 0);
+		for (size_t i = 0; same && i < expected_count; i++) {
+			same = expected[i].type == actual[i].type && expected[i].start == actual[i].start && expected[i].length == actual[i].length;
+		}
+
+		if (!same) {
+			printf("lexer: mismatch on input %u: ", n);
+			print_escaped(source);
+			size_t count = expected_count > actual_count ? expected_count : actual_count;
+			for (size_t i = 0; i < count; i++) {
+				if (i < expected_count) printf("  reference %-14s %zu+%zu", token_type_name(expected[i].type), expected[i].start, expected[i].length);
+				if (i < actual_count) printf("  | lexer %-14s %zu+%zu", token_type_name(actual[i].type), actual[i].start, actual[i].length);
+				putchar('\n');
+			}
+			printf("  index %zu | %zu\n", expected_index, actual_index);
+			diag_buffer_free(&expected_messages);
+			diag_buffer_free(&actual_messages);
+			return 0;
+		}
+		diag_buffer_free(&expected_messages);
+		diag_buffer_free(&actual_messages);
+	}
+
+	printf("lexer: %u inputs match the reference\n", inputs);
+	return 1;
+}
+
+#ifdef SCAN_X86
+
+typedef struct {
+	const char *name;
+	scan_fn scalar, sse2, avx2;
+	const char *alphabet;	// Mostly in the run, with a few bytes that end it
+} scan_case;
+
+static int check_kernel(const char *name, const char *isa, scan_fn kernel, scan_fn scalar, const char *block, size_t length) {
+	for (size_t offset = 0; offset <= length; offset++) {
+		const char *expected = scalar(block + offset), *actual = kernel(block + offset);
+		if (expected != actual) {
+			printf("scan: %s %s stops at %td, scalar at %td, from offset %zu of: ", name, isa, actual - block, expected - block, offset);
+			print_escaped(block);
+			return 0;
+		}
+	}
+	return 1;
+}
+
+static int check_line_starts(const char *isa, line_starts_fn kernel, const char *block, size_t length) {
+	size_t expected[256], actual[256];
+	for (size_t offset = 0; offset <= length; offset++) {
+		for (size_t span = 0; offset + span <= length; span += 1 + span / 4) {
+			size_t expected_count = scan_line_starts_scalar(block + offset, span, expected);
+			size_t actual_count = kernel(block + offset, span, actual);
+			if (expected_count != actual_count || memcmp(expected, actual, expected_count * sizeof(size_t)) != 0) {
+				printf("scan: line starts %s differ on [%zu, %zu)\n", isa, offset, offset + span);
+				return 0;
+			}
+		}
+	}
+	return 1;
+}
+
+static int check_scanners(uint32_t buffers) {
+	static const scan_case cases[] = {
+		{ "whitespace", scan_whitespace_scalar, scan_whitespace_sse2, scan_whitespace_avx2, " \t\n\v\f\r   \t\t\n\n\x08\x0E\x1F!a" },
+		{ "identifier", scan_identifier_scalar, scan_identifier_sse2, scan_identifier_avx2, "azAZ09_mqMQ5_xyzXYZ@[`{/:\xC0\xE1 " },
+		{ "digits", scan_digits_scalar, scan_digits_sse2, scan_digits_avx2, "0123456789012345678901234/:a\xB0 " }
+	};
+	int sse2 = __builtin_cpu_supports("sse2"), avx2 = __builtin_cpu_supports("avx2");
+
+	// Aligned so every offset from a block boundary is covered; the tail leaves room for the over-read
+	static _Alignas(64) char block[256 + 64];
+	for (uint32_t n = 0; n < buffers; n++) {
+		size_t length = next_random() % 256;
+
+		for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++) {
+			size_t alphabet_length = strlen(cases[c].alphabet);
+			for (size_t i = 0; i < length; i++) block[i] = cases[c].alphabet[next_random() % alphabet_length];
+			block[length] = '\0';
+
+			if (sse2 && !check_kernel(cases[c].name, "SSE2", cases[c].sse2, cases[c].scalar, block, length)) return 0;
+			if (avx2 && !check_kernel(cases[c].name, "AVX2", cases[c].avx2, cases[c].scalar, block, length)) return 0;
+		}
+
+		for (size_t i = 0; i < length; i++) block[i] = (next_random() % 4) ? 'a' : '\n';
+		if (sse2 && !check_line_starts("SSE2", scan_line_starts_sse2, block, length)) return 0;
+		if (avx2 && !check_line_starts("AVX2", scan_line_starts_avx2, block, length)) return 0;
+	}
+
+	printf("scan: %u buffers match the scalar kernels (%s)\n", buffers, avx2 ? "SSE2, AVX2" : sse2 ? "SSE2" : "none available");
+	return 1;
+}
+
+#else
+
+static int check_scanners(uint32_t buffers) {
+	(void)buffers;
+	printf("scan: no vector kernels on this target\n");
+	return 1;
+}
+
+#endif
+
+int main(int argc, char **argv) {
+	uint32_t inputs = 50000;
+
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+			rng_state = strtoull(argv[++i], NULL, 0) | 1;
+		} else if (strcmp(argv[i], "--inputs") == 0 && i + 1 < argc) {
+			inputs = (uint32_t)strtoul(argv[++i], NULL, 0);
+		} else {
+			fprintf(stderr, "Usage: %s [--seed n] [--inputs n]\n", argv[0]);
+			return 2;
+		}
+	}
+
+	if (!check_lexer(inputs)) return 1;
+	if (!check_scanners(inputs / 50 + 1)) return 1;
+	return 0;
+}
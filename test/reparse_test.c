@@ -0,0 +1,343 @@
+/*
+ *
+ *		reparse_test.c
+ *		LUMEN LANGUAGE PROJECT
+ *		Rainy101112 - 2025/7/20
+ *
+ */
+
+/*
+ * Incremental reparse check, run by `make test`. Generates nested
+ * programs, then applies rounds of random edits: each round replaces up to
+ * three sorted, disjoint byte ranges with statements, tokens, stray braces
+ * or nothing (most rounds keep the program well formed, and a program left
+ * broken is often dropped), and hands the tree to reparse. The result, spans included,
+ * must equal a fresh parse of the new source; the next round edits that
+ * result. Programs alternate between heap trees and arena trees. Exits 1
+ * after printing the first mismatch.
+ *
+ * Usage: reparse_test [--seed n] [--programs n] [--rounds n]
+ */
+
+#include <arena.h>
+#include <ast.h>
+#include <ctype.h>
+#include <diag.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <symbol.h>
+#include <visit.h>
+
+static uint64_t rng_state = 0xD1B54A32D192ED03u;
+
+static uint32_t next_random(void) {
+	rng_state ^= rng_state << 13;
+	rng_state ^= rng_state >> 7;
+	rng_state ^= rng_state << 17;
+	return (uint32_t)(rng_state >> 16);
+}
+
+typedef struct {
+	char *text;
+	size_t length;
+	size_t capacity;
+} text_buffer;
+
+static void append_bytes(text_buffer *buffer, const char *bytes, size_t length) {
+	if (buffer->length + length + 1 > buffer->capacity) {
+		size_t capacity = buffer->capacity ? buffer->capacity : 1024;
+		while (capacity < buffer->length + length + 1) capacity *= 2;
+		char *text = realloc(buffer->text, capacity);
+		if (!text) {
+			fprintf(stderr, "Memory allocate failed at %s:%d", __FILE__, __LINE__);
+			exit(1);
+		}
+		buffer->text = text;
+		buffer->capacity = capacity;
+	}
+	memcpy(buffer->text + buffer->length, bytes, length);
+	buffer->length += length;
+	buffer->text[buffer->length] = '\0';
+}
+
+static void append(text_buffer *buffer, const char *format, ...) {
+	char piece[256];
+	va_list args;
+	va_start(args, format);
+	int length = vsnprintf(piece, sizeof(piece), format, args);
+	va_end(args);
+	append_bytes(buffer, piece, (size_t)length < sizeof(piece) ? (size_t)length : sizeof(piece) - 1);
+}
+
+static const char *const names[] = { "a", "b", "x", "total", "i", "j", "_t1" };
+static const char *const operators[] = { "+", "-", "*", "/", "<", ">", "<=", ">=", "==", "!=", "&&", "||" };
+
+#define PICK(array) (array[next_random() % (sizeof(array) / sizeof(array[0]))])
+
+static void space(text_buffer *out) {
+	static const char *const spaces[] = { " ", " ", " ", "", "\n", "\n\t", "  " };
+	append(out, "%s", PICK(spaces));
+}
+
+static void expression(text_buffer *out, int depth) {
+	uint32_t pick = next_random() % 12;
+	if (depth > 2 || pick < 4) {
+		switch (next_random() % 4) {
+			case 0: append(out, "%u", next_random() % 100); break;
+			case 1: append(out, "%u.%u", next_random() % 10, next_random() % 100); break;
+			default: append(out, "%s", PICK(names)); break;
+		}
+	} else if (pick == 4) {
+		append(out, "(");
+		expression(out, depth + 1);
+		append(out, ")");
+	} else if (pick == 5) {
+		append(out, "%s", (next_random() & 1) ? "-" : "!");
+		expression(out, depth + 1);
+	} else if (pick == 6) {
+		append(out, "[");
+		expression(out, depth + 1);
+		append(out, "; %u]", next_random() % 5);
+	} else {
+		expression(out, depth + 1);
+		space(out);
+		append(out, "%s", PICK(operators));
+		space(out);
+		expression(out, depth + 1);
+	}
+}
+
+static void statement(text_buffer *out, int depth);
+
+static void block(text_buffer *out, int depth) {
+	append(out, "{");
+	space(out);
+	for (uint32_t n = next_random() % 5; n; n--) {
+		statement(out, depth + 1);
+		space(out);
+	}
+	append(out, "}");
+}
+
+static void statement(text_buffer *out, int depth) {
+	uint32_t pick = next_random() % 16;
+	if (depth < 4 && pick == 0) {
+		append(out, "if (");
+		expression(out, 0);
+		append(out, ") ");
+		block(out, depth);
+		if (next_random() & 1) {
+			append(out, " else ");
+			block(out, depth);
+		}
+	} else if (depth < 4 && pick == 1) {
+		append(out, "for (i = 0; i < %u; i = i + 1) ", next_random() % 10);
+		block(out, depth);
+	} else if (depth < 4 && pick == 2) {
+		append(out, "while (");
+		expression(out, 0);
+		append(out, ") ");
+		block(out, depth);
+	} else if (depth < 4 && pick == 3) {
+		block(out, depth);
+	} else if (pick == 4) {
+		append(out, "%s;", (next_random() & 1) ? "break" : "continue");
+	} else {
+		append(out, "%s = ", PICK(names));
+		expression(out, 0);
+		append(out, ";");
+	}
+}
+
+// Replacement text for one edit: often a whole statement, sometimes a fragment that breaks the syntax
+static void replacement(text_buffer *out) {
+	static const char *const fragments[] = {
+		"", "", "", " ", "\n", ";", "{", "}", "(", ")", "[", "]", ",", "=", "+", "*",
+		"if", "else", "x", "42", "3.5", "1e3", "len(", "a[0]", ") {", "} else {", "@"
+	};
+	switch (next_random() % 4) {
+		case 0:
+			statement(out, 2);
+			break;
+		case 1:
+			expression(out, 1);
+			break;
+		default:
+			append(out, "%s", PICK(fragments));
+			break;
+	}
+}
+
+/*
+ * Moves *start to the next number literal, which becomes the range to
+ * replace, or to just past the next '{', where a statement is inserted. Edits like these keep the program well formed, so reparse
+ * gets to splice instead of falling back to a full parse.
+ */
+static int find_edit_site(const char *source, size_t *start, size_t *old_length) {
+	for (size_t at = *start; source[at]; at++) {
+		if (source[at] == '{') {
+			*start = at + 1;
+			*old_length = 0;
+			return 1;
+		}
+		if (isdigit((unsigned char)source[at]) && (at == 0 || !isalnum((unsigned char)source[at - 1]))) {
+			size_t end = at;
+			while (isdigit((unsigned char)source[end]) || source[end] == '.') end++;
+			*start = at;
+			*old_length = end - at;
+			return 1;
+		}
+	}
+	return 0;
+}
+
+static int same_tree(const ast_node *expected, const ast_node *actual) {
+	if (!expected || !actual) return expected == actual;
+	if (expected->type != actual->type || expected->start != actual->start || expected->end != actual->end) return 0;
+
+	switch (expected->type) {
+		case AST_ASSIGNMENT:
+			if (expected->data.assign.name != actual->data.assign.name) return 0;
+			break;
+		case AST_VARIABLE:
+			if (expected->data.variable.name != actual->data.variable.name) return 0;
+			break;
+		case AST_BINARY_OP:
+			if (expected->data.binop.op != actual->data.binop.op) return 0;
+			break;
+		case AST_UNARY_OP:
+			if (expected->data.unop.op != actual->data.unop.op) return 0;
+			break;
+		case AST_LITERAL:
+			if (expected->data.literal.kind != actual->data.literal.kind
+				|| memcmp(&expected->data.literal.as, &actual->data.literal.as, sizeof(literal_payload)) != 0) return 0;
+			break;
+		case AST_ARRAY:
+			if (expected->data.array.repeat != actual->data.array.repeat) return 0;
+			break;
+		default:
+			break;
+	}
+
+	int count = ast_child_count(expected);
+	if (count != ast_child_count(actual)) return 0;
+	for (int i = 0; i < count; i++) {
+		if (!same_tree(ast_child(expected, i), ast_child(actual, i))) return 0;
+	}
+	return 1;
+}
+
+static void print_source(const char *label, const char *text) {
+	printf("%s (%zu bytes):\n%s\n", label, strlen(text), text);
+}
+
+int main(int argc, char **argv) {
+	uint32_t programs = 2000, rounds = 40;
+
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+			rng_state = strtoull(argv[++i], NULL, 0) | 1;
+		} else if (strcmp(argv[i], "--programs") == 0 && i + 1 < argc) {
+			programs = (uint32_t)strtoul(argv[++i], NULL, 0);
+		} else if (strcmp(argv[i], "--rounds") == 0 && i + 1 < argc) {
+			rounds = (uint32_t)strtoul(argv[++i], NULL, 0);
+		} else {
+			fprintf(stderr, "Usage: %s [--seed n] [--programs n] [--rounds n]\n", argv[0]);
+			return 2;
+		}
+	}
+
+	// Speculative and recovering parses report plenty; none of it matters here
+	diag_buffer ignored = { 0 };
+	diag_capture(&ignored);
+
+	text_buffer old_source = { 0 }, new_source = { 0 };
+	arena_t *arena = arena_create(0);
+	uint64_t edits_applied = 0;
+	int ok = 1;
+
+	for (uint32_t p = 0; ok && p < programs; p++) {
+		arena_t *tree_arena = (p & 1) ? arena : NULL;
+		old_source.length = 0;
+		append(&old_source, "{ ");
+		for (uint32_t n = 1 + next_random() % 12; n; n--) {
+			statement(&old_source, 0);
+			space(&old_source);
+		}
+		append(&old_source, "}");
+
+		ast_node *tree = parse(old_source.text, tree_arena);
+
+		for (uint32_t r = 0; ok && r < rounds; r++) {
+			// Up to three sorted, disjoint ranges of the old source, each replaced as a whole
+			source_edit edits[3];
+			size_t edit_count = 1 + next_random() % 3, cursor = 0;
+			int structured = next_random() % 4 != 0;
+			new_source.length = 0;
+			append_bytes(&new_source, "", 0);
+			for (size_t e = 0; e < edit_count; e++) {
+				size_t left = old_source.length - cursor;
+				size_t start = cursor + (left ? next_random() % (left + 1) : 0);
+				size_t old_length = next_random() % 4 == 0 ? next_random() % 24 : next_random() % 4;
+				if (old_length > old_source.length - start) old_length = old_source.length - start;
+				int well_formed = structured && find_edit_site(old_source.text, &start, &old_length);
+
+				append_bytes(&new_source, old_source.text + cursor, start - cursor);
+				size_t before = new_source.length;
+				if (!well_formed) replacement(&new_source);
+				else if (old_length) append(&new_source, "%u", next_random() % 1000);
+				else {
+					append(&new_source, " ");
+					statement(&new_source, 2);
+				}
+
+				edits[e] = (source_edit){ start, old_length, new_source.length - before };
+				cursor = start + old_length;
+				if (cursor == old_source.length && e + 1 < edit_count) edit_count = e + 1;
+			}
+			append_bytes(&new_source, old_source.text + cursor, old_source.length - cursor);
+			edits_applied += edit_count;
+
+			tree = reparse(tree, old_source.text, new_source.text, edits, edit_count, tree_arena);
+			uint32_t errors = ignored.error_count;
+			ast_node *fresh = parse(new_source.text, tree_arena);
+			int broken = ignored.error_count != errors;
+
+			if (!same_tree(fresh, tree)) {
+				printf("reparse: tree differs from a fresh parse (program %u, round %u, %s)\n", p, r, tree_arena ? "arena" : "heap");
+				for (size_t e = 0; e < edit_count; e++) {
+					printf("  edit at %zu: %zu bytes became %zu\n", edits[e].start, edits[e].old_length, edits[e].new_length);
+				}
+				print_source("old source", old_source.text);
+				print_source("new source", new_source.text);
+				ok = 0;
+			}
+			if (!tree_arena) free_ast(fresh);
+
+			text_buffer swap = old_source;
+			old_source = new_source;
+			new_source = swap;
+
+			// A broken program sends every later round down the full parse path, so it is kept only sometimes
+			if (broken && (next_random() & 1)) break;
+		}
+
+		if (tree_arena) arena_reset(arena);
+		else free_ast(tree);
+		ignored.length = 0;
+		ignored.warning_count = ignored.error_count = 0;
+	}
+
+	if (ok) printf("reparse: %u programs, %llu edits, every tree matches a fresh parse\n", programs, (unsigned long long)edits_applied);
+
+	diag_capture(NULL);
+	diag_buffer_free(&ignored);
+	arena_destroy(arena);
+	free(old_source.text);
+	free(new_source.text);
+	symbol_table_free();
+	return ok ? 0 : 1;
+}